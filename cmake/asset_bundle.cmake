@@ -0,0 +1,212 @@
+# Asset Bundle CMake Functions
+# Packs images and fonts into a bundle flashed to its own partition (the
+# devicetree chosen node watchy,asset-partition), read at runtime through
+# src/lib/asset_bundle.h instead of being compiled into the application.
+
+find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+# Functions run in the caller's scope, remember where the app scripts are
+set(ASSET_BUNDLE_SCRIPT_DIR "${CMAKE_CURRENT_LIST_DIR}/../script")
+
+# Add an image to the bundle, converted like lvgl_add_image(COLOR_FORMAT I1)
+# Usage:
+#   asset_bundle_add_image(
+#       IMAGE_FILE path/to/image.png
+#       [NAME custom_name]                    # lookup name, default: file name
+#       [DITHER FLOYD_STEINBERG|ORDERED|NONE]
+#       [THRESHOLD 128]
+#       [RESIZE 200x200]
+#       [COMPRESS NONE|RLE]
+#   )
+function(asset_bundle_add_image)
+    set(oneValueArgs IMAGE_FILE NAME DITHER THRESHOLD RESIZE COMPRESS)
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    if(NOT ARG_IMAGE_FILE)
+        message(FATAL_ERROR "IMAGE_FILE is required")
+    endif()
+
+    get_filename_component(IMAGE_ABS "${ARG_IMAGE_FILE}" ABSOLUTE)
+    if(NOT EXISTS "${IMAGE_ABS}")
+        message(FATAL_ERROR "Image file not found: ${IMAGE_ABS}")
+    endif()
+
+    if(ARG_NAME)
+        set(ASSET_NAME "${ARG_NAME}")
+    else()
+        get_filename_component(ASSET_NAME "${ARG_IMAGE_FILE}" NAME_WE)
+    endif()
+
+    set(OUT_DIR "${CMAKE_CURRENT_BINARY_DIR}/generated_assets")
+    set(OUTPUT_FILE "${OUT_DIR}/${ASSET_NAME}.i1")
+    set(SIZE_FILE "${OUT_DIR}/${ASSET_NAME}.size")
+    set(I1_SCRIPT "${ASSET_BUNDLE_SCRIPT_DIR}/img_to_i1.py")
+
+    set(CMD_ARGS "${I1_SCRIPT}" "${IMAGE_ABS}")
+    list(APPEND CMD_ARGS "--bin" "${OUTPUT_FILE}")
+    list(APPEND CMD_ARGS "--name" "${ASSET_NAME}")
+    list(APPEND CMD_ARGS "--size-file" "${SIZE_FILE}")
+
+    if(ARG_DITHER)
+        string(TOLOWER "${ARG_DITHER}" DITHER_MODE)
+        list(APPEND CMD_ARGS "--dither" "${DITHER_MODE}")
+    endif()
+
+    if(ARG_THRESHOLD)
+        list(APPEND CMD_ARGS "--threshold" "${ARG_THRESHOLD}")
+    endif()
+
+    if(ARG_RESIZE)
+        list(APPEND CMD_ARGS "--size" "${ARG_RESIZE}")
+    endif()
+
+    if(ARG_COMPRESS STREQUAL "RLE")
+        list(APPEND CMD_ARGS "--compress" "rle")
+    endif()
+
+    file(MAKE_DIRECTORY "${OUT_DIR}")
+
+    add_custom_command(
+        OUTPUT "${OUTPUT_FILE}" "${SIZE_FILE}"
+        COMMAND ${Python3_EXECUTABLE} ${CMD_ARGS}
+        DEPENDS "${IMAGE_ABS}" "${I1_SCRIPT}"
+        COMMENT "Converting image ${ARG_IMAGE_FILE} for the asset bundle"
+        VERBATIM
+    )
+
+    # Bundled images show up in lvgl_add_image_report() too
+    set_property(GLOBAL APPEND PROPERTY LVGL_IMAGE_SIZE_FILES "${SIZE_FILE}")
+    set_property(GLOBAL APPEND PROPERTY ASSET_BUNDLE_ARGS "--image" "${ASSET_NAME}=${OUTPUT_FILE}")
+    set_property(GLOBAL APPEND PROPERTY ASSET_BUNDLE_DEPENDS "${OUTPUT_FILE}")
+endfunction()
+
+# Add a font to the bundle, rasterized by lv_font_conv
+# Usage:
+#   asset_bundle_add_font(
+#       FONT_FILE path/to/font.ttf
+#       SIZE 14
+#       [NAME custom_name]                    # lookup name, default: <file>_<size>
+#       [BPP 1]
+#       [RANGE 0x20-0x7F]
+#       [SYMBOLS "abc"]
+#   )
+function(asset_bundle_add_font)
+    set(oneValueArgs FONT_FILE SIZE NAME BPP RANGE SYMBOLS)
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    if(NOT ARG_FONT_FILE OR NOT ARG_SIZE)
+        message(FATAL_ERROR "FONT_FILE and SIZE are required")
+    endif()
+
+    get_filename_component(FONT_ABS "${ARG_FONT_FILE}" ABSOLUTE)
+    if(NOT EXISTS "${FONT_ABS}")
+        message(FATAL_ERROR "Font file not found: ${FONT_ABS}")
+    endif()
+
+    if(ARG_NAME)
+        set(ASSET_NAME "${ARG_NAME}")
+    else()
+        get_filename_component(FONT_NAME "${ARG_FONT_FILE}" NAME_WE)
+        string(TOLOWER "${FONT_NAME}" FONT_NAME)
+        string(REPLACE "-" "_" FONT_NAME "${FONT_NAME}")
+        set(ASSET_NAME "${FONT_NAME}_${ARG_SIZE}")
+    endif()
+
+    find_program(LV_FONT_CONV lv_font_conv)
+    if(NOT LV_FONT_CONV)
+        message(FATAL_ERROR "lv_font_conv not found. Install it with: npm install -g lv_font_conv")
+    endif()
+
+    set(OUT_DIR "${CMAKE_CURRENT_BINARY_DIR}/generated_assets")
+    set(OUTPUT_FILE "${OUT_DIR}/${ASSET_NAME}.fnt")
+
+    # Uncompressed bitmaps, so LVGL can draw glyphs straight from flash
+    set(CMD_ARGS "--font" "${FONT_ABS}" "--size" "${ARG_SIZE}" "--format" "bin" "--no-compress")
+
+    if(ARG_BPP)
+        list(APPEND CMD_ARGS "--bpp" "${ARG_BPP}")
+    else()
+        list(APPEND CMD_ARGS "--bpp" "1")
+    endif()
+
+    if(ARG_RANGE)
+        list(APPEND CMD_ARGS "--range" "${ARG_RANGE}")
+    elseif(NOT ARG_SYMBOLS)
+        list(APPEND CMD_ARGS "--range" "0x20-0x7F")
+    endif()
+
+    if(ARG_SYMBOLS)
+        list(APPEND CMD_ARGS "--symbols" "${ARG_SYMBOLS}")
+    endif()
+
+    list(APPEND CMD_ARGS "--output" "${OUTPUT_FILE}")
+
+    file(MAKE_DIRECTORY "${OUT_DIR}")
+
+    add_custom_command(
+        OUTPUT "${OUTPUT_FILE}"
+        COMMAND ${LV_FONT_CONV} ${CMD_ARGS}
+        DEPENDS "${FONT_ABS}"
+        COMMENT "Converting font ${ARG_FONT_FILE} (size ${ARG_SIZE}) for the asset bundle"
+        VERBATIM
+    )
+
+    set_property(GLOBAL APPEND PROPERTY ASSET_BUNDLE_ARGS "--font" "${ASSET_NAME}=${OUTPUT_FILE}")
+    set_property(GLOBAL APPEND PROPERTY ASSET_BUNDLE_DEPENDS "${OUTPUT_FILE}")
+endfunction()
+
+# Pack the added assets into generated_assets/assets.bin
+# Usage (after the asset_bundle_add_* calls):
+#   asset_bundle_generate()
+# The bundle is built with the application. "west build -t flash_assets"
+# writes it to the asset partition of an ESP32 board; on native_sim a flash
+# image (zephyr/flash.bin) holding it is written for the flash simulator.
+function(asset_bundle_generate)
+    get_property(BUNDLE_ARGS GLOBAL PROPERTY ASSET_BUNDLE_ARGS)
+    get_property(BUNDLE_DEPENDS GLOBAL PROPERTY ASSET_BUNDLE_DEPENDS)
+
+    dt_chosen(ASSET_PARTITION PROPERTY "watchy,asset-partition")
+    if(NOT ASSET_PARTITION)
+        message(WARNING "No watchy,asset-partition chosen node, asset bundle not generated")
+        return()
+    endif()
+
+    dt_reg_addr(PARTITION_ADDR PATH "${ASSET_PARTITION}")
+    dt_reg_size(PARTITION_SIZE PATH "${ASSET_PARTITION}")
+
+    set(PACK_SCRIPT "${ASSET_BUNDLE_SCRIPT_DIR}/pack_assets.py")
+    set(BUNDLE_FILE "${CMAKE_CURRENT_BINARY_DIR}/generated_assets/assets.bin")
+    set(PACK_ARGS "${PACK_SCRIPT}" "-o" "${BUNDLE_FILE}" "--partition-size" "${PARTITION_SIZE}")
+    set(PACK_OUTPUTS "${BUNDLE_FILE}")
+
+    # The flash simulator takes a whole flash image, with the other partitions erased
+    if(CONFIG_FLASH_SIMULATOR)
+        dt_chosen(FLASH_NODE PROPERTY "zephyr,flash")
+        dt_reg_size(FLASH_SIZE PATH "${FLASH_NODE}")
+        set(FLASH_IMAGE "${CMAKE_BINARY_DIR}/zephyr/flash.bin")
+        list(APPEND PACK_ARGS "--flash" "${FLASH_IMAGE}" "--flash-size" "${FLASH_SIZE}"
+             "--offset" "${PARTITION_ADDR}")
+        list(APPEND PACK_OUTPUTS "${FLASH_IMAGE}")
+    endif()
+
+    add_custom_command(
+        OUTPUT ${PACK_OUTPUTS}
+        COMMAND ${Python3_EXECUTABLE} ${PACK_ARGS} ${BUNDLE_ARGS}
+        DEPENDS ${BUNDLE_DEPENDS} "${PACK_SCRIPT}"
+        COMMENT "Packing asset bundle for the partition at ${PARTITION_ADDR}"
+        VERBATIM
+    )
+
+    add_custom_target(asset_bundle ALL DEPENDS ${PACK_OUTPUTS})
+
+    if(CONFIG_SOC_FAMILY_ESPRESSIF_ESP32)
+        set(ESPTOOL "${ZEPHYR_HAL_ESPRESSIF_MODULE_DIR}/tools/esptool_py/esptool.py")
+        add_custom_target(flash_assets
+            COMMAND ${Python3_EXECUTABLE} "${ESPTOOL}" --chip esp32 write_flash
+                    "${PARTITION_ADDR}" "${BUNDLE_FILE}"
+            DEPENDS asset_bundle
+            COMMENT "Writing the asset bundle to flash at ${PARTITION_ADDR}"
+            VERBATIM
+        )
+    endif()
+endfunction()
@@ -1,5 +1,11 @@
 # LVGL Font Conversion CMake Function
-# Converts font files to C source files using lv_font_conv
+# Converts font files to C source files using lv_font_conv, through
+# script/font_build.py for subsetting and 1/2bpp thresholding
+
+find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+# Functions run in the caller's scope, remember where the app scripts are
+set(LVGL_FONT_SCRIPT_DIR "${CMAKE_CURRENT_LIST_DIR}/../script")
 
 # Function to convert a font file to LVGL C source
 # Usage:
@@ -11,15 +17,24 @@
 #       [FORMAT lvgl]
 #       [RANGE 0x20-0x7F,0x00C0-0x1EF9]
 #       [SYMBOLS "symbol1,symbol2"]
+#       [THRESHOLD 128]                       # BPP 1 or 2, cut from an 8bpp render
+#       [CATALOG src/app/foo.c corpus.txt]    # only the glyphs these files use
 #       [NO_COMPRESS]
 #       [NO_PREFILTER]
 #       [LCD]
 #       [LCD_V]
 #   )
+#
+# With CATALOG the font holds the characters of the string literals of C
+# sources and of the whole text of other files, plus SYMBOLS; RANGE then
+# limits the set instead of selecting it. THRESHOLD decides which grey levels
+# survive on the 1-bit panel at build time instead of leaving it to
+# lv_font_conv (kerning is dropped). The flash footprint of each lvgl format
+# font goes to the report of lvgl_add_font_report().
 function(lvgl_add_font)
     set(options NO_COMPRESS NO_PREFILTER LCD LCD_V)
-    set(oneValueArgs FONT_FILE SIZE OUTPUT_NAME BPP FORMAT RANGE SYMBOLS)
-    set(multiValueArgs)
+    set(oneValueArgs FONT_FILE SIZE OUTPUT_NAME BPP FORMAT RANGE SYMBOLS THRESHOLD)
+    set(multiValueArgs CATALOG)
     
     cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
     
@@ -70,17 +85,15 @@ function(lvgl_add_font)
         list(APPEND CMD_ARGS "--bpp" "1")
     endif()
     
-    # Format
-    if(ARG_FORMAT)
-        list(APPEND CMD_ARGS "--format" "${ARG_FORMAT}")
-    else()
-        list(APPEND CMD_ARGS "--format" "lvgl")
+    # Format, lvgl output goes through font_build.py
+    if(NOT ARG_FORMAT)
+        set(ARG_FORMAT "lvgl")
     endif()
     
-    # Unicode range
+    # Unicode range, a filter of the catalog glyphs when there is one
     if(ARG_RANGE)
         list(APPEND CMD_ARGS "--range" "${ARG_RANGE}")
-    else()
+    elseif(NOT ARG_CATALOG)
         list(APPEND CMD_ARGS "--range" "0x20-0x7F")
     endif()
     
@@ -112,14 +125,49 @@ function(lvgl_add_font)
     # Create output directory
     file(MAKE_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}/generated_fonts")
     
-    # Add custom command to generate C source
-    add_custom_command(
-        OUTPUT "${OUTPUT_FILE}"
-        COMMAND ${LV_FONT_CONV} ${CMD_ARGS}
-        DEPENDS "${FONT_ABS}"
-        COMMENT "Converting font ${ARG_FONT_FILE} (size ${ARG_SIZE}) to LVGL C source"
-        VERBATIM
-    )
+    if(NOT ARG_FORMAT STREQUAL "lvgl")
+        if(ARG_THRESHOLD OR ARG_CATALOG)
+            message(FATAL_ERROR "THRESHOLD and CATALOG need FORMAT lvgl")
+        endif()
+
+        add_custom_command(
+            OUTPUT "${OUTPUT_FILE}"
+            COMMAND ${LV_FONT_CONV} ${CMD_ARGS} --format ${ARG_FORMAT}
+            DEPENDS "${FONT_ABS}"
+            COMMENT "Converting font ${ARG_FONT_FILE} (size ${ARG_SIZE}) to LVGL C source"
+            VERBATIM
+        )
+    else()
+        set(BUILD_SCRIPT "${LVGL_FONT_SCRIPT_DIR}/font_build.py")
+        set(SIZE_FILE "${CMAKE_CURRENT_BINARY_DIR}/generated_fonts/${OUTPUT_BASE}.fontsize")
+        list(APPEND CMD_ARGS "--name" "${OUTPUT_BASE}" "--size-file" "${SIZE_FILE}")
+        list(APPEND CMD_ARGS "--lv-font-conv" "${LV_FONT_CONV}")
+
+        if(ARG_THRESHOLD)
+            list(APPEND CMD_ARGS "--threshold" "${ARG_THRESHOLD}")
+        endif()
+
+        set(CATALOG_FILES)
+        foreach(CATALOG ${ARG_CATALOG})
+            get_filename_component(CATALOG_ABS "${CATALOG}" ABSOLUTE)
+            if(NOT EXISTS "${CATALOG_ABS}")
+                message(FATAL_ERROR "Font catalog not found: ${CATALOG_ABS}")
+            endif()
+            list(APPEND CMD_ARGS "--catalog" "${CATALOG_ABS}")
+            list(APPEND CATALOG_FILES "${CATALOG_ABS}")
+        endforeach()
+
+        add_custom_command(
+            OUTPUT "${OUTPUT_FILE}" "${SIZE_FILE}"
+            COMMAND ${Python3_EXECUTABLE} "${BUILD_SCRIPT}" ${CMD_ARGS}
+            DEPENDS "${FONT_ABS}" ${CATALOG_FILES} "${BUILD_SCRIPT}"
+                    "${LVGL_FONT_SCRIPT_DIR}/lv_font_bin.py"
+            COMMENT "Converting font ${ARG_FONT_FILE} (size ${ARG_SIZE}) to LVGL C source"
+            VERBATIM
+        )
+
+        set_property(GLOBAL APPEND PROPERTY LVGL_FONT_SIZE_FILES "${SIZE_FILE}")
+    endif()
     
     # Add generated file to parent scope sources
     set(LVGL_FONT_SOURCES ${LVGL_FONT_SOURCES} "${OUTPUT_FILE}" PARENT_SCOPE)
@@ -135,12 +183,14 @@ endfunction()
 #       [BPP 1]
 #       [FORMAT lvgl]
 #       [RANGE 0x20-0x7F]
+#       [THRESHOLD 128]
+#       [CATALOG files...]
 #       [NO_COMPRESS]
 #   )
 function(lvgl_add_fonts)
     set(options NO_COMPRESS NO_PREFILTER LCD LCD_V)
-    set(oneValueArgs SIZE BPP FORMAT RANGE SYMBOLS)
-    set(multiValueArgs FONTS)
+    set(oneValueArgs SIZE BPP FORMAT RANGE SYMBOLS THRESHOLD)
+    set(multiValueArgs FONTS CATALOG)
     
     cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
     
@@ -171,6 +221,14 @@ function(lvgl_add_fonts)
             list(APPEND CALL_ARGS SYMBOLS ${ARG_SYMBOLS})
         endif()
         
+        if(ARG_THRESHOLD)
+            list(APPEND CALL_ARGS THRESHOLD ${ARG_THRESHOLD})
+        endif()
+        
+        if(ARG_CATALOG)
+            list(APPEND CALL_ARGS CATALOG ${ARG_CATALOG})
+        endif()
+        
         if(ARG_NO_COMPRESS)
             list(APPEND CALL_ARGS NO_COMPRESS)
         endif()
@@ -193,3 +251,90 @@ function(lvgl_add_fonts)
     # Propagate sources to parent scope
     set(LVGL_FONT_SOURCES ${LVGL_FONT_SOURCES} PARENT_SCOPE)
 endfunction()
+
+# Function to report the flash used by the fonts added so far
+# Usage (after the lvgl_add_font calls):
+#   lvgl_add_font_report()
+# Prints the table when the fonts change and writes it to
+# generated_fonts/font_sizes.txt in the build directory.
+function(lvgl_add_font_report)
+    get_property(SIZE_FILES GLOBAL PROPERTY LVGL_FONT_SIZE_FILES)
+
+    if(NOT SIZE_FILES)
+        return()
+    endif()
+
+    set(REPORT_SCRIPT "${LVGL_FONT_SCRIPT_DIR}/font_size_report.py")
+    set(REPORT_FILE "${CMAKE_CURRENT_BINARY_DIR}/generated_fonts/font_sizes.txt")
+
+    add_custom_command(
+        OUTPUT "${REPORT_FILE}"
+        COMMAND ${Python3_EXECUTABLE} "${REPORT_SCRIPT}" ${SIZE_FILES} -o "${REPORT_FILE}"
+        DEPENDS ${SIZE_FILES} "${REPORT_SCRIPT}"
+        COMMENT "Font flash usage (as built vs 1/2/4bpp)"
+        VERBATIM
+    )
+
+    add_custom_target(lvgl_font_report ALL DEPENDS "${REPORT_FILE}")
+endfunction()
+
+# Function to pre-render the seven-segment sprites of src/display/seg_digits.h
+# Usage:
+#   lvgl_add_digit_sprites(
+#       FONT_FILE fonts/seven_segments.ttf
+#       SIZE 64
+#       [THRESHOLD 128]
+#       [OUTPUT_NAME custom_name]            # default <font>_<size>_sprites
+#   )
+#
+# '0'-'9' and ':' are rendered with lv_font_conv, thresholded to 1bpp and
+# written as a struct digit_sprite_set named OUTPUT_NAME, added to
+# LVGL_FONT_SOURCES.
+function(lvgl_add_digit_sprites)
+    set(oneValueArgs FONT_FILE SIZE THRESHOLD OUTPUT_NAME)
+    cmake_parse_arguments(ARG "" "${oneValueArgs}" "" ${ARGN})
+
+    if(NOT ARG_FONT_FILE OR NOT ARG_SIZE)
+        message(FATAL_ERROR "FONT_FILE and SIZE are required")
+    endif()
+
+    get_filename_component(FONT_ABS "${ARG_FONT_FILE}" ABSOLUTE)
+    if(NOT EXISTS "${FONT_ABS}")
+        message(FATAL_ERROR "Font file not found: ${FONT_ABS}")
+    endif()
+
+    if(NOT ARG_OUTPUT_NAME)
+        get_filename_component(FONT_NAME "${ARG_FONT_FILE}" NAME_WE)
+        string(TOLOWER "${FONT_NAME}" FONT_NAME_LOWER)
+        string(MAKE_C_IDENTIFIER "${FONT_NAME_LOWER}" FONT_NAME_LOWER)
+        set(ARG_OUTPUT_NAME "${FONT_NAME_LOWER}_${ARG_SIZE}_sprites")
+    endif()
+
+    if(NOT ARG_THRESHOLD)
+        set(ARG_THRESHOLD 128)
+    endif()
+
+    find_program(LV_FONT_CONV lv_font_conv)
+    if(NOT LV_FONT_CONV)
+        message(FATAL_ERROR "lv_font_conv not found. Install it with: npm install -g lv_font_conv")
+    endif()
+
+    set(SPRITE_SCRIPT "${LVGL_FONT_SCRIPT_DIR}/digit_sprites.py")
+    set(OUTPUT_FILE "${CMAKE_CURRENT_BINARY_DIR}/generated_fonts/${ARG_OUTPUT_NAME}.c")
+    file(MAKE_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}/generated_fonts")
+
+    add_custom_command(
+        OUTPUT "${OUTPUT_FILE}"
+        COMMAND ${Python3_EXECUTABLE} "${SPRITE_SCRIPT}" --lv-font-conv ${LV_FONT_CONV}
+                --font "${FONT_ABS}" --size ${ARG_SIZE} --threshold ${ARG_THRESHOLD}
+                --name ${ARG_OUTPUT_NAME} --output "${OUTPUT_FILE}"
+        DEPENDS "${FONT_ABS}" "${SPRITE_SCRIPT}" "${LVGL_FONT_SCRIPT_DIR}/font_build.py"
+                "${LVGL_FONT_SCRIPT_DIR}/lv_font_bin.py"
+        COMMENT "Rendering digit sprites of ${ARG_FONT_FILE} (size ${ARG_SIZE})"
+        VERBATIM
+    )
+
+    set(LVGL_FONT_SOURCES ${LVGL_FONT_SOURCES} "${OUTPUT_FILE}" PARENT_SCOPE)
+
+    message(STATUS "Digit sprites: ${ARG_FONT_FILE} (size ${ARG_SIZE}) -> ${OUTPUT_FILE}")
+endfunction()
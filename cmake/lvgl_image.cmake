@@ -1,21 +1,32 @@
 # LVGL Image Conversion CMake Function
-# Converts image files to C source files using LVGL's LVGLImage.py script
+# Converts image files to C source files using LVGL's LVGLImage.py script,
+# or script/img_to_i1.py for native 1bpp (I1) output
 
 find_package(Python3 REQUIRED COMPONENTS Interpreter)
 
+# Functions run in the caller's scope, remember where the app scripts are
+set(LVGL_IMAGE_SCRIPT_DIR "${CMAKE_CURRENT_LIST_DIR}/../script")
+
 # Function to convert an image file to LVGL C source
 # Usage:
 #   lvgl_add_image(
 #       IMAGE_FILE path/to/image.png
 #       [OUTPUT_NAME custom_name]
-#       [COLOR_FORMAT RGB565]
-#       [COMPRESS NONE|RLE|LZ4]
+#       [COLOR_FORMAT RGB565|I1]
+#       [COMPRESS NONE|RLE|LZ4]              # I1: NONE or RLE (src/display/img_rle.h)
 #       [PREMULTIPLY]
 #       [RGB565_DITHER]
+#       [DITHER FLOYD_STEINBERG|ORDERED|NONE]  # I1 only, default FLOYD_STEINBERG
+#       [THRESHOLD 128]                       # I1 only
+#       [RESIZE 200x200]                      # I1 only, resize to the panel
 #   )
+#
+# I1 images are dithered at build time into the layout of the display
+# framebuffer (index 1 = white) and their size is added to the report of
+# lvgl_add_image_report().
 function(lvgl_add_image)
     set(options PREMULTIPLY RGB565_DITHER)
-    set(oneValueArgs IMAGE_FILE OUTPUT_NAME COLOR_FORMAT COMPRESS)
+    set(oneValueArgs IMAGE_FILE OUTPUT_NAME COLOR_FORMAT COMPRESS DITHER THRESHOLD RESIZE)
     set(multiValueArgs)
     
     cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
@@ -43,6 +54,52 @@ function(lvgl_add_image)
     # Output C file in build directory
     set(OUTPUT_FILE "${CMAKE_CURRENT_BINARY_DIR}/generated_images/${OUTPUT_BASE}.c")
     
+    # Native 1bpp output: dithered and resized by our own converter
+    if(ARG_COLOR_FORMAT STREQUAL "I1")
+        set(I1_SCRIPT "${LVGL_IMAGE_SCRIPT_DIR}/img_to_i1.py")
+        set(SIZE_FILE "${CMAKE_CURRENT_BINARY_DIR}/generated_images/${OUTPUT_BASE}.size")
+
+        set(CMD_ARGS "${I1_SCRIPT}" "${IMAGE_ABS}")
+        list(APPEND CMD_ARGS "-o" "${OUTPUT_FILE}")
+        list(APPEND CMD_ARGS "--name" "${OUTPUT_BASE}")
+        list(APPEND CMD_ARGS "--size-file" "${SIZE_FILE}")
+
+        if(ARG_DITHER)
+            string(TOLOWER "${ARG_DITHER}" DITHER_MODE)
+            list(APPEND CMD_ARGS "--dither" "${DITHER_MODE}")
+        endif()
+
+        if(ARG_THRESHOLD)
+            list(APPEND CMD_ARGS "--threshold" "${ARG_THRESHOLD}")
+        endif()
+
+        if(ARG_RESIZE)
+            list(APPEND CMD_ARGS "--size" "${ARG_RESIZE}")
+        endif()
+
+        if(ARG_COMPRESS STREQUAL "RLE")
+            list(APPEND CMD_ARGS "--compress" "rle")
+        elseif(ARG_COMPRESS AND NOT ARG_COMPRESS STREQUAL "NONE")
+            message(FATAL_ERROR "lvgl_add_image: I1 images support COMPRESS NONE or RLE")
+        endif()
+
+        file(MAKE_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}/generated_images")
+
+        add_custom_command(
+            OUTPUT "${OUTPUT_FILE}" "${SIZE_FILE}"
+            COMMAND ${Python3_EXECUTABLE} ${CMD_ARGS}
+            DEPENDS "${IMAGE_ABS}" "${I1_SCRIPT}"
+            COMMENT "Converting image ${ARG_IMAGE_FILE} to dithered LVGL I1 source"
+            VERBATIM
+        )
+
+        set_property(GLOBAL APPEND PROPERTY LVGL_IMAGE_SIZE_FILES "${SIZE_FILE}")
+        set(LVGL_IMAGE_SOURCES ${LVGL_IMAGE_SOURCES} "${OUTPUT_FILE}" PARENT_SCOPE)
+
+        message(STATUS "LVGL Image (I1): ${ARG_IMAGE_FILE} -> ${OUTPUT_FILE}")
+        return()
+    endif()
+
     # Path to LVGLImage.py script
     set(LVGL_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/../modules/lib/gui/lvgl/scripts/LVGLImage.py")
     
@@ -108,14 +165,17 @@ endfunction()
 # Usage:
 #   lvgl_add_images(
 #       IMAGES image1.png image2.png image3.png
-#       [COLOR_FORMAT RGB565]
-#       [COMPRESS NONE]
+#       [COLOR_FORMAT RGB565|I1]
+#       [COMPRESS NONE|RLE]
 #       [PREMULTIPLY]
 #       [RGB565_DITHER]
+#       [DITHER FLOYD_STEINBERG|ORDERED|NONE]
+#       [THRESHOLD 128]
+#       [RESIZE 200x200]
 #   )
 function(lvgl_add_images)
     set(options PREMULTIPLY RGB565_DITHER)
-    set(oneValueArgs COLOR_FORMAT COMPRESS)
+    set(oneValueArgs COLOR_FORMAT COMPRESS DITHER THRESHOLD RESIZE)
     set(multiValueArgs IMAGES)
     
     cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
@@ -143,9 +203,42 @@ function(lvgl_add_images)
             list(APPEND CALL_ARGS RGB565_DITHER)
         endif()
         
+        foreach(I1_ARG DITHER THRESHOLD RESIZE)
+            if(ARG_${I1_ARG})
+                list(APPEND CALL_ARGS ${I1_ARG} ${ARG_${I1_ARG}})
+            endif()
+        endforeach()
+        
         lvgl_add_image(${CALL_ARGS})
     endforeach()
     
     # Propagate sources to parent scope
     set(LVGL_IMAGE_SOURCES ${LVGL_IMAGE_SOURCES} PARENT_SCOPE)
 endfunction()
+
+# Flash usage report of the I1 images, against their RGB565 conversion and
+# after compression
+# Usage (after the lvgl_add_image calls):
+#   lvgl_add_image_report()
+# Prints the table when the images change and writes it to
+# generated_images/image_sizes.txt in the build directory.
+function(lvgl_add_image_report)
+    get_property(SIZE_FILES GLOBAL PROPERTY LVGL_IMAGE_SIZE_FILES)
+
+    if(NOT SIZE_FILES)
+        return()
+    endif()
+
+    set(REPORT_SCRIPT "${LVGL_IMAGE_SCRIPT_DIR}/img_size_report.py")
+    set(REPORT_FILE "${CMAKE_CURRENT_BINARY_DIR}/generated_images/image_sizes.txt")
+
+    add_custom_command(
+        OUTPUT "${REPORT_FILE}"
+        COMMAND ${Python3_EXECUTABLE} "${REPORT_SCRIPT}" ${SIZE_FILES} -o "${REPORT_FILE}"
+        DEPENDS ${SIZE_FILES} "${REPORT_SCRIPT}"
+        COMMENT "Image flash usage (RGB565 source vs I1)"
+        VERBATIM
+    )
+
+    add_custom_target(lvgl_image_report ALL DEPENDS "${REPORT_FILE}")
+endfunction()
@@ -0,0 +1,47 @@
+# Timezone Table Generation CMake Function
+# Converts a list of POSIX TZ rules to a compact C table using gen_tz_table.py
+
+find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+# Functions run in the caller's scope, remember where the app scripts are
+set(TZ_TABLE_SCRIPT_DIR "${CMAKE_CURRENT_LIST_DIR}/../script")
+
+# Function to generate the timezone rule table
+# Usage:
+#   tz_add_table(
+#       ZONES_FILE path/to/tz_zones.txt
+#   )
+function(tz_add_table)
+    set(options)
+    set(oneValueArgs ZONES_FILE)
+    set(multiValueArgs)
+
+    cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+    if(NOT ARG_ZONES_FILE)
+        message(FATAL_ERROR "ZONES_FILE is required")
+    endif()
+
+    get_filename_component(ZONES_ABS "${ARG_ZONES_FILE}" ABSOLUTE)
+
+    if(NOT EXISTS "${ZONES_ABS}")
+        message(FATAL_ERROR "Zones file not found: ${ZONES_ABS}")
+    endif()
+
+    set(TZ_SCRIPT "${TZ_TABLE_SCRIPT_DIR}/gen_tz_table.py")
+    set(OUTPUT_FILE "${CMAKE_CURRENT_BINARY_DIR}/generated_tz/tz_table.c")
+
+    file(MAKE_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}/generated_tz")
+
+    add_custom_command(
+        OUTPUT "${OUTPUT_FILE}"
+        COMMAND ${Python3_EXECUTABLE} "${TZ_SCRIPT}" "${ZONES_ABS}" -o "${OUTPUT_FILE}"
+        DEPENDS "${ZONES_ABS}" "${TZ_SCRIPT}"
+        COMMENT "Generating timezone table from ${ARG_ZONES_FILE}"
+        VERBATIM
+    )
+
+    set(TZ_TABLE_SOURCES ${TZ_TABLE_SOURCES} "${OUTPUT_FILE}" PARENT_SCOPE)
+
+    message(STATUS "Timezone table: ${ARG_ZONES_FILE} -> ${OUTPUT_FILE}")
+endfunction()
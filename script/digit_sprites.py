@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""
+Seven-segment digit sprites
+
+Renders '0'-'9' and ':' of a font with lv_font_conv, thresholds them to
+1 bpp like font_build.py and writes them as a struct digit_sprite_set
+(src/display/seg_digits.h): each character cropped to its ink, with byte
+aligned rows and its position in a fixed cell, ready to be copied into the
+framebuffer. Cells are as high as the font's line and as wide as the
+widest digit (or the colon's advance).
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+import font_build
+import lv_font_bin
+
+CHARS = "0123456789:"
+
+
+def sprite_rows(glyph, left, top, width, height):
+    """Rows of the (left, top, width, height) window of a 1 bpp glyph, padded to whole bytes"""
+    pixels = lv_font_bin.glyph_pixels(glyph, 1)
+    stride = (width + 7) // 8
+    rows = []
+    for y in range(top, top + height):
+        row = pixels[y * glyph.box_w + left:y * glyph.box_w + left + width]
+        rows.append(lv_font_bin.pack_pixels(row + [0] * (stride * 8 - width), 1))
+    return stride, rows
+
+
+def build_sprites(font, name):
+    """Sprites of CHARS as (char, x, y, w, h, stride, rows), and the cell widths"""
+    codepoints = font.codepoints()
+    missing = [c for c in CHARS if ord(c) not in codepoints]
+    if missing:
+        raise ValueError(f"the font has no glyph for {''.join(missing)!r}")
+
+    glyphs = {c: font.glyphs[codepoints[ord(c)]] for c in CHARS}
+    # LVGL rounds the 1/16 px advance the same way
+    advance = {c: (g.adv_w + 8) >> 4 for c, g in glyphs.items()}
+    digit_w = max(advance[c] for c in CHARS if c != ":")
+    colon_w = advance[":"]
+
+    sprites = []
+    for c, g in glyphs.items():
+        x = g.ofs_x + ((digit_w - advance[c]) // 2 if c != ":" else 0)
+        # Same vertical placement as a label line: ofs_y is from the base line
+        y = font.line_height - font.base_line - g.box_h - g.ofs_y
+        cell_w = colon_w if c == ":" else digit_w
+        # Only the cell is redrawn when the character changes: ink outside it is cut
+        left, top = max(0, -x), max(0, -y)
+        w = max(0, min(g.box_w, cell_w - x) - left)
+        h = max(0, min(g.box_h, font.line_height - y) - top)
+        if (w, h) != (g.box_w, g.box_h):
+            print(f"{name}: glyph {c!r} cut to its {cell_w}x{font.line_height} cell",
+                  file=sys.stderr)
+        if w == 0 or h == 0:
+            sprites.append((c, 0, 0, 0, 0, 0, []))
+            continue
+        stride, rows = sprite_rows(g, left, top, w, h)
+        sprites.append((c, x + left, y + top, w, h, stride, rows))
+    return sprites, digit_w, colon_w
+
+
+def write_c(font, sprites, digit_w, colon_w, name, args, path):
+    out = [
+        "/*",
+        f" * Seven-segment sprites of {os.path.basename(args.font)}, {args.size} px, threshold "
+        f"{args.threshold}",
+        " * Generated by script/digit_sprites.py, do not edit",
+        " */",
+        "",
+        '#include "display/seg_digits.h"',
+        "",
+        f"static const uint8_t {name}_bits[] = {{",
+    ]
+    offsets = []
+    offset = 0
+    for c, x, y, w, h, stride, rows in sprites:
+        offsets.append(offset)
+        out.append(f"    /* '{c}' {w}x{h} */")
+        data = b"".join(rows)
+        if data:
+            out.append(font_build.c_array(data, per_line=max(stride, 8)))
+        offset += len(data)
+    out += [
+        "};",
+        "",
+        f"const struct digit_sprite_set {name} = {{",
+        f"    .height = {font.line_height},",
+        f"    .digit_w = {digit_w},",
+        f"    .colon_w = {colon_w},",
+        "    .sprites = {",
+    ]
+    for (c, x, y, w, h, stride, rows), ofs in zip(sprites, offsets):
+        out.append(f"        {{.x = {x}, .y = {y}, .w = {w}, .h = {h}, .stride = {stride}, "
+                   f".bits = &{name}_bits[{ofs}]}}, /* '{c}' */")
+    out += ["    },", "};", ""]
+
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(out))
+    return offset
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pre-render seven-segment digit sprites")
+    parser.add_argument("--lv-font-conv", default="lv_font_conv", help="lv_font_conv executable")
+    parser.add_argument("--font", required=True, help="TTF/WOFF source")
+    parser.add_argument("--size", type=int, required=True, help="Font size in px")
+    parser.add_argument("--threshold", type=int, default=128,
+                        help="8 bpp level from which a pixel is ink")
+    parser.add_argument("--name", required=True, help="C symbol of the sprite set")
+    parser.add_argument("-o", "--output", required=True, help="Output C file")
+    args = parser.parse_args()
+
+    if not 1 <= args.threshold <= 255:
+        parser.error("--threshold must be 1-255")
+    if args.size > 255:
+        parser.error("--size must fit the 8-bit cell height")
+
+    try:
+        grey = font_build.render_bin(args, ["--symbols", CHARS], 8, kerning=False)
+        font = font_build.reduce_font(grey, 1, args.threshold)
+        sprites, digit_w, colon_w = build_sprites(font, args.name)
+        size = write_c(font, sprites, digit_w, colon_w, args.name, args, args.output)
+    except (ValueError, OSError, subprocess.CalledProcessError) as e:
+        print(f"{args.name}: {e}", file=sys.stderr)
+        return 1
+
+    print(f"{args.name}: {len(sprites)} sprites in {digit_w}x{font.line_height} cells, "
+          f"{size} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
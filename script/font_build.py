@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+"""
+Font builder for the 1-bit panel
+
+Wraps lv_font_conv for lvgl_add_font() (cmake/lvgl_font.cmake) with two
+additions:
+
+  subsetting    --catalog files name the glyphs the firmware actually draws.
+                From C sources the characters of string literals are taken
+                (integer conversions like %d add the digits and '-'), from any
+                other file every printable character, so a plain text corpus
+                of sample notifications works. --symbols are added on top and
+                --range, if given, limits the result.
+
+  thresholding  With --threshold the glyphs are rendered at 8 bpp and cut to
+                --bpp 1 or 2 here instead of by lv_font_conv: 1 bpp keeps the
+                pixels at or above the threshold, 2 bpp maps them onto three
+                grey levels. Rows and columns left empty are cropped. The C
+                source is then written by this script, without kerning.
+
+A size file records the flash footprint of the font as built and what the
+same glyph set would take at 1, 2 and 4 bpp, for font_size_report.py.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+import lv_font_bin
+
+CMAP_TYPES = {
+    lv_font_bin.CMAP_FORMAT0_FULL: "LV_FONT_FMT_TXT_CMAP_FORMAT0_FULL",
+    lv_font_bin.CMAP_SPARSE_FULL: "LV_FONT_FMT_TXT_CMAP_SPARSE_FULL",
+    lv_font_bin.CMAP_FORMAT0_TINY: "LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY",
+    lv_font_bin.CMAP_SPARSE_TINY: "LV_FONT_FMT_TXT_CMAP_SPARSE_TINY",
+}
+
+STRING_RE = re.compile(r'"((?:[^"\\\n]|\\.)*)"')
+ESCAPE_RE = re.compile(r"\\(x[0-9a-fA-F]+|[0-7]{1,3}|.)")
+CONVERSION_RE = re.compile(r"%[-+ #0]*(?:\d+|\*)?(?:\.(?:\d+|\*))?(?:hh|h|ll|l|z|j|t)?([a-zA-Z%])")
+SIMPLE_ESCAPES = {"n": "\n", "t": "\t", "r": "\r", "0": "\0"}
+
+
+def unescape(literal):
+    def repl(m):
+        e = m.group(1)
+        if e[0] == "x":
+            return chr(int(e[1:], 16))
+        if e[0].isdigit() and e != "0":
+            return chr(int(e, 8))
+        return SIMPLE_ESCAPES.get(e, e)
+
+    # Escapes of UTF-8 bytes are rare in this code base, treat them as code points
+    return ESCAPE_RE.sub(repl, literal)
+
+
+def catalog_chars(path):
+    """Characters a catalog file asks for"""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+
+    if os.path.splitext(path)[1] not in (".c", ".h"):
+        return set(text)
+
+    chars = set()
+    for line in text.splitlines():
+        if line.lstrip().startswith("#include"):
+            continue
+        for m in STRING_RE.finditer(line):
+            s = unescape(m.group(1))
+            for conv in CONVERSION_RE.finditer(s):
+                if conv.group(1) in "diu":
+                    chars.update("0123456789-")
+                elif conv.group(1) == "%":
+                    chars.add("%")
+            chars.update(CONVERSION_RE.sub("", s))
+    return chars
+
+
+def parse_ranges(spec):
+    """Code points of an lv_font_conv --range value"""
+    out = set()
+    for part in spec.split(","):
+        part = part.strip()
+        if not part:
+            continue
+        lo, _, hi = part.partition("-")
+        out.update(range(int(lo, 0), int(hi or lo, 0) + 1))
+    return out
+
+
+def format_ranges(codepoints):
+    """Compact an lv_font_conv --range value"""
+    parts = []
+    cps = sorted(codepoints)
+    i = 0
+    while i < len(cps):
+        j = i
+        while j + 1 < len(cps) and cps[j + 1] == cps[j] + 1:
+            j += 1
+        parts.append(f"0x{cps[i]:X}" if i == j else f"0x{cps[i]:X}-0x{cps[j]:X}")
+        i = j + 1
+    return ",".join(parts)
+
+
+def glyph_args(args):
+    """lv_font_conv arguments selecting the glyphs, and the subset size if any"""
+    if not args.catalog:
+        out = []
+        if args.range:
+            out += ["--range", args.range]
+        elif not args.symbols:
+            out += ["--range", "0x20-0x7F"]
+        if args.symbols:
+            out += ["--symbols", args.symbols]
+        return out, None
+
+    chars = set(args.symbols or "")
+    for path in args.catalog:
+        chars |= catalog_chars(path)
+    codepoints = {ord(c) for c in chars if c.isprintable() or c == " "}
+    if args.range:
+        codepoints &= parse_ranges(args.range)
+    if not codepoints:
+        raise ValueError("the catalogs select no glyphs")
+    return ["--range", format_ranges(codepoints)], len(codepoints)
+
+
+def render_bin(args, selection, bpp, kerning):
+    """Run lv_font_conv into a binary font and parse it"""
+    fd, path = tempfile.mkstemp(suffix=".bin")
+    os.close(fd)
+    try:
+        cmd = [args.lv_font_conv, "--font", args.font, "--size", str(args.size), "--bpp", str(bpp),
+               "--format", "bin", "--no-compress", "--output", path] + selection
+        if not kerning:
+            cmd.append("--no-kerning")
+        subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+        with open(path, "rb") as f:
+            return lv_font_bin.parse(f.read())
+    finally:
+        os.unlink(path)
+
+
+def quantize(level, bpp, threshold):
+    """Map an 8 bpp level onto bpp bits, levels below the threshold drop out"""
+    if bpp == 8:
+        return level
+    if level < threshold:
+        return 0
+    top = (1 << bpp) - 1
+    if bpp == 1:
+        return 1
+    return min(top, 1 + (level - threshold) * top // (256 - threshold))
+
+
+def reduce_font(font, bpp, threshold):
+    """Cut an 8 bpp font down to bpp, cropping the emptied rows and columns"""
+    out = lv_font_bin.Font(font.line_height, font.base_line, font.underline_position,
+                           font.underline_thickness, bpp, cmaps=font.cmaps)
+    for g in font.glyphs:
+        levels = [quantize(v, bpp, threshold) for v in lv_font_bin.glyph_pixels(g, 8)]
+        rows = [levels[y * g.box_w:(y + 1) * g.box_w] for y in range(g.box_h)]
+        ys = [y for y, row in enumerate(rows) if any(row)]
+        xs = [x for x in range(g.box_w) if any(row[x] for row in rows)]
+        if not ys:
+            out.glyphs.append(lv_font_bin.Glyph(g.adv_w, 0, 0, 0, 0, b""))
+            continue
+
+        top, bottom, left, right = ys[0], ys[-1], xs[0], xs[-1]
+        pixels = [v for row in rows[top:bottom + 1] for v in row[left:right + 1]]
+        # ofs_y is the offset of the bottom row from the base line
+        out.glyphs.append(lv_font_bin.Glyph(g.adv_w, right - left + 1, bottom - top + 1,
+                                            g.ofs_x + left, g.ofs_y + g.box_h - 1 - bottom,
+                                            lv_font_bin.pack_pixels(pixels, bpp)))
+    return out
+
+
+def c_array(data, per_line=16):
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def c_list(values, per_line=12):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def write_c(font, name, args, path):
+    """Write the font as lv_font_conv --format lvgl would, without kerning"""
+    guard = name.upper()
+    bitmap = b"".join(g.bitmap for g in font.glyphs)
+    out = []
+    out.append("/" + "*" * 79)
+    out.append(f" * Size: {args.size} px")
+    out.append(f" * Bpp: {font.bpp}, thresholded at {args.threshold} by font_build.py")
+    out.append(f" * Font: {os.path.basename(args.font)}")
+    out.append(" " + "*" * 78 + "/")
+    out.append("")
+    out.append("#ifdef LV_LVGL_H_INCLUDE_SIMPLE")
+    out.append('#include "lvgl.h"')
+    out.append("#else")
+    out.append('#include "lvgl/lvgl.h"')
+    out.append("#endif")
+    out.append("")
+    out.append(f"#ifndef {guard}")
+    out.append(f"#define {guard} 1")
+    out.append("#endif")
+    out.append("")
+    out.append(f"#if {guard}")
+    out.append("")
+    out.append("static LV_ATTRIBUTE_LARGE_CONST const uint8_t glyph_bitmap[] = {")
+    out.append(c_array(bitmap) if bitmap else "    0x00,")
+    out.append("};")
+    out.append("")
+    out.append("static const lv_font_fmt_txt_glyph_dsc_t glyph_dsc[] = {")
+    index = 0
+    for g in font.glyphs:
+        out.append(f"    {{.bitmap_index = {index}, .adv_w = {g.adv_w}, .box_w = {g.box_w}, "
+                   f".box_h = {g.box_h}, .ofs_x = {g.ofs_x}, .ofs_y = {g.ofs_y}}},")
+        index += len(g.bitmap)
+    out.append("};")
+    out.append("")
+
+    for i, c in enumerate(font.cmaps):
+        if c.unicode_list is not None:
+            out.append(f"static const uint16_t unicode_list_{i}[] = {{")
+            out.append(c_list(c.unicode_list))
+            out.append("};")
+            out.append("")
+        if c.glyph_id_ofs is not None:
+            ctype = "uint8_t" if c.type == lv_font_bin.CMAP_FORMAT0_FULL else "uint16_t"
+            out.append(f"static const {ctype} glyph_id_ofs_list_{i}[] = {{")
+            out.append(c_list(c.glyph_id_ofs))
+            out.append("};")
+            out.append("")
+
+    out.append("static const lv_font_fmt_txt_cmap_t cmaps[] = {")
+    for i, c in enumerate(font.cmaps):
+        unicode_list = f"unicode_list_{i}" if c.unicode_list is not None else "NULL"
+        ids = f"glyph_id_ofs_list_{i}" if c.glyph_id_ofs is not None else "NULL"
+        length = len(c.unicode_list or c.glyph_id_ofs or [])
+        out.append(f"    {{.range_start = {c.range_start}, .range_length = {c.range_length}, "
+                   f".glyph_id_start = {c.glyph_id_start}, .unicode_list = {unicode_list}, "
+                   f".glyph_id_ofs_list = {ids}, .list_length = {length}, "
+                   f".type = {CMAP_TYPES[c.type]}}},")
+    out.append("};")
+    out.append("")
+    out.append("static const lv_font_fmt_txt_dsc_t font_dsc = {")
+    out.append("    .glyph_bitmap = glyph_bitmap,")
+    out.append("    .glyph_dsc = glyph_dsc,")
+    out.append("    .cmaps = cmaps,")
+    out.append("    .kern_dsc = NULL,")
+    out.append("    .kern_scale = 0,")
+    out.append(f"    .cmap_num = {len(font.cmaps)},")
+    out.append(f"    .bpp = {font.bpp},")
+    out.append("    .kern_classes = 0,")
+    out.append("    .bitmap_format = 0,")
+    out.append("};")
+    out.append("")
+    out.append(f"const lv_font_t {name} = {{")
+    out.append("    .get_glyph_dsc = lv_font_get_glyph_dsc_fmt_txt,")
+    out.append("    .get_glyph_bitmap = lv_font_get_bitmap_fmt_txt,")
+    out.append(f"    .line_height = {font.line_height},")
+    out.append(f"    .base_line = {font.base_line},")
+    out.append("    .subpx = LV_FONT_SUBPX_NONE,")
+    out.append(f"    .underline_position = {font.underline_position},")
+    out.append(f"    .underline_thickness = {font.underline_thickness},")
+    out.append("    .dsc = &font_dsc,")
+    out.append("    .fallback = NULL,")
+    out.append("    .user_data = NULL,")
+    out.append("};")
+    out.append("")
+    out.append(f"#endif /* {guard} */")
+
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(out) + "\n")
+
+
+def total(font):
+    return sum(lv_font_bin.footprint(font))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build an LVGL font for the 1-bit panel")
+    parser.add_argument("--lv-font-conv", default="lv_font_conv", help="lv_font_conv executable")
+    parser.add_argument("--font", required=True, help="TTF/WOFF source")
+    parser.add_argument("--size", type=int, required=True, help="Font size in px")
+    parser.add_argument("--bpp", type=int, default=1, choices=(1, 2, 3, 4, 8))
+    parser.add_argument("--threshold", type=int, help="Threshold an 8 bpp render to --bpp 1 or 2")
+    parser.add_argument("--range", help="Code points, as lv_font_conv --range")
+    parser.add_argument("--symbols", help="Characters to include")
+    parser.add_argument("--catalog", action="append", default=[],
+                        help="Take the glyphs from the strings of this file")
+    parser.add_argument("--name", required=True, help="C symbol of the font")
+    parser.add_argument("-o", "--output", required=True, help="Output C file")
+    parser.add_argument("--size-file", help="Write the footprint line for font_size_report.py")
+    parser.add_argument("--no-compress", action="store_true")
+    parser.add_argument("--no-prefilter", action="store_true")
+    parser.add_argument("--lcd", action="store_true")
+    parser.add_argument("--lcd-v", action="store_true")
+    args = parser.parse_args()
+
+    if args.threshold is not None:
+        if args.bpp not in (1, 2):
+            parser.error("--threshold needs --bpp 1 or 2")
+        if not 1 <= args.threshold <= 255:
+            parser.error("--threshold must be 1-255")
+        if args.lcd or args.lcd_v:
+            parser.error("--threshold does not support subpixel rendering")
+
+    try:
+        selection, subset = glyph_args(args)
+        # One 8 bpp render gives the glyph set and the footprint of each depth
+        grey = render_bin(args, selection, 8, kerning=False)
+        threshold = args.threshold if args.threshold is not None else 128
+        variants = {bpp: total(reduce_font(grey, bpp, threshold)) for bpp in (1, 2)}
+        variants[4] = total(reduce_font(grey, 4, 1))
+
+        if args.threshold is not None:
+            font = reduce_font(grey, args.bpp, args.threshold)
+            write_c(font, args.name, args, args.output)
+            built = font
+        else:
+            cmd = [args.lv_font_conv, "--font", args.font, "--size", str(args.size), "--bpp",
+                   str(args.bpp), "--format", "lvgl", "--lv-font-name", args.name,
+                   "--output", args.output] + selection
+            for flag in ("no_compress", "no_prefilter", "lcd", "lcd_v"):
+                if getattr(args, flag):
+                    cmd.append("--" + flag.replace("_", "-"))
+            subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+            # Uncompressed size; compressed fonts come out smaller in the C source
+            built = render_bin(args, selection, args.bpp, kerning=False)
+    except (ValueError, OSError, subprocess.CalledProcessError) as e:
+        print(f"{args.name}: {e}", file=sys.stderr)
+        return 1
+
+    bitmap, dsc, cmaps = lv_font_bin.footprint(built)
+    glyphs = len(built.glyphs) - 1
+    mode = f"t{args.threshold}" if args.threshold is not None else "conv"
+    source = f"catalog:{subset}" if subset is not None else "range"
+    if args.size_file:
+        with open(args.size_file, "w", encoding="utf-8") as f:
+            f.write(f"{args.name} {args.size} {args.bpp} {mode} {source} {glyphs} {bitmap} {dsc} "
+                    f"{cmaps} {variants[1]} {variants[2]} {variants[4]}\n")
+
+    print(f"{args.name}: {glyphs} glyphs at {args.bpp} bpp, {bitmap + dsc + cmaps} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""
+Font flash usage report
+
+Collects the size lines written by font_build.py and prints, per font, how
+its glyphs were chosen and rasterized, the flash its bitmaps, glyph
+descriptors and character maps take as built, and what the same glyphs
+would take thresholded to 1 and 2 bpp or at 4 bpp. Sizes leave kerning and
+lv_font_conv compression out.
+"""
+
+import argparse
+import sys
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Summarize generated font sizes")
+    parser.add_argument("size_files", nargs="+", help="Size files written by font_build.py")
+    parser.add_argument("-o", "--output", help="Also write the report to this file")
+    args = parser.parse_args()
+
+    rows = []
+    for path in args.size_files:
+        with open(path, encoding="utf-8") as f:
+            fields = f.read().split()
+            rows.append(fields[:5] + [int(v) for v in fields[5:]])
+
+    lines = [f"{'font':<20} {'px':>3} {'bpp':>3} {'raster':>6} {'glyphs from':<12} {'glyphs':>6} "
+             f"{'bitmap':>7} {'dsc':>6} {'cmap':>6} {'total':>7} {'@1bpp':>7} {'@2bpp':>7} "
+             f"{'@4bpp':>7}"]
+    for name, px, bpp, mode, source, glyphs, bitmap, dsc, cmap, bpp1, bpp2, bpp4 in rows:
+        lines.append(f"{name:<20} {px:>3} {bpp:>3} {mode:>6} {source:<12} {glyphs:>6} "
+                     f"{bitmap:>7} {dsc:>6} {cmap:>6} {bitmap + dsc + cmap:>7} {bpp1:>7} "
+                     f"{bpp2:>7} {bpp4:>7}")
+
+    built = sum(r[6] + r[7] + r[8] for r in rows)
+    lines.append(f"{'total':<20} {'':>3} {'':>3} {'':>6} {'':<12} {sum(r[5] for r in rows):>6} "
+                 f"{sum(r[6] for r in rows):>7} {sum(r[7] for r in rows):>6} "
+                 f"{sum(r[8] for r in rows):>6} {built:>7} {sum(r[9] for r in rows):>7} "
+                 f"{sum(r[10] for r in rows):>7} {sum(r[11] for r in rows):>7}")
+
+    report = "\n".join(lines) + "\n"
+    print(report, end="")
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            f.write(report)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
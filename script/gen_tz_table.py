@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+Timezone table generator
+Converts a list of POSIX TZ rule strings into a compact C table for the
+timekeeping service (src/lib/timekeeping.c)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+
+class TzError(ValueError):
+    pass
+
+
+def parse_offset(text, pos):
+    """Parse [+|-]hh[:mm[:ss]] at pos, return (minutes, new_pos)"""
+    m = re.compile(r'([+-]?)(\d{1,2})(?::(\d{2}))?(?::(\d{2}))?').match(text, pos)
+    if not m:
+        raise TzError(f"expected offset at '{text[pos:]}'")
+    sign = -1 if m.group(1) == '-' else 1
+    minutes = int(m.group(2)) * 60 + int(m.group(3) or 0)
+    return sign * minutes, m.end()
+
+
+def parse_name(text, pos):
+    """Parse an abbreviation, either alphabetic or quoted with <...>"""
+    if pos < len(text) and text[pos] == '<':
+        end = text.index('>', pos)
+        return text[pos + 1:end], end + 1
+    m = re.compile(r'[A-Za-z]{3,}').match(text, pos)
+    if not m:
+        raise TzError(f"expected zone abbreviation at '{text[pos:]}'")
+    return m.group(0), m.end()
+
+
+def parse_rule(text):
+    """Parse Mm.w.d[/time], return (month, week, wday, minutes)"""
+    m = re.fullmatch(r'M(\d{1,2})\.(\d)\.(\d)(?:/([+-]?\d{1,3}(?::\d{2})?))?', text)
+    if not m:
+        raise TzError(f"only Mm.w.d transition rules are supported, got '{text}'")
+    month, week, wday = int(m.group(1)), int(m.group(2)), int(m.group(3))
+    if not (1 <= month <= 12 and 1 <= week <= 5 and 0 <= wday <= 6):
+        raise TzError(f"transition rule out of range: '{text}'")
+    minutes = 120
+    if m.group(4):
+        minutes, _ = parse_offset(m.group(4), 0)
+    return month, week, wday, minutes
+
+
+def parse_posix_tz(tz):
+    """Return a dict describing the zone; offsets are minutes east of UTC"""
+    _, pos = parse_name(tz, 0)
+    std, pos = parse_offset(tz, pos)
+    zone = {'std': -std, 'dst': 0, 'start': (0, 0, 0, 0), 'end': (0, 0, 0, 0)}
+    if pos == len(tz):
+        return zone
+
+    _, pos = parse_name(tz, pos)
+    dst = std - 60
+    if pos < len(tz) and tz[pos] != ',':
+        dst, pos = parse_offset(tz, pos)
+    if pos == len(tz) or tz[pos] != ',':
+        raise TzError(f"DST zone without transition rules: '{tz}'")
+
+    rules = tz[pos + 1:].split(',')
+    if len(rules) != 2:
+        raise TzError(f"expected start and end rules: '{tz}'")
+
+    zone['dst'] = -dst
+    zone['start'] = parse_rule(rules[0])
+    zone['end'] = parse_rule(rules[1])
+    return zone
+
+
+def read_zones(path):
+    zones = []
+    with open(path, encoding='utf-8') as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.split('#', 1)[0].strip()
+            if not line:
+                continue
+            parts = line.split()
+            if len(parts) != 2:
+                raise TzError(f"{path}:{lineno}: expected '<name> <posix tz>'")
+            try:
+                zones.append((parts[0], parse_posix_tz(parts[1]), parts[1]))
+            except TzError as e:
+                raise TzError(f"{path}:{lineno}: {e}") from e
+    return zones
+
+
+def format_rule(rule):
+    month, week, wday, minutes = rule
+    return f"{{{month}, {week}, {wday}, {minutes}}}"
+
+
+def generate(zones, source_name):
+    lines = [
+        f"/* Generated from {source_name} by gen_tz_table.py, do not edit */",
+        "",
+        '#include "lib/timekeeping.h"',
+        "",
+        "const struct tz_zone tz_zones[] = {",
+    ]
+    for name, z, posix in zones:
+        lines.append(f"    /* {posix} */")
+        lines.append(f'    {{"{name}", {z["std"]}, {z["dst"]}, '
+                     f'{format_rule(z["start"])}, {format_rule(z["end"])}}},')
+    lines += [
+        "};",
+        "",
+        "const size_t tz_zone_count = sizeof(tz_zones) / sizeof(tz_zones[0]);",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the timezone rule table')
+    parser.add_argument('zones', help='Zone list: one "<name> <posix tz>" per line')
+    parser.add_argument('-o', '--output', required=True, help='Output C file path')
+    args = parser.parse_args()
+
+    try:
+        zones = read_zones(args.zones)
+    except (OSError, TzError) as e:
+        print(f"Error: {e}", file=sys.stderr)
+        return 1
+
+    if not zones:
+        print(f"Error: no zones in {args.zones}", file=sys.stderr)
+        return 1
+
+    with open(args.output, 'w', encoding='utf-8') as f:
+        f.write(generate(zones, os.path.basename(args.zones)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
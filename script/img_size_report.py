@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""
+Image flash usage report
+
+Collects the size lines written by img_to_i1.py and prints, per image, the
+flash the RGB565 conversion of the source used against the I1 result and
+what is stored after compression (equal to I1 for uncompressed images).
+"""
+
+import argparse
+import sys
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Summarize converted image sizes")
+    parser.add_argument("size_files", nargs="+", help="Size files written by img_to_i1.py")
+    parser.add_argument("-o", "--output", help="Also write the report to this file")
+    args = parser.parse_args()
+
+    rows = []
+    for path in args.size_files:
+        with open(path, encoding="utf-8") as f:
+            name, src, out, rgb565, i1, stored = f.read().split()
+            rows.append((name, src, out, int(rgb565), int(i1), int(stored)))
+
+    lines = [f"{'image':<16} {'source':>9} {'output':>9} {'RGB565':>9} {'I1':>7} {'stored':>7} "
+             f"{'ratio':>6}"]
+    for name, src, out, rgb565, i1, stored in rows:
+        lines.append(f"{name:<16} {src:>9} {out:>9} {rgb565:>9} {i1:>7} {stored:>7} "
+                     f"{rgb565 / stored:>5.1f}x")
+
+    total_rgb565 = sum(r[3] for r in rows)
+    total_i1 = sum(r[4] for r in rows)
+    total_stored = sum(r[5] for r in rows)
+    lines.append(f"{'total':<16} {'':>9} {'':>9} {total_rgb565:>9} {total_i1:>7} {total_stored:>7} "
+                 f"{total_rgb565 / max(total_stored, 1):>5.1f}x")
+
+    report = "\n".join(lines) + "\n"
+    print(report, end="")
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            f.write(report)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+"""
+Image to LVGL I1 converter for the 1-bit e-paper panel
+
+Resizes an image to the panel like img_convert.py, dithers it to black and
+white at build time and writes an lv_image_dsc_t in LV_COLOR_FORMAT_I1:
+an 8-byte palette (index 0 black, index 1 white) followed by MSB-first rows,
+which is the layout of the display framebuffer, so the app can copy the rows
+as they are.
+
+With --compress rle the rows are run-length coded in the layout read by
+src/display/img_rle.c: a small row index lets the decoder start at any
+block of rows, so only the rows being drawn are decoded.
+
+With --bin the image is written as an lv_image_header_t followed by the
+data instead, for script/pack_assets.py to put in the asset bundle.
+
+A size line comparing the result with the RGB565 conversion of the source
+image is written next to the C file for the build's image size report.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+from PIL import Image
+
+# 8x8 Bayer matrix for ordered dithering, values 0..63
+BAYER_8X8 = [
+    [0, 32, 8, 40, 2, 34, 10, 42],
+    [48, 16, 56, 24, 50, 18, 58, 26],
+    [12, 44, 4, 36, 14, 46, 6, 38],
+    [60, 28, 52, 20, 62, 30, 54, 22],
+    [3, 35, 11, 43, 1, 33, 9, 41],
+    [51, 19, 59, 27, 49, 17, 57, 25],
+    [15, 47, 7, 39, 13, 45, 5, 37],
+    [63, 31, 55, 23, 61, 29, 53, 21],
+]
+
+DITHER_MODES = ("floyd_steinberg", "ordered", "none")
+COMPRESS_MODES = ("none", "rle")
+
+# Rows per entry of the compressed row index; worst case a seek skips 7 rows
+RLE_BLOCK_ROWS = 8
+
+# LV_IMAGE_FLAGS_USER1, IMG_RLE_FLAG in src/display/img_rle.h
+RLE_FLAG = "LV_IMAGE_FLAGS_USER1"
+RLE_FLAG_VALUE = 0x0100
+
+# lv_image_header_t fields of the binary output
+LV_IMAGE_HEADER_MAGIC = 0x19
+LV_COLOR_FORMAT_I1 = 0x07
+
+
+def load_gray(path, size):
+    """Load an image as rows of 0..255 gray levels, resized to size (w, h)"""
+    img = Image.open(path)
+    src_size = img.size
+
+    # Transparent pixels show the white panel background
+    if img.mode in ("RGBA", "LA", "P"):
+        img = img.convert("RGBA")
+        background = Image.new("RGBA", img.size, (255, 255, 255, 255))
+        img = Image.alpha_composite(background, img)
+
+    if size and img.size != size:
+        img = img.resize(size, Image.Resampling.LANCZOS)
+
+    img = img.convert("L")
+    width, height = img.size
+    data = list(img.getdata())
+    rows = [[float(v) for v in data[y * width:(y + 1) * width]] for y in range(height)]
+    return rows, src_size
+
+
+def dither_floyd_steinberg(rows, threshold):
+    """Error diffusion, serpentine scan to avoid directional artifacts"""
+    height = len(rows)
+    width = len(rows[0]) if height else 0
+    out = [[0] * width for _ in range(height)]
+
+    for y in range(height):
+        left_to_right = y % 2 == 0
+        xs = range(width) if left_to_right else range(width - 1, -1, -1)
+        step = 1 if left_to_right else -1
+
+        for x in xs:
+            old = rows[y][x]
+            white = old >= threshold
+            out[y][x] = 1 if white else 0
+            err = old - (255.0 if white else 0.0)
+
+            if 0 <= x + step < width:
+                rows[y][x + step] += err * 7 / 16
+            if y + 1 < height:
+                if 0 <= x - step < width:
+                    rows[y + 1][x - step] += err * 3 / 16
+                rows[y + 1][x] += err * 5 / 16
+                if 0 <= x + step < width:
+                    rows[y + 1][x + step] += err * 1 / 16
+    return out
+
+
+def dither_ordered(rows, threshold):
+    """Bayer dithering: stable patterns that do not shimmer between frames"""
+    bias = threshold - 128
+    return [[1 if v - bias > (BAYER_8X8[y % 8][x % 8] + 0.5) * 4 else 0
+             for x, v in enumerate(row)]
+            for y, row in enumerate(rows)]
+
+
+def dither_none(rows, threshold):
+    return [[1 if v >= threshold else 0 for v in row] for row in rows]
+
+
+def pack_rows(bits):
+    """Pack rows of 0/1 pixels MSB first, 1 = white"""
+    data = bytearray()
+    for row in bits:
+        for x in range(0, len(row), 8):
+            byte = 0
+            for i, bit in enumerate(row[x:x + 8]):
+                byte |= bit << (7 - i)
+            # Padding bits of the last byte stay white
+            pad = 8 - len(row[x:x + 8])
+            byte |= (1 << pad) - 1
+            data.append(byte)
+    return data
+
+
+def rle_row(row):
+    """PackBits-style codes of one row: c < 128 copies c + 1 literal bytes,
+    c >= 128 repeats the next byte c - 126 times"""
+    out = bytearray()
+    literal = bytearray()
+    i = 0
+    while i < len(row):
+        run = 1
+        while i + run < len(row) and run < 129 and row[i + run] == row[i]:
+            run += 1
+
+        # Two equal bytes only pay off as a run outside a literal
+        if run >= 3 or (run == 2 and not literal):
+            if literal:
+                out.append(len(literal) - 1)
+                out += literal
+                literal = bytearray()
+            out += bytes([run + 126, row[i]])
+            i += run
+        else:
+            literal.append(row[i])
+            i += 1
+            if len(literal) == 128:
+                out.append(127)
+                out += literal
+                literal = bytearray()
+    if literal:
+        out.append(len(literal) - 1)
+        out += literal
+    return out
+
+
+def rle_encode(pixels, stride, height):
+    """Row index header, block offsets and the coded rows"""
+    blocks = (height + RLE_BLOCK_ROWS - 1) // RLE_BLOCK_ROWS
+    offsets = []
+    stream = bytearray()
+    for y in range(height):
+        if y % RLE_BLOCK_ROWS == 0:
+            offsets.append(len(stream))
+        stream += rle_row(pixels[y * stride:(y + 1) * stride])
+    return struct.pack(f"<HH{blocks}I", RLE_BLOCK_ROWS, blocks, *offsets) + stream
+
+
+def image_data(width, height, pixels, compress):
+    """Palette and rows, run-length coded or not"""
+    stride = (width + 7) // 8
+    # Palette entries are ARGB8888 stored as B, G, R, A
+    palette = bytes([0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff])
+    if compress == "rle":
+        return palette + rle_encode(pixels, stride, height)
+    return palette + pixels
+
+
+def write_bin(path, width, height, pixels, compress):
+    stride = (width + 7) // 8
+    flags = RLE_FLAG_VALUE if compress == "rle" else 0
+    data = image_data(width, height, pixels, compress)
+    # lv_image_header_t: magic:8 cf:8 flags:16, w:16 h:16, stride:16 reserved:16
+    header = struct.pack("<BBHHHHH", LV_IMAGE_HEADER_MAGIC, LV_COLOR_FORMAT_I1, flags, width,
+                         height, stride, 0)
+    with open(path, "wb") as f:
+        f.write(header + data)
+    return len(data)
+
+
+def write_c(path, name, width, height, pixels, source, compress):
+    stride = (width + 7) // 8
+    data = image_data(width, height, pixels, compress)
+    flags = RLE_FLAG if compress == "rle" else "0"
+
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(f"""/* Generated from {os.path.basename(source)} by img_to_i1.py, do not edit */
+
+#include <lvgl.h>
+
+static const uint8_t {name}_map[] = {{
+{chr(10).join(lines)}
+}};
+
+const lv_image_dsc_t {name} = {{
+    .header.magic = LV_IMAGE_HEADER_MAGIC,
+    .header.cf = LV_COLOR_FORMAT_I1,
+    .header.flags = {flags},
+    .header.w = {width},
+    .header.h = {height},
+    .header.stride = {stride},
+    .data_size = sizeof({name}_map),
+    .data = {name}_map,
+}};
+""")
+    return len(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an image to a dithered LVGL I1 C source")
+    parser.add_argument("input", help="Input image path")
+    parser.add_argument("-o", "--output", help="Output C file path")
+    parser.add_argument("--bin", help="Output binary image path (asset bundle)")
+    parser.add_argument("-n", "--name", help="Image descriptor name (default: file name)")
+    parser.add_argument("-s", "--size", help="Resize to WIDTHxHEIGHT, e.g. 200x200")
+    parser.add_argument("--dither", choices=DITHER_MODES, default="floyd_steinberg",
+                        help="Dithering algorithm")
+    parser.add_argument("--threshold", type=int, default=128,
+                        help="Black/white threshold (0-255)")
+    parser.add_argument("--compress", choices=COMPRESS_MODES, default="none",
+                        help="Row-indexed run-length coding")
+    parser.add_argument("--size-file", help="Write a size report line to this file")
+    args = parser.parse_args()
+
+    if not args.output and not args.bin:
+        parser.error("one of --output or --bin is required")
+
+    size = None
+    if args.size:
+        try:
+            size = tuple(int(v) for v in args.size.lower().split("x"))
+        except ValueError:
+            print(f"Invalid size '{args.size}', use WIDTHxHEIGHT", file=sys.stderr)
+            return 1
+
+    name = args.name
+    if not name:
+        name = os.path.splitext(os.path.basename(args.input))[0]
+        name = name.replace("-", "_").replace(".", "_")
+
+    rows, src_size = load_gray(args.input, size)
+    height = len(rows)
+    width = len(rows[0]) if height else 0
+
+    dither = {
+        "floyd_steinberg": dither_floyd_steinberg,
+        "ordered": dither_ordered,
+        "none": dither_none,
+    }[args.dither]
+    pixels = pack_rows(dither(rows, args.threshold))
+
+    if args.bin:
+        stored = write_bin(args.bin, width, height, pixels, args.compress)
+    else:
+        stored = write_c(args.output, name, width, height, pixels, args.input, args.compress)
+
+    if args.size_file:
+        # RGB565 at the source resolution is what the image cost before
+        rgb565 = src_size[0] * src_size[1] * 2
+        i1 = 8 + len(pixels)
+        with open(args.size_file, "w", encoding="utf-8") as f:
+            f.write(f"{name} {src_size[0]}x{src_size[1]} {width}x{height} {rgb565} {i1} "
+                    f"{stored}\n")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,230 @@
+"""
+Reader of the lv_font_conv binary font format (--format bin --no-compress)
+
+Shared by pack_assets.py, which lays fonts out for the asset bundle, and
+font_build.py, which thresholds and subsets fonts for the 1-bit panel.
+Fonts are returned in the terms of LVGL's lv_font_fmt_txt: glyph id 0 is
+reserved, advance widths are in 1/16 px and each glyph bitmap starts on a
+byte boundary with its pixels packed continuously, MSB first.
+"""
+
+import struct
+from dataclasses import dataclass, field
+
+# lv_font_fmt_txt_cmap_type_t
+CMAP_FORMAT0_FULL = 0
+CMAP_SPARSE_FULL = 1
+CMAP_FORMAT0_TINY = 2
+CMAP_SPARSE_TINY = 3
+
+
+@dataclass
+class Glyph:
+    adv_w: int  # 1/16 px
+    box_w: int
+    box_h: int
+    ofs_x: int
+    ofs_y: int
+    bitmap: bytes
+
+
+@dataclass
+class Cmap:
+    range_start: int
+    range_length: int
+    glyph_id_start: int
+    type: int
+    unicode_list: list = None  # code point offsets from range_start
+    glyph_id_ofs: list = None  # glyph id offsets from glyph_id_start
+
+
+@dataclass
+class Font:
+    line_height: int
+    base_line: int
+    underline_position: int
+    underline_thickness: int
+    bpp: int
+    glyphs: list = field(default_factory=list)
+    cmaps: list = field(default_factory=list)
+    has_kerning: bool = False
+
+    def codepoints(self):
+        """Map of code point to glyph id"""
+        out = {}
+        for c in self.cmaps:
+            if c.type == CMAP_FORMAT0_TINY:
+                for i in range(c.range_length):
+                    out[c.range_start + i] = c.glyph_id_start + i
+            elif c.type == CMAP_FORMAT0_FULL:
+                for i, ofs in enumerate(c.glyph_id_ofs):
+                    if ofs or i == 0:
+                        out[c.range_start + i] = c.glyph_id_start + ofs
+            else:
+                for i, u in enumerate(c.unicode_list):
+                    ofs = c.glyph_id_ofs[i] if c.type == CMAP_SPARSE_FULL else i
+                    out[c.range_start + u] = c.glyph_id_start + ofs
+        return out
+
+
+class BitReader:
+    """MSB-first bit reader of the glyf table"""
+
+    def __init__(self, data, pos):
+        self.data = data
+        self.bit = pos * 8
+
+    def read(self, nbits):
+        value = 0
+        for _ in range(nbits):
+            byte = self.data[self.bit // 8]
+            value = (value << 1) | ((byte >> (7 - self.bit % 8)) & 1)
+            self.bit += 1
+        return value
+
+    def read_signed(self, nbits):
+        value = self.read(nbits)
+        if nbits and value & (1 << (nbits - 1)):
+            value -= 1 << nbits
+        return value
+
+
+def read_tables(data):
+    tables = {}
+    pos = 0
+    while pos + 8 <= len(data):
+        length, tag = struct.unpack_from("<I4s", data, pos)
+        if length < 8:
+            raise ValueError("corrupt table length")
+        tables[tag.decode("ascii")] = (pos, length)
+        pos += length
+    return tables
+
+
+def parse(data):
+    """Parse an lv_font_conv binary font"""
+    tables = read_tables(data)
+    for tag in ("head", "cmap", "loca", "glyf"):
+        if tag not in tables:
+            raise ValueError(f"missing '{tag}' table")
+
+    head = tables["head"][0] + 8
+    (_version, _tables, _size, _ascent, _descent, _typo_ascent, _typo_descent, _line_gap, min_y,
+     max_y, default_adv_w, _kern_scale, loca_format, _glyph_id_format, adv_w_format, bpp, xy_bits,
+     wh_bits, adv_w_bits, compression, _subpx, _pad, underline_pos,
+     underline_thickness) = struct.unpack_from("<IHHHhHhHhhHHBBBBBBBBBBhH", data, head)
+    if compression != 0:
+        raise ValueError("compressed fonts are not supported, use --no-compress")
+
+    font = Font(max_y - min_y, -min_y, underline_pos, underline_thickness, bpp,
+                has_kerning="kern" in tables)
+
+    # Glyph offsets into the glyf table
+    loca = tables["loca"][0] + 8
+    (loca_count,) = struct.unpack_from("<I", data, loca)
+    fmt = "<%d%s" % (loca_count, "H" if loca_format == 0 else "I")
+    offsets = struct.unpack_from(fmt, data, loca + 4)
+
+    glyf_start, glyf_length = tables["glyf"]
+    header_bits = adv_w_bits + 2 * xy_bits + 2 * wh_bits
+    for i, offset in enumerate(offsets):
+        if i == 0:
+            font.glyphs.append(Glyph(0, 0, 0, 0, 0, b""))
+            continue
+
+        end = offsets[i + 1] if i + 1 < loca_count else glyf_length
+        bits = BitReader(data, glyf_start + offset)
+        adv_w = bits.read(adv_w_bits) if adv_w_bits else default_adv_w
+        if adv_w_format == 0:
+            adv_w *= 16
+        ofs_x = bits.read_signed(xy_bits)
+        ofs_y = bits.read_signed(xy_bits)
+        box_w = bits.read(wh_bits)
+        box_h = bits.read(wh_bits)
+
+        # The bitmap follows the header bits; its last byte is left aligned
+        bmp_size = end - offset - header_bits // 8
+        bmp = bytes(bits.read(8) for _ in range(max(bmp_size - 1, 0)))
+        if bmp_size > 0:
+            tail = 8 - header_bits % 8 if header_bits % 8 else 8
+            bmp += bytes([(bits.read(tail) << (8 - tail)) & 0xFF])
+        font.glyphs.append(Glyph(adv_w, box_w, box_h, ofs_x, ofs_y, bmp))
+
+    cmap = tables["cmap"][0]
+    (cmap_count,) = struct.unpack_from("<I", data, cmap + 8)
+    for i in range(cmap_count):
+        (data_offset, range_start, range_length, glyph_id_start, entries,
+         cmap_type) = struct.unpack_from("<IIHHHB", data, cmap + 12 + i * 16)
+        src = cmap + data_offset
+        c = Cmap(range_start, range_length, glyph_id_start, cmap_type)
+
+        if cmap_type == CMAP_FORMAT0_FULL:
+            c.glyph_id_ofs = list(data[src:src + entries])
+        elif cmap_type in (CMAP_SPARSE_FULL, CMAP_SPARSE_TINY):
+            c.unicode_list = list(struct.unpack_from(f"<{entries}H", data, src))
+            if cmap_type == CMAP_SPARSE_FULL:
+                c.glyph_id_ofs = list(struct.unpack_from(f"<{entries}H", data, src + 2 * entries))
+        elif cmap_type != CMAP_FORMAT0_TINY:
+            raise ValueError(f"unknown cmap format {cmap_type}")
+        font.cmaps.append(c)
+
+    return font
+
+
+def glyph_pixels(glyph, bpp):
+    """Pixel levels of a glyph, 0..(1 << bpp) - 1, row major"""
+    count = glyph.box_w * glyph.box_h
+    bits = BitReader(glyph.bitmap, 0)
+    return [bits.read(bpp) for _ in range(count)]
+
+
+def pack_pixels(levels, bpp):
+    """Pack pixel levels continuously, MSB first, last byte left aligned"""
+    out = bytearray()
+    acc = 0
+    nbits = 0
+    for v in levels:
+        acc = (acc << bpp) | v
+        nbits += bpp
+        if nbits >= 8:
+            nbits -= 8
+            out.append((acc >> nbits) & 0xFF)
+    if nbits:
+        out.append((acc << (8 - nbits)) & 0xFF)
+    return bytes(out)
+
+
+def glyph_dsc_bytes(font):
+    """lv_font_fmt_txt_glyph_dsc_t array (bitmap_index:20 adv_w:12, box, offsets)"""
+    out = bytearray()
+    index = 0
+    for g in font.glyphs:
+        if index >= 1 << 20 or g.adv_w >= 1 << 12:
+            raise ValueError("font too large for lv_font_fmt_txt_glyph_dsc_t")
+        out += struct.pack("<IBBbb", index | (g.adv_w << 20), g.box_w, g.box_h, g.ofs_x, g.ofs_y)
+        index += len(g.bitmap)
+    return bytes(out)
+
+
+def cmap_list_bytes(cmap):
+    """Unicode list and glyph id offset list of a cmap, as LVGL stores them"""
+    unicode_list = b""
+    ids = b""
+    if cmap.unicode_list is not None:
+        unicode_list = struct.pack(f"<{len(cmap.unicode_list)}H", *cmap.unicode_list)
+    if cmap.type == CMAP_FORMAT0_FULL:
+        ids = bytes(cmap.glyph_id_ofs)
+    elif cmap.type == CMAP_SPARSE_FULL:
+        ids = struct.pack(f"<{len(cmap.glyph_id_ofs)}H", *cmap.glyph_id_ofs)
+    return unicode_list, ids
+
+
+def footprint(font):
+    """Flash used by the font data in lv_font_fmt_txt form, kerning left out"""
+    bitmaps = sum(len(g.bitmap) for g in font.glyphs)
+    dsc = 8 * len(font.glyphs)
+    cmaps = 0
+    for c in font.cmaps:
+        unicode_list, ids = cmap_list_bytes(c)
+        cmaps += 20 + len(unicode_list) + len(ids)
+    return bitmaps, dsc, cmaps
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""
+Asset bundle packer
+
+Packs images (written by img_to_i1.py --bin) and fonts (lv_font_conv
+--format bin --no-compress) into the bundle read by src/lib/asset_bundle.c.
+All values are little endian:
+
+    header      magic "WAB1", version, count, total size, CRC-32 of the rest
+    index       one entry per asset, sorted by the FNV-1a hash of its name:
+                hash, blob offset, blob size, type, name length, name offset
+    names       asset names, not terminated
+    blobs       one per asset, each aligned to BLOB_ALIGN
+
+Image blobs are an lv_image_header_t followed by the image data. Font blobs
+are rearranged from the lv_font_conv binary format into the arrays of an
+lv_font_fmt_txt_dsc_t (glyph descriptors, bitmaps, cmap lists), so the
+firmware points LVGL at them in flash instead of loading them into RAM.
+
+Optionally the bundle is also written into an erased flash image at the
+asset partition's offset, for the native_sim flash simulator (--flash).
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+import lv_font_bin
+
+MAGIC = 0x31424157  # "WAB1"
+VERSION = 1
+HEADER = struct.Struct("<IHHII")
+ENTRY = struct.Struct("<IIIHHI")
+BLOB_ALIGN = 16
+
+TYPE_IMAGE = 1
+TYPE_FONT = 2
+
+# Font blob: header, then the cmap records, all offsets from the blob start
+FONT_HEADER = struct.Struct("<hhhHBBHIIII")
+FONT_CMAP = struct.Struct("<IHHHBBII")
+
+
+def fnv1a(name):
+    """32-bit FNV-1a, as asset_bundle_hash()"""
+    h = 0x811C9DC5
+    for b in name.encode("utf-8"):
+        h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def align(data, boundary):
+    return data + bytes(-len(data) % boundary)
+
+
+def convert_font(data):
+    """Rearrange an lv_font_conv binary font into the zero-copy font blob"""
+    font = lv_font_bin.parse(data)
+
+    # Character maps: records with their code point and glyph id lists
+    records = []
+    lists = bytearray()
+    for c in font.cmaps:
+        unicode_list, glyph_id_ofs = lv_font_bin.cmap_list_bytes(c)
+        entries = len(c.unicode_list or c.glyph_id_ofs or [])
+        record = [c.range_start, c.range_length, c.glyph_id_start, entries, c.type, 0, 0, 0]
+        if c.unicode_list is not None:
+            lists = align(lists, 4)
+            record[6] = len(lists)
+            lists += unicode_list
+        if c.glyph_id_ofs is not None:
+            lists = align(lists, 4)
+            record[7] = len(lists)
+            lists += glyph_id_ofs
+        records.append(record)
+
+    # Blob layout: header, cmap records, glyph descriptors, cmap lists, bitmaps
+    glyph_dsc = lv_font_bin.glyph_dsc_bytes(font)
+    cmap_off = FONT_HEADER.size
+    dsc_off = cmap_off + FONT_CMAP.size * len(records)
+    lists_off = dsc_off + len(glyph_dsc)
+    bitmap_off = (lists_off + len(lists) + 3) & ~3
+
+    blob = bytearray(FONT_HEADER.pack(font.line_height, font.base_line, font.underline_position,
+                                      font.underline_thickness, font.bpp, len(records), 0,
+                                      len(font.glyphs), dsc_off, bitmap_off, cmap_off))
+    for r in records:
+        # List offsets are relative to the blob, 0 when the format has no list
+        unicode_off = lists_off + r[6] if r[4] in (1, 3) else 0
+        ids_off = lists_off + r[7] if r[4] in (0, 1) else 0
+        blob += FONT_CMAP.pack(r[0], r[1], r[2], r[3], r[4], 0, unicode_off, ids_off)
+    blob += glyph_dsc + lists
+    blob = align(blob, 4) + b"".join(g.bitmap for g in font.glyphs)
+    return bytes(blob)
+
+
+def parse_asset(spec):
+    name, sep, path = spec.partition("=")
+    if not sep or not name or not path:
+        raise argparse.ArgumentTypeError(f"expected NAME=PATH, got '{spec}'")
+    return name, path
+
+
+def pack(assets):
+    """Build the bundle from (name, type, blob) tuples"""
+    assets = sorted(assets, key=lambda a: (fnv1a(a[0]), a[0]))
+    names = bytearray()
+    name_offsets = []
+    index_end = HEADER.size + ENTRY.size * len(assets)
+    for name, _, _ in assets:
+        name_offsets.append(index_end + len(names))
+        names += name.encode("utf-8")
+
+    body = align(bytes(HEADER.size + ENTRY.size * len(assets)) + names, BLOB_ALIGN)
+    entries = bytearray()
+    for (name, asset_type, blob), name_off in zip(assets, name_offsets):
+        entries += ENTRY.pack(fnv1a(name), len(body), len(blob), asset_type,
+                              len(name.encode("utf-8")), name_off)
+        body = align(body + blob, BLOB_ALIGN)
+
+    body = bytearray(body)
+    body[HEADER.size:index_end] = entries
+    crc = zlib.crc32(body[HEADER.size:]) & 0xFFFFFFFF
+    body[:HEADER.size] = HEADER.pack(MAGIC, VERSION, len(assets), len(body), crc)
+    return bytes(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack images and fonts into an asset bundle")
+    parser.add_argument("-o", "--output", required=True, help="Output bundle path")
+    parser.add_argument("--image", action="append", default=[], type=parse_asset,
+                        metavar="NAME=PATH", help="Image from img_to_i1.py --bin")
+    parser.add_argument("--font", action="append", default=[], type=parse_asset,
+                        metavar="NAME=PATH", help="Font from lv_font_conv --format bin")
+    parser.add_argument("--partition-size", type=lambda v: int(v, 0),
+                        help="Fail if the bundle does not fit")
+    parser.add_argument("--flash", help="Also write an erased flash image holding the bundle")
+    parser.add_argument("--flash-size", type=lambda v: int(v, 0), help="Flash image size")
+    parser.add_argument("--offset", type=lambda v: int(v, 0), default=0,
+                        help="Partition offset in the flash image")
+    args = parser.parse_args()
+
+    assets = []
+    seen = set()
+    for asset_type, specs in ((TYPE_IMAGE, args.image), (TYPE_FONT, args.font)):
+        for name, path in specs:
+            if name in seen:
+                print(f"Duplicate asset name '{name}'", file=sys.stderr)
+                return 1
+            seen.add(name)
+            with open(path, "rb") as f:
+                blob = f.read()
+            if asset_type == TYPE_FONT:
+                try:
+                    blob = convert_font(blob)
+                except (ValueError, struct.error) as e:
+                    print(f"{path}: {e}", file=sys.stderr)
+                    return 1
+            assets.append((name, asset_type, blob))
+
+    bundle = pack(assets)
+    if args.partition_size is not None and len(bundle) > args.partition_size:
+        print(f"Asset bundle is {len(bundle)} bytes, the partition holds {args.partition_size}",
+              file=sys.stderr)
+        return 1
+
+    with open(args.output, "wb") as f:
+        f.write(bundle)
+
+    if args.flash:
+        if args.flash_size is None or args.offset + len(bundle) > args.flash_size:
+            print("Flash image needs --flash-size covering the bundle", file=sys.stderr)
+            return 1
+        image = bytearray(b"\xff" * args.flash_size)
+        image[args.offset:args.offset + len(bundle)] = bundle
+        with open(args.flash, "wb") as f:
+            f.write(image)
+
+    for name, asset_type, blob in sorted(assets):
+        kind = "image" if asset_type == TYPE_IMAGE else "font"
+        print(f"  {name:<20} {kind:<6} {len(blob):>8} bytes")
+    print(f"Asset bundle: {len(assets)} assets, {len(bundle)} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -11,10 +11,11 @@
  * @brief Input event structure for GPIO and other input events
  */
 typedef struct {
-  uint8_t type;  /**< Event type (e.g., 1 = KEY) */
-  uint8_t code;  /**< Event code (e.g., GPIO pin or key code) */
-  int32_t value; /**< Event value (e.g., 0 = release, 1 = press) */
-  void *data;    /**< Event data pointer (e.g., pointer to notification) */
+  uint8_t type;       /**< Event type (e.g., 1 = KEY) */
+  uint8_t code;       /**< Event code (e.g., GPIO pin or key code) */
+  int32_t value;      /**< Event value (e.g., 0 = release, 1 = press) */
+  void *data;         /**< Event data pointer (e.g., pointer to notification) */
+  uint32_t timestamp; /**< k_cycle_get_32() when the event originated */
 } input_event_t;
 
 /**
@@ -34,6 +35,10 @@ typedef struct IApp {
 #define INPUT_EVENT_TYPE_KEY 1
 #define INPUT_EVENT_TYPE_TOUCH 2
 #define INPUT_EVENT_TYPE_NOTIFICATION 3
+#define INPUT_EVENT_TYPE_SYSTEM 4
+#define INPUT_EVENT_TYPE_CHORD 5
+#define INPUT_EVENT_TYPE_TICK 6
+#define INPUT_EVENT_TYPE_CALL 7
 
 /**
  * @brief Common key codes (mapped to GPIO pins)
@@ -44,6 +49,42 @@ typedef struct IApp {
 #define INPUT_KEY_ENTER 3
 
 /**
- * @brief Notification codes
+ * @brief Key event values
+ *
+ * PRESS and RELEASE are always reported; the other gestures are reported in
+ * addition to them. SHORT_PRESS follows the release of a press that was no
+ * long press, double press or chord, once the double press window is over.
+ * Chords use INPUT_EVENT_TYPE_CHORD with a bitmask of BIT(INPUT_KEY_*) as
+ * the code.
+ *
+ * BACK is the app switch key: its PRESS is not reported and its SHORT_PRESS
+ * comes as INPUT_SYSTEM_APP_SWITCH instead.
+ */
+#define INPUT_KEY_VALUE_RELEASE 0
+#define INPUT_KEY_VALUE_PRESS 1
+#define INPUT_KEY_VALUE_LONG_PRESS 2
+#define INPUT_KEY_VALUE_REPEAT 3
+#define INPUT_KEY_VALUE_DOUBLE_PRESS 4
+#define INPUT_KEY_VALUE_SHORT_PRESS 5
+
+/**
+ * @brief Notification codes (value = UID)
+ *
+ * NEW and MODIFIED carry a struct notif handle (lib/notif_store.h) as data,
+ * valid during the event; take a reference with notif_store_ref() to keep it.
+ * Incoming calls use the same codes with INPUT_EVENT_TYPE_CALL, they go to
+ * the call overlay and their timestamp is the arrival of the ANCS event.
  */
 #define INPUT_NOTIFICATION_NEW 1
+#define INPUT_NOTIFICATION_MODIFIED 2
+#define INPUT_NOTIFICATION_REMOVED 3
+
+/**
+ * @brief Tick codes (value = running tick count)
+ */
+#define INPUT_TICK_PERIOD 1
+
+/**
+ * @brief System codes (handled by the AppManager, not forwarded to apps)
+ */
+#define INPUT_SYSTEM_APP_SWITCH 1
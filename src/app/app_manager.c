@@ -4,6 +4,8 @@
  */
 
 #include "app_manager.h"
+#include "../display/epd_refresh.h"
+#include "call/call_overlay.h"
 #include <stddef.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
@@ -66,6 +68,8 @@ void app_manager_launch(uint8_t index) {
     LOG_INF("Initializing app at index %d", index);
     manager.active->init();
   }
+  // A new screen replaces everything: clear the ghosting of the old one
+  epd_refresh_request_full(EPD_FULL_APP_SWITCH);
   LOG_INF("Launched app at index %d", index);
 }
 
@@ -74,6 +78,18 @@ void app_manager_handle_event(input_event_t *ev) {
     return;
   }
 
+  // An incoming call takes the keys from whatever app is active
+  if (call_overlay_handle_event(ev)) {
+    return;
+  }
+
+  if (ev->type == INPUT_EVENT_TYPE_SYSTEM) {
+    if (ev->code == INPUT_SYSTEM_APP_SWITCH) {
+      app_manager_switch_next();
+    }
+    return;
+  }
+
   if (manager.active != NULL && manager.active->handle_event != NULL) {
     manager.active->handle_event(ev);
   }
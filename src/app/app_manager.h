@@ -27,6 +27,9 @@ void app_manager_launch(uint8_t index);
 /**
  * @brief Handle input event and forward to active app
  *
+ * System events are consumed by the AppManager itself. Must be called
+ * from the UI thread; other contexts use ui_loop_post_event().
+ *
  * @param ev Pointer to input event
  */
 void app_manager_handle_event(input_event_t *ev);
@@ -0,0 +1,144 @@
+/**
+ * @file call_overlay.c
+ * @brief Incoming call overlay answering through ANCS
+ *
+ * Drawn on the top layer so it covers whatever app is active, without the
+ * app knowing. A BACK short press reaches the UI as the app switch system
+ * event, which the overlay takes as decline while it is up.
+ *
+ * Answer and decline act on short and long presses only. A press could
+ * still turn into a chord or a double press, and neither should act on the
+ * phone's call.
+ */
+
+#include "call_overlay.h"
+#include <zephyr/logging/log.h>
+
+#include "../../display/glyph_cache.h"
+#include "../../lib/ancs.h"
+#include "../../lib/notif_store.h"
+#include "../ui_fonts.h"
+#include "lvgl.h"
+
+LOG_MODULE_REGISTER(call_overlay, LOG_LEVEL_INF);
+
+#if defined(HAS_FONT_VI_20)
+LV_FONT_DECLARE(font_vi_20);
+#define CALLER_FONT glyph_cache_wrap(&font_vi_20)
+#else
+#define CALLER_FONT UI_FONT_24
+#endif
+
+static lv_obj_t *overlay = NULL;
+static lv_obj_t *caller_label = NULL;
+static lv_obj_t *actions_label = NULL;
+static struct notif *call = NULL; /* Call on screen */
+
+static void set_call_text(const struct notif *n) {
+  const char *positive = notif_text(n, NOTIF_ATTR_POSITIVE_ACTION);
+  const char *negative = notif_text(n, NOTIF_ATTR_NEGATIVE_ACTION);
+
+  lv_label_set_text(caller_label, notif_text(n, NOTIF_ATTR_TITLE));
+  lv_label_set_text_fmt(actions_label, "ENTER: %s\nBACK: %s", positive[0] ? positive : "Answer",
+                        negative[0] ? negative : "Decline");
+}
+
+static void show(struct notif *n) {
+  struct notif *ref = notif_store_ref(n);
+
+  if (!ref) {
+    return;
+  }
+  if (call) {
+    notif_store_put(call);
+  }
+  call = ref;
+
+  if (!overlay) {
+    overlay = lv_obj_create(lv_layer_top());
+    lv_obj_set_size(overlay, lv_pct(100), lv_pct(100));
+    lv_obj_set_style_bg_color(overlay, lv_color_white(), 0);
+    lv_obj_set_style_bg_opa(overlay, LV_OPA_COVER, 0);
+    lv_obj_set_style_border_width(overlay, 0, 0);
+    lv_obj_set_style_radius(overlay, 0, 0);
+    lv_obj_set_style_pad_all(overlay, 12, 0);
+
+    lv_obj_t *heading = lv_label_create(overlay);
+    lv_label_set_text(heading, "Incoming call");
+    lv_obj_set_style_text_font(heading, UI_FONT_16, 0);
+    lv_obj_align(heading, LV_ALIGN_TOP_MID, 0, 0);
+
+    caller_label = lv_label_create(overlay);
+    lv_label_set_long_mode(caller_label, LV_LABEL_LONG_WRAP);
+    lv_obj_set_width(caller_label, lv_pct(100));
+    lv_obj_set_style_text_font(caller_label, CALLER_FONT, 0);
+    lv_obj_set_style_text_align(caller_label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_align(caller_label, LV_ALIGN_CENTER, 0, -10);
+
+    actions_label = lv_label_create(overlay);
+    lv_obj_set_style_text_font(actions_label, UI_FONT_16, 0);
+    lv_obj_align(actions_label, LV_ALIGN_BOTTOM_MID, 0, 0);
+  }
+  set_call_text(n);
+}
+
+static void hide(void) {
+  if (overlay) {
+    lv_obj_del(overlay);
+    overlay = NULL;
+    caller_label = NULL;
+    actions_label = NULL;
+  }
+  if (call) {
+    notif_store_put(call);
+    call = NULL;
+  }
+}
+
+static void answer(ancs_action_id_t action) {
+  uint32_t uid = notif_uid(call);
+
+#if defined(CONFIG_BT)
+  int err = ancs_perform_action(uid, action);
+  if (err) {
+    LOG_WRN("Can't answer call 0x%x (err %d)", uid, err);
+  }
+#else
+  LOG_WRN("No ANCS to answer call 0x%x", uid);
+#endif
+  // The phone removes the call notification once it acts on it
+  hide();
+}
+
+static bool is_click(const input_event_t *ev) {
+  return ev->value == INPUT_KEY_VALUE_SHORT_PRESS || ev->value == INPUT_KEY_VALUE_LONG_PRESS;
+}
+
+bool call_overlay_handle_event(input_event_t *ev) {
+  if (ev->type == INPUT_EVENT_TYPE_CALL) {
+    if (ev->code == INPUT_NOTIFICATION_REMOVED) {
+      if (call && notif_uid(call) == (uint32_t)ev->value) {
+        hide();
+      }
+    } else if (ev->data) {
+      show(ev->data);
+    }
+    return true;
+  }
+
+  if (!call) {
+    return false;
+  }
+
+  if (ev->type == INPUT_EVENT_TYPE_KEY && is_click(ev) && ev->code == INPUT_KEY_ENTER) {
+    answer(ANCS_ACTION_ID_POSITIVE);
+    return true;
+  }
+  if ((ev->type == INPUT_EVENT_TYPE_KEY && is_click(ev) && ev->code == INPUT_KEY_BACK) ||
+      (ev->type == INPUT_EVENT_TYPE_SYSTEM && ev->code == INPUT_SYSTEM_APP_SWITCH)) {
+    answer(ANCS_ACTION_ID_NEGATIVE);
+    return true;
+  }
+  // Other keys would act on the app hidden below
+  return ev->type == INPUT_EVENT_TYPE_KEY || ev->type == INPUT_EVENT_TYPE_CHORD;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file call_overlay.h
+ * @brief Incoming call overlay answering through ANCS
+ *
+ * Shown above any app on an INPUT_EVENT_TYPE_CALL event. While it is up it
+ * takes the keys: a short or long ENTER press performs the positive action
+ * of the call (answer), a short or long BACK press the negative one
+ * (decline). Chords and double presses do nothing. It closes on either
+ * action, or when the call notification is removed on the phone.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "../app_interface.h"
+
+/**
+ * @brief Handle an event before the active app
+ *
+ * @return true if the overlay consumed the event
+ */
+bool call_overlay_handle_event(input_event_t *ev);
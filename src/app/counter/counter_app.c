@@ -9,6 +9,7 @@
 #include <zephyr/logging/log.h>
 
 #include "../app_interface.h"
+#include "../ui_fonts.h"
 #include "lvgl.h"
 
 LOG_MODULE_REGISTER(counter_app, LOG_LEVEL_INF);
@@ -39,7 +40,7 @@ static void counter_app_init(void) {
   // Optional: Style the labels
   static lv_style_t style;
   lv_style_init(&style);
-  lv_style_set_text_font(&style, &lv_font_montserrat_24);
+  lv_style_set_text_font(&style, UI_FONT_24);
   lv_obj_add_style(static_label, &style, 0);
   lv_obj_add_style(dynamic_label, &style, 0);
 }
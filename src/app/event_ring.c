@@ -0,0 +1,58 @@
+/**
+ * @file event_ring.c
+ * @brief Lock-free multi-producer, single-consumer ring of input events
+ *
+ * Bounded sequence-number queue: each slot carries a sequence that tells
+ * producers whether it is free for position @c pos (seq == pos) and tells
+ * the consumer whether it has been published (seq == pos + 1). Producers
+ * claim a position with a CAS on @c head, fill the slot, then publish it.
+ */
+
+#include "event_ring.h"
+#include <errno.h>
+
+static inline atomic_val_t slot_seq(const struct event_ring *ring, uint32_t idx) {
+  return atomic_get(&ring->slots[idx].seq) + (atomic_val_t)idx;
+}
+
+static inline void slot_set_seq(struct event_ring *ring, uint32_t idx, atomic_val_t seq) {
+  atomic_set(&ring->slots[idx].seq, seq - (atomic_val_t)idx);
+}
+
+int event_ring_put(struct event_ring *ring, const input_event_t *ev) {
+  uint32_t mask = ring->size - 1;
+  atomic_val_t pos = atomic_get(&ring->head);
+
+  while (1) {
+    uint32_t idx = (uint32_t)pos & mask;
+    int32_t diff = (int32_t)(slot_seq(ring, idx) - pos);
+
+    if (diff == 0) {
+      if (atomic_cas(&ring->head, pos, pos + 1)) {
+        ring->slots[idx].ev = *ev;
+        slot_set_seq(ring, idx, pos + 1);
+        return 0;
+      }
+    } else if (diff < 0) {
+      // The consumer has not released this slot yet
+      return -ENOMEM;
+    }
+
+    pos = atomic_get(&ring->head);
+  }
+}
+
+bool event_ring_get(struct event_ring *ring, input_event_t *ev) {
+  uint32_t pos = ring->tail;
+  uint32_t idx = pos & (ring->size - 1);
+
+  if ((int32_t)(slot_seq(ring, idx) - (atomic_val_t)(pos + 1)) < 0) {
+    // Empty, or the next producer has not published yet
+    return false;
+  }
+
+  *ev = ring->slots[idx].ev;
+  slot_set_seq(ring, idx, pos + ring->size);
+  ring->tail = pos + 1;
+  return true;
+}
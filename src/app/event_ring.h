@@ -0,0 +1,65 @@
+/**
+ * @file event_ring.h
+ * @brief Lock-free multi-producer, single-consumer ring of input events
+ */
+
+#pragma once
+
+#include "app_interface.h"
+#include <stdbool.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+/**
+ * @brief Ring slot
+ *
+ * @c seq is kept relative to the slot index so a zero-initialized ring is
+ * ready to use without an init call.
+ */
+struct event_ring_slot {
+  atomic_t seq;     /**< Publication sequence, relative to the slot index */
+  input_event_t ev; /**< Event payload */
+};
+
+/**
+ * @brief Ring state
+ */
+struct event_ring {
+  struct event_ring_slot *slots; /**< Slot storage, size must be a power of two */
+  uint32_t size;                 /**< Number of slots */
+  atomic_t head;                 /**< Next position reserved by producers */
+  uint32_t tail;                 /**< Next position read by the consumer */
+};
+
+/**
+ * @brief Statically define an event ring
+ *
+ * @param name Ring variable name
+ * @param n Number of slots (power of two)
+ */
+#define EVENT_RING_DEFINE(name, n)                                                  \
+  BUILD_ASSERT(IS_POWER_OF_TWO(n), "event ring size must be a power of two");       \
+  static struct event_ring_slot _##name##_slots[n];                                 \
+  static struct event_ring name = {.slots = _##name##_slots, .size = (n)}
+
+/**
+ * @brief Append an event
+ *
+ * Lock-free and safe to call concurrently from ISRs and threads.
+ *
+ * @param ring Ring
+ * @param ev Event to copy into the ring
+ * @return 0 on success, -ENOMEM if the ring is full
+ */
+int event_ring_put(struct event_ring *ring, const input_event_t *ev);
+
+/**
+ * @brief Remove the oldest published event
+ *
+ * Must only be called from the single consumer thread.
+ *
+ * @param ring Ring
+ * @param ev Destination for the event
+ * @return true if an event was returned, false if none is published
+ */
+bool event_ring_get(struct event_ring *ring, input_event_t *ev);
@@ -1,60 +1,80 @@
 /**
  * @file gpio_event.c
- * @brief GPIO event dispatcher - bridges GPIO callbacks to app events
+ * @brief GPIO event dispatcher - bridges button gestures to app events
  */
 
+#include "gpio_event.h"
 #include "app_interface.h"
-#include "app_manager.h"
+#include "ui_loop.h"
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
 
 LOG_MODULE_REGISTER(gpio_event, LOG_LEVEL_INF);
 
-/**
- * @brief Map GPIO pin to logical key code
- *
- * Maps physical GPIO pins to logical key codes based on your
- * hardware configuration.
- *
- * @param gpio_pin GPIO pin number
- * @return Logical key code
- */
-uint8_t gpio_pin_to_key(uint8_t gpio_pin) {
-  // Adjust these mappings based on your actual GPIO configuration
-  // This is just an example mapping
-  switch (gpio_pin) {
-  case 26:
-    return INPUT_KEY_BACK; // SW0
-  case 25:
-    return INPUT_KEY_UP; // SW1
-  case 32:
-    return INPUT_KEY_DOWN; // SW2
-  case 4:
-    return INPUT_KEY_ENTER; // SW3
-  default:
-    return gpio_pin;
-  }
-}
+BUILD_ASSERT(GPIO_KEY_RELEASE == INPUT_KEY_VALUE_RELEASE &&
+                 GPIO_KEY_PRESS == INPUT_KEY_VALUE_PRESS &&
+                 GPIO_KEY_LONG_PRESS == INPUT_KEY_VALUE_LONG_PRESS &&
+                 GPIO_KEY_REPEAT == INPUT_KEY_VALUE_REPEAT &&
+                 GPIO_KEY_DOUBLE_PRESS == INPUT_KEY_VALUE_DOUBLE_PRESS &&
+                 GPIO_KEY_SHORT_PRESS == INPUT_KEY_VALUE_SHORT_PRESS,
+             "gesture codes must match the key event values");
 
-/**
- * @brief Enhanced GPIO button callback with key mapping
- *
- * @param gpio_pin GPIO pin number
- * @param pressed true if pressed, false if released
- */
-void gpio_button_callback_mapped(uint8_t gpio_pin, bool pressed) {
-  // Button 0 (pin 26, SW0) is reserved for app switching
-  // Only trigger on button press (not release)
-  if (gpio_pin == 26 && pressed) {
+/* Logical key of each swN alias */
+static const uint8_t sw_keys[] = {
+    INPUT_KEY_BACK,  // SW0
+    INPUT_KEY_UP,    // SW1
+    INPUT_KEY_DOWN,  // SW2
+    INPUT_KEY_ENTER, // SW3
+};
+
+uint8_t gpio_sw_to_key(uint8_t sw) { return sw < ARRAY_SIZE(sw_keys) ? sw_keys[sw] : sw; }
+
+void gpio_key_event(uint8_t sw, enum gpio_key_gesture gesture, uint32_t timestamp) {
+  uint8_t key_code = gpio_sw_to_key(sw);
+
+  // A BACK click is reserved for app switching. It is only known to be one
+  // once no chord, long or double press took it, so the press itself is
+  // withheld and the short press switches.
+  if (key_code == INPUT_KEY_BACK && gesture == GPIO_KEY_PRESS) {
+    return;
+  }
+  if (key_code == INPUT_KEY_BACK && gesture == GPIO_KEY_SHORT_PRESS) {
     LOG_INF("App switch button pressed");
-    app_manager_switch_next();
+    input_event_t ev = {.type = INPUT_EVENT_TYPE_SYSTEM,
+                        .code = INPUT_SYSTEM_APP_SWITCH,
+                        .timestamp = timestamp};
+    ui_loop_post_event(&ev);
     return;
   }
 
-  uint8_t key_code = gpio_pin_to_key(gpio_pin);
+  input_event_t ev = {.type = INPUT_EVENT_TYPE_KEY,
+                      .code = key_code,
+                      .value = gesture,
+                      .timestamp = timestamp};
+
+  LOG_INF("Key event: code=%d, gesture=%d", key_code, gesture);
+  if (ui_loop_post_event(&ev) != 0) {
+    LOG_WRN("UI event queue full, dropping key %d", key_code);
+  }
+}
 
-  input_event_t ev = {.type = INPUT_EVENT_TYPE_KEY, .code = key_code, .value = pressed ? 1 : 0};
+void gpio_chord_event(uint8_t sw_mask, uint32_t timestamp) {
+  uint8_t key_mask = 0;
 
-  LOG_INF("Key event: code=%d, pressed=%d", key_code, pressed);
-  app_manager_handle_event(&ev);
+  for (uint8_t sw = 0; sw < ARRAY_SIZE(sw_keys); sw++) {
+    if (sw_mask & BIT(sw)) {
+      key_mask |= BIT(sw_keys[sw]);
+    }
+  }
+
+  input_event_t ev = {.type = INPUT_EVENT_TYPE_CHORD,
+                      .code = key_mask,
+                      .value = 1,
+                      .timestamp = timestamp};
+
+  LOG_INF("Chord event: keys=0x%02x", key_mask);
+  if (ui_loop_post_event(&ev) != 0) {
+    LOG_WRN("UI event queue full, dropping chord 0x%02x", key_mask);
+  }
 }
@@ -1,6 +1,10 @@
 /**
  * @file gpio_event.h
  * @brief GPIO event dispatcher header
+ *
+ * Buttons are identified by their devicetree alias index (sw0..sw3) so this
+ * header can be used next to the Zephyr input headers, whose INPUT_KEY_*
+ * codes clash with the app key codes.
  */
 
 #pragma once
@@ -9,17 +13,38 @@
 #include <stdint.h>
 
 /**
- * @brief Enhanced GPIO button callback with key mapping
+ * @brief Button gestures reported by the recognizer
+ */
+enum gpio_key_gesture {
+  GPIO_KEY_RELEASE = 0,
+  GPIO_KEY_PRESS = 1,
+  GPIO_KEY_LONG_PRESS = 2,
+  GPIO_KEY_REPEAT = 3,
+  GPIO_KEY_DOUBLE_PRESS = 4,
+  GPIO_KEY_SHORT_PRESS = 5,
+};
+
+/**
+ * @brief Queue a button gesture for the UI thread
+ *
+ * @param sw Button index (swN devicetree alias)
+ * @param gesture Recognized gesture
+ * @param timestamp k_cycle_get_32() when the gesture was recognized
+ */
+void gpio_key_event(uint8_t sw, enum gpio_key_gesture gesture, uint32_t timestamp);
+
+/**
+ * @brief Queue a two-button chord for the UI thread
  *
- * @param gpio_pin GPIO pin number
- * @param pressed true if pressed, false if released
+ * @param sw_mask Bitmask of the button indexes (BIT(swN)) held together
+ * @param timestamp k_cycle_get_32() when the chord was recognized
  */
-void gpio_button_callback_mapped(uint8_t gpio_pin, bool pressed);
+void gpio_chord_event(uint8_t sw_mask, uint32_t timestamp);
 
 /**
- * @brief Map GPIO pin to logical key code
+ * @brief Map a button index to a logical key code
  *
- * @param gpio_pin GPIO pin number
- * @return Logical key code
+ * @param sw Button index (swN devicetree alias)
+ * @return Logical key code (INPUT_KEY_*)
  */
-uint8_t gpio_pin_to_key(uint8_t gpio_pin);
+uint8_t gpio_sw_to_key(uint8_t sw);
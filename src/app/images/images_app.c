@@ -2,22 +2,60 @@
  * @file images_app.c
  * @brief Image viewer application
  *
- * Demonstrates switching between two images using button presses
+ * Demonstrates switching between two images using button presses. The
+ * images come from the asset bundle, dithered to 1bpp at build time in the
+ * panel's layout and run-length coded, and are decoded row by row straight
+ * into the framebuffer; an image widget is only used if the copy isn't
+ * possible (e.g. an image built in another color format).
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
 
+#include "../../display/epd_refresh.h"
+#include "../../display/img_rle.h"
+#include "../../lib/asset_bundle.h"
 #include "../app_interface.h"
+#include "../ui_loop.h"
 #include "lvgl.h"
 
 LOG_MODULE_REGISTER(images_app, LOG_LEVEL_INF);
 
-// External image declarations
-extern const lv_image_dsc_t img1;
-extern const lv_image_dsc_t img2;
+// Bundled images, looked up on init
+static const char *const image_names[] = {"img1", "img2"};
+static const lv_image_dsc_t *images[ARRAY_SIZE(image_names)];
 
-static int current_image = 0; // 0 = img1, 1 = img2
+static int current_image = 0; // index in images
 static lv_obj_t *image_widget = NULL;
+static bool active = false;
+
+/**
+ * @brief Show an image, copied into the framebuffer when possible
+ */
+static void show_image(const lv_image_dsc_t *img) {
+  lv_display_t *disp = lv_display_get_default();
+  // Centered, with the left edge on a framebuffer byte
+  int32_t x = ROUND_DOWN((lv_display_get_horizontal_resolution(disp) - img->header.w) / 2, 8);
+  int32_t y = (lv_display_get_vertical_resolution(disp) - img->header.h) / 2;
+  uint32_t start = k_cycle_get_32();
+
+  if (image_widget == NULL && epd_refresh_blit_i1(img, MAX(x, 0), y) == 0) {
+    LOG_DBG("Copied %ux%u image in %u us", img->header.w, img->header.h,
+            k_cyc_to_us_floor32(k_cycle_get_32() - start));
+    return;
+  }
+
+  if (image_widget == NULL) {
+    // Draw through LVGL: the screen covers the framebuffer again
+    lv_obj_set_style_bg_opa(lv_scr_act(), LV_OPA_COVER, LV_PART_MAIN);
+    image_widget = lv_image_create(lv_scr_act());
+    lv_obj_align(image_widget, LV_ALIGN_CENTER, 0, 0);
+  }
+  lv_image_set_src(image_widget, img);
+}
 
 /**
  * @brief Initialize the image viewer app UI
@@ -28,17 +66,24 @@ static void images_app_init(void) {
   // Clean the screen
   lv_obj_clean(lv_scr_act());
 
-  // Create image widget
-  image_widget = lv_image_create(lv_scr_act());
-
-  // Set initial image
-  lv_image_set_src(image_widget, &img1);
-  lv_obj_set_style_transform_scale(image_widget, 256, LV_PART_MAIN);
+  // Let the copied pixels show through: LVGL doesn't clear the framebuffer
+  // of a display without alpha under a transparent screen
+  lv_obj_set_style_bg_opa(lv_scr_act(), LV_OPA_TRANSP, LV_PART_MAIN);
 
-  // Center the image
-  lv_obj_align(image_widget, LV_ALIGN_CENTER, 0, 0);
+  for (size_t i = 0; i < ARRAY_SIZE(images); i++) {
+    images[i] = asset_bundle_image(image_names[i]);
+  }
 
+  active = true;
   current_image = 0;
+  if (images[0] == NULL) {
+    lv_obj_set_style_bg_opa(lv_scr_act(), LV_OPA_COVER, LV_PART_MAIN);
+    lv_obj_t *label = lv_label_create(lv_scr_act());
+    lv_label_set_text(label, "No images,\nflash the assets");
+    lv_obj_align(label, LV_ALIGN_CENTER, 0, 0);
+    return;
+  }
+  show_image(images[0]);
 }
 
 /**
@@ -47,7 +92,9 @@ static void images_app_init(void) {
 static void images_app_deinit(void) {
   LOG_INF("Image viewer app deinit");
   lv_obj_clean(lv_scr_act());
+  lv_obj_set_style_bg_opa(lv_scr_act(), LV_OPA_COVER, LV_PART_MAIN);
   image_widget = NULL;
+  active = false;
 }
 
 /**
@@ -56,7 +103,7 @@ static void images_app_deinit(void) {
  * @param ev Input event
  */
 static void images_app_handle_event(input_event_t *ev) {
-  if (ev == NULL || image_widget == NULL) {
+  if (ev == NULL || !active) {
     return;
   }
 
@@ -70,12 +117,9 @@ static void images_app_handle_event(input_event_t *ev) {
       // Toggle between images on any button press
       current_image = 1 - current_image;
 
-      if (current_image == 0) {
-        lv_image_set_src(image_widget, &img1);
-        LOG_INF("Switched to image 1");
-      } else {
-        lv_image_set_src(image_widget, &img2);
-        LOG_INF("Switched to image 2");
+      if (images[current_image] != NULL) {
+        show_image(images[current_image]);
+        LOG_INF("Switched to image %d", current_image + 1);
       }
       break;
     }
@@ -90,3 +134,150 @@ IApp ImagesApp = {
     .deinit = images_app_deinit,
     .handle_event = images_app_handle_event,
 };
+
+#if defined(CONFIG_SHELL)
+/* Per-frame cost of the draw paths over a full frame and a band of rows */
+static const lv_area_t bench_areas[] = {
+    {0, 0, 199, 199},  // full frame
+    {0, 60, 199, 123}, // band behind the clock digits
+};
+
+/* Decode an image once into a plain I1 copy, the uncompressed path */
+static uint8_t *bench_unpack(const lv_image_dsc_t *img) {
+  struct img_rle_cursor cur;
+  uint8_t *pixels = k_malloc(img->header.stride * img->header.h);
+
+  if (pixels == NULL) {
+    return NULL;
+  }
+  if (!img_rle_is_rle(img)) {
+    memcpy(pixels, img->data + 8 /* palette */, img->header.stride * img->header.h);
+    return pixels;
+  }
+  if (img_rle_seek(&cur, img, 0) < 0) {
+    k_free(pixels);
+    return NULL;
+  }
+  for (int32_t y = 0; y < img->header.h; y++) {
+    img_rle_next_row(&cur, &pixels[y * img->header.stride]);
+  }
+  return pixels;
+}
+
+static uint32_t bench_ns(uint32_t start, int runs) {
+  return (uint32_t)((uint64_t)k_cyc_to_us_floor32(k_cycle_get_32() - start) * 1000 / runs);
+}
+
+struct bench_decode {
+  const lv_image_dsc_t *img;
+  const lv_area_t *area;
+  int runs;
+  uint32_t ns;
+};
+
+/* Runs on the UI thread: the decoder, its scratch buffer and the LVGL heap
+ * are shared with the image being drawn */
+static void bench_decoder(void *arg) {
+  struct bench_decode *b = arg;
+  lv_image_decoder_dsc_t dsc;
+  uint32_t start = k_cycle_get_32();
+
+  for (int r = 0; r < b->runs; r++) {
+    lv_area_t decoded = {LV_COORD_MIN, LV_COORD_MIN, LV_COORD_MIN, LV_COORD_MIN};
+
+    if (lv_image_decoder_open(&dsc, b->img, NULL) != LV_RESULT_OK) {
+      break;
+    }
+    while (lv_image_decoder_get_area(&dsc, b->area, &decoded) == LV_RESULT_OK) {
+    }
+    lv_image_decoder_close(&dsc);
+  }
+  b->ns = bench_ns(start, b->runs);
+}
+
+static int cmd_images_bench(const struct shell *sh, size_t argc, char **argv) {
+  int runs = argc > 1 ? atoi(argv[1]) : 20;
+
+  if (runs <= 0) {
+    shell_error(sh, "usage: images bench [runs]");
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(image_names); i++) {
+    const lv_image_dsc_t *img = asset_bundle_image(image_names[i]);
+
+    if (img == NULL) {
+      shell_error(sh, "%s not in the asset bundle", image_names[i]);
+      continue;
+    }
+
+    uint32_t stride = img->header.stride;
+    uint8_t *pixels = bench_unpack(img);
+    uint8_t *frame = k_malloc(stride * img->header.h);
+
+    if (pixels == NULL || frame == NULL) {
+      k_free(pixels);
+      k_free(frame);
+      return -ENOMEM;
+    }
+
+    shell_print(sh, "%s: %ux%u, %u bytes I1, %u bytes stored%s", image_names[i], img->header.w,
+                img->header.h, 8 + stride * img->header.h, img->data_size,
+                img_rle_is_rle(img) ? " (RLE)" : "");
+
+    for (size_t j = 0; j < ARRAY_SIZE(bench_areas); j++) {
+      lv_area_t a = bench_areas[j];
+      uint32_t start;
+
+      if (a.y2 >= img->header.h) {
+        continue;
+      }
+
+      // Uncompressed: the straight row copy of epd_refresh_blit_i1()
+      start = k_cycle_get_32();
+      for (int r = 0; r < runs; r++) {
+        for (int32_t y = a.y1; y <= a.y2; y++) {
+          memcpy(&frame[y * stride], &pixels[y * stride], stride);
+        }
+      }
+      uint32_t raw_ns = bench_ns(start, runs);
+
+      // Compressed: seek to the first row, decode the rows of the area
+      uint32_t rle_ns = 0;
+      if (img_rle_is_rle(img)) {
+        struct img_rle_cursor cur;
+
+        start = k_cycle_get_32();
+        for (int r = 0; r < runs; r++) {
+          img_rle_seek(&cur, img, a.y1);
+          for (int32_t y = a.y1; y <= a.y2; y++) {
+            img_rle_next_row(&cur, &frame[y * stride]);
+          }
+        }
+        rle_ns = bench_ns(start, runs);
+      }
+
+      // LVGL decoder: bands of the area expanded into the scratch buffer
+      struct bench_decode dec = {.img = img, .area = &a, .runs = runs};
+      if (img_rle_is_rle(img)) {
+        ui_loop_call(bench_decoder, &dec);
+      }
+
+      shell_print(sh, "  rows %d-%d: copy %u ns, rle %u ns, decoder %u ns per frame", a.y1, a.y2,
+                  raw_ns, rle_ns, dec.ns);
+    }
+
+    k_free(pixels);
+    k_free(frame);
+  }
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(images_cmds,
+                               SHELL_CMD_ARG(bench, NULL,
+                                             "Time compressed vs uncompressed image draws [runs]",
+                                             cmd_images_bench, 1, 1),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(images, &images_cmds, "Image viewer commands", NULL);
+#endif
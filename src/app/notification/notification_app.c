@@ -1,10 +1,16 @@
 /**
  * @file notification_app.c
  * @brief Simple notification preview app
+ *
+ * Shows the newest notification. One stored as a summary gets the rest of
+ * its attributes fetched on opening, the text fills in when they arrive.
  */
 
 #include <zephyr/logging/log.h>
 
+#include "../../display/glyph_cache.h"
+#include "../../lib/ancs.h"
+#include "../../lib/notif_store.h"
 #include "../app_interface.h"
 #include "lvgl.h"
 
@@ -12,12 +18,37 @@ LOG_MODULE_REGISTER(notification_app, LOG_LEVEL_INF);
 
 #if defined(HAS_FONT_VI_20)
 LV_FONT_DECLARE(font_vi_20);
-#define NOTIFICATION_FONT &font_vi_20
+#define NOTIFICATION_FONT glyph_cache_wrap(&font_vi_20)
 #else
 #define NOTIFICATION_FONT LV_FONT_DEFAULT
 #endif
 
 static lv_obj_t *noti_label = NULL;
+static struct notif *shown = NULL; /* Notification on screen */
+
+/* Show a notification, taking over the caller's reference */
+static void show(struct notif *notif) {
+  if (shown) {
+    notif_store_put(shown);
+  }
+  shown = notif;
+
+  if (!notif) {
+    lv_label_set_text(noti_label, "Xin chào");
+    return;
+  }
+  lv_label_set_text_fmt(noti_label, "%s\n%s", notif_text(notif, NOTIF_ATTR_TITLE),
+                        notif_text(notif, NOTIF_ATTR_MESSAGE));
+
+#if defined(CONFIG_BT)
+  if (!notif_fetched(notif, NOTIF_ATTR_MESSAGE)) {
+    int err = ancs_fetch_details(notif_uid(notif));
+    if (err) {
+      LOG_WRN("Can't fetch UID 0x%x (err %d)", notif_uid(notif), err);
+    }
+  }
+#endif
+}
 
 static void notification_app_init(void) {
   LOG_INF("Notification app init");
@@ -25,19 +56,41 @@ static void notification_app_init(void) {
   lv_obj_clean(lv_scr_act());
 
   noti_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(noti_label, "Xin chào");
+  lv_obj_set_width(noti_label, lv_pct(100));
+  lv_label_set_long_mode(noti_label, LV_LABEL_LONG_WRAP);
   lv_obj_set_style_text_font(noti_label, NOTIFICATION_FONT, 0);
   lv_obj_set_style_text_align(noti_label, LV_TEXT_ALIGN_CENTER, 0);
   lv_obj_align(noti_label, LV_ALIGN_CENTER, 0, 0);
+  show(notif_store_newest());
 }
 
 static void notification_app_deinit(void) {
   LOG_INF("Notification app deinit");
+  if (shown) {
+    notif_store_put(shown);
+    shown = NULL;
+  }
   lv_obj_clean(lv_scr_act());
   noti_label = NULL;
 }
 
-static void notification_app_handle_event(input_event_t *ev) { (void)ev; }
+static void notification_app_handle_event(input_event_t *ev) {
+  if (ev->type != INPUT_EVENT_TYPE_NOTIFICATION) {
+    return;
+  }
+
+  if (ev->code == INPUT_NOTIFICATION_REMOVED) {
+    if (shown && notif_uid(shown) == (uint32_t)ev->value) {
+      show(notif_store_newest());
+    }
+  } else if (ev->data) {
+    // A new notification, or the details of the one on screen
+    if (ev->code == INPUT_NOTIFICATION_NEW ||
+        (shown && notif_uid(shown) == (uint32_t)ev->value)) {
+      show(notif_store_ref(ev->data));
+    }
+  }
+}
 
 IApp NotificationApp = {
     .init = notification_app_init,
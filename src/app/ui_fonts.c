@@ -0,0 +1,200 @@
+/**
+ * @file ui_fonts.c
+ * @brief Font benchmark over the fonts linked into the apps
+ *
+ * "fonts bench" times what LVGL does per character before blending it: the
+ * glyph descriptor lookup and the bitmap fetch, which expands the stored
+ * 1, 2 or 4bpp bitmap into A8. Together with generated_fonts/font_sizes.txt
+ * of the build it compares font configurations by flash and render time.
+ */
+
+#include "ui_fonts.h"
+#include "../display/glyph_cache.h"
+#include "ui_loop.h"
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#if defined(CONFIG_SHELL)
+LV_FONT_DECLARE(seven_segments_64);
+#if defined(HAS_FONT_VI_20)
+LV_FONT_DECLARE(font_vi_20);
+#endif
+
+/* Linked fonts with text they typically draw, cached through glyph_cache.h */
+static const struct {
+  const char *name;
+  const lv_font_t *font;
+  const char *sample;
+  bool cached;
+} bench_fonts[] = {
+    {"ui_16", UI_FONT_16, "Wed - September 24th 2026"},
+    {"ui_24", UI_FONT_24, "Counter: -42"},
+    {"ui_48", UI_FONT_48, "12:59"},
+    {"seven_segments_64", &seven_segments_64, "12:59"},
+#if defined(HAS_FONT_VI_20)
+    {"font_vi_20", &font_vi_20, "Tin nhắn mới từ Mẹ: Con ăn cơm chưa?"},
+    {"font_vi_20 cached", &font_vi_20, "Tin nhắn mới từ Mẹ: Con ăn cơm chưa?", true},
+#endif
+};
+
+/* Decode the next UTF-8 character, 0 at the end of the string */
+static uint32_t next_codepoint(const char **s) {
+  const uint8_t *p = (const uint8_t *)*s;
+  uint32_t cp;
+  int extra;
+
+  if (*p == 0) {
+    return 0;
+  }
+  if (*p < 0x80) {
+    cp = *p;
+    extra = 0;
+  } else if ((*p & 0xE0) == 0xC0) {
+    cp = *p & 0x1F;
+    extra = 1;
+  } else if ((*p & 0xF0) == 0xE0) {
+    cp = *p & 0x0F;
+    extra = 2;
+  } else {
+    cp = *p & 0x07;
+    extra = 3;
+  }
+  p++;
+  while (extra-- > 0 && (*p & 0xC0) == 0x80) {
+    cp = (cp << 6) | (*p++ & 0x3F);
+  }
+  *s = (const char *)p;
+  return cp;
+}
+
+static uint32_t font_bpp(const lv_font_t *font) {
+  if (font->get_glyph_dsc != lv_font_get_glyph_dsc_fmt_txt) {
+    return 0;
+  }
+  return ((const lv_font_fmt_txt_dsc_t *)font->dsc)->bpp;
+}
+
+static int cmd_fonts_ls(const struct shell *sh, size_t argc, char **argv) {
+  for (size_t i = 0; i < ARRAY_SIZE(bench_fonts); i++) {
+    const lv_font_t *font = bench_fonts[i].font;
+
+    shell_print(sh, "%-18s line height %d, %u bpp", bench_fonts[i].name, font->line_height,
+                font_bpp(font));
+  }
+  return 0;
+}
+
+/*
+ * Run the glyph pipeline over a sample, fetching bitmaps into buf if given.
+ * Returns the glyphs found.
+ */
+static uint32_t bench_sample(const lv_font_t *font, const char *sample, lv_draw_buf_t *buf) {
+  lv_font_glyph_dsc_t g;
+  uint32_t glyphs = 0;
+  uint32_t cp;
+
+  while ((cp = next_codepoint(&sample)) != 0) {
+    if (!lv_font_get_glyph_dsc(font, &g, cp, 0)) {
+      continue;
+    }
+    if (buf != NULL && g.box_w <= buf->header.w && g.box_h <= buf->header.h) {
+      lv_font_get_glyph_bitmap(&g, buf);
+    }
+    glyphs++;
+  }
+  return glyphs;
+}
+
+struct bench_run {
+  const lv_font_t *font;
+  const char *sample;
+  int runs;
+  uint32_t glyphs;
+  uint32_t dsc_us;
+  uint32_t all_us;
+  int err;
+};
+
+/* Runs on the UI thread: the draw buffer comes from the LVGL heap and cached
+ * fonts fill the glyph cache, both shared with the screen being drawn */
+static void bench_font(void *arg) {
+  struct bench_run *b = arg;
+  uint32_t max_w = 1;
+  uint32_t max_h = 1;
+  const char *s = b->sample;
+  lv_font_glyph_dsc_t g;
+  uint32_t cp;
+
+  // The bitmaps expand into an A8 buffer fitting the largest glyph. This
+  // pass also fills the cache, cached fonts are timed on hits
+  while ((cp = next_codepoint(&s)) != 0) {
+    if (lv_font_get_glyph_dsc(b->font, &g, cp, 0)) {
+      max_w = MAX(max_w, g.box_w);
+      max_h = MAX(max_h, g.box_h);
+    }
+  }
+
+  lv_draw_buf_t *buf = lv_draw_buf_create(max_w, max_h, LV_COLOR_FORMAT_A8, 0);
+  if (buf == NULL) {
+    b->err = -ENOMEM;
+    return;
+  }
+
+  uint32_t start = k_cycle_get_32();
+  for (int r = 0; r < b->runs; r++) {
+    b->glyphs = bench_sample(b->font, b->sample, NULL);
+  }
+  b->dsc_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+  start = k_cycle_get_32();
+  for (int r = 0; r < b->runs; r++) {
+    bench_sample(b->font, b->sample, buf);
+  }
+  b->all_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+  lv_draw_buf_destroy(buf);
+}
+
+static int cmd_fonts_bench(const struct shell *sh, size_t argc, char **argv) {
+  int runs = argc > 1 ? atoi(argv[1]) : 100;
+
+  if (runs <= 0) {
+    shell_error(sh, "usage: fonts bench [runs]");
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(bench_fonts); i++) {
+    struct bench_run b = {
+        .font = bench_fonts[i].cached ? glyph_cache_wrap(bench_fonts[i].font)
+                                      : bench_fonts[i].font,
+        .sample = bench_fonts[i].sample,
+        .runs = runs,
+    };
+
+    ui_loop_call(bench_font, &b);
+    if (b.err < 0) {
+      return b.err;
+    }
+    if (b.glyphs == 0) {
+      shell_print(sh, "%-18s no glyphs of the sample", bench_fonts[i].name);
+      continue;
+    }
+
+    uint64_t per = (uint64_t)runs * b.glyphs;
+    shell_print(sh, "%-18s %u bpp, %2u glyphs: dsc %u ns, bitmap %u ns per glyph",
+                bench_fonts[i].name, font_bpp(bench_fonts[i].font), b.glyphs,
+                (uint32_t)(b.dsc_us * 1000ULL / per),
+                (uint32_t)((b.all_us - MIN(b.dsc_us, b.all_us)) * 1000ULL / per));
+  }
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(fonts_cmds,
+                               SHELL_CMD(ls, NULL, "List the linked fonts", cmd_fonts_ls),
+                               SHELL_CMD_ARG(bench, NULL, "Time glyph lookup and bitmaps [runs]",
+                                             cmd_fonts_bench, 1, 1),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(fonts, &fonts_cmds, "Font commands", NULL);
+#endif
@@ -0,0 +1,25 @@
+/**
+ * @file ui_fonts.h
+ * @brief Fonts of the app UI
+ *
+ * The UI sizes are Montserrat subset to the strings the apps draw and
+ * thresholded to 1bpp at build time (see CMakeLists.txt). Without LVGL's
+ * Montserrat source they fall back to the built-in 4bpp fonts.
+ */
+
+#pragma once
+
+#include "lvgl.h"
+
+#if defined(HAS_UI_FONTS)
+LV_FONT_DECLARE(ui_font_16);
+LV_FONT_DECLARE(ui_font_24);
+LV_FONT_DECLARE(ui_font_48);
+#define UI_FONT_16 (&ui_font_16)
+#define UI_FONT_24 (&ui_font_24)
+#define UI_FONT_48 (&ui_font_48)
+#else
+#define UI_FONT_16 (&lv_font_montserrat_16)
+#define UI_FONT_24 (&lv_font_montserrat_24)
+#define UI_FONT_48 (&lv_font_montserrat_48)
+#endif
@@ -0,0 +1,301 @@
+/**
+ * @file ui_loop.c
+ * @brief Event-driven UI loop
+ *
+ * The loop sleeps in k_poll() on three sources: the event-posted signal,
+ * the deadline of the next LVGL timer and the display refresh-complete
+ * signal. Nothing wakes the CPU unless one of them has work for it.
+ *
+ * Producers (GPIO ISRs, BT threads) only touch the lock-free event ring;
+ * LVGL and the apps are only ever called from this thread.
+ */
+
+#include "ui_loop.h"
+#include "app_manager.h"
+#include "event_ring.h"
+#include <lvgl.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(ui_loop, LOG_LEVEL_INF);
+
+#ifndef CONFIG_UI_LOOP_EVENT_QUEUE_SIZE
+#define CONFIG_UI_LOOP_EVENT_QUEUE_SIZE 16
+#endif
+
+/* Event types tracked by the latency histogram (index = input_event_t.type) */
+#define LATENCY_TYPES 8
+
+EVENT_RING_DEFINE(ui_event_ring, CONFIG_UI_LOOP_EVENT_QUEUE_SIZE);
+
+static struct k_poll_signal event_sig = K_POLL_SIGNAL_INITIALIZER(event_sig);
+static struct k_poll_signal display_done_sig = K_POLL_SIGNAL_INITIALIZER(display_done_sig);
+
+static void (*event_done_cb)(input_event_t *ev);
+
+static struct ui_loop_stats stats;
+static atomic_t dropped;
+
+/* Latency tracking, only touched from the UI thread */
+static struct ui_latency_hist latency[LATENCY_TYPES];
+static uint32_t pending_since[LATENCY_TYPES];
+static uint8_t pending_mask;
+static bool invalidated;
+static uint32_t render_start;
+
+/* Function waiting to run on the UI thread, see ui_loop_call() */
+static K_MUTEX_DEFINE(call_mutex);
+static K_SEM_DEFINE(call_done, 0, 1);
+static void (*volatile call_fn)(void *arg);
+static void *call_arg;
+
+int ui_loop_post_event(const input_event_t *ev) {
+  int ret = event_ring_put(&ui_event_ring, ev);
+  if (ret != 0) {
+    atomic_inc(&dropped);
+    return -ENOMSG;
+  }
+
+  k_poll_signal_raise(&event_sig, 0);
+  return 0;
+}
+
+void ui_loop_call(void (*fn)(void *arg), void *arg) {
+  k_mutex_lock(&call_mutex, K_FOREVER);
+  call_arg = arg;
+  call_fn = fn;
+  k_poll_signal_raise(&event_sig, 0);
+  k_sem_take(&call_done, K_FOREVER);
+  k_mutex_unlock(&call_mutex);
+}
+
+void ui_loop_notify_display_done(void) { k_poll_signal_raise(&display_done_sig, 0); }
+
+void ui_loop_set_event_done_cb(void (*cb)(input_event_t *ev)) { event_done_cb = cb; }
+
+void ui_loop_get_stats(struct ui_loop_stats *out) {
+  *out = stats;
+  out->dropped = (uint32_t)atomic_get(&dropped);
+}
+
+void ui_loop_reset_stats(void) {
+  stats = (struct ui_loop_stats){0};
+  stats.since_ms = k_uptime_get();
+  atomic_clear(&dropped);
+  memset(latency, 0, sizeof(latency));
+}
+
+int ui_loop_get_latency(uint8_t type, struct ui_latency_hist *hist) {
+  if (type >= LATENCY_TYPES) {
+    return -EINVAL;
+  }
+  *hist = latency[type];
+  return 0;
+}
+
+static void latency_record(uint8_t type, uint32_t cycles) {
+  struct ui_latency_hist *h = &latency[type];
+  uint32_t us = k_cyc_to_us_floor32(cycles);
+  uint32_t ms = us / 1000;
+  uint8_t bucket = ms == 0 ? 0 : MIN(LOG2(ms) + 1, UI_LATENCY_BUCKETS - 1);
+
+  h->buckets[bucket]++;
+  h->count++;
+  h->total_us += us;
+  h->max_us = MAX(h->max_us, us);
+}
+
+static void display_invalidate_cb(lv_event_t *e) {
+  LV_UNUSED(e);
+  invalidated = true;
+}
+
+static void display_render_start_cb(lv_event_t *e) {
+  LV_UNUSED(e);
+  render_start = k_cycle_get_32();
+}
+
+static void display_render_ready_cb(lv_event_t *e) {
+  LV_UNUSED(e);
+  uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - render_start);
+
+  stats.renders++;
+  stats.render_us += us;
+  stats.max_render_us = MAX(stats.max_render_us, us);
+}
+
+static void display_refr_ready_cb(lv_event_t *e) {
+  LV_UNUSED(e);
+  uint32_t now = k_cycle_get_32();
+
+  for (uint8_t type = 0; type < LATENCY_TYPES; type++) {
+    if (pending_mask & BIT(type)) {
+      latency_record(type, now - pending_since[type]);
+    }
+  }
+  pending_mask = 0;
+}
+
+static void dispatch_pending_events(void) {
+  input_event_t ev;
+
+  while (event_ring_get(&ui_event_ring, &ev)) {
+    invalidated = false;
+    app_manager_handle_event(&ev);
+    stats.dispatched++;
+
+    // Measure from the source timestamp to the end of the flush the event caused
+    if (ev.type < LATENCY_TYPES) {
+      if (invalidated) {
+        if (!(pending_mask & BIT(ev.type))) {
+          pending_since[ev.type] = ev.timestamp;
+          pending_mask |= BIT(ev.type);
+        }
+      } else {
+        latency[ev.type].no_redraw++;
+      }
+    }
+
+    if (event_done_cb != NULL) {
+      event_done_cb(&ev);
+    }
+  }
+}
+
+void ui_loop_run(void) {
+  struct k_poll_event events[] = {
+      K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &event_sig),
+      K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &display_done_sig),
+  };
+
+  lv_display_t *display = lv_display_get_default();
+  lv_display_add_event_cb(display, display_invalidate_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+  lv_display_add_event_cb(display, display_refr_ready_cb, LV_EVENT_REFR_READY, NULL);
+  lv_display_add_event_cb(display, display_render_start_cb, LV_EVENT_RENDER_START, NULL);
+  lv_display_add_event_cb(display, display_render_ready_cb, LV_EVENT_RENDER_READY, NULL);
+
+  ui_loop_reset_stats();
+
+  while (1) {
+    // Drain before sleeping: producers may have posted before the first poll
+    dispatch_pending_events();
+
+    if (call_fn != NULL) {
+      call_fn(call_arg);
+      call_fn = NULL;
+      k_sem_give(&call_done);
+    }
+
+    // Run due LVGL timers (including display refresh) and learn when the next one is due
+    uint32_t next_ms = lv_timer_handler();
+    k_timeout_t timeout = next_ms == LV_NO_TIMER_READY ? K_FOREVER : K_MSEC(next_ms);
+
+    int ret = k_poll(events, ARRAY_SIZE(events), timeout);
+    stats.wakeups++;
+
+    if (ret == -EAGAIN) {
+      stats.wake_timer++;
+    }
+
+    if (events[1].state == K_POLL_STATE_SIGNALED) {
+      stats.wake_display++;
+      k_poll_signal_reset(&display_done_sig);
+    }
+
+    if (events[0].state == K_POLL_STATE_SIGNALED) {
+      stats.wake_event++;
+      // Reset before draining so a post racing with the drain wakes us again
+      k_poll_signal_reset(&event_sig);
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(events); i++) {
+      events[i].state = K_POLL_STATE_NOT_READY;
+    }
+  }
+}
+
+#if defined(CONFIG_SHELL)
+static const char *const event_type_names[LATENCY_TYPES] = {
+    [INPUT_EVENT_TYPE_KEY] = "key",
+    [INPUT_EVENT_TYPE_TOUCH] = "touch",
+    [INPUT_EVENT_TYPE_NOTIFICATION] = "notification",
+    [INPUT_EVENT_TYPE_SYSTEM] = "system",
+    [INPUT_EVENT_TYPE_CHORD] = "chord",
+    [INPUT_EVENT_TYPE_TICK] = "tick",
+    [INPUT_EVENT_TYPE_CALL] = "call",
+};
+
+static int cmd_ui_stats(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  struct ui_loop_stats s;
+  ui_loop_get_stats(&s);
+
+  int64_t elapsed_ms = k_uptime_get() - s.since_ms;
+  uint32_t per_hour = elapsed_ms > 0 ? (uint32_t)((int64_t)s.wakeups * 3600000 / elapsed_ms) : 0;
+
+  shell_print(sh, "window:     %lld ms", elapsed_ms);
+  shell_print(sh, "wakeups:    %u (%u/h)", s.wakeups, per_hour);
+  shell_print(sh, "  event:    %u", s.wake_event);
+  shell_print(sh, "  timer:    %u", s.wake_timer);
+  shell_print(sh, "  display:  %u", s.wake_display);
+  shell_print(sh, "dispatched: %u", s.dispatched);
+  shell_print(sh, "dropped:    %u", s.dropped);
+  shell_print(sh, "renders:    %u, avg %u us, max %u us", s.renders,
+              s.renders ? (uint32_t)(s.render_us / s.renders) : 0, s.max_render_us);
+  return 0;
+}
+
+static int cmd_ui_latency(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  for (uint8_t type = 0; type < LATENCY_TYPES; type++) {
+    struct ui_latency_hist h;
+    ui_loop_get_latency(type, &h);
+    if (h.count == 0 && h.no_redraw == 0) {
+      continue;
+    }
+
+    const char *name = event_type_names[type] ? event_type_names[type] : "other";
+    shell_print(sh, "%s: %u flushed, %u without redraw, avg %u us, max %u us", name, h.count,
+                h.no_redraw, h.count ? (uint32_t)(h.total_us / h.count) : 0, h.max_us);
+    for (int b = 0; b < UI_LATENCY_BUCKETS; b++) {
+      if (h.buckets[b] == 0) {
+        continue;
+      }
+      if (b == 0) {
+        shell_print(sh, "  <1 ms: %u", h.buckets[b]);
+      } else if (b == UI_LATENCY_BUCKETS - 1) {
+        shell_print(sh, "  >=%u ms: %u", (uint32_t)BIT(b - 1), h.buckets[b]);
+      } else {
+        shell_print(sh, "  %u-%u ms: %u", (uint32_t)BIT(b - 1), (uint32_t)BIT(b) - 1,
+                    h.buckets[b]);
+      }
+    }
+  }
+  return 0;
+}
+
+static int cmd_ui_reset(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  ui_loop_reset_stats();
+  shell_print(sh, "UI loop counters reset");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(ui_cmds,
+                               SHELL_CMD(stats, NULL, "Show UI loop wake-up counters", cmd_ui_stats),
+                               SHELL_CMD(latency, NULL, "Show event-to-flush latency histograms",
+                                         cmd_ui_latency),
+                               SHELL_CMD(reset, NULL, "Reset UI loop counters", cmd_ui_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(ui, &ui_cmds, "UI loop commands", NULL);
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file ui_loop.h
+ * @brief Event-driven UI loop owning LVGL and the app event queue
+ */
+
+#pragma once
+
+#include "app_interface.h"
+#include <stdint.h>
+
+/**
+ * @brief Wake-up and render counters of the UI loop
+ */
+struct ui_loop_stats {
+  uint32_t wakeups;       /**< Total number of times the loop left k_poll */
+  uint32_t wake_event;    /**< Wake-ups caused by a queued input event */
+  uint32_t wake_timer;    /**< Wake-ups caused by an LVGL timer becoming due */
+  uint32_t wake_display;  /**< Wake-ups caused by a display refresh completing */
+  uint32_t dispatched;    /**< Events dispatched to the app manager */
+  uint32_t dropped;       /**< Events dropped because the queue was full */
+  uint32_t renders;       /**< Frames rendered by LVGL */
+  uint32_t max_render_us; /**< Slowest frame, from render start to the last flush */
+  uint64_t render_us;     /**< Time spent rendering frames */
+  int64_t since_ms;       /**< Uptime when the counters were last reset */
+};
+
+/**
+ * @brief Number of buckets in a latency histogram
+ *
+ * Bucket 0 counts latencies below 1 ms, bucket n counts [2^(n-1), 2^n) ms and
+ * the last bucket is open-ended.
+ */
+#define UI_LATENCY_BUCKETS 14
+
+/**
+ * @brief Event-to-flush latency histogram for one event type
+ */
+struct ui_latency_hist {
+  uint32_t buckets[UI_LATENCY_BUCKETS]; /**< Log2 millisecond buckets */
+  uint32_t count;                       /**< Events whose redraw was flushed */
+  uint32_t no_redraw;                   /**< Events that did not invalidate the display */
+  uint32_t max_us;                      /**< Worst latency seen */
+  uint64_t total_us;                    /**< Sum of latencies, for the average */
+};
+
+/**
+ * @brief Queue an event for dispatch on the UI thread
+ *
+ * Lock-free; safe to call from ISRs and any thread. The event is copied;
+ * any memory referenced by @p ev->data must stay valid until the done
+ * callback runs. Producers should set @p ev->timestamp with
+ * k_cycle_get_32() when the event originates.
+ *
+ * @param ev Event to queue
+ * @return 0 on success, -ENOMSG if the ring is full
+ */
+int ui_loop_post_event(const input_event_t *ev);
+
+/**
+ * @brief Signal that the display finished a panel refresh
+ *
+ * Safe to call from ISRs and any thread.
+ */
+void ui_loop_notify_display_done(void);
+
+/**
+ * @brief Register a callback invoked after each event has been dispatched
+ *
+ * Lets producers release resources referenced by the event data.
+ *
+ * @param cb Callback, or NULL to remove it
+ */
+void ui_loop_set_event_done_cb(void (*cb)(input_event_t *ev));
+
+/**
+ * @brief Snapshot the wake-up and render counters
+ *
+ * @param stats Destination for the counters
+ */
+void ui_loop_get_stats(struct ui_loop_stats *stats);
+
+/**
+ * @brief Snapshot the event-to-flush latency histogram of an event type
+ *
+ * @param type Event type (INPUT_EVENT_TYPE_*)
+ * @param hist Destination for the histogram
+ * @return 0 on success, -EINVAL if the type is not tracked
+ */
+int ui_loop_get_latency(uint8_t type, struct ui_latency_hist *hist);
+
+/**
+ * @brief Reset the wake-up counters and latency histograms
+ */
+void ui_loop_reset_stats(void);
+
+/**
+ * @brief Run a function on the UI thread and wait for it to return
+ *
+ * For shell commands that need LVGL. Callers are serialized; must not be
+ * called from the UI thread itself.
+ *
+ * @param fn Function, called once between event dispatch and LVGL timers
+ * @param arg Argument passed to @p fn
+ */
+void ui_loop_call(void (*fn)(void *arg), void *arg);
+
+/**
+ * @brief Run the UI loop on the calling thread
+ *
+ * Sleeps in k_poll until an event is queued, the next LVGL timer is due or
+ * the display signals refresh completion. Never returns.
+ */
+void ui_loop_run(void);
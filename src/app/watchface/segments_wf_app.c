@@ -1,170 +1,102 @@
 /**
  * @file segments_wf_app.c
  * @brief Watchface with seven segments font displaying time (hh:mm)
+ *
+ * The face is a single widget (wf_face.h) laid out by face_layout: a minute
+ * change redraws the cells of the digits that changed, usually one.
  */
 
+#include <stdlib.h>
 #include <zephyr/device.h>
-#include <zephyr/drivers/rtc.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
 
-#include "../../lib/ancs.h"
-#include "../../lib/rtc.h"
+#include "../../display/epd_refresh.h"
+#include "../../display/glyph_cache.h"
+#include "../../display/seg_digits.h"
+#include "../../lib/notif_store.h"
+#include "../../lib/timekeeping.h"
 #include "../app_interface.h"
+#include "../ui_fonts.h"
+#include "../ui_loop.h"
 #include "lvgl.h"
+#include "wf_face.h"
+#include "wf_model.h"
 
 LOG_MODULE_REGISTER(segments_wf_app, LOG_LEVEL_INF);
 
-// Declare the generated seven segments font
+// Declare the generated seven segments font and its sprites
 LV_FONT_DECLARE(seven_segments_64);
 LV_FONT_DECLARE(font_vi_20);
+extern const struct digit_sprite_set seven_segments_64_sprites;
+
+// Hour in a black box left of the colon, minutes right of it, then the
+// date line and the week day squares below
+static const struct wf_face_layout face_layout = {
+    .digits = &seven_segments_64_sprites,
+    .digit_font = &seven_segments_64,
+    .date_font = UI_FONT_16,
+    .center =
+        {
+            [WF_FACE_HOUR] = {-50, -20},
+            [WF_FACE_COLON] = {0, -20},
+            [WF_FACE_MINUTE] = {50, -20},
+            [WF_FACE_DATE] = {0, 50},
+            [WF_FACE_WEEKDAYS] = {0, 80},
+        },
+    .hour_pad = 8,
+    .hour_radius = 10,
+    .date_w = 200,
+    .day_size = 12,
+    .day_gap = 4,
+    .day_radius = 3,
+};
 
-static lv_obj_t *hour_label = NULL;
-static lv_obj_t *min_label = NULL;
-static lv_obj_t *colon_label = NULL;
-static lv_obj_t *date_label = NULL;
-static lv_obj_t *weekday_rects[7] = {NULL};
-static lv_timer_t *update_timer = NULL;
+static lv_obj_t *face = NULL;
 static lv_timer_t *notification_timer = NULL;
 static lv_obj_t *notification_box = NULL;
-static const struct device *rtc = NULL;
-
-static void update_time_cb(lv_timer_t *timer) {
-  LV_UNUSED(timer);
+static lv_obj_t *notification_label = NULL;
+static struct notif *shown = NULL; /* Notification in the box */
 
-  if (hour_label == NULL || rtc == NULL) {
+/* On a tick the minute has just begun on the RTC, whatever the soft clock says */
+static void update_time(bool on_tick) {
+  if (face == NULL) {
     return;
   }
 
   struct rtc_time tm;
-  int ret = rtc_get_time(rtc, &tm);
-  LOG_DBG("RTC time: %02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
-
-  if (ret < 0) {
-    LOG_ERR("Failed to get RTC time: %d", ret);
-    return;
-  }
-
-  // Update hour and minute labels
-  if (hour_label && min_label) {
-    lv_label_set_text_fmt(hour_label, "%02d", tm.tm_hour);
-    lv_label_set_text_fmt(min_label, "%02d", tm.tm_min);
+  if (on_tick) {
+    timekeeping_get_local_minute(&tm);
+  } else {
+    timekeeping_get_local(&tm);
   }
+  LOG_DBG("Local time: %02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
 
-  // Update date label
-  if (date_label) {
-    const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
-                            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
-    const char *days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
-    const char *month_name = months[tm.tm_mon];
-    const char *day_name = days[tm.tm_wday];
-
-    // Format: "Month Dth Year\nDayOfWeek" (e.g., "Mar 3rd 2021\nMon")
-    const char *suffix = "th";
-    int day = tm.tm_mday;
-    if (day % 10 == 1 && day != 11) {
-      suffix = "st";
-    } else if (day % 10 == 2 && day != 12) {
-      suffix = "nd";
-    } else if (day % 10 == 3 && day != 13) {
-      suffix = "rd";
-    }
-
-    lv_label_set_text_fmt(date_label, "%s - %s %d%s %d", day_name, month_name,
-                          day, suffix, tm.tm_year + 1900);
-  }
-
-  // Update week day indicators
-  for (int i = 0; i < 7; i++) {
-    if (weekday_rects[i]) {
-      if (i == tm.tm_wday) {
-        lv_obj_set_style_bg_color(weekday_rects[i], lv_color_black(), 0);
-      } else {
-        lv_obj_set_style_bg_color(weekday_rects[i], lv_color_white(), 0);
-      }
-    }
-  }
+  // The face only invalidates what changed to keep the refreshed area small
+  wf_face_set_time(face, &tm);
 }
 
 static void segments_wf_app_init(void) {
   LOG_INF("Segments watchface app init");
 
-  // Get RTC device
-  rtc = DEVICE_DT_GET(DT_ALIAS(rtc));
-  if (!device_is_ready(rtc)) {
-    LOG_ERR("RTC device not ready");
-    rtc = NULL;
-  }
-
   // Clean screen and set a white background
   lv_obj_clean(lv_scr_act());
 
-  // Style: seven segments font for time display
-  static lv_style_t time_style;
-  lv_style_init(&time_style);
-  lv_style_set_text_font(&time_style, &seven_segments_64);
-
-  // Create hour label with black background and white text
-  hour_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(hour_label, "00");
-  lv_obj_align(hour_label, LV_ALIGN_CENTER, -50, -20);
-  lv_obj_add_style(hour_label, &time_style, 0);
-
-  static lv_style_t hour_style;
-  lv_style_init(&hour_style);
-  lv_style_set_bg_color(&hour_style, lv_color_black());
-  lv_style_set_bg_opa(&hour_style, LV_OPA_COVER);
-  lv_style_set_text_color(&hour_style, lv_color_white());
-  lv_style_set_pad_all(&hour_style, 8);
-  lv_style_set_radius(&hour_style, 10);
-  lv_obj_add_style(hour_label, &hour_style, 0);
-
-  // Create colon separator
-  colon_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(colon_label, ":");
-  lv_obj_align(colon_label, LV_ALIGN_CENTER, 0, -20);
-  lv_obj_add_style(colon_label, &time_style, 0);
-
-  // Create minute label
-  min_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(min_label, "00");
-  lv_obj_align(min_label, LV_ALIGN_CENTER, 50, -20);
-  lv_obj_add_style(min_label, &time_style, 0);
-
-  // Create date label with regular font
-  date_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(date_label, "---- -- ----");
-  lv_obj_align(date_label, LV_ALIGN_CENTER, 0, 50);
-
-  static lv_style_t date_style;
-  lv_style_init(&date_style);
-  lv_style_set_text_font(&date_style, &lv_font_montserrat_16);
-  lv_obj_add_style(date_label, &date_style, 0);
-
-  // Create 7 rectangles for week day indicators
-  static lv_style_t rect_style;
-  lv_style_init(&rect_style);
-  lv_style_set_radius(&rect_style, 3);
-  lv_style_set_border_width(&rect_style, 1);
-  lv_style_set_border_color(&rect_style, lv_color_black());
-
-  int rect_width = 12;
-  int rect_height = 12;
-  int spacing = 4;
-  int total_width = (rect_width * 7) + (spacing * 6);
-  int start_x = -total_width / 2;
-
-  for (int i = 0; i < 7; i++) {
-    weekday_rects[i] = lv_obj_create(lv_scr_act());
-    lv_obj_set_size(weekday_rects[i], rect_width, rect_height);
-    lv_obj_align(weekday_rects[i], LV_ALIGN_CENTER,
-                 start_x + (i * (rect_width + spacing)) + (rect_width / 2), 80);
-    lv_obj_add_style(weekday_rects[i], &rect_style, 0);
-    lv_obj_set_style_bg_color(weekday_rects[i], lv_color_white(), 0);
+  face = wf_face_create(lv_scr_act(), &face_layout);
+  if (face == NULL) {
+    LOG_ERR("Can't create the watchface");
+    return;
   }
 
-  // Update immediately, then every second
-  update_time_cb(NULL);
-  update_timer = lv_timer_create(update_time_cb, 1000, NULL);
+  // Update immediately, then on every time tick
+  update_time(false);
+}
+
+static void release_shown(void) {
+  if (shown) {
+    notif_store_put(shown);
+    shown = NULL;
+  }
 }
 
 static void hide_notification_cb(lv_timer_t *timer) {
@@ -173,19 +105,32 @@ static void hide_notification_cb(lv_timer_t *timer) {
   if (notification_box) {
     lv_obj_del(notification_box);
     notification_box = NULL;
+    notification_label = NULL;
     LOG_DBG("Notification box deleted");
   }
   if (notification_timer) {
     notification_timer = NULL;
   }
+  release_shown();
+}
+
+static void set_notification_text(const struct notif *notif) {
+  const char *title = notif_text(notif, NOTIF_ATTR_TITLE);
+  const char *message = notif_text(notif, NOTIF_ATTR_MESSAGE);
+
+  if (*title && *message) {
+    lv_label_set_text_fmt(notification_label, "%s\n%s", title, message);
+  } else if (*title) {
+    lv_label_set_text(notification_label, title);
+  } else if (*message) {
+    lv_label_set_text(notification_label, message);
+  } else {
+    lv_label_set_text(notification_label, "New Notification");
+  }
 }
 
 static void segments_wf_app_deinit(void) {
   LOG_INF("Segments watchface app deinit");
-  if (update_timer) {
-    lv_timer_del(update_timer);
-    update_timer = NULL;
-  }
   if (notification_timer) {
     lv_timer_del(notification_timer);
     notification_timer = NULL;
@@ -193,16 +138,11 @@ static void segments_wf_app_deinit(void) {
   if (notification_box) {
     lv_obj_del(notification_box);
     notification_box = NULL;
+    notification_label = NULL;
   }
+  release_shown();
   lv_obj_clean(lv_scr_act());
-  hour_label = NULL;
-  min_label = NULL;
-  colon_label = NULL;
-  date_label = NULL;
-  for (int i = 0; i < 7; i++) {
-    weekday_rects[i] = NULL;
-  }
-  rtc = NULL;
+  face = NULL;
 }
 
 static void segments_wf_app_handle_event(input_event_t *ev) {
@@ -210,20 +150,54 @@ static void segments_wf_app_handle_event(input_event_t *ev) {
     return;
   }
 
-  // Handle new notification event
-  if (ev->type == INPUT_EVENT_TYPE_NOTIFICATION &&
-      ev->code == INPUT_NOTIFICATION_NEW) {
-    LOG_INF("New notification received");
+  if (ev->type == INPUT_EVENT_TYPE_TICK) {
+    update_time(true);
+    return;
+  }
+
+  if (ev->type != INPUT_EVENT_TYPE_NOTIFICATION) {
+    return;
+  }
+
+  // Close the box when its notification is dismissed on the phone
+  if (ev->code == INPUT_NOTIFICATION_REMOVED) {
+    if (shown && notif_uid(shown) == (uint32_t)ev->value) {
+      if (notification_timer) {
+        lv_timer_del(notification_timer);
+        notification_timer = NULL;
+      }
+      hide_notification_cb(NULL);
+    }
+    return;
+  }
+
+  struct notif *notif = ev->data;
+  if (!notif) {
+    LOG_WRN("Notification data is NULL");
+    return;
+  }
 
-    const struct ancs_notification *notif =
-        (const struct ancs_notification *)ev->data;
-    if (!notif) {
-      LOG_WRN("Notification data is NULL");
-      return;
+  // An update of the notification on screen replaces its text in place
+  if (ev->code == INPUT_NOTIFICATION_MODIFIED) {
+    if (shown && notif_uid(shown) == notif_uid(notif)) {
+      notif_store_put(shown);
+      shown = notif_store_ref(notif);
+      set_notification_text(notif);
     }
+    return;
+  }
 
-    LOG_INF("Notification title: %s", notif->title ? notif->title : "(null)");
-    LOG_INF("Notification message: %s", notif->message ? notif->message : "(null)");
+  // A summary is only listed, it pops up once its message is fetched
+  if (ev->code == INPUT_NOTIFICATION_NEW && !notif_fetched(notif, NOTIF_ATTR_MESSAGE)) {
+    LOG_DBG("Summary of UID 0x%x not shown", notif_uid(notif));
+    return;
+  }
+
+  // Handle new notification event
+  if (ev->code == INPUT_NOTIFICATION_NEW) {
+    LOG_INF("New notification received");
+    LOG_INF("Notification title: %s", notif_text(notif, NOTIF_ATTR_TITLE));
+    LOG_INF("Notification message: %s", notif_text(notif, NOTIF_ATTR_MESSAGE));
 
     // Remove existing notification if any
     if (notification_timer) {
@@ -236,6 +210,8 @@ static void segments_wf_app_handle_event(input_event_t *ev) {
       notification_box = NULL;
       LOG_DBG("Deleted existing notification box");
     }
+    release_shown();
+    shown = notif_store_ref(notif);
 
     // Create notification overlay box
     // Get display width and calculate box width (display_width - 40 for 20px margins)
@@ -268,26 +244,19 @@ static void segments_wf_app_handle_event(input_event_t *ev) {
     lv_label_set_long_mode(noti_label, LV_LABEL_LONG_WRAP);
     lv_obj_set_width(noti_label, box_width - 24);
     lv_obj_align(noti_label, LV_ALIGN_CENTER, 0, 0);
+    notification_label = noti_label;
 
     // Display notification content
-    if (notif->title && notif->message) {
-      lv_label_set_text_fmt(noti_label, "%s\n%s", notif->title, notif->message);
-    } else if (notif->title) {
-      lv_label_set_text(noti_label, notif->title);
-    } else if (notif->message) {
-      lv_label_set_text(noti_label, notif->message);
-    } else {
-      lv_label_set_text(noti_label, "New Notification");
-    }
+    set_notification_text(notif);
 
     LOG_INF("Notification label created with text");
 
-    // Style text label - black text with font_vi_20
+    // Style text label - black text with font_vi_20, glyphs from the cache
     static lv_style_t noti_text_style;
     lv_style_init(&noti_text_style);
     lv_style_set_text_color(&noti_text_style, lv_color_black());
     lv_style_set_text_align(&noti_text_style, LV_TEXT_ALIGN_CENTER);
-    lv_style_set_text_font(&noti_text_style, &font_vi_20);
+    lv_style_set_text_font(&noti_text_style, glyph_cache_wrap(&font_vi_20));
     lv_obj_add_style(noti_label, &noti_text_style, 0);
 
     // Mark the screen as dirty to force a redraw
@@ -305,3 +274,223 @@ IApp SegmentsWatchfaceApp = {
     .deinit = segments_wf_app_deinit,
     .handle_event = segments_wf_app_handle_event,
 };
+
+#if defined(CONFIG_SHELL)
+/*
+ * "wf bench" measures this face against the tree of objects it replaced:
+ * hour, colon and minute digit widgets with theme and local styles, a date
+ * label and seven week day rectangles, rebuilt below as they were. Each
+ * face is built on a scratch screen on the UI thread and its frames are
+ * rendered with the panel held, so the bench neither refreshes the panel nor
+ * adds to its ghosting; the app screen is loaded back afterwards.
+ */
+static struct {
+  lv_obj_t *hour;
+  lv_obj_t *min;
+  lv_obj_t *date;
+  lv_obj_t *days[7];
+  lv_style_t time_style;
+  lv_style_t hour_style;
+  lv_style_t date_style;
+  lv_style_t rect_style;
+  struct wf_model model;
+} tree;
+
+static void tree_create(lv_obj_t *scr) {
+  lv_style_init(&tree.time_style);
+  lv_style_set_text_font(&tree.time_style, &seven_segments_64);
+
+  tree.hour = seg_digits_create(scr, &seven_segments_64_sprites);
+  seg_digits_set_text(tree.hour, "00");
+  lv_obj_align(tree.hour, LV_ALIGN_CENTER, -50, -20);
+  lv_obj_add_style(tree.hour, &tree.time_style, 0);
+
+  lv_style_init(&tree.hour_style);
+  lv_style_set_bg_color(&tree.hour_style, lv_color_black());
+  lv_style_set_bg_opa(&tree.hour_style, LV_OPA_COVER);
+  lv_style_set_text_color(&tree.hour_style, lv_color_white());
+  lv_style_set_pad_all(&tree.hour_style, 8);
+  lv_style_set_radius(&tree.hour_style, 10);
+  lv_obj_add_style(tree.hour, &tree.hour_style, 0);
+
+  lv_obj_t *colon = seg_digits_create(scr, &seven_segments_64_sprites);
+  seg_digits_set_text(colon, ":");
+  lv_obj_align(colon, LV_ALIGN_CENTER, 0, -20);
+  lv_obj_add_style(colon, &tree.time_style, 0);
+
+  tree.min = seg_digits_create(scr, &seven_segments_64_sprites);
+  seg_digits_set_text(tree.min, "00");
+  lv_obj_align(tree.min, LV_ALIGN_CENTER, 50, -20);
+  lv_obj_add_style(tree.min, &tree.time_style, 0);
+
+  tree.date = lv_label_create(scr);
+  lv_label_set_text(tree.date, "---- -- ----");
+  lv_obj_align(tree.date, LV_ALIGN_CENTER, 0, 50);
+
+  lv_style_init(&tree.date_style);
+  lv_style_set_text_font(&tree.date_style, UI_FONT_16);
+  lv_obj_add_style(tree.date, &tree.date_style, 0);
+
+  lv_style_init(&tree.rect_style);
+  lv_style_set_radius(&tree.rect_style, 3);
+  lv_style_set_border_width(&tree.rect_style, 1);
+  lv_style_set_border_color(&tree.rect_style, lv_color_black());
+
+  for (int i = 0; i < 7; i++) {
+    tree.days[i] = lv_obj_create(scr);
+    lv_obj_set_size(tree.days[i], 12, 12);
+    lv_obj_align(tree.days[i], LV_ALIGN_CENTER, -54 + i * 16 + 6, 80);
+    lv_obj_add_style(tree.days[i], &tree.rect_style, 0);
+    lv_obj_set_style_bg_color(tree.days[i], lv_color_white(), 0);
+  }
+  wf_model_reset(&tree.model);
+}
+
+static void tree_set_time(const struct rtc_time *tm) {
+  int prev_wday = tree.model.valid ? tree.model.wday : -1;
+  uint32_t changed = wf_model_update(&tree.model, tm);
+
+  if (changed & WF_CHANGED_HOUR) {
+    seg_digits_set_text(tree.hour, wf_two_digits[tree.model.hour]);
+  }
+  if (changed & WF_CHANGED_MINUTE) {
+    seg_digits_set_text(tree.min, wf_two_digits[tree.model.minute]);
+  }
+  if (changed & WF_CHANGED_DATE) {
+    lv_label_set_text_fmt(tree.date, "%s - %s %s %d", wf_weekday_short[tree.model.wday],
+                          wf_month_short[tree.model.mon], wf_day_ordinal[tree.model.mday],
+                          tree.model.year);
+  }
+  if (changed & WF_CHANGED_WEEKDAY) {
+    if (prev_wday >= 0) {
+      lv_obj_set_style_bg_color(tree.days[prev_wday], lv_color_white(), 0);
+    }
+    lv_obj_set_style_bg_color(tree.days[tree.model.wday], lv_color_black(), 0);
+  }
+}
+
+/* Called once the objects are gone, the styles own allocations too */
+static void tree_destroy(void) {
+  lv_style_reset(&tree.time_style);
+  lv_style_reset(&tree.hour_style);
+  lv_style_reset(&tree.date_style);
+  lv_style_reset(&tree.rect_style);
+}
+
+static uint32_t count_objects(const lv_obj_t *obj) {
+  uint32_t n = 0;
+
+  for (uint32_t i = 0; i < lv_obj_get_child_count(obj); i++) {
+    n += 1 + count_objects(lv_obj_get_child(obj, i));
+  }
+  return n;
+}
+
+struct bench {
+  bool widget; /* this face, or the tree it replaced */
+  int runs;
+  /* Results */
+  size_t heap;        /* LVGL heap held by the face, styles included */
+  uint32_t objects;   /* Objects on the screen */
+  uint32_t first_us;  /* First full frame */
+  uint32_t minute_us; /* Frame of a minute change, one digit */
+  uint32_t hour_us;   /* Frame of an hour change, all four digits */
+};
+
+static size_t heap_used(void) {
+  lv_mem_monitor_t mon;
+
+  lv_mem_monitor(&mon);
+  return mon.total_size - mon.free_size;
+}
+
+static uint32_t frame_us(lv_obj_t *obj, const struct rtc_time *tm) {
+  uint32_t start = k_cycle_get_32();
+
+  if (obj != NULL) {
+    wf_face_set_time(obj, tm);
+  } else {
+    tree_set_time(tm);
+  }
+  lv_refr_now(NULL);
+  return k_cyc_to_us_floor32(k_cycle_get_32() - start);
+}
+
+/* Runs on the UI thread */
+static void bench_face(void *arg) {
+  struct bench *b = arg;
+  // Friday 2026-10-16, the minute goes 10:41 -> 10:42 and back, the hour
+  // 10:59 -> 11:00 and back
+  struct rtc_time tm = {.tm_year = 126, .tm_mon = 9, .tm_mday = 16, .tm_wday = 5, .tm_hour = 10};
+  lv_obj_t *app_scr = lv_screen_active();
+  lv_obj_t *obj = NULL;
+  uint64_t minute_us = 0;
+  uint64_t hour_us = 0;
+
+  size_t before = heap_used();
+  lv_obj_t *scr = lv_obj_create(NULL);
+  if (b->widget) {
+    obj = wf_face_create(scr, &face_layout);
+  } else {
+    tree_create(scr);
+  }
+  b->heap = heap_used() - before;
+  b->objects = count_objects(scr);
+
+  epd_refresh_hold(true);
+  lv_screen_load(scr);
+  tm.tm_min = 41;
+  b->first_us = frame_us(obj, &tm);
+
+  for (int r = 0; r < b->runs; r++) {
+    tm.tm_hour = 10;
+    tm.tm_min = r % 2 ? 41 : 42;
+    minute_us += frame_us(obj, &tm);
+  }
+  for (int r = 0; r < b->runs; r++) {
+    tm.tm_hour = r % 2 ? 10 : 11;
+    tm.tm_min = r % 2 ? 59 : 0;
+    hour_us += frame_us(obj, &tm);
+  }
+  b->minute_us = minute_us / b->runs;
+  b->hour_us = hour_us / b->runs;
+
+  lv_screen_load(app_scr);
+  lv_obj_delete(scr);
+  if (!b->widget) {
+    tree_destroy();
+  }
+  // The framebuffer holds the scratch screen, the panel still the app one
+  lv_obj_invalidate(app_scr);
+  epd_refresh_hold(false);
+}
+
+static int cmd_wf_bench(const struct shell *sh, size_t argc, char **argv) {
+  int runs = argc > 1 ? atoi(argv[1]) : 20;
+
+  if (runs <= 0) {
+    shell_error(sh, "usage: wf bench [runs]");
+    return -EINVAL;
+  }
+
+  for (int widget = 0; widget < 2; widget++) {
+    struct bench b = {.widget = widget, .runs = runs};
+
+    ui_loop_call(bench_face, &b);
+    shell_print(sh, "%-13s %2u objects, %5zu bytes heap", widget ? "face widget:" : "object tree:",
+                b.objects, b.heap);
+    shell_print(sh, "  frame: first %u us, minute change %u us, hour change %u us", b.first_us,
+                b.minute_us, b.hour_us);
+  }
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(wf_cmds,
+                               SHELL_CMD_ARG(bench, NULL,
+                                             "Compare the face widget with the object tree "
+                                             "it replaced [runs]",
+                                             cmd_wf_bench, 1, 1),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(wf, &wf_cmds, "Segments watchface commands", NULL);
+#endif
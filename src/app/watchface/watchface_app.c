@@ -4,12 +4,13 @@
  */
 
 #include <zephyr/device.h>
-#include <zephyr/drivers/rtc.h>
 #include <zephyr/logging/log.h>
 
-#include "../../lib/rtc.h"
+#include "../../lib/timekeeping.h"
 #include "../app_interface.h"
+#include "../ui_fonts.h"
 #include "lvgl.h"
+#include "wf_model.h"
 
 LOG_MODULE_REGISTER(watchface_app, LOG_LEVEL_INF);
 
@@ -17,71 +18,48 @@ static lv_obj_t *hour_label = NULL;
 static lv_obj_t *min_label = NULL;
 static lv_obj_t *colon_label = NULL;
 static lv_obj_t *date_label = NULL;
-static lv_timer_t *update_timer = NULL;
-static const struct device *rtc = NULL;
+static struct wf_model model;
 
-static void update_time_cb(lv_timer_t *timer) {
-  LV_UNUSED(timer);
-
-  if (hour_label == NULL || rtc == NULL) {
+/* On a tick the minute has just begun on the RTC, whatever the soft clock says */
+static void update_time(bool on_tick) {
+  if (hour_label == NULL) {
     return;
   }
 
   struct rtc_time tm;
-  int ret = rtc_get_time(rtc, &tm);
-  LOG_DBG("RTC time: %02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
-
-  if (ret < 0) {
-    LOG_ERR("Failed to get RTC time: %d", ret);
-    return;
+  if (on_tick) {
+    timekeeping_get_local_minute(&tm);
+  } else {
+    timekeeping_get_local(&tm);
   }
+  LOG_DBG("Local time: %02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
 
-  // Update hour and minute labels
-  if (hour_label && min_label) {
-    lv_label_set_text_fmt(hour_label, "%02d", tm.tm_hour);
-    lv_label_set_text_fmt(min_label, "%02d", tm.tm_min);
+  uint32_t changed = wf_model_update(&model, &tm);
+
+  if (changed & WF_CHANGED_HOUR) {
+    lv_label_set_text_static(hour_label, wf_two_digits[model.hour]);
+  }
+  if (changed & WF_CHANGED_MINUTE) {
+    lv_label_set_text_static(min_label, wf_two_digits[model.minute]);
   }
 
-  // Update date label
-  if (date_label) {
-    const char *months[] = {"January",   "February", "March",    "April",
-                            "May",       "June",     "July",     "August",
-                            "September", "October",  "November", "December"};
-    const char *month_name = months[tm.tm_mon];
-
-    // Format: "Month Dth Year" (e.g., "March 3rd 2021")
-    const char *suffix = "th";
-    int day = tm.tm_mday;
-    if (day % 10 == 1 && day != 11) {
-      suffix = "st";
-    } else if (day % 10 == 2 && day != 12) {
-      suffix = "nd";
-    } else if (day % 10 == 3 && day != 13) {
-      suffix = "rd";
-    }
-
-    lv_label_set_text_fmt(date_label, "%s %d%s %d", month_name, day, suffix,
-                          tm.tm_year + 1900);
+  // Format: "Month Dth Year" (e.g., "March 3rd 2021")
+  if (changed & (WF_CHANGED_DAY | WF_CHANGED_MONTH | WF_CHANGED_YEAR)) {
+    lv_label_set_text_fmt(date_label, "%s %s %d", wf_month_long[model.mon],
+                          wf_day_ordinal[model.mday], model.year);
   }
 }
 
 static void watchface_app_init(void) {
   LOG_INF("Watchface app init");
 
-  // Get RTC device
-  rtc = DEVICE_DT_GET(DT_ALIAS(rtc));
-  if (!device_is_ready(rtc)) {
-    LOG_ERR("RTC device not ready");
-    rtc = NULL;
-  }
-
   // Clean screen and set a white background
   lv_obj_clean(lv_scr_act());
 
   // Style: larger font for readability
   static lv_style_t style;
   lv_style_init(&style);
-  lv_style_set_text_font(&style, &lv_font_montserrat_48);
+  lv_style_set_text_font(&style, UI_FONT_48);
 
   // Create hour label with black background and white text
   hour_label = lv_label_create(lv_scr_act());
@@ -116,31 +94,27 @@ static void watchface_app_init(void) {
 
   static lv_style_t date_style;
   lv_style_init(&date_style);
-  lv_style_set_text_font(&date_style, &lv_font_montserrat_16);
+  lv_style_set_text_font(&date_style, UI_FONT_16);
   lv_obj_add_style(date_label, &date_style, 0);
 
-  // Update immediately, then every second
-  update_time_cb(NULL);
-  update_timer = lv_timer_create(update_time_cb, 1000, NULL);
+  // Update immediately, then on every time tick
+  wf_model_reset(&model);
+  update_time(false);
 }
 
 static void watchface_app_deinit(void) {
   LOG_INF("Watchface app deinit");
-  if (update_timer) {
-    lv_timer_del(update_timer);
-    update_timer = NULL;
-  }
   lv_obj_clean(lv_scr_act());
   hour_label = NULL;
   min_label = NULL;
   colon_label = NULL;
   date_label = NULL;
-  rtc = NULL;
 }
 
 static void watchface_app_handle_event(input_event_t *ev) {
-  LV_UNUSED(ev);
-  // No input handling needed for simple watchface
+  if (ev && ev->type == INPUT_EVENT_TYPE_TICK) {
+    update_time(true);
+  }
 }
 
 IApp WatchfaceApp = {
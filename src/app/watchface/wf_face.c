@@ -0,0 +1,233 @@
+/**
+ * @file wf_face.c
+ * @brief Watchface drawn by a single widget from a layout descriptor
+ *
+ * Item areas are computed from the layout when needed, relative to the
+ * center of the object; nothing but the displayed model and date line is
+ * kept per face. The draw callback skips the items outside the area being
+ * redrawn, and digits are copied from their sprites (seg_digits.h).
+ */
+
+#include "wf_face.h"
+#include "wf_model.h"
+#include <lvgl_private.h>
+#include <stdio.h>
+
+struct wf_face {
+  const struct wf_face_layout *layout;
+  struct wf_model model; /* What is on screen */
+  char date[24];
+};
+
+/* Area of an item centered at its layout position, of the given size */
+static void centered(lv_obj_t *obj, const struct wf_face *f, enum wf_face_item item, int32_t w,
+                     int32_t h, lv_area_t *area) {
+  lv_obj_get_coords(obj, area);
+  int32_t cx = (area->x1 + area->x2 + 1) / 2 + f->layout->center[item].x;
+  int32_t cy = (area->y1 + area->y2 + 1) / 2 + f->layout->center[item].y;
+
+  area->x1 = cx - w / 2;
+  area->y1 = cy - h / 2;
+  area->x2 = area->x1 + w - 1;
+  area->y2 = area->y1 + h - 1;
+}
+
+static void item_area(lv_obj_t *obj, const struct wf_face *f, enum wf_face_item item,
+                      lv_area_t *area) {
+  const struct wf_face_layout *l = f->layout;
+  const struct digit_sprite_set *set = l->digits;
+
+  switch (item) {
+  case WF_FACE_HOUR:
+    centered(obj, f, item, 2 * set->digit_w + 2 * l->hour_pad, set->height + 2 * l->hour_pad,
+             area);
+    break;
+  case WF_FACE_COLON:
+    centered(obj, f, item, set->colon_w, set->height, area);
+    break;
+  case WF_FACE_MINUTE:
+    centered(obj, f, item, 2 * set->digit_w, set->height, area);
+    break;
+  case WF_FACE_DATE:
+    centered(obj, f, item, l->date_w, lv_font_get_line_height(l->date_font), area);
+    break;
+  default:
+    centered(obj, f, item, 7 * l->day_size + 6 * l->day_gap, l->day_size, area);
+    break;
+  }
+}
+
+/* Cell of digit @p i of the hour or minute */
+static void digit_cell(lv_obj_t *obj, const struct wf_face *f, enum wf_face_item item, int i,
+                       lv_area_t *cell) {
+  const struct digit_sprite_set *set = f->layout->digits;
+
+  item_area(obj, f, item, cell);
+  if (item == WF_FACE_HOUR) {
+    lv_area_increase(cell, -f->layout->hour_pad, -f->layout->hour_pad);
+  }
+  cell->x1 += i * set->digit_w;
+  cell->x2 = cell->x1 + set->digit_w - 1;
+}
+
+static void day_square(lv_obj_t *obj, const struct wf_face *f, int day, lv_area_t *area) {
+  const struct wf_face_layout *l = f->layout;
+
+  item_area(obj, f, WF_FACE_WEEKDAYS, area);
+  area->x1 += day * (l->day_size + l->day_gap);
+  area->x2 = area->x1 + l->day_size - 1;
+}
+
+static void draw_digits(lv_obj_t *obj, const struct wf_face *f, lv_layer_t *layer,
+                        enum wf_face_item item, const char *text, lv_color_t color) {
+  lv_area_t cell;
+
+  for (int i = 0; text[i] != '\0'; i++) {
+    digit_cell(obj, f, item, i, &cell);
+    if (lv_area_is_on(&cell, &layer->_clip_area)) {
+      seg_digits_draw_char(layer, f->layout->digits, text[i], &cell, color,
+                           f->layout->digit_font);
+    }
+  }
+}
+
+static void draw_face(lv_obj_t *obj, const struct wf_face *f, lv_layer_t *layer) {
+  const struct wf_face_layout *l = f->layout;
+  lv_draw_rect_dsc_t rect;
+  lv_area_t area;
+
+  if (!f->model.valid) {
+    return;
+  }
+
+  item_area(obj, f, WF_FACE_HOUR, &area);
+  if (lv_area_is_on(&area, &layer->_clip_area)) {
+    lv_draw_rect_dsc_init(&rect);
+    rect.bg_color = lv_color_black();
+    rect.radius = l->hour_radius;
+    lv_draw_rect(layer, &rect, &area);
+    draw_digits(obj, f, layer, WF_FACE_HOUR, wf_two_digits[f->model.hour], lv_color_white());
+  }
+
+  item_area(obj, f, WF_FACE_COLON, &area);
+  if (lv_area_is_on(&area, &layer->_clip_area)) {
+    seg_digits_draw_char(layer, l->digits, ':', &area, lv_color_black(), l->digit_font);
+  }
+
+  draw_digits(obj, f, layer, WF_FACE_MINUTE, wf_two_digits[f->model.minute], lv_color_black());
+
+  item_area(obj, f, WF_FACE_DATE, &area);
+  if (lv_area_is_on(&area, &layer->_clip_area)) {
+    lv_draw_label_dsc_t label;
+
+    lv_draw_label_dsc_init(&label);
+    label.font = l->date_font;
+    label.color = lv_color_black();
+    label.align = LV_TEXT_ALIGN_CENTER;
+    label.text = f->date;
+    lv_draw_label(layer, &label, &area);
+  }
+
+  item_area(obj, f, WF_FACE_WEEKDAYS, &area);
+  if (lv_area_is_on(&area, &layer->_clip_area)) {
+    lv_draw_rect_dsc_init(&rect);
+    rect.radius = l->day_radius;
+    rect.border_width = 1;
+    rect.border_color = lv_color_black();
+
+    for (int day = 0; day < 7; day++) {
+      day_square(obj, f, day, &area);
+      if (lv_area_is_on(&area, &layer->_clip_area)) {
+        rect.bg_color = day == f->model.wday ? lv_color_black() : lv_color_white();
+        lv_draw_rect(layer, &rect, &area);
+      }
+    }
+  }
+}
+
+static void wf_face_event_cb(lv_event_t *e) {
+  lv_obj_t *obj = lv_event_get_target(e);
+  struct wf_face *f = lv_obj_get_user_data(obj);
+
+  switch (lv_event_get_code(e)) {
+  case LV_EVENT_DRAW_MAIN:
+    draw_face(obj, f, lv_event_get_layer(e));
+    break;
+  case LV_EVENT_DELETE:
+    lv_free(f);
+    break;
+  default:
+    break;
+  }
+}
+
+lv_obj_t *wf_face_create(lv_obj_t *parent, const struct wf_face_layout *layout) {
+  struct wf_face *f = lv_malloc_zeroed(sizeof(*f));
+  if (f == NULL) {
+    return NULL;
+  }
+
+  lv_obj_t *obj = lv_obj_create(parent);
+  if (obj == NULL) {
+    lv_free(f);
+    return NULL;
+  }
+
+  f->layout = layout;
+  wf_model_reset(&f->model);
+  lv_obj_remove_style_all(obj);
+  lv_obj_remove_flag(obj, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_set_size(obj, lv_pct(100), lv_pct(100));
+  lv_obj_set_user_data(obj, f);
+  lv_obj_add_event_cb(obj, wf_face_event_cb, LV_EVENT_ALL, NULL);
+  return obj;
+}
+
+/* Invalidate the digits of @p item that differ between two values */
+static void invalidate_digits(lv_obj_t *obj, const struct wf_face *f, enum wf_face_item item,
+                              int from, int to) {
+  lv_area_t cell;
+
+  for (int i = 0; i < 2; i++) {
+    if (wf_two_digits[from][i] != wf_two_digits[to][i]) {
+      digit_cell(obj, f, item, i, &cell);
+      lv_obj_invalidate_area(obj, &cell);
+    }
+  }
+}
+
+void wf_face_set_time(lv_obj_t *face, const struct rtc_time *tm) {
+  struct wf_face *f = lv_obj_get_user_data(face);
+  struct wf_model prev = f->model;
+  uint32_t changed = wf_model_update(&f->model, tm);
+  const struct wf_model *m = &f->model;
+  lv_area_t area;
+
+  // Format: "DayOfWeek - Month Dth Year" (e.g., "Mon - Mar 3rd 2021")
+  if (changed & WF_CHANGED_DATE) {
+    snprintf(f->date, sizeof(f->date), "%s - %s %s %d", wf_weekday_short[m->wday],
+             wf_month_short[m->mon], wf_day_ordinal[m->mday], m->year);
+  }
+
+  if (!prev.valid) {
+    lv_obj_invalidate(face);
+    return;
+  }
+
+  if (changed & WF_CHANGED_HOUR) {
+    invalidate_digits(face, f, WF_FACE_HOUR, prev.hour, m->hour);
+  }
+  if (changed & WF_CHANGED_MINUTE) {
+    invalidate_digits(face, f, WF_FACE_MINUTE, prev.minute, m->minute);
+  }
+  if (changed & WF_CHANGED_DATE) {
+    item_area(face, f, WF_FACE_DATE, &area);
+    lv_obj_invalidate_area(face, &area);
+  }
+  if (changed & WF_CHANGED_WEEKDAY) {
+    day_square(face, f, prev.wday, &area);
+    lv_obj_invalidate_area(face, &area);
+    day_square(face, f, m->wday, &area);
+    lv_obj_invalidate_area(face, &area);
+  }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file wf_face.h
+ * @brief Watchface drawn by a single widget from a layout descriptor
+ *
+ * The face (hh:mm digits, date line and week day squares) is one LVGL
+ * object with a draw callback instead of an object with styles per element.
+ * Where each item goes is described by a struct wf_face_layout in flash;
+ * the widget keeps what it displays in a wf_model and, when the time is
+ * set, invalidates only the digit cells, date line or day squares that
+ * changed.
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <stdint.h>
+#include <zephyr/drivers/rtc.h>
+
+#include "../../display/seg_digits.h"
+
+/**
+ * @brief Items of the face
+ */
+enum wf_face_item {
+  WF_FACE_HOUR,     /**< Hour digits, white in a black rounded box */
+  WF_FACE_COLON,
+  WF_FACE_MINUTE,
+  WF_FACE_DATE,     /**< "Wed - Sep 24th 2026", centered in a band */
+  WF_FACE_WEEKDAYS, /**< Row of 7 squares, Sunday first, today filled */
+  WF_FACE_ITEMS,
+};
+
+/**
+ * @brief Where and how the face draws its items
+ */
+struct wf_face_layout {
+  const struct digit_sprite_set *digits;
+  const lv_font_t *digit_font; /**< Digits where the sprites can't be copied */
+  const lv_font_t *date_font;
+  struct {
+    int8_t x; /**< Offset of the item's center from the face's center */
+    int8_t y;
+  } center[WF_FACE_ITEMS];
+  uint8_t hour_pad;    /**< Space around the hour digits in their box */
+  uint8_t hour_radius;
+  uint8_t date_w;      /**< Width of the date band */
+  uint8_t day_size;    /**< Side of a week day square */
+  uint8_t day_gap;
+  uint8_t day_radius;
+};
+
+/**
+ * @brief Create a face covering its parent
+ *
+ * Nothing is drawn until the first wf_face_set_time().
+ *
+ * @param parent Parent object, usually the screen
+ * @param layout Layout, must stay valid
+ *
+ * @return The face, or NULL on allocation failure
+ */
+lv_obj_t *wf_face_create(lv_obj_t *parent, const struct wf_face_layout *layout);
+
+/**
+ * @brief Show a time, invalidating the parts of the face that changed
+ */
+void wf_face_set_time(lv_obj_t *face, const struct rtc_time *tm);
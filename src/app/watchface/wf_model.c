@@ -0,0 +1,73 @@
+/**
+ * @file wf_model.c
+ * @brief Watchface view-model and precomputed date strings
+ */
+
+#include "wf_model.h"
+
+const char wf_two_digits[60][3] = {
+    "00", "01", "02", "03", "04", "05", "06", "07", "08", "09",
+    "10", "11", "12", "13", "14", "15", "16", "17", "18", "19",
+    "20", "21", "22", "23", "24", "25", "26", "27", "28", "29",
+    "30", "31", "32", "33", "34", "35", "36", "37", "38", "39",
+    "40", "41", "42", "43", "44", "45", "46", "47", "48", "49",
+    "50", "51", "52", "53", "54", "55", "56", "57", "58", "59",
+};
+
+const char wf_day_ordinal[32][5] = {
+    "",     "1st",  "2nd",  "3rd",  "4th",  "5th",  "6th",  "7th",
+    "8th",  "9th",  "10th", "11th", "12th", "13th", "14th", "15th",
+    "16th", "17th", "18th", "19th", "20th", "21st", "22nd", "23rd",
+    "24th", "25th", "26th", "27th", "28th", "29th", "30th", "31st",
+};
+
+const char *const wf_month_short[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+const char *const wf_month_long[12] = {"January",   "February", "March",    "April",
+                                       "May",       "June",     "July",     "August",
+                                       "September", "October",  "November", "December"};
+
+const char *const wf_weekday_short[7] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+
+void wf_model_reset(struct wf_model *model) { model->valid = false; }
+
+uint32_t wf_model_update(struct wf_model *model, const struct rtc_time *tm) {
+  struct wf_model next = {
+      .hour = tm->tm_hour,
+      .minute = tm->tm_min,
+      .mday = tm->tm_mday,
+      .wday = tm->tm_wday,
+      .mon = tm->tm_mon,
+      .year = tm->tm_year + 1900,
+      .valid = true,
+  };
+  uint32_t changed = 0;
+
+  if (!model->valid) {
+    *model = next;
+    return WF_CHANGED_ALL;
+  }
+
+  if (next.hour != model->hour) {
+    changed |= WF_CHANGED_HOUR;
+  }
+  if (next.minute != model->minute) {
+    changed |= WF_CHANGED_MINUTE;
+  }
+  if (next.mday != model->mday) {
+    changed |= WF_CHANGED_DAY;
+  }
+  if (next.wday != model->wday) {
+    changed |= WF_CHANGED_WEEKDAY;
+  }
+  if (next.mon != model->mon) {
+    changed |= WF_CHANGED_MONTH;
+  }
+  if (next.year != model->year) {
+    changed |= WF_CHANGED_YEAR;
+  }
+
+  *model = next;
+  return changed;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file wf_model.h
+ * @brief Watchface view-model - tracks the displayed time and date fields
+ *
+ * Watchfaces keep a model of what is on screen and feed it the current time
+ * on every tick. The update returns a mask of the fields that changed so only
+ * the matching widgets are touched, which keeps the invalidated area (and the
+ * e-paper partial refresh) to what actually changed.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/drivers/rtc.h>
+#include <zephyr/sys/util.h>
+
+/**
+ * @brief Bits of the change mask returned by wf_model_update()
+ */
+enum wf_change {
+  WF_CHANGED_HOUR = BIT(0),
+  WF_CHANGED_MINUTE = BIT(1),
+  WF_CHANGED_DAY = BIT(2),     /**< Day of the month */
+  WF_CHANGED_WEEKDAY = BIT(3),
+  WF_CHANGED_MONTH = BIT(4),
+  WF_CHANGED_YEAR = BIT(5),
+};
+
+/** Any field shown in a date line */
+#define WF_CHANGED_DATE                                                                            \
+  (WF_CHANGED_DAY | WF_CHANGED_WEEKDAY | WF_CHANGED_MONTH | WF_CHANGED_YEAR)
+
+#define WF_CHANGED_ALL (WF_CHANGED_HOUR | WF_CHANGED_MINUTE | WF_CHANGED_DATE)
+
+/**
+ * @brief Time and date fields currently displayed
+ */
+struct wf_model {
+  int8_t hour;
+  int8_t minute;
+  int8_t mday;
+  int8_t wday;
+  int8_t mon;
+  int16_t year; /**< Full year, e.g. 2024 */
+  bool valid;   /**< False until the first update */
+};
+
+/** Zero-padded "00".."59", for hours and minutes */
+extern const char wf_two_digits[60][3];
+
+/** Day of the month with its ordinal suffix, "1st".."31st" (index 0 unused) */
+extern const char wf_day_ordinal[32][5];
+
+/** "Jan".."Dec" */
+extern const char *const wf_month_short[12];
+
+/** "January".."December" */
+extern const char *const wf_month_long[12];
+
+/** "Sun".."Sat" */
+extern const char *const wf_weekday_short[7];
+
+/**
+ * @brief Forget the displayed state so the next update reports every field
+ */
+void wf_model_reset(struct wf_model *model);
+
+/**
+ * @brief Store the new time in the model
+ *
+ * @param model Model of the displayed fields
+ * @param tm Current local time
+ * @return Mask of WF_CHANGED_* bits for the fields that differ; all bits
+ *         after a reset
+ */
+uint32_t wf_model_update(struct wf_model *model, const struct rtc_time *tm);
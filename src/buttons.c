@@ -4,92 +4,303 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  *
- * NOTE: If you are looking into an implementation of button events with
- * debouncing, check out `input` subsystem and `samples/subsys/input/input_dump`
- * example instead.
+ * Button gesture recognizer on top of the Zephyr input subsystem. The
+ * gpio-keys driver debounces the contacts (debounce-interval-ms in the
+ * devicetree); this file turns the clean press/release stream into press,
+ * release, long-press, repeat, double-press and two-button chord events.
+ *
+ * A short press is reported once a press is known to be none of the other
+ * gestures: after its release, when the double press window has passed
+ * without a second press. It is what a single click should act on.
  */
 
-#include <inttypes.h>
+#include <stdlib.h>
 #include <zephyr/device.h>
-#include <zephyr/drivers/gpio.h>
+#include <zephyr/input/input.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
-#include <zephyr/sys/printk.h>
+#include <zephyr/shell/shell.h>
 #include <zephyr/sys/util.h>
 
 #include "app/gpio_event.h"
+#include "buttons.h"
 
 LOG_MODULE_REGISTER(buttons, LOG_LEVEL_INF);
 
-/*
- * Get button configuration from the devicetree sw0 alias. This is mandatory.
- */
-#define SW0_NODE DT_ALIAS(sw0)
-#define SW1_NODE DT_ALIAS(sw1)
-#define SW2_NODE DT_ALIAS(sw2)
-#define SW3_NODE DT_ALIAS(sw3)
+#ifndef CONFIG_BUTTON_LONG_PRESS_MS
+#define CONFIG_BUTTON_LONG_PRESS_MS 600
+#endif
+
+#ifndef CONFIG_BUTTON_REPEAT_MS
+#define CONFIG_BUTTON_REPEAT_MS 200
+#endif
+
+#ifndef CONFIG_BUTTON_DOUBLE_PRESS_MS
+#define CONFIG_BUTTON_DOUBLE_PRESS_MS 300
+#endif
+
+#ifndef CONFIG_BUTTON_CHORD_MS
+#define CONFIG_BUTTON_CHORD_MS 80
+#endif
+
+#define GPIO_KEYS_NODE DT_NODELABEL(gpio_keys)
 
 #define MAX_BUTTONS 4
-static struct gpio_callback button_cb_data[MAX_BUTTONS];
 
-static const struct gpio_dt_spec buttons[MAX_BUTTONS] = {
-    GPIO_DT_SPEC_GET_OR(SW0_NODE, gpios, {0}),
-    GPIO_DT_SPEC_GET_OR(SW1_NODE, gpios, {0}),
-    GPIO_DT_SPEC_GET_OR(SW2_NODE, gpios, {0}),
-    GPIO_DT_SPEC_GET_OR(SW3_NODE, gpios, {0}),
+/* Input codes of the swN aliases, from their zephyr,code property */
+static const uint16_t sw_codes[MAX_BUTTONS] = {
+    DT_PROP(DT_ALIAS(sw0), zephyr_code),
+    DT_PROP(DT_ALIAS(sw1), zephyr_code),
+    DT_PROP(DT_ALIAS(sw2), zephyr_code),
+    DT_PROP(DT_ALIAS(sw3), zephyr_code),
 };
 
-void button_pressed(const struct device *dev, struct gpio_callback *cb, uint32_t pins) {
-  LOG_INF("Button event port = %s pins = 0x%08x", dev->name, pins);
+struct button_state {
+  struct k_work_delayable hold_work;
+  struct k_work_delayable click_work;
+  int64_t press_ms;    /**< Uptime of the last press */
+  int64_t release_ms;  /**< Uptime of the last release eligible for a double press */
+  uint32_t release_ts; /**< Cycle timestamp of that release, for the short press */
+  bool pressed;
+  bool long_sent;
+  bool double_sent;
+  bool in_chord;
+};
 
-  // Find which button triggered the interrupt and check its state
-  for (int i = 0; i < MAX_BUTTONS; i++) {
-    const struct gpio_dt_spec *button = &buttons[i];
-    if (button->port == dev && (pins & BIT(button->pin))) {
-      // Read actual button state
-      int val = gpio_pin_get_dt(button);
-      if (val < 0) {
-        LOG_ERR("Failed to read button state: %d", val);
-        continue;
-      }
+static struct button_state states[MAX_BUTTONS];
+static struct button_timing timing = {
+    .long_press_ms = CONFIG_BUTTON_LONG_PRESS_MS,
+    .repeat_ms = CONFIG_BUTTON_REPEAT_MS,
+    .double_press_ms = CONFIG_BUTTON_DOUBLE_PRESS_MS,
+    .chord_ms = CONFIG_BUTTON_CHORD_MS,
+};
+static struct k_spinlock lock;
+static bool ready;
 
-      // Send event based on actual state (pressed=1, released=0)
-      gpio_button_callback_mapped(button->pin, val == 1);
-      LOG_INF("Button %d %s", i, val == 1 ? "pressed" : "released");
+static int code_to_sw(uint16_t code) {
+  for (int i = 0; i < MAX_BUTTONS; i++) {
+    if (sw_codes[i] == code) {
+      return i;
     }
   }
+  return -1;
 }
 
-int button_init(void) {
-  int ret;
-  for (int i = 0; i < MAX_BUTTONS; i++) {
-    const struct gpio_dt_spec *button = &buttons[i];
-    if (button->port == NULL) {
-      LOG_WRN("Button %d not defined in device tree, skipping...", i);
-      continue;
+static void hold_work_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct button_state *st = CONTAINER_OF(dwork, struct button_state, hold_work);
+  uint8_t sw = st - states;
+  enum gpio_key_gesture gesture;
+  uint16_t next_ms;
+
+  k_spinlock_key_t key = k_spin_lock(&lock);
+  if (!st->pressed || st->in_chord) {
+    k_spin_unlock(&lock, key);
+    return;
+  }
+  gesture = st->long_sent ? GPIO_KEY_REPEAT : GPIO_KEY_LONG_PRESS;
+  st->long_sent = true;
+  next_ms = timing.repeat_ms;
+  k_spin_unlock(&lock, key);
+
+  gpio_key_event(sw, gesture, k_cycle_get_32());
+
+  if (next_ms > 0) {
+    k_work_reschedule(&st->hold_work, K_MSEC(next_ms));
+  }
+}
+
+static void click_work_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct button_state *st = CONTAINER_OF(dwork, struct button_state, click_work);
+  uint8_t sw = st - states;
+  bool single = false;
+
+  k_spinlock_key_t key = k_spin_lock(&lock);
+  // A press in the meantime has already taken the release
+  if (st->release_ms != 0) {
+    st->release_ms = 0;
+    single = true;
+  }
+  k_spin_unlock(&lock, key);
+
+  if (single) {
+    gpio_key_event(sw, GPIO_KEY_SHORT_PRESS, st->release_ts);
+  }
+}
+
+static void on_press(uint8_t sw, int64_t now, uint32_t timestamp) {
+  struct button_state *st = &states[sw];
+  uint8_t chord_mask = 0;
+  bool double_press = false;
+  bool late_single = false;
+
+  k_work_cancel_delayable(&st->click_work);
+
+  k_spinlock_key_t key = k_spin_lock(&lock);
+  st->pressed = true;
+  st->long_sent = false;
+  st->double_sent = false;
+  st->in_chord = false;
+  st->press_ms = now;
+
+  // A second button going down shortly after the first forms a chord
+  for (uint8_t i = 0; i < MAX_BUTTONS; i++) {
+    struct button_state *other = &states[i];
+    if (i != sw && other->pressed && !other->in_chord &&
+        now - other->press_ms <= timing.chord_ms) {
+      other->in_chord = true;
+      st->in_chord = true;
+      chord_mask = BIT(i) | BIT(sw);
+      break;
     }
+  }
 
-    if (!gpio_is_ready_dt(button)) {
-      LOG_ERR("Error: button device %s is not ready\n", button->port->name);
-      continue;
+  if (st->release_ms != 0) {
+    if (!st->in_chord && now - st->release_ms <= timing.double_press_ms) {
+      double_press = true;
+      st->double_sent = true;
+    } else {
+      // The click work was due but has not run yet
+      late_single = true;
     }
+    // Do not chain a third press into another double press
+    st->release_ms = 0;
+  }
+  k_spin_unlock(&lock, key);
 
-    ret = gpio_pin_configure_dt(button, GPIO_INPUT);
-    if (ret != 0) {
-      LOG_ERR("Error %d: failed to configure %s pin %d\n", ret, button->port->name, button->pin);
-      continue;
+  if (late_single) {
+    gpio_key_event(sw, GPIO_KEY_SHORT_PRESS, st->release_ts);
+  }
+  gpio_key_event(sw, GPIO_KEY_PRESS, timestamp);
+
+  if (chord_mask) {
+    for (uint8_t i = 0; i < MAX_BUTTONS; i++) {
+      if (chord_mask & BIT(i)) {
+        k_work_cancel_delayable(&states[i].hold_work);
+      }
     }
+    gpio_chord_event(chord_mask, timestamp);
+    return;
+  }
+
+  if (double_press) {
+    gpio_key_event(sw, GPIO_KEY_DOUBLE_PRESS, timestamp);
+  }
+
+  if (timing.long_press_ms > 0) {
+    k_work_reschedule(&st->hold_work, K_MSEC(timing.long_press_ms));
+  }
+}
+
+static void on_release(uint8_t sw, int64_t now, uint32_t timestamp) {
+  struct button_state *st = &states[sw];
+  uint16_t wait_ms = 0;
+  bool single = false;
 
-    ret = gpio_pin_interrupt_configure_dt(button, GPIO_INT_EDGE_BOTH);
-    if (ret != 0) {
-      LOG_ERR("Error %d: failed to configure interrupt on %s pin %d\n", ret, button->port->name,
-              button->pin);
-      continue;
+  k_work_cancel_delayable(&st->hold_work);
+
+  k_spinlock_key_t key = k_spin_lock(&lock);
+  // Only a press that was no other gesture can become a double or short press
+  single = !st->in_chord && !st->long_sent && !st->double_sent;
+  wait_ms = timing.double_press_ms;
+  st->release_ms = (single && wait_ms > 0) ? now : 0;
+  st->release_ts = timestamp;
+  st->pressed = false;
+  st->in_chord = false;
+  k_spin_unlock(&lock, key);
+
+  gpio_key_event(sw, GPIO_KEY_RELEASE, timestamp);
+
+  if (single) {
+    if (wait_ms > 0) {
+      k_work_reschedule(&st->click_work, K_MSEC(wait_ms));
+    } else {
+      gpio_key_event(sw, GPIO_KEY_SHORT_PRESS, timestamp);
     }
+  }
+}
 
-    gpio_init_callback(&button_cb_data[i], button_pressed, BIT(button->pin));
-    gpio_add_callback(button->port, &button_cb_data[i]);
-    LOG_INF("Set up button at %s pin %d\n", button->port->name, button->pin);
+static void button_input_cb(struct input_event *evt, void *user_data) {
+  ARG_UNUSED(user_data);
+
+  if (!ready || evt->type != INPUT_EV_KEY) {
+    return;
+  }
+
+  int sw = code_to_sw(evt->code);
+  if (sw < 0) {
+    LOG_WRN("Unmapped input code %d", evt->code);
+    return;
   }
+
+  uint32_t timestamp = k_cycle_get_32();
+  int64_t now = k_uptime_get();
+
+  LOG_DBG("Button %d %s", sw, evt->value ? "pressed" : "released");
+  if (evt->value) {
+    on_press(sw, now, timestamp);
+  } else {
+    on_release(sw, now, timestamp);
+  }
+}
+
+INPUT_CALLBACK_DEFINE(DEVICE_DT_GET(GPIO_KEYS_NODE), button_input_cb, NULL);
+
+void button_set_timing(const struct button_timing *t) {
+  k_spinlock_key_t key = k_spin_lock(&lock);
+  timing = *t;
+  k_spin_unlock(&lock, key);
+}
+
+void button_get_timing(struct button_timing *t) {
+  k_spinlock_key_t key = k_spin_lock(&lock);
+  *t = timing;
+  k_spin_unlock(&lock, key);
+}
+
+int button_init(void) {
+  const struct device *keys = DEVICE_DT_GET(GPIO_KEYS_NODE);
+
+  if (!device_is_ready(keys)) {
+    LOG_ERR("Error: button device %s is not ready", keys->name);
+    return -ENODEV;
+  }
+
+  for (int i = 0; i < MAX_BUTTONS; i++) {
+    k_work_init_delayable(&states[i].hold_work, hold_work_handler);
+    k_work_init_delayable(&states[i].click_work, click_work_handler);
+    LOG_INF("Set up button %d with input code %d", i, sw_codes[i]);
+  }
+  ready = true;
   return 0;
 }
+
+#if defined(CONFIG_SHELL)
+static int cmd_buttons_timing(const struct shell *sh, size_t argc, char **argv) {
+  struct button_timing t;
+  button_get_timing(&t);
+
+  if (argc == 5) {
+    t.long_press_ms = (uint16_t)strtoul(argv[1], NULL, 10);
+    t.repeat_ms = (uint16_t)strtoul(argv[2], NULL, 10);
+    t.double_press_ms = (uint16_t)strtoul(argv[3], NULL, 10);
+    t.chord_ms = (uint16_t)strtoul(argv[4], NULL, 10);
+    button_set_timing(&t);
+  } else if (argc != 1) {
+    shell_error(sh, "usage: buttons timing [<long> <repeat> <double> <chord>]");
+    return -EINVAL;
+  }
+
+  shell_print(sh, "long press: %u ms, repeat: %u ms, double press: %u ms, chord: %u ms",
+              t.long_press_ms, t.repeat_ms, t.double_press_ms, t.chord_ms);
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(buttons_cmds,
+                               SHELL_CMD(timing, NULL, "Show or set gesture timings (ms)",
+                                         cmd_buttons_timing),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(buttons, &buttons_cmds, "Button commands", NULL);
+#endif
@@ -5,6 +5,32 @@
 #ifndef BUTTONS_H
 #define BUTTONS_H
 
+#include <stdint.h>
+
+/**
+ * @brief Gesture recognizer timings, in milliseconds
+ */
+struct button_timing {
+  uint16_t long_press_ms;   /**< Hold time before a long press (0 disables) */
+  uint16_t repeat_ms;       /**< Repeat period while held after a long press (0 disables) */
+  uint16_t double_press_ms; /**< Max release-to-press gap for a double press */
+  uint16_t chord_ms;        /**< Max gap between two presses forming a chord */
+};
+
 int button_init(void);
 
-#endif /* BUTTONS_H */
\ No newline at end of file
+/**
+ * @brief Replace the gesture recognizer timings
+ *
+ * @param timing New timings
+ */
+void button_set_timing(const struct button_timing *timing);
+
+/**
+ * @brief Read the current gesture recognizer timings
+ *
+ * @param timing Destination for the timings
+ */
+void button_get_timing(struct button_timing *timing);
+
+#endif /* BUTTONS_H */
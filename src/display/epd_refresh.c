@@ -0,0 +1,714 @@
+/**
+ * @file epd_refresh.c
+ * @brief E-paper refresh scheduler
+ *
+ * LVGL renders in direct mode into a single full-screen I1 framebuffer. I1
+ * rows are byte packed, MSB first and 1 = white, which is exactly the RAM
+ * layout of the SSD1681 in the orientation the driver programs through its
+ * data-entry mode (rotation = <270> reports a horizontally tiled panel), so
+ * nothing is rotated or repacked in software.
+ *
+ * Updates are double buffered. At the end of each LVGL frame the UI thread
+ * packs the byte-aligned dirty window into the free transmit slot and
+ * returns; the worker thread sends the other slot to the driver (SPI DMA,
+ * then the waveform) in parallel. Frames rendered while the panel is busy
+ * are merged into the free slot and go out together as the next update.
+ * Completion is signalled to the UI loop from the BUSY line interrupt.
+ */
+
+#include "epd_refresh.h"
+#include "../app/ui_loop.h"
+#include "img_rle.h"
+#include <lvgl.h>
+#include <lvgl_private.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/display.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(epd_refresh, LOG_LEVEL_INF);
+
+/* Partial refreshes of one tile before a full refresh is forced */
+#ifndef CONFIG_EPD_REFRESH_GHOST_LIMIT
+#define CONFIG_EPD_REFRESH_GHOST_LIMIT 30
+#endif
+
+/* Ghosting level from which a full refresh is run once the screen is idle */
+#ifndef CONFIG_EPD_REFRESH_QUIET_MIN
+#define CONFIG_EPD_REFRESH_QUIET_MIN 10
+#endif
+
+/* Idle time after the last update that counts as a quiet moment */
+#ifndef CONFIG_EPD_REFRESH_QUIET_MS
+#define CONFIG_EPD_REFRESH_QUIET_MS 20000
+#endif
+
+/* How long a requested full refresh waits for LVGL to draw the next frame */
+#ifndef CONFIG_EPD_REFRESH_FULL_WAIT_MS
+#define CONFIG_EPD_REFRESH_FULL_WAIT_MS 500
+#endif
+
+#ifndef CONFIG_EPD_REFRESH_STACK_SIZE
+#define CONFIG_EPD_REFRESH_STACK_SIZE 1536
+#endif
+
+#ifndef CONFIG_EPD_REFRESH_PRIORITY
+#define CONFIG_EPD_REFRESH_PRIORITY 7
+#endif
+
+#define EPD_NODE DT_CHOSEN(zephyr_display)
+#define EPD_MAX_PX (DT_PROP(EPD_NODE, width) * DT_PROP(EPD_NODE, height))
+#define EPD_MAX_STRIDE (DT_PROP(EPD_NODE, width) / 8)
+#define EPD_MAX_TILES                                                                              \
+  (DIV_ROUND_UP(DT_PROP(EPD_NODE, width), EPD_TILE_PX) *                                           \
+   DIV_ROUND_UP(DT_PROP(EPD_NODE, height), EPD_TILE_PX))
+
+/* LVGL I1 buffers start with a 2-entry ARGB8888 palette */
+#define I1_PALETTE_SIZE 8
+
+static const struct device *const display_dev = DEVICE_DT_GET(EPD_NODE);
+static const struct gpio_dt_spec busy_gpio = GPIO_DT_SPEC_GET(EPD_NODE, busy_gpios);
+
+/* Packed dirty window of one update */
+struct tx_slot {
+  uint8_t buf[EPD_MAX_PX / 8];
+  lv_area_t area;
+  bool pending; /* Filled and not yet sent */
+};
+
+/* LVGL direct-mode framebuffer: palette followed by the panel RAM image.
+ * Only touched from the UI thread */
+static uint8_t framebuf[I1_PALETTE_SIZE + EPD_MAX_PX / 8] __aligned(4);
+static uint8_t *const fb_pixels = &framebuf[I1_PALETTE_SIZE];
+
+/* Image on the panel, kept by the worker for full refreshes */
+static uint8_t panel[EPD_MAX_PX / 8];
+
+/* The UI thread fills slots[fill] while the worker sends the other one */
+static struct tx_slot slots[2];
+
+static struct {
+  uint16_t width;
+  uint16_t height;
+  uint16_t stride;     /* Bytes per framebuffer row */
+  lv_area_t frame;     /* Dirty area of the frame being flushed (UI thread) */
+  bool frame_valid;    /* UI thread */
+  uint8_t frame_areas; /* UI thread */
+  bool hold;           /* UI thread */
+  uint8_t fill;
+  bool in_flight;
+  bool full_pending;
+  enum epd_full_reason full_reason;
+  uint8_t tiles[EPD_MAX_TILES]; /* Partial refreshes per tile since the last full */
+  uint8_t tiles_x;
+  struct epd_refresh_stats stats;
+} epd;
+
+/* Panel busy time measured from the BUSY line edges, owned by the ISR */
+static struct {
+  bool irq;
+  bool active;
+  uint32_t since;
+  uint32_t count;
+  uint64_t cycles;
+} busy;
+
+static struct gpio_callback busy_cb;
+static struct k_spinlock busy_lock;
+
+static K_MUTEX_DEFINE(epd_mutex);
+static K_SEM_DEFINE(frame_sem, 0, 1);
+
+static K_THREAD_STACK_DEFINE(epd_stack, CONFIG_EPD_REFRESH_STACK_SIZE);
+static struct k_thread epd_thread;
+
+/* Copy the byte-aligned window of @p area from the framebuffer into @p dst.
+ * Returns the number of bytes that will go over SPI */
+static uint32_t pack(uint8_t *dst, const lv_area_t *area) {
+  uint16_t row_bytes = DIV_ROUND_UP(lv_area_get_width(area), 8);
+  const uint8_t *src = &fb_pixels[area->y1 * epd.stride + area->x1 / 8];
+
+  if (row_bytes == epd.stride) {
+    // Full-width window: rows are contiguous in the framebuffer
+    memcpy(dst, src, row_bytes * lv_area_get_height(area));
+  } else {
+    for (int32_t y = area->y1; y <= area->y2; y++) {
+      memcpy(dst, src, row_bytes);
+      src += epd.stride;
+      dst += row_bytes;
+    }
+  }
+  return row_bytes * lv_area_get_height(area);
+}
+
+/* Copy a packed window back into the panel image (worker thread) */
+static void unpack_to_panel(const struct tx_slot *slot) {
+  uint16_t row_bytes = DIV_ROUND_UP(lv_area_get_width(&slot->area), 8);
+  const uint8_t *src = slot->buf;
+
+  for (int32_t y = slot->area.y1; y <= slot->area.y2; y++) {
+    memcpy(&panel[y * epd.stride + slot->area.x1 / 8], src, row_bytes);
+    src += row_bytes;
+  }
+}
+
+/* End of an LVGL frame: hand its dirty window to the worker (UI thread) */
+static void queue_frame(void) {
+  uint32_t start = k_cycle_get_32();
+
+  k_mutex_lock(&epd_mutex, K_FOREVER);
+  struct tx_slot *slot = &slots[epd.fill];
+  lv_area_t area = epd.frame;
+
+  if (slot->pending) {
+    // The panel is still busy with the previous update: merge into this one
+    lv_area_join(&area, &area, &slot->area);
+    epd.stats.coalesced++;
+  }
+  if (epd.in_flight) {
+    epd.stats.overlapped++;
+  }
+
+  slot->area = area;
+  pack(slot->buf, &area);
+  slot->pending = true;
+
+  epd.stats.flushes += epd.frame_areas;
+  epd.stats.cpu_cycles += k_cycle_get_32() - start;
+  k_mutex_unlock(&epd_mutex);
+
+  epd.frame_valid = false;
+  epd.frame_areas = 0;
+  k_sem_give(&frame_sem);
+}
+
+static void epd_flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map) {
+  ARG_UNUSED(px_map);
+
+  // The display rounder keeps areas byte aligned for horizontally tiled panels
+  __ASSERT(area->x1 % 8 == 0, "unaligned flush area");
+
+  if (epd.hold) {
+    lv_display_flush_ready(disp);
+    return;
+  }
+
+  // Direct mode: the pixels are already in place, only remember where
+  if (epd.frame_valid) {
+    lv_area_join(&epd.frame, &epd.frame, area);
+  } else {
+    epd.frame = *area;
+    epd.frame_valid = true;
+  }
+  epd.frame_areas++;
+
+  // Queue once per frame, not per flushed area
+  if (lv_display_flush_is_last(disp)) {
+    queue_frame();
+  }
+  lv_display_flush_ready(disp);
+}
+
+static void busy_isr(const struct device *port, struct gpio_callback *cb, uint32_t pins) {
+  ARG_UNUSED(port);
+  ARG_UNUSED(cb);
+  ARG_UNUSED(pins);
+  uint32_t now = k_cycle_get_32();
+  bool done = false;
+
+  K_SPINLOCK(&busy_lock) {
+    if (gpio_pin_get_dt(&busy_gpio) > 0) {
+      busy.active = true;
+      busy.since = now;
+    } else if (busy.active) {
+      busy.active = false;
+      busy.cycles += now - busy.since;
+      busy.count++;
+      done = true;
+    }
+  }
+
+  // The driver still has to notice the edge; the UI can go on right away
+  if (done) {
+    ui_loop_notify_display_done();
+  }
+}
+
+static int busy_irq_init(void) {
+  int ret = gpio_pin_interrupt_configure_dt(&busy_gpio, GPIO_INT_EDGE_BOTH);
+  if (ret < 0) {
+    return ret;
+  }
+
+  gpio_init_callback(&busy_cb, busy_isr, BIT(busy_gpio.pin));
+  return gpio_add_callback_dt(&busy_gpio, &busy_cb);
+}
+
+/* Count a partial refresh of @p area against the tiles it covers; caller holds the mutex */
+static void account_partial(const lv_area_t *area) {
+  for (int32_t ty = area->y1 / EPD_TILE_PX; ty <= area->y2 / EPD_TILE_PX; ty++) {
+    for (int32_t tx = area->x1 / EPD_TILE_PX; tx <= area->x2 / EPD_TILE_PX; tx++) {
+      uint8_t *tile = &epd.tiles[ty * epd.tiles_x + tx];
+
+      if (*tile < UINT8_MAX) {
+        (*tile)++;
+      }
+      epd.stats.max_tile = MAX(epd.stats.max_tile, *tile);
+    }
+  }
+
+  if (epd.stats.max_tile >= CONFIG_EPD_REFRESH_GHOST_LIMIT && !epd.full_pending) {
+    epd.full_pending = true;
+    epd.full_reason = EPD_FULL_GHOSTING;
+  }
+}
+
+static k_timeout_t next_timeout(void) {
+  k_timeout_t timeout = K_FOREVER;
+
+  k_mutex_lock(&epd_mutex, K_FOREVER);
+  if (epd.full_pending) {
+    timeout = K_MSEC(CONFIG_EPD_REFRESH_FULL_WAIT_MS);
+  } else if (epd.stats.max_tile >= CONFIG_EPD_REFRESH_QUIET_MIN) {
+    timeout = K_MSEC(CONFIG_EPD_REFRESH_QUIET_MS);
+  }
+  k_mutex_unlock(&epd_mutex);
+  return timeout;
+}
+
+static int refresh(const lv_area_t *area, const uint8_t *buf, bool full) {
+  uint16_t w = lv_area_get_width(area);
+  uint16_t h = lv_area_get_height(area);
+  struct display_buffer_descriptor desc = {
+      .buf_size = DIV_ROUND_UP(w, 8) * h,
+      .width = w,
+      .height = h,
+      .pitch = w,
+  };
+  int ret;
+
+  if (full) {
+    // Blanking selects the full waveform and holds the update until unblanked
+    display_blanking_on(display_dev);
+    ret = display_write(display_dev, area->x1, area->y1, &desc, buf);
+    display_blanking_off(display_dev);
+  } else {
+    ret = display_write(display_dev, area->x1, area->y1, &desc, buf);
+  }
+  return ret;
+}
+
+static void epd_thread_fn(void *p1, void *p2, void *p3) {
+  ARG_UNUSED(p1);
+  ARG_UNUSED(p2);
+  ARG_UNUSED(p3);
+
+  while (1) {
+    int ret = k_sem_take(&frame_sem, next_timeout());
+    struct tx_slot *slot;
+    lv_area_t area;
+    bool full;
+    enum epd_full_reason reason;
+
+    k_mutex_lock(&epd_mutex, K_FOREVER);
+    if (ret == -EAGAIN && !epd.full_pending) {
+      // Quiet moment: clear the accumulated ghosting while nobody is looking
+      epd.full_pending = true;
+      epd.full_reason = EPD_FULL_QUIET;
+    }
+
+    slot = &slots[epd.fill];
+    full = epd.full_pending;
+    reason = epd.full_reason;
+    // Nothing drawn yet: wait for a frame, or for the timeout on a full request
+    if (!slot->pending && (!full || ret == 0)) {
+      k_mutex_unlock(&epd_mutex);
+      continue;
+    }
+
+    if (slot->pending) {
+      // Take this slot; the UI thread fills the other one from now on
+      epd.fill ^= 1;
+    } else {
+      slot = NULL;
+    }
+
+    if (full) {
+      memset(epd.tiles, 0, sizeof(epd.tiles));
+      epd.stats.max_tile = 0;
+      epd.full_pending = false;
+    } else {
+      account_partial(&slot->area);
+    }
+    epd.in_flight = true;
+    k_mutex_unlock(&epd_mutex);
+
+    const uint8_t *buf;
+    if (slot != NULL) {
+      unpack_to_panel(slot);
+    }
+    if (full) {
+      lv_area_set(&area, 0, 0, epd.width - 1, epd.height - 1);
+      buf = panel;
+    } else {
+      area = slot->area;
+      buf = slot->buf;
+    }
+
+    int64_t start = k_uptime_get();
+    ret = refresh(&area, buf, full);
+    uint32_t ms = (uint32_t)(k_uptime_get() - start);
+
+    if (ret < 0) {
+      LOG_ERR("Panel %s refresh failed: %d", full ? "full" : "partial", ret);
+    }
+
+    k_mutex_lock(&epd_mutex, K_FOREVER);
+    if (slot != NULL) {
+      slot->pending = false;
+    }
+    epd.in_flight = false;
+    if (full) {
+      epd.stats.full++;
+      epd.stats.full_reason[reason]++;
+      epd.stats.full_ms += ms;
+      epd.stats.max_full_ms = MAX(epd.stats.max_full_ms, ms);
+    } else {
+      epd.stats.partial++;
+      epd.stats.partial_ms += ms;
+      epd.stats.max_partial_ms = MAX(epd.stats.max_partial_ms, ms);
+    }
+    epd.stats.pixels += (uint64_t)lv_area_get_size(&area);
+    epd.stats.tx_bytes += DIV_ROUND_UP(lv_area_get_width(&area), 8) * lv_area_get_height(&area);
+    k_mutex_unlock(&epd_mutex);
+
+    LOG_DBG("%s refresh (%d,%d)-(%d,%d) in %u ms", full ? "Full" : "Partial", area.x1, area.y1,
+            area.x2, area.y2, ms);
+    if (!busy.irq) {
+      ui_loop_notify_display_done();
+    }
+  }
+}
+
+void epd_refresh_request_full(enum epd_full_reason reason) {
+  k_mutex_lock(&epd_mutex, K_FOREVER);
+  epd.full_pending = true;
+  epd.full_reason = reason;
+  k_mutex_unlock(&epd_mutex);
+
+  // Wake the worker so it waits for the next frame with a bounded timeout
+  k_sem_give(&frame_sem);
+}
+
+void epd_refresh_get_stats(struct epd_refresh_stats *stats) {
+  k_mutex_lock(&epd_mutex, K_FOREVER);
+  *stats = epd.stats;
+  k_mutex_unlock(&epd_mutex);
+
+  K_SPINLOCK(&busy_lock) {
+    stats->busy_count = busy.count;
+    stats->busy_cycles = busy.cycles;
+  }
+}
+
+void epd_refresh_reset_stats(void) {
+  k_mutex_lock(&epd_mutex, K_FOREVER);
+  uint32_t max_tile = epd.stats.max_tile;
+  epd.stats = (struct epd_refresh_stats){0};
+  epd.stats.max_tile = max_tile;
+  epd.stats.since_ms = k_uptime_get();
+  k_mutex_unlock(&epd_mutex);
+
+  K_SPINLOCK(&busy_lock) {
+    busy.count = 0;
+    busy.cycles = 0;
+  }
+}
+
+void epd_refresh_hold(bool hold) { epd.hold = hold; }
+
+int epd_refresh_blit_i1(const lv_image_dsc_t *img, int32_t x, int32_t y) {
+  if (img == NULL || img->header.cf != LV_COLOR_FORMAT_I1 || x % 8 != 0 || epd.stride == 0) {
+    return -ENOTSUP;
+  }
+
+  lv_area_t clip = {0, 0, epd.width - 1, epd.height - 1};
+  lv_area_t dst = {x, y, x + img->header.w - 1, y + img->header.h - 1};
+  if (!lv_area_intersect(&clip, &clip, &dst)) {
+    return 0;
+  }
+
+  // Compressed rows are decoded one at a time, right before their copy
+  struct img_rle_cursor cur;
+  uint8_t row_buf[EPD_MAX_STRIDE];
+  bool rle = img_rle_is_rle(img);
+  if (rle && (img->header.stride > sizeof(row_buf) || img_rle_seek(&cur, img, clip.y1 - y) < 0)) {
+    return -ENOTSUP;
+  }
+
+  // Rows are copied as they are, the last byte keeps the pixels right of the image
+  const uint8_t *src = img->data + I1_PALETTE_SIZE + (clip.y1 - y) * img->header.stride;
+  uint8_t *out = &fb_pixels[clip.y1 * epd.stride + clip.x1 / 8];
+  int32_t skip = (clip.x1 - x) / 8;
+  int32_t width = lv_area_get_width(&clip);
+  uint16_t full_bytes = width / 8;
+  uint8_t tail_mask = width % 8 ? (uint8_t)(0xFF << (8 - width % 8)) : 0;
+
+  for (int32_t row = clip.y1; row <= clip.y2; row++) {
+    const uint8_t *line = src + skip;
+
+    if (rle) {
+      if (img_rle_next_row(&cur, row_buf) < 0) {
+        return -EINVAL;
+      }
+      line = row_buf + skip;
+    }
+
+    memcpy(out, line, full_bytes);
+    if (tail_mask != 0) {
+      out[full_bytes] = (out[full_bytes] & ~tail_mask) | (line[full_bytes] & tail_mask);
+    }
+    src += img->header.stride;
+    out += epd.stride;
+  }
+
+  // Let the next frame send the area; LVGL leaves it alone if nothing opaque covers it
+  lv_obj_invalidate_area(lv_screen_active(), &clip);
+  return 0;
+}
+
+/* Run the draw tasks queued on the layer, so direct writes go on top of them */
+static void finish_draw_tasks(lv_layer_t *layer) {
+  for (;;) {
+    lv_draw_task_t *t = layer->draw_task_head;
+
+    while (t != NULL && t->state == LV_DRAW_TASK_STATE_READY) {
+      t = t->next;
+    }
+    if (t == NULL) {
+      return;
+    }
+    lv_draw_dispatch();
+  }
+}
+
+int epd_refresh_draw_1bpp(lv_layer_t *layer, const uint8_t *bits, uint16_t stride,
+                          const lv_area_t *area, bool white) {
+  if (epd.stride == 0 || layer == NULL || layer->draw_buf == NULL ||
+      layer->draw_buf->data != framebuf) {
+    return -ENOTSUP;
+  }
+
+  lv_area_t clip = {0, 0, epd.width - 1, epd.height - 1};
+  if (!lv_area_intersect(&clip, &clip, &layer->_clip_area) ||
+      !lv_area_intersect(&clip, &clip, area)) {
+    return 0;
+  }
+
+  finish_draw_tasks(layer);
+
+  // Each framebuffer byte takes 8 mask bits starting at its column, from the
+  // two mask bytes they straddle
+  int32_t first = clip.x1 / 8;
+  int32_t last = clip.x2 / 8;
+  uint8_t first_mask = 0xFF >> (clip.x1 % 8);
+  uint8_t last_mask = (uint8_t)(0xFF << (7 - clip.x2 % 8));
+
+  for (int32_t y = clip.y1; y <= clip.y2; y++) {
+    const uint8_t *src = &bits[(y - area->y1) * stride];
+    uint8_t *dst = &fb_pixels[y * epd.stride];
+
+    for (int32_t b = first; b <= last; b++) {
+      int32_t sx = b * 8 - area->x1;
+      int32_t si = sx >= 0 ? sx / 8 : -1;
+      uint32_t window = (si >= 0 ? src[si] << 8 : 0) | (si + 1 < stride ? src[si + 1] : 0);
+      uint8_t ink = (uint8_t)(window >> (8 - (sx - si * 8)));
+
+      if (b == first) {
+        ink &= first_mask;
+      }
+      if (b == last) {
+        ink &= last_mask;
+      }
+      dst[b] = white ? dst[b] | ink : dst[b] & ~ink;
+    }
+  }
+  return lv_area_get_size(&clip);
+}
+
+int epd_refresh_init(void) {
+  struct display_capabilities caps;
+  lv_display_t *disp = lv_display_get_default();
+
+  if (!device_is_ready(display_dev) || disp == NULL) {
+    LOG_ERR("Display not ready");
+    return -ENODEV;
+  }
+
+  display_get_capabilities(display_dev, &caps);
+  if (caps.x_resolution % 8 != 0 || caps.x_resolution * caps.y_resolution > EPD_MAX_PX) {
+    LOG_ERR("Unsupported panel size %ux%u", caps.x_resolution, caps.y_resolution);
+    return -ENOTSUP;
+  }
+
+  if (lv_display_get_color_format(disp) != LV_COLOR_FORMAT_I1 ||
+      lv_draw_buf_width_to_stride(caps.x_resolution, LV_COLOR_FORMAT_I1) != caps.x_resolution / 8) {
+    LOG_ERR("LVGL must render unpadded I1 rows for direct mode");
+    return -ENOTSUP;
+  }
+
+  epd.width = caps.x_resolution;
+  epd.height = caps.y_resolution;
+  epd.stride = caps.x_resolution / 8;
+  epd.tiles_x = DIV_ROUND_UP(caps.x_resolution, EPD_TILE_PX);
+  epd.stats.since_ms = k_uptime_get();
+
+  // Render straight into the panel image; the buffers set up by the LVGL
+  // module are no longer used, so keep CONFIG_LV_Z_VDB_SIZE small
+  lv_display_set_buffers(disp, framebuf, NULL, I1_PALETTE_SIZE + epd.stride * epd.height,
+                         LV_DISPLAY_RENDER_MODE_DIRECT);
+  lv_display_set_flush_cb(disp, epd_flush_cb);
+
+  // Signal refresh completion from the BUSY edge instead of the driver's polling
+  busy.irq = busy_irq_init() == 0;
+  if (!busy.irq) {
+    LOG_WRN("No BUSY interrupt, completion follows the driver");
+  }
+
+  k_thread_create(&epd_thread, epd_stack, K_THREAD_STACK_SIZEOF(epd_stack), epd_thread_fn, NULL,
+                  NULL, NULL, CONFIG_EPD_REFRESH_PRIORITY, 0, K_NO_WAIT);
+  k_thread_name_set(&epd_thread, "epd_refresh");
+
+  LOG_INF("Refresh scheduler on %ux%u panel, ghost limit %d", epd.width, epd.height,
+          CONFIG_EPD_REFRESH_GHOST_LIMIT);
+  return 0;
+}
+
+#if defined(CONFIG_SHELL)
+static const char *const full_reason_names[EPD_FULL_REASON_COUNT] = {
+    [EPD_FULL_GHOSTING] = "ghosting",
+    [EPD_FULL_APP_SWITCH] = "app switch",
+    [EPD_FULL_QUIET] = "quiet",
+    [EPD_FULL_REQUEST] = "request",
+};
+
+static int cmd_epd_stats(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  struct epd_refresh_stats s;
+
+  epd_refresh_get_stats(&s);
+  uint32_t updates = s.partial + s.full;
+
+  shell_print(sh, "window:    %lld ms", (long long)(k_uptime_get() - s.since_ms));
+  shell_print(sh, "flushes:   %u (%u coalesced)", s.flushes, s.coalesced);
+  shell_print(sh, "partial:   %u, avg %u ms, max %u ms", s.partial,
+              s.partial ? s.partial_ms / s.partial : 0, s.max_partial_ms);
+  shell_print(sh, "full:      %u, avg %u ms, max %u ms", s.full, s.full ? s.full_ms / s.full : 0,
+              s.max_full_ms);
+  for (int i = 0; i < EPD_FULL_REASON_COUNT; i++) {
+    shell_print(sh, "  %-10s %u", full_reason_names[i], s.full_reason[i]);
+  }
+  shell_print(sh, "pixels:    %llu", (unsigned long long)s.pixels);
+  shell_print(sh, "spi bytes: %llu (%u per update)", (unsigned long long)s.tx_bytes,
+              updates ? (uint32_t)(s.tx_bytes / updates) : 0);
+  shell_print(sh, "cpu:       %u us per update",
+              updates ? (uint32_t)(k_cyc_to_us_floor64(s.cpu_cycles) / updates) : 0);
+  shell_print(sh, "waveform:  %u, avg %u ms (BUSY line)", s.busy_count,
+              s.busy_count ? (uint32_t)(k_cyc_to_ms_floor64(s.busy_cycles) / s.busy_count) : 0);
+  shell_print(sh, "overlap:   %u frames rendered during an update", s.overlapped);
+  shell_print(sh, "ghosting:  %u/%d", s.max_tile, CONFIG_EPD_REFRESH_GHOST_LIMIT);
+  return 0;
+}
+
+static int cmd_epd_tiles(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  char line[DIV_ROUND_UP(DT_PROP(EPD_NODE, width), EPD_TILE_PX) * 4 + 1];
+  uint8_t tiles_y = DIV_ROUND_UP(epd.height, EPD_TILE_PX);
+
+  k_mutex_lock(&epd_mutex, K_FOREVER);
+  for (uint8_t ty = 0; ty < tiles_y; ty++) {
+    int len = 0;
+    for (uint8_t tx = 0; tx < epd.tiles_x; tx++) {
+      len += snprintf(&line[len], sizeof(line) - len, "%4u", epd.tiles[ty * epd.tiles_x + tx]);
+    }
+    shell_print(sh, "%s", line);
+  }
+  k_mutex_unlock(&epd_mutex);
+  return 0;
+}
+
+static int cmd_epd_bench(const struct shell *sh, size_t argc, char **argv) {
+  int runs = argc > 1 ? atoi(argv[1]) : 100;
+  lv_area_t areas[] = {
+      {0, 0, epd.width - 1, epd.height - 1}, // full screen
+      {0, 60, epd.width - 1, 123},           // full-width band
+      {104, 60, 151, 123},                   // two digits
+  };
+
+  if (runs <= 0) {
+    shell_error(sh, "usage: epd bench [runs]");
+    return -EINVAL;
+  }
+
+  uint8_t *scratch = k_malloc(sizeof(panel));
+  if (scratch == NULL) {
+    return -ENOMEM;
+  }
+
+  // Time the CPU side of an update: packing the dirty window on the UI thread
+  for (size_t i = 0; i < ARRAY_SIZE(areas); i++) {
+    const lv_area_t *a = &areas[i];
+    uint32_t bytes = 0;
+    uint32_t start = k_cycle_get_32();
+
+    for (int r = 0; r < runs; r++) {
+      bytes = pack(scratch, a);
+    }
+
+    uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    shell_print(sh, "(%d,%d)-(%d,%d): %u bytes, %u ns per flush", a->x1, a->y1, a->x2, a->y2,
+                bytes, (uint32_t)((uint64_t)us * 1000 / runs));
+  }
+
+  k_free(scratch);
+  return 0;
+}
+
+static int cmd_epd_full(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  epd_refresh_request_full(EPD_FULL_REQUEST);
+  shell_print(sh, "Full refresh requested");
+  return 0;
+}
+
+static int cmd_epd_reset(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  epd_refresh_reset_stats();
+  shell_print(sh, "Refresh counters reset");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(epd_cmds,
+                               SHELL_CMD(stats, NULL, "Show refresh counters", cmd_epd_stats),
+                               SHELL_CMD(tiles, NULL, "Show partial refreshes per tile",
+                                         cmd_epd_tiles),
+                               SHELL_CMD_ARG(bench, NULL, "Time the flush path [runs]",
+                                             cmd_epd_bench, 1, 1),
+                               SHELL_CMD(full, NULL, "Request a full refresh", cmd_epd_full),
+                               SHELL_CMD(reset, NULL, "Reset refresh counters", cmd_epd_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(epd, &epd_cmds, "E-paper refresh commands", NULL);
+#endif
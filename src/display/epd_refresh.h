@@ -0,0 +1,136 @@
+/**
+ * @file epd_refresh.h
+ * @brief E-paper refresh scheduler between LVGL and the SSD16xx driver
+ *
+ * LVGL renders directly into a framebuffer in the panel's RAM layout and
+ * its flushes return immediately. At the end of each frame the dirty window
+ * is packed into one of two transmit buffers, and a worker thread sends the
+ * other to the panel, so rendering overlaps the SPI transfer and waveform.
+ * Frames arriving while the panel is busy are merged into one update of
+ * their bounding box. Partial refreshes are counted per screen tile, and a
+ * full refresh is run when the ghosting budget of a tile is used up, on app
+ * switch or at a quiet moment.
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Side of a ghosting accounting tile, in pixels */
+#define EPD_TILE_PX 40
+
+/**
+ * @brief Why a full refresh was run
+ */
+enum epd_full_reason {
+  EPD_FULL_GHOSTING,   /**< A tile reached the partial refresh limit */
+  EPD_FULL_APP_SWITCH, /**< A new app was launched */
+  EPD_FULL_QUIET,      /**< Ghosting cleanup while nothing else was drawn */
+  EPD_FULL_REQUEST,    /**< Explicit request (shell) */
+  EPD_FULL_REASON_COUNT,
+};
+
+/**
+ * @brief Refresh counters, for benchmarking
+ */
+struct epd_refresh_stats {
+  uint32_t flushes;   /**< LVGL flush callbacks */
+  uint32_t coalesced; /**< Flushes merged into an update that was already pending */
+  uint32_t partial;   /**< Partial refreshes run */
+  uint32_t full;      /**< Full refreshes run */
+  uint32_t full_reason[EPD_FULL_REASON_COUNT];
+  uint32_t partial_ms;     /**< Time spent in partial refreshes */
+  uint32_t full_ms;        /**< Time spent in full refreshes */
+  uint32_t max_partial_ms; /**< Slowest partial refresh */
+  uint32_t max_full_ms;    /**< Slowest full refresh */
+  uint64_t pixels;         /**< Area sent to the panel */
+  uint64_t tx_bytes;       /**< Framebuffer bytes sent over SPI */
+  uint64_t cpu_cycles;     /**< UI thread time spent packing dirty windows */
+  uint32_t overlapped;     /**< Frames queued while an update was in flight */
+  uint32_t busy_count;     /**< Waveforms timed from the BUSY line interrupt */
+  uint64_t busy_cycles;    /**< Total BUSY high time */
+  uint32_t max_tile;       /**< Partial refreshes of the most used tile since the last full */
+  int64_t since_ms;        /**< Uptime when the counters were last reset */
+};
+
+/**
+ * @brief Take over the LVGL flush of the default display and start the worker
+ *
+ * Must be called after LVGL is initialized and before the UI loop runs.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int epd_refresh_init(void);
+
+/**
+ * @brief Make the next panel update a full refresh
+ *
+ * The whole frame is redrawn with the full waveform when LVGL flushes the
+ * next frame, or with the current content if nothing is drawn shortly.
+ */
+void epd_refresh_request_full(enum epd_full_reason reason);
+
+/**
+ * @brief Get the refresh counters
+ */
+void epd_refresh_get_stats(struct epd_refresh_stats *stats);
+
+/**
+ * @brief Reset the refresh counters (not the ghosting accounting)
+ */
+void epd_refresh_reset_stats(void);
+
+/**
+ * @brief Render frames without sending them to the panel
+ *
+ * For benchmarks of the render path: while held, LVGL still draws into the
+ * framebuffer but its flushes are dropped and not counted, so no refresh
+ * runs and no ghosting is accounted. The panel then no longer matches the
+ * framebuffer: invalidate what was drawn (e.g. load the screen back) so the
+ * first frame after the release sends it again. UI thread only.
+ *
+ * @param hold Drop flushes from now on, or send them again
+ */
+void epd_refresh_hold(bool hold);
+
+/**
+ * @brief Copy an I1 image straight into the framebuffer
+ *
+ * The rows of a build-time dithered image (see lvgl_add_image COLOR_FORMAT
+ * I1) are already in the panel layout, so they are copied without going
+ * through the LVGL image decoder and blender. Compressed images (img_rle.h)
+ * are decoded row by row into the framebuffer. The area is invalidated so
+ * the next frame sends it; objects drawn over it must not have an opaque
+ * background, and the screen's background must be transparent. UI thread
+ * only.
+ *
+ * @param img Image in LV_COLOR_FORMAT_I1
+ * @param x Left edge, a multiple of 8
+ * @param y Top edge
+ *
+ * @return 0 on success, -ENOTSUP if the image or position can't be copied
+ */
+int epd_refresh_blit_i1(const lv_image_dsc_t *img, int32_t x, int32_t y);
+
+/**
+ * @brief Draw a 1bpp mask into the framebuffer from an LVGL draw event
+ *
+ * For widgets drawing pre-rendered bitmaps (LV_EVENT_DRAW_MAIN): the set
+ * bits of @p bits become black or white pixels, the others are left as
+ * LVGL drew them. The mask is clipped to the area being redrawn, after the
+ * draw tasks already queued on the layer have run, so it lands over the
+ * widget's background and under whatever is drawn after it. UI thread only.
+ *
+ * @param layer Layer of the draw event
+ * @param bits Mask rows, MSB first, unused bits of a row clear
+ * @param stride Bytes per mask row
+ * @param area Screen area of the mask, any position
+ * @param white Draw the set bits white instead of black
+ *
+ * @return Pixels of the mask inside the clip area, or -ENOTSUP if the layer
+ *         doesn't render into the framebuffer
+ */
+int epd_refresh_draw_1bpp(lv_layer_t *layer, const uint8_t *bits, uint16_t stride,
+                          const lv_area_t *area, bool white);
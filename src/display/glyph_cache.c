@@ -0,0 +1,395 @@
+/**
+ * @file glyph_cache.c
+ * @brief LRU cache of thresholded 1bpp glyph bitmaps
+ *
+ * A wrapped font's get_glyph_dsc finds the glyph in a hash of (font, code
+ * point) and, on a miss, asks the wrapped font for the descriptor and the
+ * bitmap, thresholds the bitmap into 1bpp rows and stores both in the least
+ * recently used slot. The descriptor handed to LVGL carries the slot and its
+ * stamp, so get_glyph_bitmap just expands the cached rows into LVGL's A8
+ * glyph buffer, a nibble at a time. LVGL asks for a glyph's bitmap right
+ * after its descriptor in the same thread; should the slot have been reused
+ * in between, the stamp no longer matches and the glyph is skipped.
+ */
+
+#include "glyph_cache.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/dlist.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(glyph_cache, LOG_LEVEL_INF);
+
+/* Cached glyphs, sized for the unique characters of a few notifications */
+#ifndef CONFIG_GLYPH_CACHE_ENTRIES
+#define CONFIG_GLYPH_CACHE_ENTRIES 96
+#endif
+
+/* 1bpp bytes per glyph, rows byte aligned: fits 24x32 px */
+#ifndef CONFIG_GLYPH_CACHE_SLOT_SIZE
+#define CONFIG_GLYPH_CACHE_SLOT_SIZE 96
+#endif
+
+/* A8 level from which a pixel is black on the panel */
+#ifndef CONFIG_GLYPH_CACHE_THRESHOLD
+#define CONFIG_GLYPH_CACHE_THRESHOLD 128
+#endif
+
+/* Fonts that can be wrapped */
+#ifndef CONFIG_GLYPH_CACHE_FONTS
+#define CONFIG_GLYPH_CACHE_FONTS 4
+#endif
+
+#define BUCKETS 64 /* power of two */
+#define NO_ENTRY UINT16_MAX
+
+/* Glyph ids of cached descriptors: flag, 15-bit stamp, slot */
+#define GID_CACHED BIT(31)
+#define GID_STAMP_SHIFT 16
+#define GID_STAMP_MASK 0x7FFF
+#define GID_SLOT_MASK 0xFFFF
+
+BUILD_ASSERT(CONFIG_GLYPH_CACHE_ENTRIES < NO_ENTRY, "too many glyph cache entries");
+
+struct cached_font {
+  lv_font_t font;       /* handed to LVGL, dsc points back here */
+  const lv_font_t *src; /* wrapped font */
+  bool kerned;          /* adv_w depends on the next letter */
+};
+
+struct glyph_entry {
+  sys_dnode_t lru; /* most recently used at the head */
+  const struct cached_font *font;
+  uint32_t letter;
+  uint16_t next;  /* hash chain */
+  uint16_t stamp; /* bumped when the slot is reused */
+  uint16_t adv_w;
+  uint8_t box_w;
+  uint8_t box_h;
+  int8_t ofs_x;
+  int8_t ofs_y;
+  uint8_t bitmap[CONFIG_GLYPH_CACHE_SLOT_SIZE];
+};
+
+static struct cached_font fonts[CONFIG_GLYPH_CACHE_FONTS];
+static size_t font_count;
+static struct k_spinlock font_lock;
+
+static struct glyph_entry entries[CONFIG_GLYPH_CACHE_ENTRIES];
+static uint16_t buckets[BUCKETS];
+static sys_dlist_t lru = SYS_DLIST_STATIC_INIT(&lru);
+static size_t used;
+static atomic_t flush_pending = ATOMIC_INIT(1); /* buckets start out empty */
+
+/* Bitmaps of missed glyphs are fetched into this A8 buffer */
+static uint8_t scratch[CONFIG_GLYPH_CACHE_SLOT_SIZE * 8] __aligned(LV_DRAW_BUF_ALIGN);
+static lv_draw_buf_t scratch_buf;
+
+static struct glyph_cache_stats stats;
+static struct k_spinlock stats_lock;
+
+/* A8 pixels of a 1bpp nibble, most significant bit first */
+static const uint8_t nibble_a8[16][4] = {
+    {0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x00, 0xFF}, {0x00, 0x00, 0xFF, 0x00},
+    {0x00, 0x00, 0xFF, 0xFF}, {0x00, 0xFF, 0x00, 0x00}, {0x00, 0xFF, 0x00, 0xFF},
+    {0x00, 0xFF, 0xFF, 0x00}, {0x00, 0xFF, 0xFF, 0xFF}, {0xFF, 0x00, 0x00, 0x00},
+    {0xFF, 0x00, 0x00, 0xFF}, {0xFF, 0x00, 0xFF, 0x00}, {0xFF, 0x00, 0xFF, 0xFF},
+    {0xFF, 0xFF, 0x00, 0x00}, {0xFF, 0xFF, 0x00, 0xFF}, {0xFF, 0xFF, 0xFF, 0x00},
+    {0xFF, 0xFF, 0xFF, 0xFF},
+};
+
+static void count(uint32_t *counter) {
+  k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+  (*counter)++;
+  k_spin_unlock(&stats_lock, key);
+}
+
+static uint32_t bucket_of(const struct cached_font *font, uint32_t letter) {
+  uint32_t h = (letter * 0x9E3779B1u) ^ ((uintptr_t)font >> 4);
+
+  return (h ^ (h >> 16)) & (BUCKETS - 1);
+}
+
+static void flush(void) {
+  memset(buckets, 0xFF, sizeof(buckets));
+  sys_dlist_init(&lru);
+  used = 0;
+}
+
+static struct glyph_entry *lookup(const struct cached_font *font, uint32_t letter) {
+  for (uint16_t i = buckets[bucket_of(font, letter)]; i != NO_ENTRY; i = entries[i].next) {
+    if (entries[i].font == font && entries[i].letter == letter) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+/* Take a free slot, or evict the least recently used glyph */
+static struct glyph_entry *alloc_entry(void) {
+  struct glyph_entry *e;
+
+  if (used < ARRAY_SIZE(entries)) {
+    return &entries[used++];
+  }
+
+  e = CONTAINER_OF(sys_dlist_peek_tail(&lru), struct glyph_entry, lru);
+  sys_dlist_remove(&e->lru);
+
+  uint16_t *link = &buckets[bucket_of(e->font, e->letter)];
+  uint16_t idx = e - entries;
+  while (*link != idx) {
+    link = &entries[*link].next;
+  }
+  *link = e->next;
+
+  e->stamp = (e->stamp + 1) & GID_STAMP_MASK;
+  count(&stats.evictions);
+  return e;
+}
+
+/* Threshold the A8 bitmap of a glyph into the entry's 1bpp rows */
+static void store_bitmap(struct glyph_entry *e, const uint8_t *a8, uint32_t a8_stride) {
+  uint32_t stride = DIV_ROUND_UP(e->box_w, 8);
+
+  memset(e->bitmap, 0, stride * e->box_h);
+  if (a8 == NULL) {
+    return;
+  }
+  for (uint32_t y = 0; y < e->box_h; y++) {
+    const uint8_t *src = &a8[y * a8_stride];
+    uint8_t *dst = &e->bitmap[y * stride];
+
+    for (uint32_t x = 0; x < e->box_w; x++) {
+      if (src[x] >= CONFIG_GLYPH_CACHE_THRESHOLD) {
+        dst[x / 8] |= 0x80 >> (x % 8);
+      }
+    }
+  }
+}
+
+static void fill_dsc(const struct glyph_entry *e, lv_font_glyph_dsc_t *dsc) {
+  dsc->adv_w = e->adv_w;
+  dsc->box_w = e->box_w;
+  dsc->box_h = e->box_h;
+  dsc->ofs_x = e->ofs_x;
+  dsc->ofs_y = e->ofs_y;
+  dsc->format = LV_FONT_GLYPH_FORMAT_A1;
+  dsc->is_placeholder = false;
+  dsc->gid.index = GID_CACHED | ((uint32_t)e->stamp << GID_STAMP_SHIFT) | (e - entries);
+}
+
+static bool cache_get_glyph_dsc(const lv_font_t *lv_font, lv_font_glyph_dsc_t *dsc,
+                                uint32_t letter, uint32_t letter_next) {
+  const struct cached_font *font = lv_font->dsc;
+  const lv_font_t *src = font->src;
+  struct glyph_entry *e;
+
+  if (atomic_clear(&flush_pending)) {
+    flush();
+  }
+
+  e = lookup(font, letter);
+  if (e != NULL) {
+    sys_dlist_remove(&e->lru);
+    sys_dlist_prepend(&lru, &e->lru);
+    count(&stats.hits);
+    fill_dsc(e, dsc);
+
+    // Kerning pairs are not cached, only the advance changes
+    if (font->kerned && letter_next != 0) {
+      lv_font_glyph_dsc_t kerned;
+
+      if (src->get_glyph_dsc(src, &kerned, letter, letter_next)) {
+        dsc->adv_w = kerned.adv_w;
+      }
+    }
+    return true;
+  }
+
+  if (!src->get_glyph_dsc(src, dsc, letter, letter_next)) {
+    return false;
+  }
+
+  // Glyphs of other formats or too large for a slot are drawn by the wrapped
+  // font, whose glyph ids (below 2^20 for fmt_txt) never have GID_CACHED set
+  uint32_t a8_stride = lv_draw_buf_width_to_stride(dsc->box_w, LV_COLOR_FORMAT_A8);
+  if (dsc->format < LV_FONT_GLYPH_FORMAT_A1 || dsc->format > LV_FONT_GLYPH_FORMAT_A8 ||
+      dsc->box_w > UINT8_MAX || dsc->box_h > UINT8_MAX || dsc->ofs_x < INT8_MIN ||
+      dsc->ofs_x > INT8_MAX || dsc->ofs_y < INT8_MIN || dsc->ofs_y > INT8_MAX ||
+      DIV_ROUND_UP(dsc->box_w, 8) * dsc->box_h > CONFIG_GLYPH_CACHE_SLOT_SIZE ||
+      a8_stride * dsc->box_h > sizeof(scratch)) {
+    count(&stats.bypass);
+    return true;
+  }
+
+  const uint8_t *a8 = NULL;
+  if (dsc->box_w > 0 && dsc->box_h > 0) {
+    lv_draw_buf_init(&scratch_buf, dsc->box_w, dsc->box_h, LV_COLOR_FORMAT_A8, a8_stride, scratch,
+                     sizeof(scratch));
+    dsc->resolved_font = src;
+    a8 = src->get_glyph_bitmap(dsc, &scratch_buf);
+  }
+
+  // The cache keeps the advance without kerning, dsc has it for this pair
+  uint16_t adv_w = dsc->adv_w;
+  uint16_t plain_adv_w = adv_w;
+  if (font->kerned && letter_next != 0) {
+    lv_font_glyph_dsc_t plain;
+
+    if (src->get_glyph_dsc(src, &plain, letter, 0)) {
+      plain_adv_w = plain.adv_w;
+    }
+  }
+
+  e = alloc_entry();
+  e->font = font;
+  e->letter = letter;
+  e->adv_w = plain_adv_w;
+  e->box_w = dsc->box_w;
+  e->box_h = dsc->box_h;
+  e->ofs_x = dsc->ofs_x;
+  e->ofs_y = dsc->ofs_y;
+  store_bitmap(e, a8, a8_stride);
+
+  uint32_t b = bucket_of(font, letter);
+  e->next = buckets[b];
+  buckets[b] = e - entries;
+  sys_dlist_prepend(&lru, &e->lru);
+  count(&stats.misses);
+
+  fill_dsc(e, dsc);
+  dsc->adv_w = adv_w;
+  return true;
+}
+
+static const void *cache_get_glyph_bitmap(lv_font_glyph_dsc_t *dsc, lv_draw_buf_t *draw_buf) {
+  const struct cached_font *font = dsc->resolved_font->dsc;
+  uint32_t gid = dsc->gid.index;
+
+  if (!(gid & GID_CACHED)) {
+    lv_font_glyph_dsc_t src_dsc = *dsc;
+
+    src_dsc.resolved_font = font->src;
+    return font->src->get_glyph_bitmap(&src_dsc, draw_buf);
+  }
+
+  const struct glyph_entry *e = &entries[gid & GID_SLOT_MASK];
+  if (e->stamp != ((gid >> GID_STAMP_SHIFT) & GID_STAMP_MASK) || e->box_w != dsc->box_w ||
+      e->box_h != dsc->box_h) {
+    count(&stats.stale);
+    return NULL;
+  }
+  if (draw_buf == NULL || e->box_w == 0 || e->box_h == 0) {
+    return NULL;
+  }
+
+  uint32_t stride = DIV_ROUND_UP(e->box_w, 8);
+  uint32_t whole = e->box_w / 8;
+  uint8_t *out = draw_buf->data;
+
+  for (uint32_t y = 0; y < e->box_h; y++) {
+    const uint8_t *row = &e->bitmap[y * stride];
+    uint8_t *dst = out + y * draw_buf->header.stride;
+    uint32_t x;
+
+    for (x = 0; x < whole; x++) {
+      memcpy(dst, nibble_a8[row[x] >> 4], 4);
+      memcpy(dst + 4, nibble_a8[row[x] & 0x0F], 4);
+      dst += 8;
+    }
+    for (x *= 8; x < e->box_w; x++) {
+      *dst++ = (row[x / 8] & (0x80 >> (x % 8))) ? 0xFF : 0x00;
+    }
+  }
+  return out;
+}
+
+const lv_font_t *glyph_cache_wrap(const lv_font_t *font) {
+  const lv_font_t *wrapped = font;
+  k_spinlock_key_t key = k_spin_lock(&font_lock);
+
+  for (size_t i = 0; i < font_count; i++) {
+    if (fonts[i].src == font) {
+      wrapped = &fonts[i].font;
+      goto out;
+    }
+  }
+
+  if (font_count == ARRAY_SIZE(fonts)) {
+    LOG_WRN("No glyph cache slot for another font");
+    goto out;
+  }
+
+  struct cached_font *f = &fonts[font_count++];
+
+  f->src = font;
+  f->kerned = font->kerning != LV_FONT_KERNING_NONE;
+  if (font->get_glyph_dsc == lv_font_get_glyph_dsc_fmt_txt) {
+    f->kerned = f->kerned && ((const lv_font_fmt_txt_dsc_t *)font->dsc)->kern_dsc != NULL;
+  }
+  f->font = *font;
+  f->font.get_glyph_dsc = cache_get_glyph_dsc;
+  f->font.get_glyph_bitmap = cache_get_glyph_bitmap;
+  f->font.dsc = f;
+  wrapped = &f->font;
+
+out:
+  k_spin_unlock(&font_lock, key);
+  return wrapped;
+}
+
+void glyph_cache_flush(void) { atomic_set(&flush_pending, 1); }
+
+void glyph_cache_get_stats(struct glyph_cache_stats *out) {
+  k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+  *out = stats;
+  k_spin_unlock(&stats_lock, key);
+  out->entries = atomic_get(&flush_pending) ? 0 : used;
+  out->capacity = ARRAY_SIZE(entries);
+}
+
+void glyph_cache_reset_stats(void) {
+  k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+  memset(&stats, 0, sizeof(stats));
+  k_spin_unlock(&stats_lock, key);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_glyphs_stats(const struct shell *sh, size_t argc, char **argv) {
+  struct glyph_cache_stats s;
+
+  glyph_cache_get_stats(&s);
+  shell_print(sh, "entries: %u/%u, %zu bytes", s.entries, s.capacity, sizeof(entries));
+  shell_print(sh, "hits: %u, misses: %u (%u%% hit rate)", s.hits, s.misses,
+              s.hits + s.misses ? s.hits * 100 / (s.hits + s.misses) : 0);
+  shell_print(sh, "evictions: %u, bypass: %u, stale: %u", s.evictions, s.bypass, s.stale);
+  return 0;
+}
+
+static int cmd_glyphs_reset(const struct shell *sh, size_t argc, char **argv) {
+  glyph_cache_reset_stats();
+  shell_print(sh, "Counters cleared");
+  return 0;
+}
+
+static int cmd_glyphs_flush(const struct shell *sh, size_t argc, char **argv) {
+  glyph_cache_flush();
+  shell_print(sh, "Cache emptied at the next lookup");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(glyphs_cmds,
+                               SHELL_CMD(stats, NULL, "Show cache counters", cmd_glyphs_stats),
+                               SHELL_CMD(reset, NULL, "Clear cache counters", cmd_glyphs_reset),
+                               SHELL_CMD(flush, NULL, "Drop all cached glyphs", cmd_glyphs_flush),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(glyphs, &glyphs_cmds, "Glyph cache commands", NULL);
+#endif
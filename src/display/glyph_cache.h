@@ -0,0 +1,58 @@
+/**
+ * @file glyph_cache.h
+ * @brief LRU cache of thresholded 1bpp glyph bitmaps
+ *
+ * LVGL looks every character of a label up in its font on each redraw, once
+ * for the glyph descriptor and once for the bitmap, which a fmt_txt font
+ * finds by searching its character maps and unpacks from its tables. A font
+ * returned by glyph_cache_wrap() answers both from a fixed-size cache keyed
+ * by (font, code point) instead, holding each bitmap cut to 1bpp the way the
+ * panel shows it. Misses are filled from the wrapped font, evicting the
+ * least recently used glyph.
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <stdint.h>
+
+/**
+ * @brief Cache counters
+ */
+struct glyph_cache_stats {
+  uint32_t hits;      /**< Glyphs served from the cache */
+  uint32_t misses;    /**< Glyphs filled from the wrapped font */
+  uint32_t evictions; /**< Least recently used glyphs dropped for a miss */
+  uint32_t bypass;    /**< Glyphs too large for a cache slot, drawn uncached */
+  uint32_t stale;     /**< Bitmaps requested after their glyph was evicted */
+  uint32_t entries;   /**< Glyphs in the cache */
+  uint32_t capacity;  /**< Cache slots */
+};
+
+/**
+ * @brief Get the cached version of a font
+ *
+ * The returned font draws the same glyphs as @p font, thresholded to 1bpp,
+ * and keeps its fallback. Wrapping the same font again returns the same
+ * font; only bitmap fonts (lv_font_fmt_txt and the like) can be wrapped.
+ *
+ * @return The cached font, or @p font itself if all wrapper slots are used
+ */
+const lv_font_t *glyph_cache_wrap(const lv_font_t *font);
+
+/**
+ * @brief Drop all cached glyphs
+ *
+ * Safe from any thread, the cache is emptied by the next lookup.
+ */
+void glyph_cache_flush(void);
+
+/**
+ * @brief Get the cache counters
+ */
+void glyph_cache_get_stats(struct glyph_cache_stats *stats);
+
+/**
+ * @brief Clear the hit, miss, eviction, bypass and stale counters
+ */
+void glyph_cache_reset_stats(void);
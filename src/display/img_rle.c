@@ -0,0 +1,215 @@
+/**
+ * @file img_rle.c
+ * @brief Run-length compressed 1bpp images
+ *
+ * Rows are decoded on demand through a cursor. The LVGL decoder never holds
+ * a decoded copy of the image: for each draw it hands LVGL bands of the
+ * requested area, decoded into one static scratch buffer, so drawing an
+ * image costs the rows it touches and no heap. LVGL draws one image at a
+ * time (single software draw unit), an image opened while the scratch
+ * buffer is in use is left to the next decoder.
+ */
+
+#include "img_rle.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(img_rle, LOG_LEVEL_INF);
+
+/* Band buffer handed to LVGL, in L8 (one byte per pixel) */
+#ifndef CONFIG_IMG_RLE_SCRATCH_SIZE
+#define CONFIG_IMG_RLE_SCRATCH_SIZE 2048
+#endif
+
+/* Widest decodable row, in bytes (512 pixels) */
+#define IMG_RLE_MAX_STRIDE 64
+
+#define IMG_RLE_PALETTE_SIZE 8
+#define IMG_RLE_HEADER_SIZE 4
+
+static struct {
+  struct img_rle_cursor cur;
+  lv_draw_buf_t band;
+  uint8_t row[IMG_RLE_MAX_STRIDE];
+  bool in_use;
+} dec;
+
+static uint8_t scratch[CONFIG_IMG_RLE_SCRATCH_SIZE] __aligned(LV_DRAW_BUF_ALIGN);
+
+/* Run a row's codes, writing them to @p dst unless it is NULL */
+static int decode_row(struct img_rle_cursor *cur, uint8_t *dst) {
+  uint32_t stride = cur->img->header.stride;
+  const uint8_t *p = cur->pos;
+  uint32_t out = 0;
+
+  while (out < stride) {
+    if (p >= cur->end) {
+      return -EINVAL;
+    }
+
+    uint8_t code = *p++;
+    if (code < 128) {
+      uint32_t n = code + 1;
+      if (out + n > stride || p + n > cur->end) {
+        return -EINVAL;
+      }
+      if (dst != NULL) {
+        memcpy(&dst[out], p, n);
+      }
+      p += n;
+      out += n;
+    } else {
+      uint32_t n = code - 126;
+      if (out + n > stride || p >= cur->end) {
+        return -EINVAL;
+      }
+      if (dst != NULL) {
+        memset(&dst[out], *p, n);
+      }
+      p++;
+      out += n;
+    }
+  }
+
+  cur->pos = p;
+  cur->row++;
+  return 0;
+}
+
+int img_rle_seek(struct img_rle_cursor *cur, const lv_image_dsc_t *img, int32_t row) {
+  if (!img_rle_is_rle(img) || row < 0 || row >= img->header.h ||
+      img->data_size < IMG_RLE_PALETTE_SIZE + IMG_RLE_HEADER_SIZE) {
+    return -EINVAL;
+  }
+
+  const uint8_t *hdr = img->data + IMG_RLE_PALETTE_SIZE;
+  uint16_t block_rows = sys_get_le16(hdr);
+  uint16_t blocks = sys_get_le16(hdr + 2);
+  const uint8_t *offsets = hdr + IMG_RLE_HEADER_SIZE;
+  const uint8_t *stream = offsets + blocks * sizeof(uint32_t);
+  int32_t block = block_rows ? row / block_rows : 0;
+
+  if (block_rows == 0 || block >= blocks || stream > img->data + img->data_size) {
+    return -EINVAL;
+  }
+
+  cur->img = img;
+  cur->end = img->data + img->data_size;
+  cur->pos = stream + sys_get_le32(offsets + block * sizeof(uint32_t));
+  cur->row = block * block_rows;
+  if (cur->pos > cur->end) {
+    return -EINVAL;
+  }
+
+  // Skip the rows of the block above the requested one
+  while (cur->row < row) {
+    int ret = decode_row(cur, NULL);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int img_rle_next_row(struct img_rle_cursor *cur, uint8_t *dst) {
+  if (cur->row >= cur->img->header.h) {
+    return -EINVAL;
+  }
+  return decode_row(cur, dst);
+}
+
+static lv_result_t rle_info(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc,
+                            lv_image_header_t *header) {
+  ARG_UNUSED(decoder);
+
+  if (dsc->src_type != LV_IMAGE_SRC_VARIABLE || !img_rle_is_rle(dsc->src)) {
+    return LV_RESULT_INVALID;
+  }
+
+  *header = ((const lv_image_dsc_t *)dsc->src)->header;
+  return LV_RESULT_OK;
+}
+
+static lv_result_t rle_open(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc) {
+  ARG_UNUSED(decoder);
+  const lv_image_dsc_t *img = dsc->src;
+
+  if (dec.in_use || img->header.stride > IMG_RLE_MAX_STRIDE ||
+      lv_draw_buf_width_to_stride(img->header.w, LV_COLOR_FORMAT_L8) > sizeof(scratch)) {
+    LOG_WRN("Can't open %ux%u image", img->header.w, img->header.h);
+    return LV_RESULT_INVALID;
+  }
+
+  // Nothing decoded up front, LVGL asks for bands through rle_get_area()
+  dec.in_use = true;
+  dec.cur.img = NULL;
+  dsc->decoded = NULL;
+  return LV_RESULT_OK;
+}
+
+static lv_result_t rle_get_area(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc,
+                                const lv_area_t *full_area, lv_area_t *decoded_area) {
+  ARG_UNUSED(decoder);
+  const lv_image_dsc_t *img = dsc->src;
+  int32_t y = decoded_area->y1 == LV_COORD_MIN ? full_area->y1 : decoded_area->y2 + 1;
+
+  if (y > full_area->y2) {
+    return LV_RESULT_INVALID;
+  }
+
+  // Bands follow each other, the cursor only seeks for the first one
+  if ((dec.cur.img != img || dec.cur.row != y) && img_rle_seek(&dec.cur, img, y) < 0) {
+    return LV_RESULT_INVALID;
+  }
+
+  int32_t width = lv_area_get_width(full_area);
+  uint32_t stride = lv_draw_buf_width_to_stride(width, LV_COLOR_FORMAT_L8);
+  int32_t rows = MIN((int32_t)(sizeof(scratch) / stride), full_area->y2 - y + 1);
+
+  lv_draw_buf_init(&dec.band, width, rows, LV_COLOR_FORMAT_L8, stride, scratch, sizeof(scratch));
+
+  // Expand the requested columns, palette index 1 is white
+  for (int32_t r = 0; r < rows; r++) {
+    uint8_t *out = &scratch[r * stride];
+
+    if (img_rle_next_row(&dec.cur, dec.row) < 0) {
+      return LV_RESULT_INVALID;
+    }
+    for (int32_t x = full_area->x1; x <= full_area->x2; x++) {
+      *out++ = dec.row[x / 8] & BIT(7 - x % 8) ? 0xFF : 0x00;
+    }
+  }
+
+  decoded_area->x1 = full_area->x1;
+  decoded_area->x2 = full_area->x2;
+  decoded_area->y1 = y;
+  decoded_area->y2 = y + rows - 1;
+  dsc->decoded = &dec.band;
+  return LV_RESULT_OK;
+}
+
+static void rle_close(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc) {
+  ARG_UNUSED(decoder);
+  ARG_UNUSED(dsc);
+
+  dec.in_use = false;
+}
+
+int img_rle_decoder_init(void) {
+  lv_image_decoder_t *decoder = lv_image_decoder_create();
+
+  if (decoder == NULL) {
+    return -ENOMEM;
+  }
+
+  lv_image_decoder_set_info_cb(decoder, rle_info);
+  lv_image_decoder_set_open_cb(decoder, rle_open);
+  lv_image_decoder_set_get_area_cb(decoder, rle_get_area);
+  lv_image_decoder_set_close_cb(decoder, rle_close);
+
+  LOG_INF("RLE image decoder, %u byte band buffer", (unsigned int)sizeof(scratch));
+  return 0;
+}
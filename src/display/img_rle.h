@@ -0,0 +1,71 @@
+/**
+ * @file img_rle.h
+ * @brief Run-length compressed 1bpp images with row-level random access
+ *
+ * Produced by script/img_to_i1.py (lvgl_add_image COLOR_FORMAT I1 COMPRESS
+ * RLE). The descriptor keeps cf = LV_COLOR_FORMAT_I1 and the decoded stride,
+ * and sets IMG_RLE_FLAG. Data layout, little endian:
+ *
+ *   palette[8]                     same as an uncompressed I1 image
+ *   uint16_t block_rows            rows per index entry
+ *   uint16_t blocks
+ *   uint32_t offsets[blocks]       start of each block, from the stream
+ *   stream                         PackBits-style codes, row by row
+ *
+ * A code byte c < 128 is followed by c + 1 literal bytes; c >= 128 repeats
+ * the next byte c - 126 times. Codes never span rows, so a row is reached
+ * by jumping to its block and skipping at most block_rows - 1 rows.
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Descriptor flag marking the compressed layout */
+#define IMG_RLE_FLAG LV_IMAGE_FLAGS_USER1
+
+/**
+ * @brief Sequential row reader of a compressed image
+ */
+struct img_rle_cursor {
+  const lv_image_dsc_t *img;
+  const uint8_t *pos; /**< Next code of row */
+  const uint8_t *end;
+  int32_t row;        /**< Row decoded by the next img_rle_next_row() */
+};
+
+/**
+ * @brief Check whether an image uses the compressed layout
+ */
+static inline bool img_rle_is_rle(const lv_image_dsc_t *img) {
+  return img->header.cf == LV_COLOR_FORMAT_I1 && (img->header.flags & IMG_RLE_FLAG);
+}
+
+/**
+ * @brief Position a cursor on a row
+ *
+ * @return 0 on success, -EINVAL if the image or row is invalid
+ */
+int img_rle_seek(struct img_rle_cursor *cur, const lv_image_dsc_t *img, int32_t row);
+
+/**
+ * @brief Decode the cursor's row and advance to the next one
+ *
+ * @param dst Destination of header.stride bytes, in the I1 layout
+ *
+ * @return 0 on success, -EINVAL on corrupt data or past the last row
+ */
+int img_rle_next_row(struct img_rle_cursor *cur, uint8_t *dst);
+
+/**
+ * @brief Register the LVGL image decoder for compressed images
+ *
+ * Image widgets then draw compressed images by decoding only the rows of
+ * the area being drawn, a band at a time, into a fixed scratch buffer.
+ * Transformed (scaled or rotated) drawing is not supported.
+ *
+ * @return 0 on success, -ENOMEM if the decoder can't be created
+ */
+int img_rle_decoder_init(void);
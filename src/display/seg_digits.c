@@ -0,0 +1,219 @@
+/**
+ * @file seg_digits.c
+ * @brief Seven-segment time digits drawn from pre-rendered 1bpp sprites
+ *
+ * The widget (shell builds only) is a plain object with a draw callback;
+ * its text lives in a small struct in the user data. Cells are laid out left
+ * to right in the content area, digits in cells of digit_w and colons in
+ * cells of colon_w, each sprite placed at its offset in the cell.
+ */
+
+#include "seg_digits.h"
+#include "epd_refresh.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(seg_digits, LOG_LEVEL_INF);
+
+/* Only touched from the UI thread, read by the shell */
+static struct seg_digits_stats stats;
+
+static int sprite_index(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  return c == ':' ? DIGIT_SPRITE_COLON : -1;
+}
+
+void seg_digits_draw_char(lv_layer_t *layer, const struct digit_sprite_set *set, char c,
+                          const lv_area_t *cell, lv_color_t color, const lv_font_t *font) {
+  int index = sprite_index(c);
+  if (index < 0) {
+    return;
+  }
+
+  uint32_t start = k_cycle_get_32();
+  const struct digit_sprite *s = &set->sprites[index];
+  lv_area_t box = {cell->x1 + s->x, cell->y1 + s->y, cell->x1 + s->x + s->w - 1,
+                   cell->y1 + s->y + s->h - 1};
+  bool white = lv_color_brightness(color) > 127;
+  int ret = s->w > 0 ? epd_refresh_draw_1bpp(layer, s->bits, s->stride, &box, white) : 0;
+
+  if (ret > 0) {
+    stats.cells_drawn++;
+    stats.pixels += ret;
+  } else if (ret < 0) {
+    // Not the framebuffer: draw the character as text
+    char text[2] = {c, '\0'};
+    lv_draw_label_dsc_t dsc;
+
+    lv_draw_label_dsc_init(&dsc);
+    dsc.font = font;
+    dsc.color = color;
+    dsc.text = text;
+    dsc.text_local = 1;
+    dsc.align = LV_TEXT_ALIGN_CENTER;
+    lv_draw_label(layer, &dsc, cell);
+    stats.fallback++;
+  }
+  stats.draw_cycles += k_cycle_get_32() - start;
+}
+
+void seg_digits_get_stats(struct seg_digits_stats *out) {
+  *out = stats;
+}
+
+void seg_digits_reset_stats(void) {
+  stats = (struct seg_digits_stats){0};
+}
+
+#if defined(CONFIG_SHELL)
+/* The widget, kept to compare the face against in "wf bench" */
+struct seg_digits {
+  const struct digit_sprite_set *set;
+  char text[SEG_DIGITS_MAX_CELLS + 1];
+};
+
+static int32_t text_width(const struct seg_digits *d) {
+  int32_t w = 0;
+
+  for (const char *c = d->text; *c != '\0'; c++) {
+    w += seg_digits_cell_width(d->set, *c);
+  }
+  return w;
+}
+
+/* Screen area of cell @p i */
+static void cell_area(lv_obj_t *obj, const struct seg_digits *d, int i, lv_area_t *area) {
+  lv_obj_get_content_coords(obj, area);
+  for (int j = 0; j < i; j++) {
+    area->x1 += seg_digits_cell_width(d->set, d->text[j]);
+  }
+  area->x2 = area->x1 + seg_digits_cell_width(d->set, d->text[i]) - 1;
+  area->y2 = area->y1 + d->set->height - 1;
+}
+
+static void draw_cells(lv_obj_t *obj, const struct seg_digits *d, lv_layer_t *layer) {
+  lv_color_t color = lv_obj_get_style_text_color(obj, LV_PART_MAIN);
+  const lv_font_t *font = lv_obj_get_style_text_font(obj, LV_PART_MAIN);
+  lv_area_t cell;
+
+  for (int i = 0; d->text[i] != '\0'; i++) {
+    cell_area(obj, d, i, &cell);
+    seg_digits_draw_char(layer, d->set, d->text[i], &cell, color, font);
+  }
+}
+
+static void seg_digits_event_cb(lv_event_t *e) {
+  lv_obj_t *obj = lv_event_get_target(e);
+  struct seg_digits *d = lv_obj_get_user_data(obj);
+
+  switch (lv_event_get_code(e)) {
+  case LV_EVENT_DRAW_MAIN:
+    // The object's own handler has drawn the background already
+    draw_cells(obj, d, lv_event_get_layer(e));
+    break;
+  case LV_EVENT_GET_SELF_SIZE: {
+    lv_point_t *size = lv_event_get_param(e);
+    size->x = MAX(size->x, text_width(d));
+    size->y = MAX(size->y, d->set->height);
+    break;
+  }
+  case LV_EVENT_DELETE:
+    lv_free(d);
+    break;
+  default:
+    break;
+  }
+}
+
+lv_obj_t *seg_digits_create(lv_obj_t *parent, const struct digit_sprite_set *set) {
+  struct seg_digits *d = lv_malloc_zeroed(sizeof(*d));
+  if (d == NULL) {
+    return NULL;
+  }
+
+  lv_obj_t *obj = lv_obj_create(parent);
+  if (obj == NULL) {
+    lv_free(d);
+    return NULL;
+  }
+
+  d->set = set;
+  lv_obj_remove_style_all(obj);
+  lv_obj_remove_flag(obj, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_set_size(obj, LV_SIZE_CONTENT, LV_SIZE_CONTENT);
+  lv_obj_set_user_data(obj, d);
+  lv_obj_add_event_cb(obj, seg_digits_event_cb, LV_EVENT_ALL, NULL);
+  return obj;
+}
+
+void seg_digits_set_text(lv_obj_t *obj, const char *text) {
+  struct seg_digits *d = lv_obj_get_user_data(obj);
+  size_t len = MIN(strlen(text), SEG_DIGITS_MAX_CELLS);
+  bool relayout = len != strlen(d->text);
+
+  // A digit turning into a colon (or back) moves the cells after it
+  for (size_t i = 0; i < len && !relayout; i++) {
+    relayout = (text[i] == ':') != (d->text[i] == ':');
+  }
+
+  if (relayout) {
+    lv_obj_invalidate(obj);
+    memcpy(d->text, text, len);
+    d->text[len] = '\0';
+    stats.cells_changed += len;
+    lv_obj_refresh_self_size(obj);
+    return;
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    if (d->text[i] == text[i]) {
+      continue;
+    }
+
+    lv_area_t cell;
+    d->text[i] = text[i];
+    cell_area(obj, d, i, &cell);
+    lv_obj_invalidate_area(obj, &cell);
+    stats.cells_changed++;
+  }
+}
+
+static int cmd_digits_stats(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  struct seg_digits_stats s;
+  seg_digits_get_stats(&s);
+
+  uint32_t us = (uint32_t)k_cyc_to_us_floor64(s.draw_cycles);
+  shell_print(sh, "cells changed: %u", s.cells_changed);
+  shell_print(sh, "cells drawn:   %u, %u more as text", s.cells_drawn, s.fallback);
+  shell_print(sh, "pixels:        %u", s.pixels);
+  shell_print(sh, "draw time:     %u us, %u us per cell", us,
+              s.cells_drawn ? us / s.cells_drawn : 0);
+  return 0;
+}
+
+static int cmd_digits_reset(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  seg_digits_reset_stats();
+  shell_print(sh, "Digit counters reset");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(digits_cmds,
+                               SHELL_CMD(stats, NULL, "Show sprite digit counters",
+                                         cmd_digits_stats),
+                               SHELL_CMD(reset, NULL, "Reset sprite digit counters",
+                                         cmd_digits_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(digits, &digits_cmds, "Sprite digit commands", NULL);
+#endif
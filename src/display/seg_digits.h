@@ -0,0 +1,122 @@
+/**
+ * @file seg_digits.h
+ * @brief Seven-segment time digits drawn from pre-rendered 1bpp sprites
+ *
+ * The sprites of '0'-'9' and ':' are rasterized and thresholded at build
+ * time (lvgl_add_digit_sprites() in cmake/lvgl_font.cmake), so drawing a
+ * digit is a copy of its ink bits into the framebuffer: no text layout, no
+ * glyph lookup and no bitmap unpacking. Each character sits in a fixed cell
+ * and changing the text invalidates only the cells whose character changed.
+ *
+ * The watch face draws its digits with seg_digits_draw_char(). The widget
+ * built on it is only there for "wf bench" to compare against, so it exists
+ * in shell builds only. It is a plain object: background, border, padding
+ * and radius come from its styles, the ink is drawn white if the text color
+ * is light. Where the framebuffer can't be written directly the characters
+ * are drawn as text in the object's font.
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <stdint.h>
+
+/** Sprites of a set: the ten digits, then the colon */
+#define DIGIT_SPRITE_COLON 10
+#define DIGIT_SPRITE_COUNT 11
+
+/** Longest text of a widget */
+#define SEG_DIGITS_MAX_CELLS 8
+
+/**
+ * @brief Ink bits of one character, cropped to its bounding box
+ *
+ * Rows are byte aligned, MSB first, 1 = ink.
+ */
+struct digit_sprite {
+  int8_t x;       /**< Left of the box in the cell */
+  int8_t y;       /**< Top of the box in the cell */
+  uint8_t w;      /**< Box width */
+  uint8_t h;      /**< Box height */
+  uint8_t stride; /**< Bytes per row */
+  const uint8_t *bits;
+};
+
+/**
+ * @brief Sprites generated from one font size
+ */
+struct digit_sprite_set {
+  uint8_t height;  /**< Cell height, the font's line height */
+  uint8_t digit_w; /**< Cell width of the digits */
+  uint8_t colon_w; /**< Cell width of the colon */
+  struct digit_sprite sprites[DIGIT_SPRITE_COUNT];
+};
+
+/**
+ * @brief Sprite widget counters, of the widget and seg_digits_draw_char()
+ */
+struct seg_digits_stats {
+  uint32_t cells_changed; /**< Cells invalidated by a text change */
+  uint32_t cells_drawn;   /**< Cells copied into the framebuffer */
+  uint32_t fallback;      /**< Cells drawn as text */
+  uint32_t pixels;        /**< Sprite pixels copied */
+  uint64_t draw_cycles;   /**< Time spent drawing cells */
+};
+
+#if defined(CONFIG_SHELL)
+/**
+ * @brief Create a digit widget
+ *
+ * The widget sizes itself to its text and starts empty.
+ *
+ * @param parent Parent object
+ * @param set Sprites to draw with, must stay valid
+ *
+ * @return The widget, or NULL on allocation failure
+ */
+lv_obj_t *seg_digits_create(lv_obj_t *parent, const struct digit_sprite_set *set);
+
+/**
+ * @brief Set the text of a digit widget
+ *
+ * Only '0'-'9' and ':' are drawn, other characters leave their cell blank.
+ * Text longer than SEG_DIGITS_MAX_CELLS is cut. Cells whose character is
+ * unchanged are not redrawn, unless the cell layout changes.
+ */
+void seg_digits_set_text(lv_obj_t *obj, const char *text);
+#endif
+
+/**
+ * @brief Get the width of the cell of a character
+ */
+static inline int32_t seg_digits_cell_width(const struct digit_sprite_set *set, char c) {
+  return c == ':' ? set->colon_w : set->digit_w;
+}
+
+/**
+ * @brief Draw one character cell from a draw event
+ *
+ * The building block of the widget, for custom widgets drawing their own
+ * digits. The sprite's ink is copied into the framebuffer, or the character
+ * is drawn as text in @p font where that isn't possible. Counted in the
+ * widget counters.
+ *
+ * @param layer Layer of the draw event
+ * @param set Sprites to draw with
+ * @param c Character, nothing is drawn for one without a sprite
+ * @param cell Screen area of the cell
+ * @param color Ink color, black or white
+ * @param font Font of the text fallback
+ */
+void seg_digits_draw_char(lv_layer_t *layer, const struct digit_sprite_set *set, char c,
+                          const lv_area_t *cell, lv_color_t color, const lv_font_t *font);
+
+/**
+ * @brief Get the counters of all digit widgets
+ */
+void seg_digits_get_stats(struct seg_digits_stats *stats);
+
+/**
+ * @brief Reset the counters of all digit widgets
+ */
+void seg_digits_reset_stats(void);
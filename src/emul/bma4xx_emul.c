@@ -0,0 +1,652 @@
+/**
+ * @file bma4xx_emul.c
+ * @brief Emulated BMA423 accelerometer for native_sim
+ *
+ * Registered as an I2C emulator on the bosch,bma4xx node in place of the
+ * upstream emulator (CONFIG_EMUL_BMA4XX=n), which only models the data
+ * registers. Time advances on each access: the samples due since the last
+ * one are produced in order, so a trace plays at the rate the driver
+ * configured whether or not anything polls it.
+ */
+
+#define DT_DRV_COMPAT bosch_bma4xx
+
+#include "bma4xx_emul.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(bma4xx_emul, LOG_LEVEL_INF);
+
+#define REG_CHIP_ID 0x00
+#define REG_STATUS 0x03
+#define REG_DATA_8 0x12 /* ACC_X_LSB, followed by X_MSB .. Z_MSB */
+#define REG_SENSORTIME_0 0x18
+#define REG_INT_STAT_0 0x1C
+#define REG_INT_STAT_1 0x1D
+#define REG_STEP_COUNTER_0 0x1E
+#define REG_FIFO_LENGTH_0 0x24
+#define REG_FIFO_DATA 0x26
+#define REG_INTERNAL_STATUS 0x2A
+#define REG_ACC_CONF 0x40
+#define REG_ACC_RANGE 0x41
+#define REG_FIFO_WTM_0 0x46
+#define REG_FIFO_CONFIG_0 0x48
+#define REG_FIFO_CONFIG_1 0x49
+#define REG_INT1_IO_CTRL 0x53
+#define REG_INT1_MAP 0x56
+#define REG_INT_MAP_DATA 0x58
+#define REG_INIT_CTRL 0x59
+#define REG_FEATURES_IN 0x5E
+#define REG_PWR_CONF 0x7C
+#define REG_PWR_CTRL 0x7D
+#define REG_CMD 0x7E
+#define REG_COUNT 0x80
+
+#define CHIP_ID_BMA423 0x13
+#define STATUS_CMD_RDY BIT(4)
+#define STATUS_DRDY_ACC BIT(7)
+#define INT_STAT_1_FFULL BIT(0)
+#define INT_STAT_1_FWM BIT(1)
+#define INT_STAT_1_ACC_DRDY BIT(7)
+#define INT_MAP_DATA_INT1_FFULL BIT(0)
+#define INT_MAP_DATA_INT1_FWM BIT(1)
+#define INT_MAP_DATA_INT1_DRDY BIT(2)
+#define INT1_IO_CTRL_LVL BIT(1)
+#define INT1_IO_CTRL_OUTPUT_EN BIT(3)
+#define FIFO_CONFIG_0_STOP_ON_FULL BIT(0)
+#define FIFO_CONFIG_1_HEADER_EN BIT(4)
+#define FIFO_CONFIG_1_ACC_EN BIT(6)
+#define PWR_CTRL_ACC_EN BIT(2)
+#define CMD_FIFO_FLUSH 0xB0
+#define CMD_SOFT_RESET 0xB6
+
+#define FIFO_SIZE 1024
+#define FIFO_HEADER_ACC 0x84
+#define FIFO_HEADER_OVER_READ 0x80
+#define ACC_FRAME_SIZE 6
+
+// Samples older than this many output periods only advance the trace and the
+// step counter on catch-up, they would have left the FIFO anyway
+#define CATCH_UP_SAMPLES (FIFO_SIZE / ACC_FRAME_SIZE + 1)
+
+struct bma4xx_emul_cfg {
+  struct gpio_dt_spec int1;
+};
+
+struct bma4xx_emul_data {
+  const struct bma4xx_emul_cfg *cfg;
+  struct k_spinlock lock;
+  struct k_work_delayable irq_work;
+  uint8_t regs[REG_COUNT];
+  uint8_t ptr;
+  bool irq;
+
+  uint8_t fifo[FIFO_SIZE];
+  uint16_t fifo_head; /* Oldest byte */
+  uint16_t fifo_len;
+
+  int64_t last_sample_us; /* Uptime of the last produced sample */
+  uint32_t step_count;
+  struct bma4xx_emul_sample accel; /* Held when no trace plays */
+  const struct bma4xx_emul_sample *trace;
+  size_t trace_len;
+  size_t trace_pos;
+  bool trace_loop;
+
+  struct bma4xx_emul_stats stats;
+};
+
+static int64_t now_us(void) { return k_ticks_to_us_floor64(k_uptime_ticks()); }
+
+static bool acc_enabled(const struct bma4xx_emul_data *data) {
+  return data->regs[REG_PWR_CTRL] & PWR_CTRL_ACC_EN;
+}
+
+/* ODR code 8 is 100 Hz, each step doubles or halves it (1 = 0.78 Hz, 12 = 1600 Hz) */
+static uint32_t odr_period_us(const struct bma4xx_emul_data *data) {
+  uint8_t odr = CLAMP(data->regs[REG_ACC_CONF] & 0x0f, 1, 12);
+
+  return odr >= 8 ? 10000 >> (odr - 8) : 10000 << (8 - odr);
+}
+
+static size_t frame_size(const struct bma4xx_emul_data *data) {
+  return (data->regs[REG_FIFO_CONFIG_1] & FIFO_CONFIG_1_HEADER_EN) ? ACC_FRAME_SIZE + 1
+                                                                     : ACC_FRAME_SIZE;
+}
+
+static uint16_t fifo_watermark(const struct bma4xx_emul_data *data) {
+  return sys_get_le16(&data->regs[REG_FIFO_WTM_0]) & 0x1fff;
+}
+
+static void reset_regs(struct bma4xx_emul_data *data) {
+  memset(data->regs, 0, sizeof(data->regs));
+  data->regs[REG_CHIP_ID] = CHIP_ID_BMA423;
+  data->regs[REG_STATUS] = STATUS_CMD_RDY;
+  data->regs[REG_ACC_CONF] = 0xa8;
+  data->regs[REG_ACC_RANGE] = 0x01;
+  sys_put_le16(0x0200, &data->regs[REG_FIFO_WTM_0]);
+  data->regs[REG_FIFO_CONFIG_1] = FIFO_CONFIG_1_HEADER_EN;
+  data->regs[REG_PWR_CONF] = 0x03;
+  data->fifo_head = 0;
+  data->fifo_len = 0;
+  data->step_count = 0;
+}
+
+/* Milli-g to the left-aligned 12-bit register value for the current range */
+static int16_t to_raw(const struct bma4xx_emul_data *data, int16_t mg) {
+  int32_t range_g = 2 << (data->regs[REG_ACC_RANGE] & 0x03);
+  int32_t raw = (int32_t)mg * 2048 / (range_g * 1000);
+
+  return CLAMP(raw, -2048, 2047) << 4;
+}
+
+static void fifo_push(struct bma4xx_emul_data *data, const uint8_t *frame, size_t len) {
+  if (data->fifo_len + len > FIFO_SIZE) {
+    data->stats.fifo_overruns++;
+    if (data->regs[REG_FIFO_CONFIG_0] & FIFO_CONFIG_0_STOP_ON_FULL) {
+      return;
+    }
+    // Stream mode: the oldest frame makes room
+    size_t drop = data->fifo_len + len - FIFO_SIZE;
+
+    data->fifo_head = (data->fifo_head + drop) % FIFO_SIZE;
+    data->fifo_len -= drop;
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    data->fifo[(data->fifo_head + data->fifo_len + i) % FIFO_SIZE] = frame[i];
+  }
+  data->fifo_len += len;
+  data->stats.fifo_frames++;
+}
+
+static uint8_t fifo_pop(struct bma4xx_emul_data *data) {
+  if (data->fifo_len == 0) {
+    return FIFO_HEADER_OVER_READ;
+  }
+
+  uint8_t byte = data->fifo[data->fifo_head];
+
+  data->fifo_head = (data->fifo_head + 1) % FIFO_SIZE;
+  data->fifo_len--;
+  data->stats.fifo_bytes++;
+  return byte;
+}
+
+static void update_fifo_status(struct bma4xx_emul_data *data) {
+  uint16_t wtm = fifo_watermark(data);
+
+  if (wtm > 0 && data->fifo_len >= wtm) {
+    data->regs[REG_INT_STAT_1] |= INT_STAT_1_FWM;
+  }
+  if (data->fifo_len + frame_size(data) > FIFO_SIZE) {
+    data->regs[REG_INT_STAT_1] |= INT_STAT_1_FFULL;
+  }
+  sys_put_le16(data->fifo_len, &data->regs[REG_FIFO_LENGTH_0]);
+}
+
+static void raise_events(struct bma4xx_emul_data *data, uint8_t events) {
+  if (events == 0) {
+    return;
+  }
+  if (events & BMA4XX_EMUL_EVT_STEP) {
+    data->step_count++;
+    sys_put_le32(data->step_count, &data->regs[REG_STEP_COUNTER_0]);
+  }
+  data->regs[REG_INT_STAT_0] |= events;
+  data->stats.events++;
+}
+
+static void push_sample(struct bma4xx_emul_data *data, const struct bma4xx_emul_sample *s) {
+  uint8_t frame[ACC_FRAME_SIZE + 1];
+  uint8_t *xyz = frame;
+
+  if (data->regs[REG_FIFO_CONFIG_1] & FIFO_CONFIG_1_HEADER_EN) {
+    frame[0] = FIFO_HEADER_ACC;
+    xyz = &frame[1];
+  }
+  sys_put_le16(to_raw(data, s->x), &xyz[0]);
+  sys_put_le16(to_raw(data, s->y), &xyz[2]);
+  sys_put_le16(to_raw(data, s->z), &xyz[4]);
+
+  memcpy(&data->regs[REG_DATA_8], xyz, ACC_FRAME_SIZE);
+  data->regs[REG_STATUS] |= STATUS_DRDY_ACC;
+  data->regs[REG_INT_STAT_1] |= INT_STAT_1_ACC_DRDY;
+
+  if (data->regs[REG_FIFO_CONFIG_1] & FIFO_CONFIG_1_ACC_EN) {
+    fifo_push(data, frame, frame_size(data));
+  }
+}
+
+/* The next sample of the trace, or the held acceleration */
+static const struct bma4xx_emul_sample *next_sample(struct bma4xx_emul_data *data) {
+  if (data->trace == NULL) {
+    return &data->accel;
+  }
+
+  const struct bma4xx_emul_sample *s = &data->trace[data->trace_pos++];
+
+  if (data->trace_pos == data->trace_len) {
+    if (data->trace_loop) {
+      data->trace_pos = 0;
+    } else {
+      data->accel = *s;
+      data->accel.events = 0;
+      data->trace = NULL;
+    }
+  }
+  return s;
+}
+
+/* Produce the samples due since the last one */
+static void catch_up(struct bma4xx_emul_data *data) {
+  int64_t now = now_us();
+
+  if (!acc_enabled(data)) {
+    data->last_sample_us = now;
+    return;
+  }
+
+  uint32_t period = odr_period_us(data);
+  int64_t due = (now - data->last_sample_us) / period;
+
+  for (int64_t i = 0; i < due; i++) {
+    const struct bma4xx_emul_sample *s = next_sample(data);
+
+    data->stats.samples++;
+    raise_events(data, s->events);
+    if (due - i <= CATCH_UP_SAMPLES) {
+      push_sample(data, s);
+    }
+    if (data->trace == NULL && i + 1 < due - CATCH_UP_SAMPLES) {
+      // Holding a constant sample: nothing changes until the FIFO window
+      data->stats.samples += due - CATCH_UP_SAMPLES - i - 1;
+      i = due - CATCH_UP_SAMPLES - 1;
+    }
+  }
+
+  data->last_sample_us += due * period;
+  data->regs[REG_STATUS] |= STATUS_CMD_RDY;
+  sys_put_le24((now * 256 / 10000) & 0xffffff, &data->regs[REG_SENSORTIME_0]);
+  update_fifo_status(data);
+}
+
+static uint8_t int1_status_mask(const struct bma4xx_emul_data *data) {
+  uint8_t map = data->regs[REG_INT_MAP_DATA];
+
+  return ((map & INT_MAP_DATA_INT1_FFULL) ? INT_STAT_1_FFULL : 0) |
+         ((map & INT_MAP_DATA_INT1_FWM) ? INT_STAT_1_FWM : 0) |
+         ((map & INT_MAP_DATA_INT1_DRDY) ? INT_STAT_1_ACC_DRDY : 0);
+}
+
+/* Samples until the next mapped interrupt condition, or 0 if none is coming */
+static int64_t samples_to_irq(const struct bma4xx_emul_data *data) {
+  uint8_t mask = int1_status_mask(data);
+  uint8_t features = data->regs[REG_INT1_MAP];
+  size_t frame = frame_size(data);
+  int64_t next = 0;
+
+  if (!acc_enabled(data)) {
+    return 0;
+  }
+
+  if (mask & INT_STAT_1_ACC_DRDY) {
+    return 1;
+  }
+  if (data->regs[REG_FIFO_CONFIG_1] & FIFO_CONFIG_1_ACC_EN) {
+    uint16_t wtm = fifo_watermark(data);
+
+    if ((mask & INT_STAT_1_FWM) && wtm > data->fifo_len) {
+      next = DIV_ROUND_UP(wtm - data->fifo_len, frame);
+    }
+    if ((mask & INT_STAT_1_FFULL) && data->fifo_len + frame <= FIFO_SIZE) {
+      int64_t full = (FIFO_SIZE - data->fifo_len) / frame;
+
+      next = next ? MIN(next, full) : full;
+    }
+  }
+  if ((features != 0) && data->trace != NULL) {
+    for (size_t i = 0; i < data->trace_len; i++) {
+      size_t pos = (data->trace_pos + i) % data->trace_len;
+
+      if (!data->trace_loop && data->trace_pos + i >= data->trace_len) {
+        break;
+      }
+      if (data->trace[pos].events & features) {
+        next = next ? MIN(next, (int64_t)i + 1) : (int64_t)i + 1;
+        break;
+      }
+    }
+  }
+
+  return next;
+}
+
+/* Re-evaluate INT1 after a state change. Returns the delay to the next
+ * interrupt condition in microseconds, or -1 */
+static int64_t update_locked(struct bma4xx_emul_data *data) {
+  bool irq = (data->regs[REG_INT_STAT_0] & data->regs[REG_INT1_MAP]) ||
+             (data->regs[REG_INT_STAT_1] & int1_status_mask(data));
+
+  if (irq && !data->irq) {
+    data->stats.irqs++;
+  }
+  data->irq = irq;
+
+  int64_t samples = samples_to_irq(data);
+
+  if (samples == 0) {
+    return -1;
+  }
+  return MAX(data->last_sample_us + samples * odr_period_us(data) - now_us(), 0);
+}
+
+/* Drive INT1 as INT1_IO_CTRL configures it and schedule the next interrupt */
+static void apply(struct bma4xx_emul_data *data, bool irq, uint8_t io_ctrl, int64_t delay_us) {
+  const struct gpio_dt_spec *int1 = &data->cfg->int1;
+  bool active_high = io_ctrl & INT1_IO_CTRL_LVL;
+
+  if (int1->port != NULL) {
+    bool asserted = irq && (io_ctrl & INT1_IO_CTRL_OUTPUT_EN);
+
+    gpio_emul_input_set(int1->port, int1->pin, asserted == active_high);
+  }
+
+  if (delay_us >= 0) {
+    k_work_reschedule(&data->irq_work, K_USEC(delay_us));
+  } else {
+    k_work_cancel_delayable(&data->irq_work);
+  }
+}
+
+/* Finish a state change made under the lock: re-evaluate INT1, unlock and
+ * drive the pin, which may run GPIO callbacks */
+static void update_unlock(struct bma4xx_emul_data *data, k_spinlock_key_t key) {
+  int64_t delay_us = update_locked(data);
+  uint8_t io_ctrl = data->regs[REG_INT1_IO_CTRL];
+  bool irq = data->irq;
+
+  k_spin_unlock(&data->lock, key);
+  apply(data, irq, io_ctrl, delay_us);
+}
+
+static void irq_work_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct bma4xx_emul_data *data = CONTAINER_OF(dwork, struct bma4xx_emul_data, irq_work);
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+  catch_up(data);
+  update_unlock(data, key);
+}
+
+static uint8_t read_reg(struct bma4xx_emul_data *data, uint8_t reg) {
+  uint8_t val;
+
+  if (reg == REG_FIFO_DATA) {
+    val = fifo_pop(data);
+    sys_put_le16(data->fifo_len, &data->regs[REG_FIFO_LENGTH_0]);
+    return val;
+  }
+
+  val = data->regs[reg];
+  switch (reg) {
+  case REG_INT_STAT_0:
+  case REG_INT_STAT_1:
+    // Interrupt status is cleared on read
+    data->regs[reg] = 0;
+    break;
+  case REG_DATA_8 + ACC_FRAME_SIZE - 1:
+    data->regs[REG_STATUS] &= ~STATUS_DRDY_ACC;
+    break;
+  default:
+    break;
+  }
+  return val;
+}
+
+static void write_reg(struct bma4xx_emul_data *data, uint8_t reg, uint8_t val) {
+  switch (reg) {
+  case REG_CMD:
+    if (val == CMD_SOFT_RESET) {
+      reset_regs(data);
+    } else if (val == CMD_FIFO_FLUSH) {
+      data->fifo_head = 0;
+      data->fifo_len = 0;
+      update_fifo_status(data);
+    }
+    return;
+  case REG_INIT_CTRL:
+    // Feature configuration is accepted as soon as it is loaded
+    data->regs[REG_INTERNAL_STATUS] = (val & 0x01) ? 0x01 : 0x00;
+    break;
+  case REG_PWR_CTRL:
+    if ((val & PWR_CTRL_ACC_EN) && !acc_enabled(data)) {
+      data->last_sample_us = now_us();
+    }
+    break;
+  case REG_FEATURES_IN:
+    // Feature configuration blob, not modelled
+    return;
+  case REG_CHIP_ID:
+  case REG_STATUS:
+  case REG_FIFO_DATA:
+    return;
+  default:
+    break;
+  }
+  data->regs[reg] = val;
+}
+
+static int bma4xx_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs,
+                                int addr) {
+  struct bma4xx_emul_data *data = target->data;
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+  bool have_ptr = false;
+
+  ARG_UNUSED(addr);
+
+  data->stats.transfers++;
+  catch_up(data);
+
+  for (int i = 0; i < num_msgs; i++) {
+    struct i2c_msg *msg = &msgs[i];
+
+    for (uint32_t j = 0; j < msg->len; j++) {
+      if (msg->flags & I2C_MSG_READ) {
+        msg->buf[j] = read_reg(data, data->ptr);
+      } else if (!have_ptr) {
+        data->ptr = msg->buf[j] % REG_COUNT;
+        have_ptr = true;
+        continue;
+      } else {
+        write_reg(data, data->ptr, msg->buf[j]);
+      }
+      // FIFO data and the feature blob are streamed through one address
+      if (data->ptr != REG_FIFO_DATA && data->ptr != REG_FEATURES_IN) {
+        data->ptr = (data->ptr + 1) % REG_COUNT;
+      }
+      data->stats.bytes++;
+    }
+  }
+
+  update_unlock(data, key);
+  return 0;
+}
+
+static const struct i2c_emul_api bma4xx_emul_i2c_api = {
+    .transfer = bma4xx_emul_transfer,
+};
+
+static int bma4xx_emul_init(const struct emul *target, const struct device *parent) {
+  struct bma4xx_emul_data *data = target->data;
+
+  ARG_UNUSED(parent);
+
+  data->cfg = target->cfg;
+  k_work_init_delayable(&data->irq_work, irq_work_handler);
+  reset_regs(data);
+
+  // Lying flat, face up
+  data->accel = (struct bma4xx_emul_sample){.z = 1000};
+  data->stats.since_ms = k_uptime_get();
+  return 0;
+}
+
+const struct emul *bma4xx_emul_get(void) { return EMUL_DT_GET(DT_DRV_INST(0)); }
+
+void bma4xx_emul_set_accel(const struct emul *target, int16_t x_mg, int16_t y_mg, int16_t z_mg) {
+  struct bma4xx_emul_data *data = target->data;
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+  catch_up(data);
+  data->trace = NULL;
+  data->accel = (struct bma4xx_emul_sample){.x = x_mg, .y = y_mg, .z = z_mg};
+  update_unlock(data, key);
+}
+
+void bma4xx_emul_set_trace(const struct emul *target, const struct bma4xx_emul_sample *trace,
+                           size_t count, bool loop) {
+  struct bma4xx_emul_data *data = target->data;
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+  catch_up(data);
+  data->trace = count > 0 ? trace : NULL;
+  data->trace_len = count;
+  data->trace_pos = 0;
+  data->trace_loop = loop;
+  update_unlock(data, key);
+}
+
+void bma4xx_emul_fill_fifo(const struct emul *target, const struct bma4xx_emul_sample *samples,
+                           size_t count) {
+  struct bma4xx_emul_data *data = target->data;
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+  catch_up(data);
+  for (size_t i = 0; i < count; i++) {
+    push_sample(data, &samples[i]);
+  }
+  update_fifo_status(data);
+  update_unlock(data, key);
+}
+
+void bma4xx_emul_raise(const struct emul *target, uint8_t events) {
+  struct bma4xx_emul_data *data = target->data;
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+  catch_up(data);
+  raise_events(data, events);
+  update_unlock(data, key);
+}
+
+void bma4xx_emul_get_stats(const struct emul *target, struct bma4xx_emul_stats *stats) {
+  struct bma4xx_emul_data *data = target->data;
+
+  K_SPINLOCK(&data->lock) {
+    catch_up(data);
+    *stats = data->stats;
+  }
+}
+
+void bma4xx_emul_reset_stats(const struct emul *target) {
+  struct bma4xx_emul_data *data = target->data;
+
+  K_SPINLOCK(&data->lock) {
+    catch_up(data);
+    memset(&data->stats, 0, sizeof(data->stats));
+    data->stats.since_ms = k_uptime_get();
+  }
+}
+
+#define BMA4XX_EMUL_DEFINE(n)                                                                      \
+  static struct bma4xx_emul_data bma4xx_emul_data_##n;                                             \
+  static const struct bma4xx_emul_cfg bma4xx_emul_cfg_##n = {                                      \
+      .int1 = GPIO_DT_SPEC_INST_GET_OR(n, int1_gpios, {0}),                                        \
+  };                                                                                               \
+  EMUL_DT_INST_DEFINE(n, bma4xx_emul_init, &bma4xx_emul_data_##n, &bma4xx_emul_cfg_##n,            \
+                      &bma4xx_emul_i2c_api, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(BMA4XX_EMUL_DEFINE)
+
+#if defined(CONFIG_SHELL)
+static int cmd_accel_emul_stats(const struct shell *sh, size_t argc, char **argv) {
+  const struct emul *target = bma4xx_emul_get();
+  struct bma4xx_emul_data *data = target->data;
+  struct bma4xx_emul_stats s;
+
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  bma4xx_emul_get_stats(target, &s);
+  shell_print(sh, "window:    %lld ms", (long long)(k_uptime_get() - s.since_ms));
+  shell_print(sh, "transfers: %u (%u bytes)", s.transfers, s.bytes);
+  shell_print(sh, "samples:   %u at %u us, %u steps", s.samples, odr_period_us(data),
+              data->step_count);
+  shell_print(sh, "fifo:      %u frames in, %u bytes out, %u overruns, %u held", s.fifo_frames,
+              s.fifo_bytes, s.fifo_overruns, data->fifo_len);
+  shell_print(sh, "events:    %u, %u interrupts", s.events, s.irqs);
+  return 0;
+}
+
+static int cmd_accel_emul_set(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+
+  bma4xx_emul_set_accel(bma4xx_emul_get(), atoi(argv[1]), atoi(argv[2]), atoi(argv[3]));
+  shell_print(sh, "Acceleration set");
+  return 0;
+}
+
+static int cmd_accel_emul_step(const struct shell *sh, size_t argc, char **argv) {
+  int steps = argc > 1 ? atoi(argv[1]) : 1;
+
+  for (int i = 0; i < steps; i++) {
+    bma4xx_emul_raise(bma4xx_emul_get(), BMA4XX_EMUL_EVT_STEP);
+  }
+  shell_print(sh, "%d steps raised", steps);
+  return 0;
+}
+
+static int cmd_accel_emul_tap(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  bma4xx_emul_raise(bma4xx_emul_get(), BMA4XX_EMUL_EVT_TAP);
+  shell_print(sh, "Tap raised");
+  return 0;
+}
+
+static int cmd_accel_emul_reset(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  bma4xx_emul_reset_stats(bma4xx_emul_get());
+  shell_print(sh, "Accelerometer counters reset");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(accel_emul_cmds,
+                               SHELL_CMD(stats, NULL, "Show accelerometer counters",
+                                         cmd_accel_emul_stats),
+                               SHELL_CMD_ARG(set, NULL, "Hold an acceleration <x> <y> <z> [mg]",
+                                             cmd_accel_emul_set, 4, 0),
+                               SHELL_CMD_ARG(step, NULL, "Raise step events [count]",
+                                             cmd_accel_emul_step, 1, 1),
+                               SHELL_CMD(tap, NULL, "Raise a tap event", cmd_accel_emul_tap),
+                               SHELL_CMD(reset, NULL, "Reset accelerometer counters",
+                                         cmd_accel_emul_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(accel_emul, &accel_emul_cmds, "Emulated BMA423 accelerometer", NULL);
+#endif
@@ -0,0 +1,92 @@
+/**
+ * @file bma4xx_emul.h
+ * @brief Emulated BMA423 accelerometer for native_sim
+ *
+ * Register-level model behind the stock bma4xx driver. Samples are produced
+ * at the configured output data rate, either a constant acceleration or a
+ * scripted trace, into the data registers and the 1 KB FIFO. Trace samples
+ * can carry step and tap events that advance the step counter and raise the
+ * feature interrupts. INT1 follows the interrupt mapping the driver
+ * programmed, so FIFO watermark batching and wake-on-gesture can be
+ * benchmarked on the host. Samples are generated lazily on each access, the
+ * emulator only schedules work for mapped interrupts.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/sys/util.h>
+
+/** Feature events, as BMA423 INT_STATUS_0 bits */
+#define BMA4XX_EMUL_EVT_STEP BIT(1)
+#define BMA4XX_EMUL_EVT_ACTIVITY BIT(2)
+#define BMA4XX_EMUL_EVT_WRIST_WEAR BIT(3)
+#define BMA4XX_EMUL_EVT_TAP BIT(4)
+#define BMA4XX_EMUL_EVT_ANY_MOTION BIT(5)
+#define BMA4XX_EMUL_EVT_NO_MOTION BIT(6)
+
+/**
+ * @brief One accelerometer sample of a trace
+ */
+struct bma4xx_emul_sample {
+  int16_t x, y, z; /**< Acceleration in milli-g */
+  uint8_t events;  /**< BMA4XX_EMUL_EVT_* raised when the sample is produced */
+};
+
+/**
+ * @brief Bus, FIFO and interrupt counters
+ */
+struct bma4xx_emul_stats {
+  uint32_t transfers;     /**< I2C transactions */
+  uint32_t bytes;         /**< Register bytes read or written */
+  uint32_t samples;       /**< Samples produced at the output data rate */
+  uint32_t fifo_frames;   /**< Frames written to the FIFO */
+  uint32_t fifo_bytes;    /**< Bytes read from FIFO_DATA */
+  uint32_t fifo_overruns; /**< Frames lost to a full FIFO */
+  uint32_t events;        /**< Feature events raised */
+  uint32_t irqs;          /**< INT1 assertions */
+  int64_t since_ms;       /**< Uptime when the counters were last reset */
+};
+
+/**
+ * @brief Get the emulated accelerometer of the devicetree (first instance)
+ */
+const struct emul *bma4xx_emul_get(void);
+
+/**
+ * @brief Produce a constant acceleration, ending any trace
+ */
+void bma4xx_emul_set_accel(const struct emul *target, int16_t x_mg, int16_t y_mg, int16_t z_mg);
+
+/**
+ * @brief Play a trace, one entry per sample at the output data rate
+ *
+ * The trace is not copied and must stay valid while it plays. Without loop
+ * the last sample is held once the trace ends.
+ */
+void bma4xx_emul_set_trace(const struct emul *target, const struct bma4xx_emul_sample *trace,
+                           size_t count, bool loop);
+
+/**
+ * @brief Write frames into the FIFO now, as if they had been sampled
+ */
+void bma4xx_emul_fill_fifo(const struct emul *target, const struct bma4xx_emul_sample *samples,
+                           size_t count);
+
+/**
+ * @brief Raise feature events now, e.g. a step or a tap
+ */
+void bma4xx_emul_raise(const struct emul *target, uint8_t events);
+
+/**
+ * @brief Get the counters
+ */
+void bma4xx_emul_get_stats(const struct emul *target, struct bma4xx_emul_stats *stats);
+
+/**
+ * @brief Reset the counters, e.g. at the start of a scenario
+ */
+void bma4xx_emul_reset_stats(const struct emul *target);
@@ -0,0 +1,437 @@
+/**
+ * @file pcf8563_emul.c
+ * @brief Emulated PCF8563 RTC for native_sim
+ *
+ * Registered as an I2C emulator on the nxp,pcf8563 node, so the stock driver,
+ * the timekeeping service and the minute tick run unmodified on the host.
+ * The clock registers are latched at the start of each transaction, like the
+ * real chip freezes its counters during an access. The alarm is only
+ * evaluated at minute boundaries while at least one alarm field is enabled,
+ * so the emulator adds no wake-ups of its own when the alarm is off.
+ */
+
+#define DT_DRV_COMPAT nxp_pcf8563
+
+#include "pcf8563_emul.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/timeutil.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(pcf8563_emul, LOG_LEVEL_INF);
+
+#define REG_CTRL1 0x00
+#define REG_CTRL2 0x01
+#define REG_SECONDS 0x02
+#define REG_MINUTES 0x03
+#define REG_HOURS 0x04
+#define REG_DAYS 0x05
+#define REG_WEEKDAYS 0x06
+#define REG_MONTHS 0x07
+#define REG_YEARS 0x08
+#define REG_ALARM_MINUTE 0x09
+#define REG_ALARM_HOUR 0x0A
+#define REG_ALARM_DAY 0x0B
+#define REG_ALARM_WEEKDAY 0x0C
+#define REG_COUNT 0x10
+
+#define CTRL2_TIE BIT(0)
+#define CTRL2_AIE BIT(1)
+#define CTRL2_TF BIT(2)
+#define CTRL2_AF BIT(3)
+#define SECONDS_VL BIT(7)
+#define ALARM_AE BIT(7) /* Set: field does not take part in the match */
+
+struct pcf8563_emul_cfg {
+  struct gpio_dt_spec int1;
+};
+
+struct pcf8563_emul_data {
+  const struct pcf8563_emul_cfg *cfg;
+  struct k_spinlock lock;
+  struct k_work_delayable alarm_work;
+  uint8_t regs[REG_COUNT];
+  uint8_t ptr; /* Register address pointer, auto-increments */
+  bool vl;
+  bool irq;
+
+  /* Clock: base_ms at base_uptime_ms, running drift_ppm fast */
+  int64_t base_ms;
+  int64_t base_uptime_ms;
+  int32_t drift_ppm;
+
+  struct pcf8563_emul_stats stats;
+};
+
+static int64_t clock_ms(const struct pcf8563_emul_data *data, int64_t uptime_ms) {
+  int64_t elapsed = uptime_ms - data->base_uptime_ms;
+
+  return data->base_ms + elapsed + elapsed * data->drift_ppm / 1000000;
+}
+
+static void set_clock(struct pcf8563_emul_data *data, int64_t ms) {
+  data->base_ms = ms;
+  data->base_uptime_ms = k_uptime_get();
+}
+
+/* Copy the running clock into the time registers */
+static void latch_time(struct pcf8563_emul_data *data) {
+  time_t t = clock_ms(data, k_uptime_get()) / MSEC_PER_SEC;
+  struct tm tm;
+
+  gmtime_r(&t, &tm);
+  data->regs[REG_SECONDS] = bin2bcd(tm.tm_sec) | (data->vl ? SECONDS_VL : 0);
+  data->regs[REG_MINUTES] = bin2bcd(tm.tm_min);
+  data->regs[REG_HOURS] = bin2bcd(tm.tm_hour);
+  data->regs[REG_DAYS] = bin2bcd(tm.tm_mday);
+  data->regs[REG_WEEKDAYS] = tm.tm_wday;
+  data->regs[REG_MONTHS] = bin2bcd(tm.tm_mon + 1);
+  data->regs[REG_YEARS] = bin2bcd(tm.tm_year % 100);
+}
+
+/* Restart the clock from the time registers, as after an I2C write */
+static void load_time(struct pcf8563_emul_data *data) {
+  const uint8_t *r = data->regs;
+  struct tm tm = {
+      .tm_sec = bcd2bin(r[REG_SECONDS] & 0x7f),
+      .tm_min = bcd2bin(r[REG_MINUTES] & 0x7f),
+      .tm_hour = bcd2bin(r[REG_HOURS] & 0x3f),
+      .tm_mday = bcd2bin(r[REG_DAYS] & 0x3f),
+      .tm_mon = bcd2bin(r[REG_MONTHS] & 0x1f) - 1,
+      .tm_year = bcd2bin(r[REG_YEARS]) + 100,
+  };
+
+  data->vl = r[REG_SECONDS] & SECONDS_VL;
+  set_clock(data, timeutil_timegm64(&tm) * MSEC_PER_SEC);
+}
+
+static bool alarm_enabled(const struct pcf8563_emul_data *data) {
+  for (int reg = REG_ALARM_MINUTE; reg <= REG_ALARM_WEEKDAY; reg++) {
+    if (!(data->regs[reg] & ALARM_AE)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool alarm_matches(const struct pcf8563_emul_data *data) {
+  static const struct {
+    uint8_t alarm;
+    uint8_t time;
+    uint8_t mask;
+  } fields[] = {
+      {REG_ALARM_MINUTE, REG_MINUTES, 0x7f},
+      {REG_ALARM_HOUR, REG_HOURS, 0x3f},
+      {REG_ALARM_DAY, REG_DAYS, 0x3f},
+      {REG_ALARM_WEEKDAY, REG_WEEKDAYS, 0x07},
+  };
+
+  for (size_t i = 0; i < ARRAY_SIZE(fields); i++) {
+    uint8_t alarm = data->regs[fields[i].alarm];
+
+    if (!(alarm & ALARM_AE) &&
+        (alarm & fields[i].mask) != (data->regs[fields[i].time] & fields[i].mask)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Uptime until the clock reaches its next minute, or -1 if the alarm is off */
+static int64_t next_alarm_check_ms(const struct pcf8563_emul_data *data) {
+  if (!alarm_enabled(data)) {
+    return -1;
+  }
+
+  int64_t now = clock_ms(data, k_uptime_get());
+  int64_t to_minute = MSEC_PER_SEC * 60 - now % (MSEC_PER_SEC * 60);
+
+  // Convert clock time back to uptime, 1 ms late so the minute has rolled over
+  return to_minute * 1000000 / (1000000 + data->drift_ppm) + 1;
+}
+
+static bool irq_asserted(const struct pcf8563_emul_data *data) {
+  uint8_t ctrl2 = data->regs[REG_CTRL2];
+
+  return ((ctrl2 & CTRL2_AF) && (ctrl2 & CTRL2_AIE)) ||
+         ((ctrl2 & CTRL2_TF) && (ctrl2 & CTRL2_TIE));
+}
+
+/* Re-evaluate INT after a register change. Returns the alarm check delay */
+static int64_t update_locked(struct pcf8563_emul_data *data) {
+  bool irq = irq_asserted(data);
+
+  if (irq && !data->irq) {
+    data->stats.irqs++;
+  }
+  data->irq = irq;
+  return next_alarm_check_ms(data);
+}
+
+/* Drive INT (open drain, low when asserted) and schedule the next alarm check */
+static void apply(struct pcf8563_emul_data *data, bool irq, int64_t check_ms) {
+  const struct gpio_dt_spec *int1 = &data->cfg->int1;
+
+  if (int1->port != NULL) {
+    gpio_emul_input_set(int1->port, int1->pin, irq != !!(int1->dt_flags & GPIO_ACTIVE_LOW));
+  }
+
+  if (check_ms >= 0) {
+    k_work_reschedule(&data->alarm_work, K_MSEC(check_ms));
+  } else {
+    k_work_cancel_delayable(&data->alarm_work);
+  }
+}
+
+static void alarm_work_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct pcf8563_emul_data *data = CONTAINER_OF(dwork, struct pcf8563_emul_data, alarm_work);
+  int64_t check_ms = -1;
+  bool irq = false;
+
+  K_SPINLOCK(&data->lock) {
+    latch_time(data);
+    if (bcd2bin(data->regs[REG_SECONDS] & 0x7f) == 0 && alarm_matches(data)) {
+      data->regs[REG_CTRL2] |= CTRL2_AF;
+      data->stats.alarms++;
+      LOG_DBG("alarm at %02x:%02x", data->regs[REG_HOURS], data->regs[REG_MINUTES]);
+    }
+    check_ms = update_locked(data);
+    irq = data->irq;
+  }
+
+  apply(data, irq, check_ms);
+}
+
+static void write_reg(struct pcf8563_emul_data *data, uint8_t reg, uint8_t val,
+                      bool *time_written) {
+  if (reg == REG_CTRL2) {
+    // AF and TF can only be cleared: writing 1 leaves them unchanged
+    uint8_t flags = CTRL2_AF | CTRL2_TF;
+
+    data->regs[REG_CTRL2] = (val & ~flags) | (data->regs[REG_CTRL2] & val & flags);
+    return;
+  }
+
+  data->regs[reg] = val;
+  if (reg >= REG_SECONDS && reg <= REG_YEARS) {
+    *time_written = true;
+  }
+}
+
+static int pcf8563_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs,
+                                 int addr) {
+  struct pcf8563_emul_data *data = target->data;
+  int64_t check_ms = -1;
+  bool irq = false;
+
+  ARG_UNUSED(addr);
+
+  K_SPINLOCK(&data->lock) {
+    bool have_ptr = false;
+    bool time_read = false;
+    bool time_written = false;
+
+    data->stats.transfers++;
+    latch_time(data);
+
+    for (int i = 0; i < num_msgs; i++) {
+      struct i2c_msg *msg = &msgs[i];
+
+      for (uint32_t j = 0; j < msg->len; j++) {
+        if (msg->flags & I2C_MSG_READ) {
+          msg->buf[j] = data->regs[data->ptr];
+          time_read |= data->ptr >= REG_SECONDS && data->ptr <= REG_YEARS;
+        } else if (!have_ptr) {
+          // First byte written in a transaction is the register address
+          data->ptr = msg->buf[j] % REG_COUNT;
+          have_ptr = true;
+          continue;
+        } else {
+          write_reg(data, data->ptr, msg->buf[j], &time_written);
+        }
+        data->ptr = (data->ptr + 1) % REG_COUNT;
+        data->stats.bytes++;
+      }
+    }
+
+    if (time_read) {
+      data->stats.time_reads++;
+    }
+    if (time_written) {
+      load_time(data);
+    }
+    check_ms = update_locked(data);
+    irq = data->irq;
+  }
+
+  apply(data, irq, check_ms);
+  return 0;
+}
+
+static const struct i2c_emul_api pcf8563_emul_i2c_api = {
+    .transfer = pcf8563_emul_transfer,
+};
+
+static int pcf8563_emul_init(const struct emul *target, const struct device *parent) {
+  struct pcf8563_emul_data *data = target->data;
+
+  ARG_UNUSED(parent);
+
+  data->cfg = target->cfg;
+  k_work_init_delayable(&data->alarm_work, alarm_work_handler);
+  for (int reg = REG_ALARM_MINUTE; reg <= REG_ALARM_WEEKDAY; reg++) {
+    data->regs[reg] = ALARM_AE;
+  }
+
+  // Start on 2000-01-01, the register reset value; INT is driven from the first access
+  set_clock(data, 946684800LL * MSEC_PER_SEC);
+  data->stats.since_ms = k_uptime_get();
+  return 0;
+}
+
+const struct emul *pcf8563_emul_get(void) { return EMUL_DT_GET(DT_DRV_INST(0)); }
+
+void pcf8563_emul_set_time(const struct emul *target, time_t unix_s) {
+  struct pcf8563_emul_data *data = target->data;
+  int64_t check_ms = -1;
+  bool irq = false;
+
+  K_SPINLOCK(&data->lock) {
+    set_clock(data, (int64_t)unix_s * MSEC_PER_SEC);
+    check_ms = update_locked(data);
+    irq = data->irq;
+  }
+
+  apply(data, irq, check_ms);
+}
+
+time_t pcf8563_emul_get_time(const struct emul *target) {
+  struct pcf8563_emul_data *data = target->data;
+  time_t t = 0;
+
+  K_SPINLOCK(&data->lock) {
+    t = clock_ms(data, k_uptime_get()) / MSEC_PER_SEC;
+  }
+
+  return t;
+}
+
+void pcf8563_emul_set_drift(const struct emul *target, int32_t ppm) {
+  struct pcf8563_emul_data *data = target->data;
+  int64_t check_ms = -1;
+  bool irq = false;
+
+  K_SPINLOCK(&data->lock) {
+    // Restart from the current time so the new rate only applies from now on
+    set_clock(data, clock_ms(data, k_uptime_get()));
+    data->drift_ppm = ppm;
+    check_ms = update_locked(data);
+    irq = data->irq;
+  }
+
+  apply(data, irq, check_ms);
+}
+
+void pcf8563_emul_set_vl(const struct emul *target, bool vl) {
+  struct pcf8563_emul_data *data = target->data;
+
+  K_SPINLOCK(&data->lock) {
+    data->vl = vl;
+  }
+}
+
+void pcf8563_emul_get_stats(const struct emul *target, struct pcf8563_emul_stats *stats) {
+  struct pcf8563_emul_data *data = target->data;
+
+  K_SPINLOCK(&data->lock) {
+    *stats = data->stats;
+  }
+}
+
+void pcf8563_emul_reset_stats(const struct emul *target) {
+  struct pcf8563_emul_data *data = target->data;
+
+  K_SPINLOCK(&data->lock) {
+    memset(&data->stats, 0, sizeof(data->stats));
+    data->stats.since_ms = k_uptime_get();
+  }
+}
+
+#define PCF8563_EMUL_DEFINE(n)                                                                     \
+  static struct pcf8563_emul_data pcf8563_emul_data_##n;                                           \
+  static const struct pcf8563_emul_cfg pcf8563_emul_cfg_##n = {                                    \
+      .int1 = GPIO_DT_SPEC_INST_GET_OR(n, int1_gpios, {0}),                                        \
+  };                                                                                               \
+  EMUL_DT_INST_DEFINE(n, pcf8563_emul_init, &pcf8563_emul_data_##n, &pcf8563_emul_cfg_##n,         \
+                      &pcf8563_emul_i2c_api, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(PCF8563_EMUL_DEFINE)
+
+#if defined(CONFIG_SHELL)
+static int cmd_rtc_emul_stats(const struct shell *sh, size_t argc, char **argv) {
+  const struct emul *target = pcf8563_emul_get();
+  struct pcf8563_emul_data *data = target->data;
+  struct pcf8563_emul_stats s;
+
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  pcf8563_emul_get_stats(target, &s);
+  shell_print(sh, "window:    %lld ms", (long long)(k_uptime_get() - s.since_ms));
+  shell_print(sh, "clock:     %lld (drift %d ppm)", (long long)pcf8563_emul_get_time(target),
+              data->drift_ppm);
+  shell_print(sh, "transfers: %u (%u bytes, %u clock reads)", s.transfers, s.bytes,
+              s.time_reads);
+  shell_print(sh, "alarms:    %u, %u interrupts", s.alarms, s.irqs);
+  return 0;
+}
+
+static int cmd_rtc_emul_set(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+
+  pcf8563_emul_set_time(pcf8563_emul_get(), strtoll(argv[1], NULL, 10));
+  shell_print(sh, "Clock set");
+  return 0;
+}
+
+static int cmd_rtc_emul_drift(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+
+  pcf8563_emul_set_drift(pcf8563_emul_get(), strtol(argv[1], NULL, 10));
+  shell_print(sh, "Drift set");
+  return 0;
+}
+
+static int cmd_rtc_emul_reset(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  pcf8563_emul_reset_stats(pcf8563_emul_get());
+  shell_print(sh, "RTC counters reset");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rtc_emul_cmds,
+                               SHELL_CMD(stats, NULL, "Show RTC counters", cmd_rtc_emul_stats),
+                               SHELL_CMD_ARG(set, NULL, "Set the clock <unix>", cmd_rtc_emul_set,
+                                             2, 0),
+                               SHELL_CMD_ARG(drift, NULL, "Set the clock drift <ppm>",
+                                             cmd_rtc_emul_drift, 2, 0),
+                               SHELL_CMD(reset, NULL, "Reset RTC counters", cmd_rtc_emul_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(rtc_emul, &rtc_emul_cmds, "Emulated PCF8563 RTC", NULL);
+#endif
@@ -0,0 +1,66 @@
+/**
+ * @file pcf8563_emul.h
+ * @brief Emulated PCF8563 RTC for native_sim
+ *
+ * Register-level model behind the stock PCF8563 driver: the clock runs from
+ * the kernel uptime with a programmable start time and drift, the minute
+ * alarm sets AF and pulls INT low like the real chip, and counters record
+ * bus traffic and alarm wake-ups for power benchmarks.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <zephyr/drivers/emul.h>
+
+/**
+ * @brief Bus and alarm counters
+ */
+struct pcf8563_emul_stats {
+  uint32_t transfers;  /**< I2C transactions */
+  uint32_t bytes;      /**< Register bytes read or written */
+  uint32_t time_reads; /**< Transactions that read the clock registers */
+  uint32_t alarms;     /**< Alarm matches (AF set) */
+  uint32_t irqs;       /**< INT assertions */
+  int64_t since_ms;    /**< Uptime when the counters were last reset */
+};
+
+/**
+ * @brief Get the emulated RTC of the devicetree (first instance)
+ */
+const struct emul *pcf8563_emul_get(void);
+
+/**
+ * @brief Set the clock, as if the registers were written over I2C
+ *
+ * @param target Emulator
+ * @param unix_s Time in seconds since the epoch, between 2000 and 2099
+ */
+void pcf8563_emul_set_time(const struct emul *target, time_t unix_s);
+
+/**
+ * @brief Get the clock time the registers would show now
+ */
+time_t pcf8563_emul_get_time(const struct emul *target);
+
+/**
+ * @brief Make the clock run fast (positive) or slow (negative) against uptime
+ */
+void pcf8563_emul_set_drift(const struct emul *target, int32_t ppm);
+
+/**
+ * @brief Set or clear the voltage-low flag (clock integrity not guaranteed)
+ */
+void pcf8563_emul_set_vl(const struct emul *target, bool vl);
+
+/**
+ * @brief Get the counters
+ */
+void pcf8563_emul_get_stats(const struct emul *target, struct pcf8563_emul_stats *stats);
+
+/**
+ * @brief Reset the counters, e.g. at the start of a scenario
+ */
+void pcf8563_emul_reset_stats(const struct emul *target);
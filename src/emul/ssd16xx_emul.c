@@ -0,0 +1,540 @@
+/**
+ * @file ssd16xx_emul.c
+ * @brief Emulated SSD1681 e-paper controller for native_sim
+ *
+ * Registered as a SPI emulator, so the stock mipi-dbi-spi and ssd16xx
+ * drivers run unmodified on top of it. Each transfer is classified as command
+ * or data from the DC pin, RAM writes follow the window, counters and data
+ * entry mode the driver programmed, and a master activation holds BUSY high
+ * for the duration of the selected waveform.
+ */
+
+#define DT_DRV_COMPAT sqfmi_watchy_epd_emul
+
+#include "ssd16xx_emul.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/drivers/spi_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+
+LOG_MODULE_REGISTER(ssd16xx_emul, LOG_LEVEL_INF);
+
+// Commands kept in the log
+#ifndef CONFIG_SSD16XX_EMUL_LOG_SIZE
+#define CONFIG_SSD16XX_EMUL_LOG_SIZE 64
+#endif
+
+// Data entry mode after reset: X then Y, both incrementing
+#define ENTRY_MODE_RESET 0x03
+#define ENTRY_X_INC BIT(0)
+#define ENTRY_Y_INC BIT(1)
+#define ENTRY_Y_FIRST BIT(2)
+
+struct ssd16xx_emul_cfg {
+  struct gpio_dt_spec dc;
+  struct gpio_dt_spec busy;
+  uint8_t *ram; /* Both planes, SSD16XX_EMUL_BW first */
+  uint16_t width;
+  uint16_t height;
+  uint16_t full_ms;
+  uint16_t partial_ms;
+  uint16_t command_ms;
+};
+
+struct ssd16xx_emul_data {
+  const struct ssd16xx_emul_cfg *cfg;
+  struct k_spinlock lock;
+  struct k_work_delayable busy_work;
+  bool busy;
+
+  /* Command being received */
+  uint8_t cmd;
+  uint16_t len;
+  uint8_t params[5];
+
+  /* Controller registers, RAM X positions in bytes */
+  uint8_t entry_mode;
+  uint8_t ctrl2;
+  uint16_t x_start, x_end;
+  uint16_t y_start, y_end;
+  uint16_t x, y;
+
+  /* RAM area written since the last activation */
+  bool dirty;
+  uint16_t dirty_x1, dirty_y1, dirty_x2, dirty_y2;
+
+  struct ssd16xx_emul_cmd log[CONFIG_SSD16XX_EMUL_LOG_SIZE];
+  uint32_t logged; /* Commands logged since the reset, the newest is logged - 1 */
+  struct ssd16xx_emul_stats stats;
+};
+
+static size_t ram_stride(const struct ssd16xx_emul_cfg *cfg) { return cfg->width / 8; }
+
+static uint8_t *ram_plane(const struct ssd16xx_emul_cfg *cfg, enum ssd16xx_emul_plane plane) {
+  return &cfg->ram[plane * ram_stride(cfg) * cfg->height];
+}
+
+static void reset_controller(struct ssd16xx_emul_data *data) {
+  const struct ssd16xx_emul_cfg *cfg = data->cfg;
+
+  data->entry_mode = ENTRY_MODE_RESET;
+  data->ctrl2 = 0;
+  data->x_start = 0;
+  data->x_end = ram_stride(cfg) - 1;
+  data->y_start = 0;
+  data->y_end = cfg->height - 1;
+  data->x = 0;
+  data->y = 0;
+  data->dirty = false;
+}
+
+/* Move an address counter one step, wrapping to the window start after the
+ * window end. Returns true when it wrapped */
+static bool step_counter(uint16_t *pos, uint16_t start, uint16_t end, bool inc) {
+  if (*pos == end) {
+    *pos = start;
+    return true;
+  }
+  *pos = inc ? *pos + 1 : *pos - 1;
+  return false;
+}
+
+static void ram_write(struct ssd16xx_emul_data *data, enum ssd16xx_emul_plane plane,
+                      uint8_t byte) {
+  const struct ssd16xx_emul_cfg *cfg = data->cfg;
+  bool x_inc = data->entry_mode & ENTRY_X_INC;
+  bool y_inc = data->entry_mode & ENTRY_Y_INC;
+
+  if (data->x >= ram_stride(cfg) || data->y >= cfg->height) {
+    data->stats.ram_errors++;
+  } else {
+    ram_plane(cfg, plane)[data->y * ram_stride(cfg) + data->x] = byte;
+    data->stats.ram_bytes++;
+
+    if (!data->dirty) {
+      data->dirty_x1 = data->dirty_x2 = data->x;
+      data->dirty_y1 = data->dirty_y2 = data->y;
+      data->dirty = true;
+    } else {
+      data->dirty_x1 = MIN(data->dirty_x1, data->x);
+      data->dirty_x2 = MAX(data->dirty_x2, data->x);
+      data->dirty_y1 = MIN(data->dirty_y1, data->y);
+      data->dirty_y2 = MAX(data->dirty_y2, data->y);
+    }
+  }
+
+  if (data->entry_mode & ENTRY_Y_FIRST) {
+    if (step_counter(&data->y, data->y_start, data->y_end, y_inc)) {
+      step_counter(&data->x, data->x_start, data->x_end, x_inc);
+    }
+  } else if (step_counter(&data->x, data->x_start, data->x_end, x_inc)) {
+    step_counter(&data->y, data->y_start, data->y_end, y_inc);
+  }
+}
+
+/* Apply the parameters of the command that just ended */
+static void finish_command(struct ssd16xx_emul_data *data) {
+  const uint8_t *p = data->params;
+
+  switch (data->cmd) {
+  case SSD16XX_EMUL_CMD_ENTRY_MODE:
+    if (data->len >= 1) {
+      data->entry_mode = p[0] & 0x07;
+    }
+    break;
+  case SSD16XX_EMUL_CMD_RAM_XPOS:
+    if (data->len >= 2) {
+      data->x_start = p[0] & 0x3f;
+      data->x_end = p[1] & 0x3f;
+    }
+    break;
+  case SSD16XX_EMUL_CMD_RAM_YPOS:
+    if (data->len >= 4) {
+      data->y_start = p[0] | ((p[1] & 0x01) << 8);
+      data->y_end = p[2] | ((p[3] & 0x01) << 8);
+    }
+    break;
+  case SSD16XX_EMUL_CMD_RAM_XCNT:
+    if (data->len >= 1) {
+      data->x = p[0] & 0x3f;
+    }
+    break;
+  case SSD16XX_EMUL_CMD_RAM_YCNT:
+    if (data->len >= 2) {
+      data->y = p[0] | ((p[1] & 0x01) << 8);
+    }
+    break;
+  case SSD16XX_EMUL_CMD_UPDATE_CTRL2:
+    if (data->len >= 1) {
+      data->ctrl2 = p[0];
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/* Run the waveform selected by Display Update Control 2. Returns the BUSY time */
+static uint32_t activate(struct ssd16xx_emul_data *data) {
+  const struct ssd16xx_emul_cfg *cfg = data->cfg;
+  uint32_t ms;
+
+  if (!(data->ctrl2 & SSD16XX_EMUL_CTRL2_DISPLAY)) {
+    data->stats.other++;
+    ms = cfg->command_ms;
+  } else if (data->ctrl2 & SSD16XX_EMUL_CTRL2_MODE2) {
+    data->stats.partial++;
+    if (data->dirty) {
+      data->stats.refreshed_px += (data->dirty_x2 - data->dirty_x1 + 1) * 8 *
+                                  (data->dirty_y2 - data->dirty_y1 + 1);
+    }
+    ms = cfg->partial_ms;
+  } else {
+    data->stats.full++;
+    data->stats.refreshed_px += cfg->width * cfg->height;
+    ms = cfg->full_ms;
+  }
+
+  LOG_DBG("activation 0x%02x: %u ms", data->ctrl2, ms);
+  data->dirty = false;
+  return ms;
+}
+
+/* Handle a command byte. Returns the BUSY time it starts, or 0 */
+static uint32_t command_byte(struct ssd16xx_emul_data *data, uint8_t cmd) {
+  struct ssd16xx_emul_cmd *entry = &data->log[data->logged % CONFIG_SSD16XX_EMUL_LOG_SIZE];
+  uint32_t busy_ms = 0;
+
+  finish_command(data);
+
+  data->cmd = cmd;
+  data->len = 0;
+  data->stats.commands++;
+  if (data->busy) {
+    // The real controller ignores the bus while BUSY is high
+    data->stats.busy_errors++;
+    LOG_WRN("command 0x%02x while busy", cmd);
+  }
+
+  *entry = (struct ssd16xx_emul_cmd){
+      .time_ms = k_uptime_get_32(),
+      .cmd = cmd,
+  };
+  data->logged++;
+
+  switch (cmd) {
+  case SSD16XX_EMUL_CMD_SW_RESET:
+    reset_controller(data);
+    busy_ms = data->cfg->command_ms;
+    break;
+  case SSD16XX_EMUL_CMD_MASTER_ACTIVATION:
+    busy_ms = activate(data);
+    break;
+  default:
+    break;
+  }
+
+  return busy_ms;
+}
+
+static void data_byte(struct ssd16xx_emul_data *data, uint8_t byte) {
+  struct ssd16xx_emul_cmd *entry =
+      &data->log[(data->logged - 1) % CONFIG_SSD16XX_EMUL_LOG_SIZE];
+
+  if (data->len < ARRAY_SIZE(data->params)) {
+    data->params[data->len] = byte;
+  }
+  if (data->logged > 0 && data->len < ARRAY_SIZE(entry->params)) {
+    entry->params[data->len] = byte;
+  }
+  if (data->logged > 0 && entry->len < UINT16_MAX) {
+    entry->len++;
+  }
+  data->len++;
+
+  if (data->cmd == SSD16XX_EMUL_CMD_WRITE_BW) {
+    ram_write(data, SSD16XX_EMUL_BW, byte);
+  } else if (data->cmd == SSD16XX_EMUL_CMD_WRITE_RED) {
+    ram_write(data, SSD16XX_EMUL_RED, byte);
+  }
+}
+
+static void set_busy_pin(const struct ssd16xx_emul_cfg *cfg, bool busy) {
+  bool active_low = cfg->busy.dt_flags & GPIO_ACTIVE_LOW;
+
+  gpio_emul_input_set(cfg->busy.port, cfg->busy.pin, busy != active_low);
+}
+
+static void busy_work_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct ssd16xx_emul_data *data = CONTAINER_OF(dwork, struct ssd16xx_emul_data, busy_work);
+
+  K_SPINLOCK(&data->lock) {
+    data->busy = false;
+  }
+  set_busy_pin(data->cfg, false);
+}
+
+static int ssd16xx_emul_io(const struct emul *target, const struct spi_config *config,
+                           const struct spi_buf_set *tx_bufs, const struct spi_buf_set *rx_bufs) {
+  struct ssd16xx_emul_data *data = target->data;
+  const struct ssd16xx_emul_cfg *cfg = target->cfg;
+  bool active_low = cfg->dc.dt_flags & GPIO_ACTIVE_LOW;
+  uint32_t busy_ms = 0;
+
+  ARG_UNUSED(rx_bufs);
+
+  if (tx_bufs == NULL) {
+    return 0;
+  }
+
+  // The mipi-dbi driver sets DC before each transfer: low for the command byte
+  bool is_data = (gpio_emul_output_get(cfg->dc.port, cfg->dc.pin) > 0) != active_low;
+
+  K_SPINLOCK(&data->lock) {
+    size_t total = 0;
+
+    for (size_t i = 0; i < tx_bufs->count; i++) {
+      const uint8_t *buf = tx_bufs->buffers[i].buf;
+      size_t len = tx_bufs->buffers[i].len;
+
+      if (buf == NULL) {
+        continue;
+      }
+      for (size_t j = 0; j < len; j++) {
+        if (is_data) {
+          data_byte(data, buf[j]);
+        } else {
+          uint32_t ms = command_byte(data, buf[j]);
+
+          busy_ms = ms ? ms : busy_ms;
+        }
+      }
+      total += len;
+    }
+
+    data->stats.bus_bytes += total;
+    if (config->frequency > 0) {
+      data->stats.bus_us += (uint64_t)total * 8 * USEC_PER_SEC / config->frequency;
+    }
+    if (busy_ms > 0) {
+      data->busy = true;
+      data->stats.busy_ms += busy_ms;
+    }
+  }
+
+  // Raised outside the lock, the pin change may run GPIO callbacks
+  if (busy_ms > 0) {
+    set_busy_pin(cfg, true);
+    k_work_reschedule(&data->busy_work, K_MSEC(busy_ms));
+  }
+
+  return 0;
+}
+
+static const struct spi_emul_api ssd16xx_emul_spi_api = {
+    .io = ssd16xx_emul_io,
+};
+
+static int ssd16xx_emul_init(const struct emul *target, const struct device *parent) {
+  struct ssd16xx_emul_data *data = target->data;
+  const struct ssd16xx_emul_cfg *cfg = target->cfg;
+
+  ARG_UNUSED(parent);
+
+  data->cfg = cfg;
+  k_work_init_delayable(&data->busy_work, busy_work_handler);
+  reset_controller(data);
+  memset(cfg->ram, 0xff, ram_stride(cfg) * cfg->height * SSD16XX_EMUL_PLANES);
+  data->stats.since_ms = k_uptime_get();
+
+  // BUSY idles low on the emulated GPIO until the first waveform
+  return 0;
+}
+
+const struct emul *ssd16xx_emul_get(void) { return EMUL_DT_GET(DT_DRV_INST(0)); }
+
+void ssd16xx_emul_get_stats(const struct emul *target, struct ssd16xx_emul_stats *stats) {
+  struct ssd16xx_emul_data *data = target->data;
+
+  K_SPINLOCK(&data->lock) {
+    *stats = data->stats;
+  }
+}
+
+void ssd16xx_emul_reset_stats(const struct emul *target) {
+  struct ssd16xx_emul_data *data = target->data;
+
+  K_SPINLOCK(&data->lock) {
+    memset(&data->stats, 0, sizeof(data->stats));
+    data->stats.since_ms = k_uptime_get();
+    data->logged = 0;
+  }
+}
+
+size_t ssd16xx_emul_get_log(const struct emul *target, struct ssd16xx_emul_cmd *out, size_t max) {
+  struct ssd16xx_emul_data *data = target->data;
+  size_t count = 0;
+
+  K_SPINLOCK(&data->lock) {
+    uint32_t held = MIN(data->logged, CONFIG_SSD16XX_EMUL_LOG_SIZE);
+    uint32_t first = data->logged - MIN(held, max);
+
+    for (uint32_t i = first; i < data->logged; i++) {
+      out[count++] = data->log[i % CONFIG_SSD16XX_EMUL_LOG_SIZE];
+    }
+  }
+
+  return count;
+}
+
+int ssd16xx_emul_get_pixel(const struct emul *target, enum ssd16xx_emul_plane plane, int x,
+                           int y) {
+  const struct ssd16xx_emul_cfg *cfg = target->cfg;
+
+  if (plane >= SSD16XX_EMUL_PLANES || x < 0 || y < 0 || x >= cfg->width || y >= cfg->height) {
+    return -EINVAL;
+  }
+
+  uint8_t byte = ram_plane(cfg, plane)[y * ram_stride(cfg) + x / 8];
+
+  return (byte >> (7 - x % 8)) & 0x01;
+}
+
+bool ssd16xx_emul_is_busy(const struct emul *target) {
+  struct ssd16xx_emul_data *data = target->data;
+  bool busy = false;
+
+  K_SPINLOCK(&data->lock) {
+    busy = data->busy;
+  }
+
+  return busy;
+}
+
+#define SSD16XX_EMUL_DEFINE(n)                                                                     \
+  BUILD_ASSERT(DT_INST_PROP(n, width) % 8 == 0, "RAM width must be a multiple of 8");              \
+  static uint8_t ssd16xx_emul_ram_##n[SSD16XX_EMUL_PLANES * DT_INST_PROP(n, width) / 8 *           \
+                                      DT_INST_PROP(n, height)];                                    \
+  static struct ssd16xx_emul_data ssd16xx_emul_data_##n;                                           \
+  static const struct ssd16xx_emul_cfg ssd16xx_emul_cfg_##n = {                                    \
+      .dc = GPIO_DT_SPEC_INST_GET(n, dc_gpios),                                                    \
+      .busy = GPIO_DT_SPEC_INST_GET(n, busy_gpios),                                                \
+      .ram = ssd16xx_emul_ram_##n,                                                                 \
+      .width = DT_INST_PROP(n, width),                                                             \
+      .height = DT_INST_PROP(n, height),                                                           \
+      .full_ms = DT_INST_PROP(n, full_refresh_ms),                                                 \
+      .partial_ms = DT_INST_PROP(n, partial_refresh_ms),                                           \
+      .command_ms = DT_INST_PROP(n, command_busy_ms),                                              \
+  };                                                                                               \
+  EMUL_DT_INST_DEFINE(n, ssd16xx_emul_init, &ssd16xx_emul_data_##n, &ssd16xx_emul_cfg_##n,         \
+                      &ssd16xx_emul_spi_api, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(SSD16XX_EMUL_DEFINE)
+
+#if defined(CONFIG_SHELL)
+static int cmd_emul_stats(const struct shell *sh, size_t argc, char **argv) {
+  const struct emul *target = ssd16xx_emul_get();
+  struct ssd16xx_emul_stats s;
+
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  ssd16xx_emul_get_stats(target, &s);
+  uint32_t refreshes = s.full + s.partial;
+
+  shell_print(sh, "window:    %lld ms", (long long)(k_uptime_get() - s.since_ms));
+  shell_print(sh, "refreshes: %u full, %u partial, %u other", s.full, s.partial, s.other);
+  shell_print(sh, "area:      %llu px (%llu per refresh)", (unsigned long long)s.refreshed_px,
+              (unsigned long long)(refreshes ? s.refreshed_px / refreshes : 0));
+  shell_print(sh, "ram bytes: %llu", (unsigned long long)s.ram_bytes);
+  shell_print(sh, "bus:       %llu bytes, %llu us", (unsigned long long)s.bus_bytes,
+              (unsigned long long)s.bus_us);
+  shell_print(sh, "busy:      %llu ms", (unsigned long long)s.busy_ms);
+  shell_print(sh, "commands:  %u (%u while busy, %u RAM overruns)", s.commands, s.busy_errors,
+              s.ram_errors);
+  return 0;
+}
+
+static int cmd_emul_log(const struct shell *sh, size_t argc, char **argv) {
+  static struct ssd16xx_emul_cmd log[CONFIG_SSD16XX_EMUL_LOG_SIZE];
+  int max = argc > 1 ? atoi(argv[1]) : 16;
+
+  if (max <= 0) {
+    shell_error(sh, "usage: epd_emul log [count]");
+    return -EINVAL;
+  }
+
+  size_t count = ssd16xx_emul_get_log(ssd16xx_emul_get(), log, MIN(max, ARRAY_SIZE(log)));
+
+  for (size_t i = 0; i < count; i++) {
+    const struct ssd16xx_emul_cmd *c = &log[i];
+    char params[16] = "";
+    int len = 0;
+
+    for (size_t j = 0; j < MIN(c->len, ARRAY_SIZE(c->params)); j++) {
+      len += snprintf(&params[len], sizeof(params) - len, "%02x ", c->params[j]);
+    }
+    shell_print(sh, "%8u ms  0x%02x  %5u  %s", c->time_ms, c->cmd, c->len, params);
+  }
+  return 0;
+}
+
+static int cmd_emul_show(const struct shell *sh, size_t argc, char **argv) {
+  const struct emul *target = ssd16xx_emul_get();
+  const struct ssd16xx_emul_cfg *cfg = target->cfg;
+  enum ssd16xx_emul_plane plane = SSD16XX_EMUL_BW;
+  char line[64];
+
+  if (argc > 1 && strcmp(argv[1], "red") == 0) {
+    plane = SSD16XX_EMUL_RED;
+  }
+
+  // One character per 4x4 block, '#' if any pixel in it is black
+  for (int y = 0; y < cfg->height; y += 4) {
+    int len = 0;
+
+    for (int x = 0; x < cfg->width && len < (int)sizeof(line) - 1; x += 4) {
+      bool black = false;
+
+      for (int i = 0; i < 16 && !black; i++) {
+        black = ssd16xx_emul_get_pixel(target, plane, x + i % 4, y + i / 4) == 0;
+      }
+      line[len++] = black ? '#' : '.';
+    }
+    line[len] = '\0';
+    shell_print(sh, "%s", line);
+  }
+  return 0;
+}
+
+static int cmd_emul_reset(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  ssd16xx_emul_reset_stats(ssd16xx_emul_get());
+  shell_print(sh, "Panel counters reset");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(epd_emul_cmds,
+                               SHELL_CMD(stats, NULL, "Show panel counters", cmd_emul_stats),
+                               SHELL_CMD_ARG(log, NULL, "Show recent commands [count]",
+                                             cmd_emul_log, 1, 1),
+                               SHELL_CMD_ARG(show, NULL, "Draw a RAM plane [bw|red]",
+                                             cmd_emul_show, 1, 1),
+                               SHELL_CMD(reset, NULL, "Reset panel counters and log",
+                                         cmd_emul_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(epd_emul, &epd_emul_cmds, "Emulated e-paper panel", NULL);
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @file ssd16xx_emul.h
+ * @brief Emulated SSD1681 e-paper controller for native_sim
+ *
+ * The emulator sits behind the display's SPI bus and sees exactly what the
+ * stock ssd16xx driver sends. It keeps the controller RAM, logs the commands,
+ * and holds BUSY high for as long as the real waveform would take, so the
+ * refresh scheduler and the UI loop run against realistic panel timing
+ * without hardware. Counters can be reset before a scenario and read after
+ * it to report refreshes, refreshed area and bytes sent.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/drivers/emul.h>
+
+/** SSD1681 commands decoded by the emulator */
+#define SSD16XX_EMUL_CMD_DRIVER_OUT 0x01
+#define SSD16XX_EMUL_CMD_DEEP_SLEEP 0x10
+#define SSD16XX_EMUL_CMD_ENTRY_MODE 0x11
+#define SSD16XX_EMUL_CMD_SW_RESET 0x12
+#define SSD16XX_EMUL_CMD_MASTER_ACTIVATION 0x20
+#define SSD16XX_EMUL_CMD_UPDATE_CTRL2 0x22
+#define SSD16XX_EMUL_CMD_WRITE_BW 0x24
+#define SSD16XX_EMUL_CMD_WRITE_RED 0x26
+#define SSD16XX_EMUL_CMD_WRITE_LUT 0x32
+#define SSD16XX_EMUL_CMD_BORDER 0x3C
+#define SSD16XX_EMUL_CMD_RAM_XPOS 0x44
+#define SSD16XX_EMUL_CMD_RAM_YPOS 0x45
+#define SSD16XX_EMUL_CMD_RAM_XCNT 0x4E
+#define SSD16XX_EMUL_CMD_RAM_YCNT 0x4F
+
+/** Display Update Control 2 bits that pick the waveform */
+#define SSD16XX_EMUL_CTRL2_DISPLAY 0x04
+#define SSD16XX_EMUL_CTRL2_MODE2 0x08
+
+/** RAM planes */
+enum ssd16xx_emul_plane {
+  SSD16XX_EMUL_BW,  /**< New image (0x24) */
+  SSD16XX_EMUL_RED, /**< Previous image for partial waveforms (0x26) */
+  SSD16XX_EMUL_PLANES,
+};
+
+/**
+ * @brief One decoded command
+ */
+struct ssd16xx_emul_cmd {
+  uint32_t time_ms;  /**< Uptime when the command byte arrived */
+  uint16_t len;      /**< Parameter or RAM data bytes that followed */
+  uint8_t cmd;       /**< Command byte */
+  uint8_t params[5]; /**< First parameter bytes */
+};
+
+/**
+ * @brief Panel counters, for scenario reports
+ */
+struct ssd16xx_emul_stats {
+  uint32_t commands;    /**< Command bytes received */
+  uint32_t full;        /**< Full refresh waveforms run */
+  uint32_t partial;     /**< Partial (mode 2) waveforms run */
+  uint32_t other;       /**< Activations that did not drive the panel */
+  uint32_t busy_errors; /**< Commands received while BUSY was high */
+  uint32_t ram_errors;  /**< RAM writes outside the controller RAM */
+  uint64_t refreshed_px; /**< Area of the RAM windows written before each refresh */
+  uint64_t ram_bytes;    /**< Bytes written to either RAM plane */
+  uint64_t bus_bytes;    /**< All bytes on the bus */
+  uint64_t bus_us;       /**< Transfer time at the configured SPI clock */
+  uint64_t busy_ms;      /**< Simulated waveform time */
+  int64_t since_ms;      /**< Uptime when the counters were last reset */
+};
+
+/**
+ * @brief Get the emulated panel of the devicetree (first instance)
+ *
+ * @return The emulator, or NULL if the build has none.
+ */
+const struct emul *ssd16xx_emul_get(void);
+
+/**
+ * @brief Get the panel counters
+ */
+void ssd16xx_emul_get_stats(const struct emul *target, struct ssd16xx_emul_stats *stats);
+
+/**
+ * @brief Reset the panel counters and the command log, e.g. at the start of a scenario
+ */
+void ssd16xx_emul_reset_stats(const struct emul *target);
+
+/**
+ * @brief Copy the most recent commands, oldest first
+ *
+ * @return Number of entries copied.
+ */
+size_t ssd16xx_emul_get_log(const struct emul *target, struct ssd16xx_emul_cmd *out, size_t max);
+
+/**
+ * @brief Read one pixel of a RAM plane, in controller coordinates
+ *
+ * @return 1 for white, 0 for black, or -EINVAL outside the RAM.
+ */
+int ssd16xx_emul_get_pixel(const struct emul *target, enum ssd16xx_emul_plane plane, int x,
+                           int y);
+
+/**
+ * @brief Check whether the emulated BUSY line is high
+ */
+bool ssd16xx_emul_is_busy(const struct emul *target);
@@ -1,3 +1,5 @@
+#include <stdlib.h>
+#include <string.h>
 #include <zephyr/bluetooth/addr.h>
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/conn.h>
@@ -5,9 +7,12 @@
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
 #include <zephyr/sys/byteorder.h>
 
 #include "ancs.h"
+#include "ancs_parser.h"
 #include "host/gatt_internal.h"
 #include "host/hci_core.h"
 
@@ -23,22 +28,39 @@
 #define CONFIG_ANCS_WORK_QUEUE_PRIORITY 7
 #endif
 
-#ifndef CONFIG_ANCS_NOTIFICATION_POOL_SIZE
-#define CONFIG_ANCS_NOTIFICATION_POOL_SIZE 2
+/* Control Point commands queued or in flight */
+#ifndef CONFIG_ANCS_CP_QUEUE_SIZE
+#define CONFIG_ANCS_CP_QUEUE_SIZE 8
 #endif
 
-#ifndef CONFIG_ANCS_NOTIFICATION_QUEUE_SIZE
-#define CONFIG_ANCS_NOTIFICATION_QUEUE_SIZE 2
+/* Control Point writes handed to the stack at once */
+#ifndef CONFIG_ANCS_CP_WINDOW
+#define CONFIG_ANCS_CP_WINDOW 3
 #endif
 
-#ifndef CONFIG_ANCS_DATA_SOURCE_BUFFER_SIZE
-#define CONFIG_ANCS_DATA_SOURCE_BUFFER_SIZE 512
+/* Wait for the Data Source response of an attribute request */
+#ifndef CONFIG_ANCS_CP_TIMEOUT_MS
+#define CONFIG_ANCS_CP_TIMEOUT_MS 1000
+#endif
+
+/* Timed out attribute requests remembered for their late responses */
+#ifndef CONFIG_ANCS_EXPIRED_SIZE
+#define CONFIG_ANCS_EXPIRED_SIZE 4
+#endif
+
+/* Notification events waiting for room in the command queue */
+#ifndef CONFIG_ANCS_BACKLOG_SIZE
+#define CONFIG_ANCS_BACKLOG_SIZE 64
+#endif
+
+/* Attribute requests of the backlog in the command queue at once */
+#ifndef CONFIG_ANCS_BACKLOG_IN_FLIGHT
+#define CONFIG_ANCS_BACKLOG_IN_FLIGHT 2
 #endif
 
 /* Kconfig should be used for these */
-#define NOTIFICATION_POOL_SIZE CONFIG_ANCS_NOTIFICATION_POOL_SIZE
-#define NOTIFICATION_QUEUE_SIZE CONFIG_ANCS_NOTIFICATION_QUEUE_SIZE
-#define DATA_SOURCE_BUFFER_SIZE CONFIG_ANCS_DATA_SOURCE_BUFFER_SIZE
+#define CP_QUEUE_SIZE CONFIG_ANCS_CP_QUEUE_SIZE
+#define CP_WINDOW CONFIG_ANCS_CP_WINDOW
 
 LOG_MODULE_REGISTER(ancs, CONFIG_ANCS_LOG_LEVEL);
 
@@ -78,17 +100,6 @@ typedef enum {
   COMMAND_ID_PERFORM_NOTIFICATION_ACTION = 2,
 } command_id_t;
 
-typedef enum {
-  ATTR_ID_APP_IDENTIFIER = 0,
-  ATTR_ID_TITLE = 1,
-  ATTR_ID_SUBTITLE = 2,
-  ATTR_ID_MESSAGE = 3,
-  ATTR_ID_MESSAGE_SIZE = 4,
-  ATTR_ID_DATE = 5,
-  ATTR_ID_POSITIVE_ACTION_LABEL = 6,
-  ATTR_ID_NEGATIVE_ACTION_LABEL = 7,
-} notification_attribute_id_t;
-
 /* Static data for the ANCS client */
 static struct {
   struct bt_conn *conn;
@@ -96,21 +107,21 @@ static struct {
   uint16_t ns_handle;
   uint16_t cp_handle;
   uint16_t ds_handle;
+  uint16_t ns_ccc;  // 0 until known, then subscribing skips its discovery
+  uint16_t ds_ccc;
+  uint16_t sc_handle;  // Service Changed of the phone's GATT service
+  uint16_t sc_ccc;
+  bool cached;  // Handles from the cache rather than discovered
   struct bt_gatt_subscribe_params ns_sub_params;
   struct bt_gatt_subscribe_params ds_sub_params;
+  struct bt_gatt_subscribe_params sc_sub_params;
   struct bt_gatt_discover_params discover_params;
   const struct ancs_callbacks *app_cb;
 
-  /* Pool to store notifications being processed */
-  struct ancs_notification notif_pool[NOTIFICATION_POOL_SIZE];
-  bool pool_in_use[NOTIFICATION_POOL_SIZE];
-
-  /* Data source parsing state */
-  uint8_t ds_buffer[DATA_SOURCE_BUFFER_SIZE];
-  size_t ds_buffer_len;
-  int current_notif_idx;  // Index in notif_pool
-  int num_attr_requested;
-  int remain_num_attr;
+  /* Data source parsing state, attributes go straight into notif */
+  struct ancs_parser parser;
+  struct ancs_notification notif;
+  uint32_t parsing_seq;  // Command of the response being parsed
   bool is_init;
 
 } ancs;
@@ -119,16 +130,9 @@ static struct {
 static struct k_work_q ancs_work_q;
 static K_KERNEL_STACK_DEFINE(ancs_stack, CONFIG_ANCS_WORK_QUEUE_STACK_SIZE);
 
-K_MSGQ_DEFINE(notification_q, sizeof(uint32_t), NOTIFICATION_QUEUE_SIZE, 4);
-static void req_notif_info_work_handler(struct k_work *work);
-static struct k_work req_notif_info_work;
-
 static void discovery_work_handler(struct k_work *work);
 static struct k_work_delayable discovery_work;
 
-K_MUTEX_DEFINE(ancs_pool_mutex);
-K_SEM_DEFINE(ancs_data_sem, 0, 1);
-
 /* Forward declarations */
 static void ancs_reset_state(void);
 static int subscribe_to_ns(struct bt_conn *conn);
@@ -136,27 +140,582 @@ static int subscribe_to_ds(struct bt_conn *conn);
 static void process_notification_attributes(const uint8_t *data,
                                             uint16_t length);
 
-/*** Notification Pool Management ***/
+/* Time to enable ANCS on a connection, and how the handles were found */
+static struct {
+  uint32_t connected_at;  // Uptime ms
+  uint32_t last_enable_ms;
+  bool last_cached;
+  uint32_t cache_hits;
+  uint32_t discoveries;
+  uint32_t invalidated;
+} conn_stats;
+
+/* Data Source parse time, per fragment and per response */
+static struct {
+  uint32_t fragments;
+  uint32_t bytes;
+  uint32_t max_cycles;  // Longest fragment
+  uint64_t cycles;
+} ds_stats;
 
-static int find_free_pool_slot(void) {
-  for (int i = 0; i < NOTIFICATION_POOL_SIZE; i++) {
-    if (!ancs.pool_in_use[i]) {
-      return i;
+/*** Control Point Command Queue ***/
+
+/* Commands go from queued to written, and attribute requests then wait for
+ * their Data Source response. Only the work queue writes to the Control
+ * Point; submitters and completions just update the table and kick it. */
+enum {
+  CP_FREE,
+  CP_QUEUED,   // Waiting for room in the window
+  CP_WRITING,  // Write handed to the stack, no response yet
+  CP_WAITING,  // Attributes requested, Data Source response pending
+};
+
+/* What an attribute request asks for. The app identifier and title come
+ * first when the filter needs them to decide, the rest only when the
+ * notification is to be shown or is opened. */
+enum {
+  FETCH_APP,      // Summary, then the filter decides
+  FETCH_SUMMARY,  // App identifier and title
+  FETCH_FULL,
+  FETCH_DETAILS,  // What a summary left out
+  FETCH_KINDS,
+};
+
+#define SUMMARY_ATTRS \
+  (BIT(ANCS_ATTR_ID_APP_IDENTIFIER) | BIT(ANCS_ATTR_ID_TITLE))
+#define ALL_ATTRS (BIT_MASK(8) & ~BIT(ANCS_ATTR_ID_MESSAGE_SIZE))
+
+static const uint8_t fetch_attrs[FETCH_KINDS] = {
+    [FETCH_APP] = SUMMARY_ATTRS,
+    [FETCH_SUMMARY] = SUMMARY_ATTRS,
+    [FETCH_FULL] = ALL_ATTRS,
+    [FETCH_DETAILS] = ALL_ATTRS & ~SUMMARY_ATTRS,
+};
+
+struct cp_cmd {
+  uint8_t state;
+  uint8_t command;  // command_id_t
+  uint8_t arg;      // ancs_action_id_t of an action, FETCH_* of a request
+  bool cancelled;   // Connection reset while writing
+  bool deferred;    // Taken from the backlog
+  uint32_t seq;     // Submission order
+  uint32_t queued;  // Cycles when submitted
+  uint32_t sent;    // Uptime ms when written, then when acknowledged
+  struct ancs_notification_source source;
+  uint8_t request[18];
+  struct bt_gatt_write_params params;
+};
+
+static struct {
+  struct cp_cmd cmds[CP_QUEUE_SIZE];
+  uint32_t seq;
+  struct k_spinlock lock;
+  struct k_work work;
+  struct k_work_delayable timeout_work;
+} cp;
+
+/* A response can still come after its request timed out. It holds no
+ * attribute count, so the count of the request is kept to skip it whole. */
+static struct {
+  struct {
+    uint32_t uid;
+    uint8_t num_attr;
+  } ring[CONFIG_ANCS_EXPIRED_SIZE];
+  uint8_t head;  // Oldest entry
+  uint8_t count;
+} expired;
+
+static struct {
+  uint32_t queued;
+  uint32_t merged;   // Attribute requests folded into a queued one
+  uint32_t dropped;  // Queue full
+  uint32_t written;
+  uint32_t busy;     // Writes retried for lack of stack buffers
+  uint32_t failed;
+  uint32_t timeouts;
+  uint32_t late;  // Responses to timed out requests
+  uint32_t actions;
+  uint32_t responses;
+  uint32_t max_in_flight;
+  uint32_t fetches[FETCH_KINDS];
+  uint32_t filtered;        // Dropped on the Notification Source event
+  uint32_t filtered_app;    // Dropped once the app identifier was known
+  uint64_t latency_cycles;  // Submission to parsed response
+  /* Busy periods, from the first command queued to the queue empty */
+  uint32_t burst_start;
+  uint32_t burst_responses;
+  uint32_t last_burst_responses;
+  uint32_t last_burst_us;
+} cp_stats;
+
+/* Events whose attributes are fetched later, in arrival order. Pre-existing
+ * notifications, which iOS replays all at once on reconnect, always wait
+ * here, other events only when the command queue is full. A few at a time
+ * go to the queue, most important first, leaving it to new events. */
+struct backlog_entry {
+  uint32_t uid;
+  uint32_t timestamp;
+  uint8_t event_id;
+  uint8_t flags;
+  uint8_t category;
+  uint8_t fetch;
+};
+
+static struct {
+  struct backlog_entry ring[CONFIG_ANCS_BACKLOG_SIZE];
+  uint16_t head;  // Oldest entry
+  uint16_t count;
+} backlog;
+
+static struct {
+  uint32_t deferred;
+  uint32_t fetched;
+  uint32_t removed;  // Removed on the phone before being fetched
+  uint32_t dropped;  // Backlog full
+  uint32_t max_depth;
+} backlog_stats;
+
+/* Nothing queued, in flight or deferred */
+static bool cp_idle(void) {
+  for (int i = 0; i < CP_QUEUE_SIZE; i++) {
+    if (cp.cmds[i].state != CP_FREE) {
+      return false;
     }
   }
-  return -1;
+  return backlog.count == 0;
+}
+
+/* Call with cp.lock held */
+static void cp_free(struct cp_cmd *c) {
+  c->state = CP_FREE;
+  c->cancelled = false;
+  c->deferred = false;
+
+  if (cp_idle()) {
+    cp_stats.last_burst_responses = cp_stats.burst_responses;
+    cp_stats.last_burst_us =
+        k_cyc_to_us_floor32(k_cycle_get_32() - cp_stats.burst_start);
+  }
 }
 
-static int find_pool_slot_by_uid(uint32_t uid) {
-  for (int i = 0; i < NOTIFICATION_POOL_SIZE; i++) {
-    if (ancs.pool_in_use[i] &&
-        ancs.notif_pool[i].source.notification_uid == uid) {
+/* Call with cp.lock held */
+static int cp_queue(uint8_t command, const struct ancs_notification_source *src,
+                    uint8_t arg, bool deferred) {
+  struct cp_cmd *c = NULL;
+
+  for (int i = 0; i < CP_QUEUE_SIZE; i++) {
+    struct cp_cmd *q = &cp.cmds[i];
+
+    // A newer event for a UID not requested yet only updates its source
+    if (command == COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES &&
+        q->state == CP_QUEUED && q->command == command && q->arg == arg &&
+        q->source.notification_uid == src->notification_uid) {
+      q->source = *src;
+      cp_stats.merged++;
+      return 0;
+    }
+    if (c == NULL && q->state == CP_FREE) {
+      c = q;
+    }
+  }
+
+  if (c == NULL) {
+    return -ENOMEM;
+  }
+
+  if (cp_idle()) {
+    cp_stats.burst_start = k_cycle_get_32();
+    cp_stats.burst_responses = 0;
+  }
+  c->state = CP_QUEUED;
+  c->command = command;
+  c->arg = arg;
+  c->deferred = deferred;
+  c->seq = cp.seq++;
+  c->queued = k_cycle_get_32();
+  c->source = *src;
+  cp_stats.queued++;
+  if (command == COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES) {
+    cp_stats.fetches[arg]++;
+  }
+  return 0;
+}
+
+static int cp_submit(uint8_t command,
+                     const struct ancs_notification_source *src, uint8_t arg) {
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  int err = cp_queue(command, src, arg, false);
+  if (err) {
+    cp_stats.dropped++;
+  }
+  k_spin_unlock(&cp.lock, key);
+
+  if (err == 0) {
+    k_work_submit_to_queue(&ancs_work_q, &cp.work);
+  }
+  return err;
+}
+
+/*** Deferred Attribute Requests ***/
+
+/* Calls first, then messages, then the rest */
+static uint8_t category_priority(uint8_t category) {
+  switch (category) {
+    case ANCS_CATEGORY_ID_INCOMING_CALL:
+    case ANCS_CATEGORY_ID_ACTIVE_CALL:
+      return 3;
+    case ANCS_CATEGORY_ID_MISSED_CALL:
+    case ANCS_CATEGORY_ID_VOICEMAIL:
+    case ANCS_CATEGORY_ID_SOCIAL:
+      return 2;
+    case ANCS_CATEGORY_ID_SCHEDULE:
+    case ANCS_CATEGORY_ID_EMAIL:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+/* The backlog functions are called with cp.lock held */
+static struct backlog_entry *backlog_at(int i) {
+  return &backlog.ring[(backlog.head + i) % CONFIG_ANCS_BACKLOG_SIZE];
+}
+
+static int backlog_find(uint32_t uid) {
+  for (int i = 0; i < backlog.count; i++) {
+    if (backlog_at(i)->uid == uid) {
       return i;
     }
   }
   return -1;
 }
 
+static void backlog_remove(int i) {
+  if (i == 0) {
+    backlog.head = (backlog.head + 1) % CONFIG_ANCS_BACKLOG_SIZE;
+  } else {
+    for (; i + 1 < backlog.count; i++) {
+      *backlog_at(i) = *backlog_at(i + 1);
+    }
+  }
+  backlog.count--;
+}
+
+/* Defer an event, false if it was dropped */
+static bool backlog_add(const struct ancs_notification_source *src,
+                        uint8_t fetch) {
+  struct backlog_entry e = {
+      .uid = src->notification_uid,
+      .timestamp = src->timestamp,
+      .event_id = src->event_id,
+      .flags = src->event_flags,
+      .category = src->category_id,
+      .fetch = fetch,
+  };
+  int i = backlog_find(e.uid);
+
+  backlog_stats.deferred++;
+  if (i >= 0) {
+    *backlog_at(i) = e;
+    return true;
+  }
+
+  if (backlog.count == CONFIG_ANCS_BACKLOG_SIZE) {
+    // Make room by dropping the oldest of the least important
+    int worst = 0;
+    for (i = 1; i < backlog.count; i++) {
+      if (category_priority(backlog_at(i)->category) <
+          category_priority(backlog_at(worst)->category)) {
+        worst = i;
+      }
+    }
+    backlog_stats.dropped++;
+    if (category_priority(e.category) <
+        category_priority(backlog_at(worst)->category)) {
+      return false;
+    }
+    backlog_remove(worst);
+  }
+
+  *backlog_at(backlog.count++) = e;
+  backlog_stats.max_depth = MAX(backlog_stats.max_depth, backlog.count);
+  return true;
+}
+
+/* Move the most important entries, newest first, to the command queue */
+static void backlog_refill(void) {
+  int in_flight = 0;
+
+  for (int i = 0; i < CP_QUEUE_SIZE; i++) {
+    in_flight += cp.cmds[i].state != CP_FREE && cp.cmds[i].deferred;
+  }
+
+  while (backlog.count > 0 && in_flight < CONFIG_ANCS_BACKLOG_IN_FLIGHT) {
+    int best = 0;
+    for (int i = 1; i < backlog.count; i++) {
+      if (category_priority(backlog_at(i)->category) >=
+          category_priority(backlog_at(best)->category)) {
+        best = i;
+      }
+    }
+
+    const struct backlog_entry *e = backlog_at(best);
+    struct ancs_notification_source src = {
+        .event_id = e->event_id,
+        .event_flags = e->flags,
+        .category_id = e->category,
+        .notification_uid = e->uid,
+        .timestamp = e->timestamp,
+    };
+
+    if (cp_queue(COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES, &src, e->fetch,
+                 true) != 0) {
+      break;
+    }
+    backlog_remove(best);
+    backlog_stats.fetched++;
+    in_flight++;
+  }
+}
+
+static void cp_write_cb(struct bt_conn *conn, uint8_t err,
+                        struct bt_gatt_write_params *params) {
+  struct cp_cmd *c = CONTAINER_OF(params, struct cp_cmd, params);
+
+  LOG_ERR_OR_DBG(err, "Control Point write for UID 0x%x %s, %d",
+                 c->source.notification_uid, err ? "failed" : "successful",
+                 err);
+
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  if (err) {
+    cp_stats.failed++;
+    cp_free(c);
+  } else if (c->cancelled ||
+             c->command != COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES) {
+    cp_stats.actions += !c->cancelled;
+    cp_free(c);
+  } else {
+    c->state = CP_WAITING;
+    c->sent = k_uptime_get_32();
+  }
+  k_spin_unlock(&cp.lock, key);
+
+  // Room in the window for the next one
+  k_work_submit_to_queue(&ancs_work_q, &cp.work);
+}
+
+static size_t cp_build(struct cp_cmd *c) {
+  size_t len = 5;
+
+  c->request[0] = c->command;
+  sys_put_le32(c->source.notification_uid, &c->request[1]);
+
+  if (c->command == COMMAND_ID_PERFORM_NOTIFICATION_ACTION) {
+    c->request[len++] = c->arg;
+    return len;
+  }
+
+  for (uint8_t id = 0; id <= ANCS_ATTR_ID_NEGATIVE_ACTION_LABEL; id++) {
+    if (!(fetch_attrs[c->arg] & BIT(id))) {
+      continue;
+    }
+    c->request[len++] = id;
+
+    // Text attributes take a maximum length
+    uint16_t max = id == ANCS_ATTR_ID_TITLE      ? CONFIG_ANCS_TITLE_MAX_LEN
+                   : id == ANCS_ATTR_ID_SUBTITLE ? CONFIG_ANCS_SUBTITLE_MAX_LEN
+                   : id == ANCS_ATTR_ID_MESSAGE  ? CONFIG_ANCS_MESSAGE_MAX_LEN
+                                                 : 0;
+    if (max > 0) {
+      sys_put_le16(max, &c->request[len]);
+      len += 2;
+    }
+  }
+  return len;
+}
+
+/* Actions first, the user is waiting on them, then by category */
+static uint8_t cp_priority(const struct cp_cmd *c) {
+  if (c->command == COMMAND_ID_PERFORM_NOTIFICATION_ACTION) {
+    return 4;
+  }
+  if (c->arg == FETCH_DETAILS) {
+    return 2;  // Opened on the watch, the category isn't known here
+  }
+  return category_priority(c->source.category_id);
+}
+
+/* Most important queued command, the oldest among equals, if the window has
+ * room. Marked as writing. */
+static struct cp_cmd *cp_next(void) {
+  struct cp_cmd *next = NULL;
+  uint32_t in_flight = 0;
+
+  for (int i = 0; i < CP_QUEUE_SIZE; i++) {
+    struct cp_cmd *c = &cp.cmds[i];
+
+    in_flight += c->state == CP_WRITING;
+    if (c->state != CP_QUEUED) {
+      continue;
+    }
+    if (next == NULL || cp_priority(c) > cp_priority(next) ||
+        (cp_priority(c) == cp_priority(next) &&
+         (int32_t)(c->seq - next->seq) < 0)) {
+      next = c;
+    }
+  }
+
+  if (next == NULL || in_flight >= CP_WINDOW) {
+    return NULL;
+  }
+  next->state = CP_WRITING;
+  next->sent = k_uptime_get_32();
+  cp_stats.max_in_flight = MAX(cp_stats.max_in_flight, in_flight + 1);
+  return next;
+}
+
+static void cp_work_handler(struct k_work *work) {
+  ARG_UNUSED(work);
+
+  for (;;) {
+    struct bt_conn *conn = ancs.conn;
+
+    if (ancs.state != ANCS_STATE_ENABLED || conn == NULL) {
+      break;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&cp.lock);
+    backlog_refill();
+    struct cp_cmd *c = cp_next();
+    k_spin_unlock(&cp.lock, key);
+
+    if (c == NULL) {
+      break;
+    }
+
+    c->params.func = cp_write_cb;
+    c->params.handle = ancs.cp_handle;
+    c->params.offset = 0;
+    c->params.data = c->request;
+    c->params.length = cp_build(c);
+
+    int err = bt_gatt_write(conn, &c->params);
+    if (err == 0) {
+      cp_stats.written++;
+      continue;
+    }
+
+    key = k_spin_lock(&cp.lock);
+    if (err == -ENOMEM) {
+      // No ATT buffer: retried when a write completes or times out
+      c->state = CP_QUEUED;
+      cp_stats.busy++;
+      k_spin_unlock(&cp.lock, key);
+      break;
+    }
+    LOG_ERR("Control Point write for UID 0x%x failed (err %d)",
+            c->source.notification_uid, err);
+    cp_stats.failed++;
+    cp_free(c);
+    k_spin_unlock(&cp.lock, key);
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  bool idle = cp_idle();
+  k_spin_unlock(&cp.lock, key);
+
+  if (!idle) {
+    k_work_schedule_for_queue(&ancs_work_q, &cp.timeout_work,
+                              K_MSEC(CONFIG_ANCS_CP_TIMEOUT_MS));
+  }
+}
+
+/* Remember a request given up on, the oldest one goes when full */
+static void expired_add(const struct cp_cmd *c) {
+  uint8_t i = (expired.head + expired.count) % CONFIG_ANCS_EXPIRED_SIZE;
+
+  if (expired.count == CONFIG_ANCS_EXPIRED_SIZE) {
+    expired.head = (expired.head + 1) % CONFIG_ANCS_EXPIRED_SIZE;
+  } else {
+    expired.count++;
+  }
+  expired.ring[i].uid = c->source.notification_uid;
+  expired.ring[i].num_attr = __builtin_popcount(fetch_attrs[c->arg]);
+}
+
+/* Attribute count of the oldest expired request for a UID, 0 if none */
+static uint8_t expired_take(uint32_t uid) {
+  for (uint8_t n = 0; n < expired.count; n++) {
+    uint8_t i = (expired.head + n) % CONFIG_ANCS_EXPIRED_SIZE;
+
+    if (expired.ring[i].uid != uid) {
+      continue;
+    }
+    uint8_t num_attr = expired.ring[i].num_attr;
+
+    // Close the gap, keeping the order of the others
+    for (; n + 1 < expired.count; n++) {
+      uint8_t next = (i + 1) % CONFIG_ANCS_EXPIRED_SIZE;
+
+      expired.ring[i] = expired.ring[next];
+      i = next;
+    }
+    expired.count--;
+    return num_attr;
+  }
+  return 0;
+}
+
+/* Give up on responses that don't come; writes are timed out by the stack */
+static void cp_timeout_handler(struct k_work *work) {
+  ARG_UNUSED(work);
+  uint32_t now = k_uptime_get_32();
+  uint32_t timeouts = 0;
+
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  for (int i = 0; i < CP_QUEUE_SIZE; i++) {
+    struct cp_cmd *c = &cp.cmds[i];
+
+    if (c->state == CP_WAITING && now - c->sent >= CONFIG_ANCS_CP_TIMEOUT_MS) {
+      // A response being parsed is already sized
+      if (c->command == COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES &&
+          c->seq != ancs.parsing_seq) {
+        expired_add(c);
+      }
+      timeouts++;
+      cp_free(c);
+    }
+  }
+  cp_stats.timeouts += timeouts;
+  k_spin_unlock(&cp.lock, key);
+
+  if (timeouts > 0) {
+    LOG_ERR("No attributes received for %u requests", timeouts);
+  }
+
+  cp_work_handler(NULL);
+}
+
+/* Drop the queue and the backlog, writes still in the stack complete with
+ * an error. iOS replays the notifications on the next connection. */
+static void cp_reset(void) {
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  backlog.head = 0;
+  backlog.count = 0;
+  expired.head = 0;
+  expired.count = 0;
+  for (int i = 0; i < CP_QUEUE_SIZE; i++) {
+    struct cp_cmd *c = &cp.cmds[i];
+
+    if (c->state == CP_WRITING) {
+      c->cancelled = true;
+    } else if (c->state != CP_FREE) {
+      cp_free(c);
+    }
+  }
+  k_spin_unlock(&cp.lock, key);
+}
+
 /*** GATT Notification Handlers ***/
 
 static uint8_t data_source_notify_cb(struct bt_conn *conn,
@@ -170,6 +729,30 @@ static uint8_t data_source_notify_cb(struct bt_conn *conn,
   return BT_GATT_ITER_CONTINUE;
 }
 
+/* Queue an attribute request, or defer it; false if it was dropped */
+static bool request_attributes(const struct ancs_notification_source *src,
+                               uint8_t fetch) {
+  bool deferred = false;
+  bool queued = true;
+
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  // An update of a deferred event stays deferred, in its place
+  if ((src->event_flags & ANCS_EVENT_FLAG_PRE_EXISTING) ||
+      backlog_find(src->notification_uid) >= 0 ||
+      cp_queue(COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES, src, fetch, false) !=
+          0) {
+    deferred = true;
+    queued = backlog_add(src, fetch);
+  }
+  k_spin_unlock(&cp.lock, key);
+
+  if (deferred) {
+    LOG_DBG("UID 0x%x deferred", src->notification_uid);
+  }
+  k_work_submit_to_queue(&ancs_work_q, &cp.work);
+  return queued;
+}
+
 static uint8_t notif_source_notify_cb(struct bt_conn *conn,
                                       struct bt_gatt_subscribe_params *params,
                                       const void *data, uint16_t length) {
@@ -180,6 +763,7 @@ static uint8_t notif_source_notify_cb(struct bt_conn *conn,
   const uint8_t *raw = data;
   struct ancs_notification_source src;
 
+  src.timestamp = k_cycle_get_32();
   src.event_id = raw[0];
   src.event_flags = raw[1];
   src.category_id = raw[2];
@@ -192,37 +776,38 @@ static uint8_t notif_source_notify_cb(struct bt_conn *conn,
 
   if (src.event_id == ANCS_EVENT_ID_NOTIFICATION_ADDED ||
       src.event_id == ANCS_EVENT_ID_NOTIFICATION_MODIFIED) {
-    k_mutex_lock(&ancs_pool_mutex, K_FOREVER);
-    int idx = find_pool_slot_by_uid(src.notification_uid);
-    if (idx < 0) {
-      idx = find_free_pool_slot();
-    }
+    ancs_filter_t filter = ANCS_FILTER_FULL;
+    uint8_t fetch = FETCH_FULL;
 
-    if (idx >= 0) {
-      ancs.notif_pool[idx].source = src;
-      ancs.pool_in_use[idx] = true;
-      k_mutex_unlock(&ancs_pool_mutex);
-
-      if (k_msgq_put(&notification_q, &src.notification_uid, K_NO_WAIT) != 0) {
-        uint32_t used = k_msgq_num_used_get(&notification_q);
-
-        LOG_WRN("Notification queue full (%u/%u used), dropping UID 0x%x", used,
-                (uint32_t)NOTIFICATION_QUEUE_SIZE, src.notification_uid);
-      }
-    } else {
-      k_mutex_unlock(&ancs_pool_mutex);
-      LOG_WRN("Notification pool full, dropping notification");
+    if (ancs.app_cb && ancs.app_cb->filter) {
+      filter = ancs.app_cb->filter(&src, NULL);
     }
-
-    if (ancs.state == ANCS_STATE_ENABLED) {
-      k_work_submit_to_queue(&ancs_work_q, &req_notif_info_work);
+    if (filter == ANCS_FILTER_DROP) {
+      LOG_DBG("UID 0x%x filtered out", src.notification_uid);
+      cp_stats.filtered++;
+      return BT_GATT_ITER_CONTINUE;
+    }
+    if (filter == ANCS_FILTER_SUMMARY) {
+      fetch = FETCH_SUMMARY;
+    } else if (filter == ANCS_FILTER_NEED_APP) {
+      fetch = FETCH_APP;
     }
 
+    if (!request_attributes(&src, fetch)) {
+      LOG_WRN("Backlog full, dropping UID 0x%x", src.notification_uid);
+    }
   } else if (src.event_id == ANCS_EVENT_ID_NOTIFICATION_REMOVED) {
     LOG_DBG("ANCS notification removed: %d", src.notification_uid);
-    // Here we just notify the app. We don't need to clear from the pool
-    // as it will be cleared after a potential ongoing attribute fetch
-    // completes.
+    k_spinlock_key_t key = k_spin_lock(&cp.lock);
+    int i = backlog_find(src.notification_uid);
+    if (i >= 0) {
+      backlog_remove(i);
+      backlog_stats.removed++;
+    }
+    k_spin_unlock(&cp.lock, key);
+
+    // Here we just notify the app. A pending attribute request for it
+    // completes, or times out, on its own.
     if (ancs.app_cb && ancs.app_cb->on_notification_removed) {
       ancs.app_cb->on_notification_removed(src.notification_uid);
     }
@@ -231,6 +816,114 @@ static uint8_t notif_source_notify_cb(struct bt_conn *conn,
   return BT_GATT_ITER_CONTINUE;
 }
 
+/*** Handle Cache ***/
+
+/* The ANCS handles and CCC descriptors of a bonded phone, saved once they
+ * are discovered so a reconnection subscribes right away. They are dropped
+ * when the phone reports a Service Changed, a subscription with them fails
+ * or the bond is deleted. */
+struct handle_cache {
+  uint16_t ns;
+  uint16_t cp;
+  uint16_t ds;
+  uint16_t ns_ccc;
+  uint16_t ds_ccc;
+  uint16_t sc;  // 0 if the phone has no Service Changed characteristic
+  uint16_t sc_ccc;
+};
+
+static void cache_key(uint8_t id, const bt_addr_le_t *addr, char *key,
+                      size_t size) {
+  snprintk(key, size, "ancs/%u/%02x%02x%02x%02x%02x%02x%u", id,
+           addr->a.val[5], addr->a.val[4], addr->a.val[3], addr->a.val[2],
+           addr->a.val[1], addr->a.val[0], addr->type);
+}
+
+static void conn_cache_key(struct bt_conn *conn, char *key, size_t size) {
+  struct bt_conn_info info = {0};
+
+  bt_conn_get_info(conn, &info);
+  cache_key(info.id, info.le.dst, key, size);
+}
+
+static int cache_read_cb(const char *key, size_t len, settings_read_cb read_cb,
+                         void *cb_arg, void *param) {
+  // Only the entry itself, not keys below it
+  if ((key != NULL && key[0] != '\0') || len != sizeof(struct handle_cache)) {
+    return 0;
+  }
+  if (read_cb(cb_arg, param, len) != len) {
+    memset(param, 0, sizeof(struct handle_cache));
+  }
+  return 0;
+}
+
+/* Take the handles of a bonded phone from the cache */
+static int cache_load(struct bt_conn *conn) {
+  struct bt_conn_info info = {0};
+  struct handle_cache c = {0};
+  char key[32];
+
+  if (!IS_ENABLED(CONFIG_SETTINGS)) {
+    return -ENOTSUP;
+  }
+  bt_conn_get_info(conn, &info);
+  if (!bt_le_bond_exists(info.id, info.le.dst)) {
+    return -ENOENT;
+  }
+
+  cache_key(info.id, info.le.dst, key, sizeof(key));
+  settings_load_subtree_direct(key, cache_read_cb, &c);
+  if (c.ns == 0 || c.cp == 0 || c.ds == 0) {
+    return -ENOENT;
+  }
+
+  ancs.ns_handle = c.ns;
+  ancs.cp_handle = c.cp;
+  ancs.ds_handle = c.ds;
+  ancs.ns_ccc = c.ns_ccc;
+  ancs.ds_ccc = c.ds_ccc;
+  ancs.sc_handle = c.sc;
+  ancs.sc_ccc = c.sc_ccc;
+  ancs.cached = true;
+  return 0;
+}
+
+static void cache_save(struct bt_conn *conn) {
+  struct handle_cache c = {
+      .ns = ancs.ns_handle,
+      .cp = ancs.cp_handle,
+      .ds = ancs.ds_handle,
+      .ns_ccc = ancs.ns_ccc,
+      .ds_ccc = ancs.ds_ccc,
+      .sc = ancs.sc_handle,
+      .sc_ccc = ancs.sc_ccc,
+  };
+  char key[32];
+
+  if (!IS_ENABLED(CONFIG_SETTINGS)) {
+    return;
+  }
+  conn_cache_key(conn, key, sizeof(key));
+  int err = settings_save_one(key, &c, sizeof(c));
+  if (err) {
+    LOG_ERR("Saving ANCS handles failed (err %d)", err);
+  } else {
+    LOG_INF("ANCS handles saved for the next connection");
+  }
+}
+
+static void cache_delete(struct bt_conn *conn) {
+  char key[32];
+
+  if (!IS_ENABLED(CONFIG_SETTINGS)) {
+    return;
+  }
+  conn_cache_key(conn, key, sizeof(key));
+  settings_delete(key);
+  conn_stats.invalidated++;
+}
+
 /*** GATT Discovery and Subscription Logic ***/
 
 static uint8_t discover_func(struct bt_conn *conn,
@@ -317,6 +1010,7 @@ static uint8_t discover_func(struct bt_conn *conn,
 }
 
 static void start_discovery(struct bt_conn *conn) {
+  conn_stats.discoveries++;
   ancs.state = ANCS_STATE_DISCOVERING;
   ancs.discover_params.uuid = &ancs_service_uuid.uuid;
   ancs.discover_params.func = discover_func;
@@ -330,6 +1024,123 @@ static void start_discovery(struct bt_conn *conn) {
   }
 }
 
+/* Forget the cached handles and find them again on this connection */
+static void rediscover(struct bt_conn *conn) {
+  cache_delete(conn);
+  bt_gatt_unsubscribe(conn, &ancs.ns_sub_params);
+  bt_gatt_unsubscribe(conn, &ancs.ds_sub_params);
+  ancs_reset_state();
+  ancs.conn = conn;
+  k_work_reschedule_for_queue(&ancs_work_q, &discovery_work, K_NO_WAIT);
+}
+
+static uint8_t service_changed_cb(struct bt_conn *conn,
+                                  struct bt_gatt_subscribe_params *params,
+                                  const void *data, uint16_t length) {
+  if (!data) {
+    return BT_GATT_ITER_STOP;
+  }
+
+  uint16_t start = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+  uint16_t end = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+  if (length >= 4) {
+    start = sys_get_le16(data);
+    end = sys_get_le16((const uint8_t *)data + 2);
+  }
+  LOG_INF("Service Changed, handles 0x%04x-0x%04x", start, end);
+  cache_delete(conn);
+
+  // ANCS itself moved: subscribe again where it is now
+  uint16_t lo = MIN(ancs.ns_handle, MIN(ancs.cp_handle, ancs.ds_handle));
+  uint16_t hi = MAX(MAX(ancs.ns_ccc, ancs.ds_ccc),
+                    MAX(ancs.ns_handle, MAX(ancs.cp_handle, ancs.ds_handle)));
+  if (ancs.state >= ANCS_STATE_START_SUBSCRIPTIONS && start <= hi &&
+      end >= lo) {
+    rediscover(conn);
+  }
+  return BT_GATT_ITER_CONTINUE;
+}
+
+static void sc_subscription_cb(struct bt_conn *conn, uint8_t err,
+                               struct bt_gatt_subscribe_params *params) {
+  if (err) {
+    LOG_WRN("Service Changed subscription failed (err %d)", err);
+    if (ancs.cached) {
+      cache_delete(conn);  // Discovered again on the next connection
+      return;
+    }
+    ancs.sc_handle = 0;
+    ancs.sc_ccc = 0;
+  } else {
+    ancs.sc_ccc = params->ccc_handle;
+  }
+
+  if (!ancs.cached) {
+    cache_save(conn);
+  }
+}
+
+static void subscribe_to_sc(struct bt_conn *conn) {
+  ancs.sc_sub_params.subscribe = sc_subscription_cb;
+  ancs.sc_sub_params.notify = service_changed_cb;
+  ancs.sc_sub_params.value = BT_GATT_CCC_INDICATE;
+  ancs.sc_sub_params.value_handle = ancs.sc_handle;
+  ancs.sc_sub_params.ccc_handle = ancs.sc_ccc;  // 0 to auto-discover
+#if defined(CONFIG_BT_GATT_AUTO_DISCOVER_CCC)
+  ancs.sc_sub_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+  ancs.sc_sub_params.disc_params = &ancs.discover_params;
+#endif
+  atomic_set_bit(ancs.sc_sub_params.flags, BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
+
+  int err = bt_gatt_subscribe(conn, &ancs.sc_sub_params);
+  if (err) {
+    sc_subscription_cb(conn, err, &ancs.sc_sub_params);
+  }
+}
+
+static uint8_t sc_discover_func(struct bt_conn *conn,
+                                const struct bt_gatt_attr *attr,
+                                struct bt_gatt_discover_params *params) {
+  if (attr) {
+    struct bt_gatt_chrc *chrc = (struct bt_gatt_chrc *)attr->user_data;
+
+    ancs.sc_handle = chrc->value_handle;
+    subscribe_to_sc(conn);
+  } else {
+    LOG_INF("No Service Changed characteristic, caching ANCS handles anyway");
+    cache_save(conn);
+  }
+  return BT_GATT_ITER_STOP;
+}
+
+/* Subscriptions done: time it, then watch for Service Changed and cache the
+ * discovered handles */
+static void ancs_enabled(struct bt_conn *conn) {
+  ancs.state = ANCS_STATE_ENABLED;
+  conn_stats.last_enable_ms = k_uptime_get_32() - conn_stats.connected_at;
+  conn_stats.last_cached = ancs.cached;
+  LOG_INF("ANCS enabled %u ms after connecting, %s handles",
+          conn_stats.last_enable_ms, ancs.cached ? "cached" : "discovered");
+  k_work_submit_to_queue(&ancs_work_q, &cp.work);
+
+  if (ancs.sc_sub_params.value_handle != 0) {
+    // Already watched: rediscovered after a Service Changed
+    cache_save(conn);
+  } else if (ancs.sc_handle != 0) {
+    subscribe_to_sc(conn);
+  } else if (!ancs.cached) {
+    ancs.discover_params.uuid = BT_UUID_GATT_SC;
+    ancs.discover_params.func = sc_discover_func;
+    ancs.discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    ancs.discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    ancs.discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+    if (bt_gatt_discover(conn, &ancs.discover_params) != 0) {
+      cache_save(conn);
+    }
+  }
+}
+
 static void subsciption_cb(struct bt_conn *conn, uint8_t err,
                            struct bt_gatt_subscribe_params *params) {
   if (ancs.state == ANCS_STATE_SUBSCRIBING_NS ||
@@ -337,17 +1148,21 @@ static void subsciption_cb(struct bt_conn *conn, uint8_t err,
     if (err) {
       LOG_ERR("%s subscription failed (err %d)",
               params->value_handle == ancs.ns_handle ? "NS" : "DS", err);
-      ancs_reset_state();
+      if (ancs.cached) {
+        // The phone may have changed its handles while disconnected
+        rediscover(conn);
+      } else {
+        ancs_reset_state();
+      }
     } else {
       LOG_INF("%s subscription successful",
               params->value_handle == ancs.ns_handle ? "NS" : "DS");
       if (params->value_handle == ancs.ds_handle) {
+        ancs.ds_ccc = params->ccc_handle;
         subscribe_to_ns(conn);
       } else {
-        ancs.state = ANCS_STATE_ENABLED;
-        if (k_msgq_num_used_get(&notification_q) > 0) {
-          k_work_submit_to_queue(&ancs_work_q, &req_notif_info_work);
-        }
+        ancs.ns_ccc = params->ccc_handle;
+        ancs_enabled(conn);
       }
     }
   }
@@ -359,7 +1174,7 @@ static int subscribe_to_ns(struct bt_conn *conn) {
   ancs.ns_sub_params.notify = notif_source_notify_cb;
   ancs.ns_sub_params.value = BT_GATT_CCC_NOTIFY;
   ancs.ns_sub_params.value_handle = ancs.ns_handle;
-  ancs.ns_sub_params.ccc_handle = 0;  // Auto-discover CCC
+  ancs.ns_sub_params.ccc_handle = ancs.ns_ccc;  // 0 to auto-discover
 #if defined(CONFIG_BT_GATT_AUTO_DISCOVER_CCC)
   ancs.ns_sub_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
   ancs.ns_sub_params.disc_params = &ancs.discover_params;
@@ -380,7 +1195,7 @@ static int subscribe_to_ds(struct bt_conn *conn) {
   ancs.ds_sub_params.notify = data_source_notify_cb;
   ancs.ds_sub_params.value = BT_GATT_CCC_NOTIFY;
   ancs.ds_sub_params.value_handle = ancs.ds_handle;
-  ancs.ds_sub_params.ccc_handle = 0;  // Auto-discover CCC
+  ancs.ds_sub_params.ccc_handle = ancs.ds_ccc;  // 0 to auto-discover
 #if defined(CONFIG_BT_GATT_AUTO_DISCOVER_CCC)
   ancs.ds_sub_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
   ancs.ds_sub_params.disc_params = &ancs.discover_params;
@@ -405,199 +1220,117 @@ static void discovery_work_handler(struct k_work *work) {
 
 /*** Attribute Parsing Logic ***/
 
-static void process_notification_attributes(const uint8_t *data,
-                                            uint16_t length) {
-  // Append new data to our buffer
-  if (ancs.ds_buffer_len + length > DATA_SOURCE_BUFFER_SIZE) {
-    LOG_ERR(
-        "Data source buffer overflow. Data length: %d, buffer length: %d, "
-        "dropping data",
-        length, ancs.ds_buffer_len);
-    ancs.ds_buffer_len = 0;  // Reset buffer to prevent corruption
-    return;
-  }
-  memcpy(&ancs.ds_buffer[ancs.ds_buffer_len], data, length);
-  ancs.ds_buffer_len += length;
-
-  uint8_t *buf = ancs.ds_buffer;
-  size_t remaining_len = ancs.ds_buffer_len;
-
-  // Start of a new notification attribute response
-  if (ancs.current_notif_idx == -1) {
-    if (remaining_len < 5) {
-      return;  // Need at least CommandID + UID
+static struct ancs_notification *parser_begin(uint32_t uid, uint8_t *num_attr,
+                                              void *user_data) {
+  ARG_UNUSED(user_data);
+  struct ancs_notification_source src;
+  struct cp_cmd *req = NULL;
+
+  // Responses come in request order: the oldest request for the UID
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  for (int i = 0; i < CP_QUEUE_SIZE; i++) {
+    struct cp_cmd *c = &cp.cmds[i];
+
+    if ((c->state == CP_WRITING || c->state == CP_WAITING) &&
+        c->command == COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES &&
+        c->source.notification_uid == uid &&
+        (req == NULL || (int32_t)(c->seq - req->seq) < 0)) {
+      req = c;
     }
+  }
+  if (req != NULL) {
+    src = req->source;
+    ancs.parsing_seq = req->seq;
+    *num_attr = __builtin_popcount(fetch_attrs[req->arg]);
+  } else {
+    *num_attr = expired_take(uid);
+    cp_stats.late += *num_attr > 0;
+  }
+  k_spin_unlock(&cp.lock, key);
 
-    if (buf[0] != COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES) {
-      LOG_WRN("Unexpected Command ID: %d", buf[0]);
-      goto parse_done;
+  if (req == NULL) {
+    if (*num_attr > 0) {
+      LOG_WRN("Late attributes for UID 0x%x skipped", uid);
+    } else {
+      LOG_WRN("Attributes for unknown UID 0x%x received", uid);
     }
+    return NULL;
+  }
+  memset(&ancs.notif, 0, sizeof(ancs.notif));
+  ancs.notif.source = src;
+  return &ancs.notif;
+}
 
-    uint32_t uid = sys_get_le32(&buf[1]);
-    k_mutex_lock(&ancs_pool_mutex, K_FOREVER);
-    ancs.current_notif_idx = find_pool_slot_by_uid(uid);
-    k_mutex_unlock(&ancs_pool_mutex);
-
-    if (ancs.current_notif_idx < 0) {
-      LOG_WRN("Attributes for unknown UID 0x%x received", uid);
-      goto parse_done;
-    }
-
-    buf += 5;
-    remaining_len -= 5;
-    ancs.remain_num_attr = ancs.num_attr_requested;
-  }
-
-  // Process attributes in a loop (TLV format)
-  while (ancs.remain_num_attr > 0 && remaining_len >= 3) {
-    uint8_t attr_id = buf[0];
-    uint16_t attr_len = sys_get_le16(&buf[1]);
-
-    if (remaining_len < (size_t)3 + attr_len) {
-      break;  // Not enough data for this attribute, wait for more
-    }
-
-    char *target_str = NULL;
-    size_t max_len = 0;
-    struct ancs_notification *notif = &ancs.notif_pool[ancs.current_notif_idx];
-
-    switch (attr_id) {
-      case ATTR_ID_APP_IDENTIFIER:
-        target_str = notif->app_identifier;
-        max_len = sizeof(notif->app_identifier) - 1;
-        break;
-      case ATTR_ID_TITLE:
-        target_str = notif->title;
-        max_len = sizeof(notif->title) - 1;
-        break;
-      case ATTR_ID_SUBTITLE:
-        target_str = notif->subtitle;
-        max_len = sizeof(notif->subtitle) - 1;
-        break;
-      case ATTR_ID_MESSAGE:
-        target_str = notif->message;
-        max_len = sizeof(notif->message) - 1;
-        break;
-      case ATTR_ID_DATE:
-        target_str = notif->date;
-        max_len = sizeof(notif->date) - 1;
-        break;
-      case ATTR_ID_POSITIVE_ACTION_LABEL:
-        target_str = notif->positive_action_label;
-        max_len = sizeof(notif->positive_action_label) - 1;
-        break;
-      case ATTR_ID_NEGATIVE_ACTION_LABEL:
-        target_str = notif->negative_action_label;
-        max_len = sizeof(notif->negative_action_label) - 1;
-        break;
-    }
-
-    if (target_str) {
-      size_t copy_len = MIN(attr_len, max_len);
-      memcpy(target_str, &buf[3], copy_len);
-      target_str[copy_len] = '\0';
-    }
-
-    buf += 3 + attr_len;
-    remaining_len -= (3 + attr_len);
-    ancs.remain_num_attr--;
-  }
-
-  if (ancs.remain_num_attr == 0) {
-    LOG_DBG(
-        "Notification parsed: UID=0x%x, AppID = %s, Title=%s, SubTitle=%s, "
-        "Message=%s, "
-        "Date=%s, Positive=%s, Negative=%s",
-        ancs.notif_pool[ancs.current_notif_idx].source.notification_uid,
-        ancs.notif_pool[ancs.current_notif_idx].app_identifier,
-        ancs.notif_pool[ancs.current_notif_idx].title,
-        ancs.notif_pool[ancs.current_notif_idx].subtitle,
-        ancs.notif_pool[ancs.current_notif_idx].message,
-        ancs.notif_pool[ancs.current_notif_idx].date,
-        ancs.notif_pool[ancs.current_notif_idx].positive_action_label,
-        ancs.notif_pool[ancs.current_notif_idx].negative_action_label);
-
-    if (ancs.app_cb && ancs.app_cb->on_new_notification) {
-      ancs.app_cb->on_new_notification(
-          &ancs.notif_pool[ancs.current_notif_idx]);
-    }
-    goto parse_done;
-  }
-
-  // Shift remaining partial data to the start of the buffer
-  if (remaining_len > 0 && remaining_len < ancs.ds_buffer_len) {
-    memmove(ancs.ds_buffer, buf, remaining_len);
-  }
-  ancs.ds_buffer_len = remaining_len;
-  return;
-
-parse_done:
-  // Reset parser state for the next notification
-  k_mutex_lock(&ancs_pool_mutex, K_FOREVER);
-  if (ancs.current_notif_idx >= 0) {
-    ancs.pool_in_use[ancs.current_notif_idx] = false;
-    memset(&ancs.notif_pool[ancs.current_notif_idx], 0,
-           sizeof(struct ancs_notification));
-  }
-  k_mutex_unlock(&ancs_pool_mutex);
-
-  ancs.current_notif_idx = -1;
-  ancs.ds_buffer_len = 0;
-}
-
-static void bt_ancs_cp_write_callback(struct bt_conn *conn, uint8_t err,
-                                      struct bt_gatt_write_params *params) {
-  LOG_ERR_OR_DBG(err, "Control Point write %s, %d",
-                 err ? "failed" : "successful", err);
-  k_sem_give(&ancs_data_sem);
-}
-
-/*** Work Handler for Requesting Attributes ***/
-
-static void req_notif_info_work_handler(struct k_work *work) {
-  uint32_t uid;
-  LOG_DBG("Requesting notification attributes");
-  while (k_msgq_get(&notification_q, &uid, K_NO_WAIT) == 0) {
-    LOG_DBG("Requesting attributes for UID 0x%x", uid);
-    uint8_t request[18];
-    request[0] = COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES;
-    sys_put_le32(uid, &request[1]);
-    request[5] = ATTR_ID_APP_IDENTIFIER;
-    request[6] = ATTR_ID_TITLE;
-    sys_put_le16(CONFIG_ANCS_TITLE_MAX_LEN, &request[7]);  // Max len for title
-    request[9] = ATTR_ID_SUBTITLE;
-    sys_put_le16(CONFIG_ANCS_SUBTITLE_MAX_LEN,
-                 &request[10]);  // Max len for subtitle
-    request[12] = ATTR_ID_MESSAGE;
-    sys_put_le16(CONFIG_ANCS_MESSAGE_MAX_LEN,
-                 &request[13]);  // Max len for message
-    request[15] = ATTR_ID_DATE;
-    request[16] = ATTR_ID_POSITIVE_ACTION_LABEL;
-    request[17] = ATTR_ID_NEGATIVE_ACTION_LABEL;
-
-    ancs.num_attr_requested = 7;
-
-    static struct bt_gatt_write_params write_params = {0};
-
-    write_params.func = bt_ancs_cp_write_callback;
-    write_params.handle = ancs.cp_handle;
-    write_params.offset = 0;
-    write_params.data = request;
-    write_params.length = sizeof(request);
-
-    int err = bt_gatt_write(ancs.conn, &write_params);
-    if (err) {
-      LOG_ERR("Failed to request attributes for UID 0x%x (err %d)", uid, err);
-    } else {
-      LOG_DBG("Requested attributes for UID 0x%x", uid);
+static void parser_done(struct ancs_notification *notif, void *user_data) {
+  ARG_UNUSED(user_data);
+
+  LOG_DBG(
+      "Notification parsed: UID=0x%x, AppID = %s, Title=%s, SubTitle=%s, "
+      "Message=%s, Date=%s, Positive=%s, Negative=%s",
+      notif->source.notification_uid, notif->app_identifier, notif->title,
+      notif->subtitle, notif->message, notif->date,
+      notif->positive_action_label, notif->negative_action_label);
+
+  // The request may have timed out meanwhile, and its entry been reused
+  int fetch = -1;
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  for (int i = 0; i < CP_QUEUE_SIZE; i++) {
+    struct cp_cmd *c = &cp.cmds[i];
+
+    if ((c->state == CP_WRITING || c->state == CP_WAITING) &&
+        c->seq == ancs.parsing_seq) {
+      fetch = c->arg;
+      cp_stats.responses++;
+      cp_stats.burst_responses++;
+      cp_stats.latency_cycles += k_cycle_get_32() - c->queued;
+      cp_free(c);
+      break;
     }
-    // Waiting for the write to complete
-    if (k_sem_take(&ancs_data_sem, K_MSEC(1000)) == 0) {
-      LOG_DBG("Control point write done. Continue for the next notif");
-    } else {
-      LOG_ERR("Control point write timeout");
+  }
+  k_spin_unlock(&cp.lock, key);
+
+  if (fetch == FETCH_APP && ancs.app_cb->filter) {
+    ancs_filter_t filter =
+        ancs.app_cb->filter(&notif->source, notif->app_identifier);
+
+    if (filter == ANCS_FILTER_DROP) {
+      LOG_DBG("UID 0x%x from %s filtered out", notif->source.notification_uid,
+              notif->app_identifier);
+      cp_stats.filtered_app++;
+      fetch = -1;
+    } else if (filter == ANCS_FILTER_FULL) {
+      // Fetches the app identifier and title again, so the notification
+      // comes whole from one response; the summary is kept if it can't
+      if (cp_submit(COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES, &notif->source,
+                    FETCH_FULL) == 0) {
+        fetch = -1;
+      }
     }
   }
+
+  if (fetch >= 0 && ancs.app_cb && ancs.app_cb->on_new_notification) {
+    ancs.app_cb->on_new_notification(notif);
+  }
+
+  k_work_submit_to_queue(&ancs_work_q, &cp.work);
+}
+
+static const struct ancs_parser_cb parser_cb = {
+    .begin = parser_begin,
+    .done = parser_done,
+};
+
+static void process_notification_attributes(const uint8_t *data,
+                                            uint16_t length) {
+  // Each fragment is parsed as it comes, nothing is buffered
+  uint32_t start = k_cycle_get_32();
+  ancs_parser_feed(&ancs.parser, data, length);
+  uint32_t cycles = k_cycle_get_32() - start;
+
+  ds_stats.fragments++;
+  ds_stats.bytes += length;
+  ds_stats.cycles += cycles;
+  ds_stats.max_cycles = MAX(ds_stats.max_cycles, cycles);
 }
 
 /*** Public API and Connection Management ***/
@@ -607,28 +1340,22 @@ int ancs_perform_action(uint32_t notification_uid, ancs_action_id_t action) {
     return -EPERM;
   }
 
-  uint8_t request[6] = {
-      [0] = COMMAND_ID_PERFORM_NOTIFICATION_ACTION,
-      // UID will be placed at [1]
-      [5] = action,
-  };
-  sys_put_le32(notification_uid, &request[1]);
-
-  static struct bt_gatt_write_params write_params = {0};
+  struct ancs_notification_source src = {.notification_uid = notification_uid};
 
-  write_params.func = bt_ancs_cp_write_callback;
-  write_params.handle = ancs.cp_handle;
-  write_params.offset = 0;
-  write_params.data = request;
-  write_params.length = sizeof(request);
+  return cp_submit(COMMAND_ID_PERFORM_NOTIFICATION_ACTION, &src, action);
+}
 
-  // Take semaphore to block other writes.
-  k_sem_take(&ancs_data_sem, K_MSEC(1000));
-  if (ancs.conn == NULL) {
+int ancs_fetch_details(uint32_t notification_uid) {
+  if (ancs.state != ANCS_STATE_ENABLED) {
     return -EPERM;
   }
 
-  return bt_gatt_write(ancs.conn, &write_params);
+  // The response only completes the stored notification, the source is kept
+  struct ancs_notification_source src = {.notification_uid = notification_uid,
+                                         .timestamp = k_cycle_get_32()};
+
+  return cp_submit(COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES, &src,
+                   FETCH_DETAILS);
 }
 
 static void ancs_reset_state(void) {
@@ -638,20 +1365,11 @@ static void ancs_reset_state(void) {
   ancs.ns_handle = 0;
   ancs.cp_handle = 0;
   ancs.ds_handle = 0;
-  ancs.ds_buffer_len = 0;
-  ancs.current_notif_idx = -1;
-
-  k_mutex_lock(&ancs_pool_mutex, K_FOREVER);
-  for (int i = 0; i < NOTIFICATION_POOL_SIZE; i++) {
-    ancs.pool_in_use[i] = false;
-  }
-  k_mutex_unlock(&ancs_pool_mutex);
-
-  k_msgq_purge(&notification_q);
-  // Clear the ancs_data_sem if any
-  if (k_sem_count_get(&ancs_data_sem) == 1) {
-    k_sem_take(&ancs_data_sem, K_NO_WAIT);
-  }
+  ancs.ns_ccc = 0;
+  ancs.ds_ccc = 0;
+  ancs.cached = false;
+  ancs_parser_reset(&ancs.parser);
+  cp_reset();
 }
 
 static const struct bt_data ad[] = {
@@ -670,6 +1388,21 @@ static struct bt_gatt_cb gatt_callbacks = {
     .att_mtu_updated = mtu_updated,
 };
 
+#if defined(CONFIG_BT_SMP)
+static void bond_deleted(uint8_t id, const bt_addr_le_t *peer) {
+  char key[32];
+
+  if (IS_ENABLED(CONFIG_SETTINGS)) {
+    cache_key(id, peer, key, sizeof(key));
+    settings_delete(key);
+  }
+}
+
+static struct bt_conn_auth_info_cb auth_info_callbacks = {
+    .bond_deleted = bond_deleted,
+};
+#endif
+
 int ancs_client_init(void) {
   if (IS_ENABLED(CONFIG_SETTINGS)) {
     settings_load();
@@ -694,9 +1427,13 @@ int ancs_client_init(void) {
 
   LOG_INF("Initializing ANCS Client");
   if (ancs.is_init == false) {
-    ancs.current_notif_idx = -1;  // Initialize parser state
-    k_work_init(&req_notif_info_work, req_notif_info_work_handler);
+    ancs_parser_init(&ancs.parser, &parser_cb, NULL);
+    k_work_init(&cp.work, cp_work_handler);
+    k_work_init_delayable(&cp.timeout_work, cp_timeout_handler);
     k_work_init_delayable(&discovery_work, discovery_work_handler);
+#if defined(CONFIG_BT_SMP)
+    bt_conn_auth_info_cb_register(&auth_info_callbacks);
+#endif
 
     k_work_queue_init(&ancs_work_q);
     k_work_queue_start(&ancs_work_q, ancs_stack,
@@ -735,6 +1472,28 @@ static void connected(struct bt_conn *conn, uint8_t err) {
   LOG_INF("Connected");
   ancs_reset_state();
   ancs.conn = conn;
+  ancs.sc_handle = 0;
+  ancs.sc_ccc = 0;
+  memset(&ancs.sc_sub_params, 0, sizeof(ancs.sc_sub_params));
+  conn_stats.connected_at = k_uptime_get_32();
+
+  // A bonded phone seen before: subscribe as soon as the link is encrypted
+  if (cache_load(conn) == 0) {
+    LOG_INF("Using cached ANCS handles");
+    conn_stats.cache_hits++;
+    ancs.state = ANCS_STATE_START_SUBSCRIPTIONS;
+
+    int ret = bt_conn_set_security(conn, BT_SECURITY_L2);
+    if (ret == 0) {
+      if (bt_conn_get_security(conn) >= BT_SECURITY_L2) {
+        subscribe_to_ds(conn);
+      }
+      return;
+    }
+    LOG_ERR("Failed to set security (err %d)", ret);
+    ancs_reset_state();
+    ancs.conn = conn;
+  }
 
   /* Workaround for the error of Android. If we call discovery immediately after
    * connection, it will halt by no response for updating connection param */
@@ -761,4 +1520,177 @@ int ancs_register_cb(const struct ancs_callbacks *cb) {
   return 0;
 }
 
+#if defined(CONFIG_SHELL)
+static int cmd_ancs_stats(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  uint32_t us = (uint32_t)k_cyc_to_us_floor64(ds_stats.cycles);
+  uint32_t responses = ancs.parser.responses;
+
+  shell_print(sh, "fragments: %u, %u bytes", ds_stats.fragments,
+              ds_stats.bytes);
+  shell_print(sh, "responses: %u, %u values truncated, %u errors, %u unsized",
+              responses, ancs.parser.truncated, ancs.parser.errors,
+              ancs.parser.skipped);
+  shell_print(sh, "parse time: %u us, %u us per response, %u us max fragment",
+              us, responses ? us / responses : 0,
+              k_cyc_to_us_floor32(ds_stats.max_cycles));
+
+  uint32_t latency_ms =
+      (uint32_t)k_cyc_to_ms_floor64(cp_stats.latency_cycles);
+  uint32_t burst_ms = cp_stats.last_burst_us / 1000;
+
+  shell_print(sh, "control point: %u queued, %u merged, %u dropped",
+              cp_stats.queued, cp_stats.merged, cp_stats.dropped);
+  shell_print(sh, "  %u written (%u max in flight), %u retried, %u failed",
+              cp_stats.written, cp_stats.max_in_flight, cp_stats.busy,
+              cp_stats.failed);
+  shell_print(sh, "  %u actions, %u responses, %u timeouts (%u answered late)",
+              cp_stats.actions, cp_stats.responses, cp_stats.timeouts,
+              cp_stats.late);
+  shell_print(sh, "fetches: %u app, %u summary, %u full, %u details",
+              cp_stats.fetches[FETCH_APP], cp_stats.fetches[FETCH_SUMMARY],
+              cp_stats.fetches[FETCH_FULL], cp_stats.fetches[FETCH_DETAILS]);
+  shell_print(sh, "  %u filtered on event, %u on app identifier",
+              cp_stats.filtered, cp_stats.filtered_app);
+
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  uint32_t depth = backlog.count;
+  k_spin_unlock(&cp.lock, key);
+
+  shell_print(sh, "backlog: %u/%u (max %u), %u deferred, %u fetched", depth,
+              CONFIG_ANCS_BACKLOG_SIZE, backlog_stats.max_depth,
+              backlog_stats.deferred, backlog_stats.fetched);
+  shell_print(sh, "  %u removed before fetch, %u dropped",
+              backlog_stats.removed, backlog_stats.dropped);
+  shell_print(sh, "  %u ms from event to attributes",
+              cp_stats.responses ? latency_ms / cp_stats.responses : 0);
+  shell_print(sh, "connection: enabled in %u ms with %s handles",
+              conn_stats.last_enable_ms,
+              conn_stats.last_cached ? "cached" : "discovered");
+  shell_print(sh, "  %u from cache, %u discoveries, %u invalidated",
+              conn_stats.cache_hits, conn_stats.discoveries,
+              conn_stats.invalidated);
+  shell_print(sh, "last burst: %u notifications in %u ms, %u.%u per second",
+              cp_stats.last_burst_responses, burst_ms,
+              burst_ms ? cp_stats.last_burst_responses * 1000 / burst_ms : 0,
+              burst_ms ? cp_stats.last_burst_responses * 10000 / burst_ms % 10
+                       : 0);
+  return 0;
+}
+
+static int cmd_ancs_reset(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  ds_stats.fragments = 0;
+  ds_stats.bytes = 0;
+  ds_stats.cycles = 0;
+  ds_stats.max_cycles = 0;
+  ancs.parser.responses = 0;
+  ancs.parser.truncated = 0;
+  ancs.parser.errors = 0;
+  ancs.parser.skipped = 0;
+
+  k_spinlock_key_t key = k_spin_lock(&cp.lock);
+  uint32_t burst_start = cp_stats.burst_start;
+  uint32_t burst_responses = cp_stats.burst_responses;
+  memset(&cp_stats, 0, sizeof(cp_stats));
+  memset(&backlog_stats, 0, sizeof(backlog_stats));
+  // Keep counting a burst in progress
+  cp_stats.burst_start = burst_start;
+  cp_stats.burst_responses = burst_responses;
+  k_spin_unlock(&cp.lock, key);
+  shell_print(sh, "ANCS counters reset");
+  return 0;
+}
+
+static struct ancs_notification bench_notif;
+
+static struct ancs_notification *bench_begin(uint32_t uid, uint8_t *num_attr,
+                                             void *user_data) {
+  ARG_UNUSED(uid);
+  ARG_UNUSED(user_data);
+  *num_attr = 7;
+  return &bench_notif;
+}
+
+static void bench_done(struct ancs_notification *notif, void *user_data) {
+  ARG_UNUSED(notif);
+  (*(uint32_t *)user_data)++;
+}
+
+static size_t bench_attr(uint8_t *buf, uint8_t id, const char *value) {
+  size_t len = strlen(value);
+
+  buf[0] = id;
+  sys_put_le16(len, &buf[1]);
+  memcpy(&buf[3], value, len);
+  return 3 + len;
+}
+
+/* Parse a made up 7 attribute response cut in fragments of the given size */
+static int cmd_ancs_bench(const struct shell *sh, size_t argc, char **argv) {
+  static const struct ancs_parser_cb bench_cb = {
+      .begin = bench_begin,
+      .done = bench_done,
+  };
+  static uint8_t rsp[512];
+  int count = argc > 1 ? atoi(argv[1]) : 100;
+  int frag = argc > 2 ? atoi(argv[2]) : 20;  // Default ATT MTU 23, minus 3
+  struct ancs_parser parser;
+  uint32_t done = 0;
+  size_t len = 0;
+
+  if (count <= 0 || frag <= 0) {
+    shell_error(sh, "Usage: ancs bench [count] [fragment size]");
+    return -EINVAL;
+  }
+
+  rsp[len++] = COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES;
+  sys_put_le32(0x1234, &rsp[len]);
+  len += 4;
+  len += bench_attr(&rsp[len], ANCS_ATTR_ID_APP_IDENTIFIER,
+                    "com.apple.MobileSMS");
+  len += bench_attr(&rsp[len], ANCS_ATTR_ID_TITLE, "Nguyễn Văn A");
+  len += bench_attr(&rsp[len], ANCS_ATTR_ID_SUBTITLE, "");
+  len += bench_attr(&rsp[len], ANCS_ATTR_ID_MESSAGE,
+                    "Tối nay mình đi ăn phở nhé, 7 giờ ở quán cũ. Nhớ mang "
+                    "theo ô vì trời có thể mưa. Tối nay mình đi ăn phở nhé, 7 "
+                    "giờ ở quán cũ. Nhớ mang theo ô vì trời có thể mưa. Tối "
+                    "nay mình đi ăn phở nhé, 7 giờ ở quán cũ.");
+  len += bench_attr(&rsp[len], ANCS_ATTR_ID_DATE, "20261016T101010");
+  len += bench_attr(&rsp[len], ANCS_ATTR_ID_POSITIVE_ACTION_LABEL, "Reply");
+  len += bench_attr(&rsp[len], ANCS_ATTR_ID_NEGATIVE_ACTION_LABEL, "Clear");
+
+  ancs_parser_init(&parser, &bench_cb, &done);
+
+  uint32_t start = k_cycle_get_32();
+  for (int i = 0; i < count; i++) {
+    for (size_t ofs = 0; ofs < len; ofs += frag) {
+      ancs_parser_feed(&parser, &rsp[ofs], MIN((size_t)frag, len - ofs));
+    }
+  }
+  uint32_t cycles = k_cycle_get_32() - start;
+
+  shell_print(sh, "%u/%d responses of %zu bytes in %d byte fragments", done,
+              count, len, frag);
+  shell_print(sh, "%u ns per response, message kept %zu bytes",
+              (uint32_t)(k_cyc_to_ns_floor64(cycles) / count),
+              strlen(bench_notif.message));
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    ancs_cmds,
+    SHELL_CMD(stats, NULL, "Show Data Source parse counters", cmd_ancs_stats),
+    SHELL_CMD(reset, NULL, "Reset Data Source parse counters", cmd_ancs_reset),
+    SHELL_CMD_ARG(bench, NULL, "Time the Data Source parser [count] [frag]",
+                  cmd_ancs_bench, 1, 2),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(ancs, &ancs_cmds, "ANCS client commands", NULL);
+#endif
+
 // SYS_INIT(ancs_client_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
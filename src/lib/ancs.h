@@ -54,6 +54,27 @@ typedef enum {
     ANCS_ACTION_ID_NEGATIVE = 1,
 } ancs_action_id_t;
 
+typedef enum {
+    ANCS_ATTR_ID_APP_IDENTIFIER = 0,
+    ANCS_ATTR_ID_TITLE = 1,
+    ANCS_ATTR_ID_SUBTITLE = 2,
+    ANCS_ATTR_ID_MESSAGE = 3,
+    ANCS_ATTR_ID_MESSAGE_SIZE = 4,
+    ANCS_ATTR_ID_DATE = 5,
+    ANCS_ATTR_ID_POSITIVE_ACTION_LABEL = 6,
+    ANCS_ATTR_ID_NEGATIVE_ACTION_LABEL = 7,
+} ancs_attribute_id_t;
+
+/**
+ * @brief What to fetch of a notification, decided by the filter callback.
+ */
+typedef enum {
+    ANCS_FILTER_DROP,     /**< Fetch and report nothing */
+    ANCS_FILTER_SUMMARY,  /**< App identifier and title, reported as silent */
+    ANCS_FILTER_FULL,     /**< All attributes */
+    ANCS_FILTER_NEED_APP, /**< Decide once the app identifier is known */
+} ancs_filter_t;
+
 /**
  * @brief Structure for a parsed ANCS notification source event.
  */
@@ -63,6 +84,7 @@ struct ancs_notification_source {
     ancs_category_id_t category_id;
     uint8_t category_count;
     uint32_t notification_uid;
+    uint32_t timestamp; /**< k_cycle_get_32() when the event was received */
 };
 
 /**
@@ -73,6 +95,7 @@ struct ancs_notification_source {
  */
 struct ancs_notification {
     struct ancs_notification_source source;
+    uint8_t attr_mask; /**< BIT(ancs_attribute_id_t) of the attributes received */
     char app_identifier[CONFIG_ANCS_APP_ID_MAX_LEN + 1];
     char title[CONFIG_ANCS_TITLE_MAX_LEN + 1];
     char subtitle[CONFIG_ANCS_SUBTITLE_MAX_LEN + 1];
@@ -89,7 +112,11 @@ struct ancs_notification {
  */
 struct ancs_callbacks {
     /**
-     * @brief Called when a new or updated notification with all its attributes is ready.
+     * @brief Called when a new or updated notification is ready.
+     *
+     * Only the attributes in notif->attr_mask were fetched, as decided by the
+     * filter callback or asked with ancs_fetch_details(); the others are empty.
+     *
      * @param notif Pointer to the notification structure. This pointer is valid only
      * within the scope of this callback.
      */
@@ -100,6 +127,20 @@ struct ancs_callbacks {
      * @param notification_uid The UID of the removed notification.
      */
     void (*on_notification_removed)(uint32_t notification_uid);
+
+    /**
+     * @brief Decide what to fetch of a notification.
+     *
+     * Called first with the Notification Source event alone, then, if that
+     * returned ANCS_FILTER_NEED_APP, with the app identifier once it and the
+     * title are fetched. Without a filter every notification is fetched whole.
+     *
+     * @param src The Notification Source event.
+     * @param app_id The app identifier, or NULL before it is fetched.
+     * @return What to fetch; ANCS_FILTER_NEED_APP once the app identifier is
+     * known is taken as ANCS_FILTER_SUMMARY.
+     */
+    ancs_filter_t (*filter)(const struct ancs_notification_source *src, const char *app_id);
 };
 
 /**
@@ -125,10 +166,26 @@ int ancs_register_cb(const struct ancs_callbacks *cb);
 /**
  * @brief Perform an action on a notification.
  *
+ * The action is queued with the attribute requests and written to the
+ * Control Point by the ANCS work queue; the call doesn't block.
+ *
  * @param notification_uid The UID of the notification to act upon.
  * @param action The action to perform (Positive or Negative).
- * @return 0 on success, or a negative error code on failure.
+ * @return 0 once queued, -EPERM if ANCS is not enabled, -ENOMEM if the
+ * command queue is full.
  */
 int ancs_perform_action(uint32_t notification_uid, ancs_action_id_t action);
 
+/**
+ * @brief Fetch the attributes of a notification left out by the filter.
+ *
+ * Asks for the subtitle, message, date and action labels; they are reported
+ * through on_new_notification() with only those attributes in attr_mask.
+ *
+ * @param notification_uid The UID of the notification.
+ * @return 0 once queued, -EPERM if ANCS is not enabled, -ENOMEM if the
+ * command queue is full.
+ */
+int ancs_fetch_details(uint32_t notification_uid);
+
 #endif /* ANCS_H_ */
\ No newline at end of file
@@ -0,0 +1,205 @@
+/**
+ * @file ancs_parser.c
+ * @brief Streaming parser of ANCS Data Source responses
+ *
+ * Only the value state consumes more than one byte per step: it copies what
+ * the fragment holds of the value, up to the room left in the buffer, and
+ * skips the rest. The value is NUL-terminated, after dropping a partial
+ * UTF-8 sequence at its end, once its last byte went by.
+ *
+ * A response nobody requested has no known attribute count. Its command
+ * byte and attribute ids are both 0 for the app identifier, so it can't be
+ * read as a series of responses: its attributes are stepped over by their
+ * lengths instead, until a fragment ends on an attribute boundary.
+ */
+
+#include "ancs_parser.h"
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+#define COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES 0
+
+enum {
+  P_COMMAND,
+  P_UID,
+  P_ATTR_ID,
+  P_LEN_LO,
+  P_LEN_HI,
+  P_VALUE,
+  P_DISCARD, /* rest of a fragment with an unexpected command */
+};
+
+#define FIELD(f) {offsetof(struct ancs_notification, f), SIZEOF_FIELD(struct ancs_notification, f)}
+
+/* Buffers by attribute id, message size is skipped */
+static const struct {
+  uint16_t offset;
+  uint16_t size;
+} attr_fields[] = {
+    [ANCS_ATTR_ID_APP_IDENTIFIER] = FIELD(app_identifier),
+    [ANCS_ATTR_ID_TITLE] = FIELD(title),
+    [ANCS_ATTR_ID_SUBTITLE] = FIELD(subtitle),
+    [ANCS_ATTR_ID_MESSAGE] = FIELD(message),
+    [ANCS_ATTR_ID_DATE] = FIELD(date),
+    [ANCS_ATTR_ID_POSITIVE_ACTION_LABEL] = FIELD(positive_action_label),
+    [ANCS_ATTR_ID_NEGATIVE_ACTION_LABEL] = FIELD(negative_action_label),
+};
+
+size_t ancs_utf8_whole(const char *s, size_t len) {
+  size_t lead = len;
+
+  // At most 3 continuation bytes follow a lead byte
+  while (lead > 0 && len - lead < 3 && ((uint8_t)s[lead - 1] & 0xC0) == 0x80) {
+    lead--;
+  }
+  if (lead == 0) {
+    return len;
+  }
+
+  uint8_t c = s[lead - 1];
+  size_t need = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 1;
+
+  return len - lead + 1 >= need ? len : lead - 1;
+}
+
+void ancs_parser_init(struct ancs_parser *p, const struct ancs_parser_cb *cb, void *user_data) {
+  memset(p, 0, sizeof(*p));
+  p->cb = cb;
+  p->user_data = user_data;
+}
+
+void ancs_parser_reset(struct ancs_parser *p) {
+  p->state = P_COMMAND;
+  p->unsized = false;
+  p->notif = NULL;
+  p->dest = NULL;
+}
+
+static void end_response(struct ancs_parser *p) {
+  if (p->notif != NULL) {
+    p->cb->done(p->notif, p->user_data);
+  }
+  p->responses++;
+  ancs_parser_reset(p);
+}
+
+static void start_value(struct ancs_parser *p) {
+  p->pos = 0;
+  p->cut = false;
+  p->dest = NULL;
+  p->cap = 0;
+
+  if (p->notif != NULL && p->attr_id < ARRAY_SIZE(attr_fields) &&
+      attr_fields[p->attr_id].size > 0) {
+    p->dest = (char *)p->notif + attr_fields[p->attr_id].offset;
+    p->cap = attr_fields[p->attr_id].size - 1;
+  }
+}
+
+static void end_value(struct ancs_parser *p) {
+  if (p->dest != NULL) {
+    p->truncated += p->cut;
+    p->pos = ancs_utf8_whole(p->dest, p->pos);
+    p->dest[p->pos] = '\0';
+    p->notif->attr_mask |= BIT(p->attr_id);
+  }
+
+  if (p->unsized) {
+    p->remain++;
+    p->state = P_ATTR_ID;
+  } else if (--p->remain == 0) {
+    end_response(p);
+  } else {
+    p->state = P_ATTR_ID;
+  }
+}
+
+void ancs_parser_feed(struct ancs_parser *p, const uint8_t *data, size_t len) {
+  size_t i = 0;
+
+  if (p->state == P_DISCARD) {
+    p->state = P_COMMAND;
+  }
+
+  while (i < len) {
+    uint8_t b = data[i];
+
+    switch (p->state) {
+    case P_COMMAND:
+      if (b != COMMAND_ID_GET_NOTIFICATION_ATTRIBUTES) {
+        p->errors++;
+        p->state = P_DISCARD;
+        return;
+      }
+      p->uid = 0;
+      p->uid_len = 0;
+      p->state = P_UID;
+      i++;
+      break;
+
+    case P_UID:
+      p->uid |= (uint32_t)b << (8 * p->uid_len);
+      i++;
+      if (++p->uid_len < 4) {
+        break;
+      }
+      p->remain = 0;
+      p->notif = p->cb->begin(p->uid, &p->remain, p->user_data);
+      if (p->remain == 0) {
+        p->unsized = true;
+        p->skipped++;
+      }
+      p->state = P_ATTR_ID;
+      break;
+
+    case P_ATTR_ID:
+      p->attr_id = b;
+      p->state = P_LEN_LO;
+      i++;
+      break;
+
+    case P_LEN_LO:
+      p->value_left = b;
+      p->state = P_LEN_HI;
+      i++;
+      break;
+
+    case P_LEN_HI:
+      p->value_left |= (uint16_t)b << 8;
+      i++;
+      start_value(p);
+      if (p->value_left == 0) {
+        end_value(p);
+      } else {
+        p->state = P_VALUE;
+      }
+      break;
+
+    case P_VALUE: {
+      size_t n = MIN(len - i, p->value_left);
+      size_t copy = MIN(n, (size_t)(p->cap - p->pos));
+
+      if (copy > 0) {
+        memcpy(&p->dest[p->pos], &data[i], copy);
+        p->pos += copy;
+      }
+      p->cut |= copy < n;
+      p->value_left -= n;
+      i += n;
+      if (p->value_left == 0) {
+        end_value(p);
+      }
+      break;
+    }
+
+    default:
+      return;
+    }
+  }
+
+  // An unsized response is taken to end with the fragment
+  if (p->unsized && p->state == P_ATTR_ID && p->remain > 0) {
+    end_response(p);
+  }
+}
@@ -0,0 +1,97 @@
+/**
+ * @file ancs_parser.h
+ * @brief Streaming parser of ANCS Data Source responses
+ *
+ * A Get Notification Attributes response (command id, UID, then an id,
+ * length and value per attribute) arrives split over GATT notifications.
+ * The parser is a state machine fed each fragment as it comes: header bytes
+ * are decoded one at a time and attribute values are copied straight from
+ * the fragment into the notification's string buffer. Nothing is buffered,
+ * so a response can be any length; a value longer than its buffer is cut
+ * at the last complete UTF-8 character that fits.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ancs.h"
+
+/**
+ * @brief Where the parsed attributes go
+ */
+struct ancs_parser_cb {
+  /**
+   * @brief A response starts
+   *
+   * The response holds no attribute count, only the request says how many
+   * follow. Left at 0, the response is skipped attribute by attribute up to
+   * the end of a fragment, where iOS ends its responses.
+   *
+   * @param num_attr Set to the number of attributes requested, which the
+   *                 response holds whether it is skipped or not
+   * @return The notification to fill, or NULL to skip the response
+   */
+  struct ancs_notification *(*begin)(uint32_t uid, uint8_t *num_attr, void *user_data);
+
+  /**
+   * @brief All the requested attributes of a notification were parsed
+   */
+  void (*done)(struct ancs_notification *notif, void *user_data);
+};
+
+/**
+ * @brief Parser state, one per Data Source
+ */
+struct ancs_parser {
+  const struct ancs_parser_cb *cb;
+  void *user_data;
+  /* Private */
+  uint8_t state;
+  uint8_t remain;   /* attributes left in the response */
+  uint8_t attr_id;
+  uint8_t uid_len;  /* UID bytes read */
+  bool cut;         /* bytes of the current value dropped */
+  bool unsized;     /* no attribute count, remain counts up */
+  uint16_t value_left;
+  uint16_t pos;
+  uint16_t cap;
+  uint32_t uid;
+  char *dest;
+  struct ancs_notification *notif;
+
+  /* Counters */
+  uint32_t responses; /**< Responses parsed, skipped ones included */
+  uint32_t truncated; /**< Values cut to their buffer */
+  uint32_t errors;    /**< Fragments dropped for an unexpected command */
+  uint32_t skipped;   /**< Responses skipped without an attribute count */
+};
+
+/**
+ * @brief Initialize a parser
+ *
+ * @param p Parser
+ * @param cb Callbacks, must stay valid
+ * @param user_data Passed to the callbacks
+ */
+void ancs_parser_init(struct ancs_parser *p, const struct ancs_parser_cb *cb, void *user_data);
+
+/**
+ * @brief Drop a partly parsed response, the next byte starts a new one
+ */
+void ancs_parser_reset(struct ancs_parser *p);
+
+/**
+ * @brief Parse one Data Source fragment
+ *
+ * Calls the callbacks for the responses that start or complete in it. A
+ * fragment starting with an unexpected command is dropped.
+ */
+void ancs_parser_feed(struct ancs_parser *p, const uint8_t *data, size_t len);
+
+/**
+ * @brief Get the length of the longest prefix ending on a whole UTF-8 character
+ */
+size_t ancs_utf8_whole(const char *s, size_t len);
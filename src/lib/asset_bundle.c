@@ -0,0 +1,423 @@
+/**
+ * @file asset_bundle.c
+ * @brief Asset bundle lookup
+ *
+ * The partition is chosen in devicetree (watchy,asset-partition). On the
+ * ESP32 it is mapped into the data address space through the flash MMU, on
+ * native_sim the flash simulator's memory is used directly, so in both cases
+ * LVGL reads pixels and glyphs from the bundle without copies. Only small
+ * descriptors are allocated, once per asset, on its first lookup.
+ */
+
+#include "asset_bundle.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/crc.h>
+
+#if defined(CONFIG_SOC_FAMILY_ESPRESSIF_ESP32)
+#include <spi_flash_mmap.h>
+#elif defined(CONFIG_FLASH_SIMULATOR)
+#include <zephyr/drivers/flash/flash_simulator.h>
+#endif
+
+LOG_MODULE_REGISTER(asset_bundle, LOG_LEVEL_INF);
+
+#define ASSET_NODE DT_CHOSEN(watchy_asset_partition)
+#define ASSET_VERSION 1
+
+/* Font blob header written by pack_assets.py, offsets from the blob start */
+struct asset_font_header {
+  int16_t line_height;
+  int16_t base_line;
+  int16_t underline_position;
+  uint16_t underline_thickness;
+  uint8_t bpp;
+  uint8_t cmap_num;
+  uint16_t reserved;
+  uint32_t glyph_count;
+  uint32_t glyph_dsc;
+  uint32_t bitmap;
+  uint32_t cmaps;
+} __packed;
+
+/* Character map record following the font header */
+struct asset_font_cmap {
+  uint32_t range_start;
+  uint16_t range_length;
+  uint16_t glyph_id_start;
+  uint16_t list_length;
+  uint8_t type;
+  uint8_t reserved;
+  uint32_t unicode_list;      /* 0 if the map type has none */
+  uint32_t glyph_id_ofs_list; /* 0 if the map type has none */
+} __packed;
+
+/* RAM part of a bundled font */
+struct asset_font {
+  lv_font_t font;
+  lv_font_fmt_txt_dsc_t dsc;
+  lv_font_fmt_txt_cmap_t cmaps[];
+};
+
+static struct {
+  const uint8_t *base; /* Mapped bundle, NULL if none */
+  const struct asset_bundle_header *hdr;
+  const struct asset_bundle_entry *index;
+  void **objs; /* Descriptor built for each entry, by index */
+  struct asset_bundle_stats stats;
+} bundle;
+
+static K_MUTEX_DEFINE(bundle_mutex);
+static struct k_spinlock stats_lock;
+
+#if DT_NODE_EXISTS(ASSET_NODE)
+static int map_partition(const uint8_t **base) {
+#if defined(CONFIG_SOC_FAMILY_ESPRESSIF_ESP32)
+  // The MMU maps whole 64 KB pages
+  uint32_t page = DT_REG_ADDR(ASSET_NODE) & ~(SPI_FLASH_MMU_PAGE_SIZE - 1);
+  uint32_t skip = DT_REG_ADDR(ASSET_NODE) - page;
+  spi_flash_mmap_handle_t handle;
+  const void *ptr;
+
+  if (spi_flash_mmap(page, skip + DT_REG_SIZE(ASSET_NODE), SPI_FLASH_MMAP_DATA, &ptr, &handle) !=
+      ESP_OK) {
+    return -EIO;
+  }
+  *base = (const uint8_t *)ptr + skip;
+  return 0;
+#elif defined(CONFIG_FLASH_SIMULATOR)
+  const struct device *flash = DEVICE_DT_GET(DT_MTD_FROM_FIXED_PARTITION(ASSET_NODE));
+  size_t size;
+  uint8_t *mem = flash_simulator_get_memory(flash, &size);
+
+  if (mem == NULL || size < DT_REG_ADDR(ASSET_NODE) + DT_REG_SIZE(ASSET_NODE)) {
+    return -EIO;
+  }
+  *base = mem + DT_REG_ADDR(ASSET_NODE);
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+#else
+static int map_partition(const uint8_t **base) {
+  ARG_UNUSED(base);
+  return -ENODEV;
+}
+#endif
+
+int asset_bundle_init(void) {
+  const uint8_t *base;
+  int ret = map_partition(&base);
+
+  if (ret < 0) {
+    LOG_ERR("Asset partition not mapped (%d)", ret);
+    return ret;
+  }
+
+  const struct asset_bundle_header *hdr = (const struct asset_bundle_header *)base;
+  if (hdr->magic != ASSET_BUNDLE_MAGIC || hdr->version != ASSET_VERSION) {
+    LOG_WRN("No asset bundle in the partition, flash it with the flash_assets target");
+    return -ENOENT;
+  }
+
+#if DT_NODE_EXISTS(ASSET_NODE)
+  size_t index_end = sizeof(*hdr) + hdr->count * sizeof(struct asset_bundle_entry);
+
+  if (hdr->size < index_end || hdr->size > DT_REG_SIZE(ASSET_NODE)) {
+    LOG_ERR("Asset bundle size %u out of range", hdr->size);
+    return -EINVAL;
+  }
+#endif
+
+  uint32_t start = k_cycle_get_32();
+  uint32_t crc = crc32_ieee(base + sizeof(*hdr), hdr->size - sizeof(*hdr));
+  if (crc != hdr->crc32) {
+    LOG_ERR("Asset bundle CRC mismatch (%08x != %08x)", crc, hdr->crc32);
+    return -EBADMSG;
+  }
+
+  bundle.objs = k_calloc(MAX(hdr->count, 1), sizeof(void *));
+  if (bundle.objs == NULL) {
+    return -ENOMEM;
+  }
+
+  bundle.base = base;
+  bundle.hdr = hdr;
+  bundle.index = (const struct asset_bundle_entry *)(base + sizeof(*hdr));
+
+  LOG_INF("Asset bundle: %u assets, %u bytes, checked in %u us", hdr->count, hdr->size,
+          k_cyc_to_us_floor32(k_cycle_get_32() - start));
+  return 0;
+}
+
+uint32_t asset_bundle_hash(const char *name) {
+  uint32_t hash = 0x811C9DC5;
+
+  while (*name != '\0') {
+    hash = (hash ^ (uint8_t)*name++) * 0x01000193;
+  }
+  return hash;
+}
+
+/* Index of the entry, or -1 */
+static int find_index(const char *name, uint32_t *probes) {
+  uint32_t hash = asset_bundle_hash(name);
+  size_t len = strlen(name);
+  int lo = 0;
+  int hi = bundle.hdr->count;
+
+  // Lower bound of the hash, then the names sharing it
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+
+    (*probes)++;
+    if (bundle.index[mid].hash < hash) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  for (int i = lo; i < bundle.hdr->count && bundle.index[i].hash == hash; i++) {
+    const struct asset_bundle_entry *e = &bundle.index[i];
+
+    (*probes)++;
+    if (e->name_len == len && memcmp(bundle.base + e->name, name, len) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* Look up a name and count it */
+static int lookup(const char *name) {
+  uint32_t probes = 0;
+  uint32_t start = k_cycle_get_32();
+  int i = bundle.base != NULL ? find_index(name, &probes) : -1;
+  uint32_t cycles = k_cycle_get_32() - start;
+
+  K_SPINLOCK(&stats_lock) {
+    bundle.stats.lookups++;
+    bundle.stats.misses += i < 0;
+    bundle.stats.probes += probes;
+    bundle.stats.cycles += cycles;
+  }
+  return i;
+}
+
+const struct asset_bundle_entry *asset_bundle_find(const char *name) {
+  int i = lookup(name);
+
+  return i < 0 ? NULL : &bundle.index[i];
+}
+
+static void *build_image(const struct asset_bundle_entry *e) {
+  const uint8_t *blob = bundle.base + e->offset;
+  lv_image_dsc_t *img;
+
+  if (e->size < sizeof(lv_image_header_t)) {
+    return NULL;
+  }
+
+  img = k_malloc(sizeof(*img));
+  if (img == NULL) {
+    return NULL;
+  }
+
+  *img = (lv_image_dsc_t){0};
+  memcpy(&img->header, blob, sizeof(img->header));
+  img->data = blob + sizeof(lv_image_header_t);
+  img->data_size = e->size - sizeof(lv_image_header_t);
+
+  if (img->header.magic != LV_IMAGE_HEADER_MAGIC) {
+    k_free(img);
+    return NULL;
+  }
+  return img;
+}
+
+static void *build_font(const struct asset_bundle_entry *e) {
+  const uint8_t *blob = bundle.base + e->offset;
+  const struct asset_font_header *fh = (const struct asset_font_header *)blob;
+  struct asset_font *af;
+
+  if (e->size < sizeof(*fh) ||
+      fh->cmaps + fh->cmap_num * sizeof(struct asset_font_cmap) > e->size ||
+      fh->glyph_dsc >= e->size || fh->bitmap > e->size) {
+    return NULL;
+  }
+
+  af = k_malloc(sizeof(*af) + fh->cmap_num * sizeof(lv_font_fmt_txt_cmap_t));
+  if (af == NULL) {
+    return NULL;
+  }
+
+  // Character maps hold pointers, so they are rebuilt in RAM around the lists in flash
+  const struct asset_font_cmap *cm = (const struct asset_font_cmap *)(blob + fh->cmaps);
+  for (uint8_t i = 0; i < fh->cmap_num; i++) {
+    af->cmaps[i] = (lv_font_fmt_txt_cmap_t){
+        .range_start = cm[i].range_start,
+        .range_length = cm[i].range_length,
+        .glyph_id_start = cm[i].glyph_id_start,
+        .unicode_list = cm[i].unicode_list ? (const uint16_t *)(blob + cm[i].unicode_list) : NULL,
+        .glyph_id_ofs_list = cm[i].glyph_id_ofs_list ? blob + cm[i].glyph_id_ofs_list : NULL,
+        .list_length = cm[i].list_length,
+        .type = cm[i].type,
+    };
+  }
+
+  af->dsc = (lv_font_fmt_txt_dsc_t){
+      .glyph_bitmap = blob + fh->bitmap,
+      .glyph_dsc = (const lv_font_fmt_txt_glyph_dsc_t *)(blob + fh->glyph_dsc),
+      .cmaps = af->cmaps,
+      .kern_dsc = NULL,
+      .kern_scale = 0,
+      .cmap_num = fh->cmap_num,
+      .bpp = fh->bpp,
+      .kern_classes = 0,
+      .bitmap_format = 0,
+  };
+
+  af->font = (lv_font_t){
+      .get_glyph_dsc = lv_font_get_glyph_dsc_fmt_txt,
+      .get_glyph_bitmap = lv_font_get_bitmap_fmt_txt,
+      .line_height = fh->line_height,
+      .base_line = fh->base_line,
+      .subpx = LV_FONT_SUBPX_NONE,
+      .underline_position = fh->underline_position,
+      .underline_thickness = fh->underline_thickness,
+      .dsc = &af->dsc,
+  };
+  return af;
+}
+
+/* Descriptor of an entry of the given type, built on first use */
+static void *get_object(const char *name, enum asset_type type) {
+  int i = lookup(name);
+  void *obj;
+
+  if (i < 0 || bundle.index[i].type != type) {
+    return NULL;
+  }
+
+  k_mutex_lock(&bundle_mutex, K_FOREVER);
+  obj = bundle.objs[i];
+  if (obj == NULL) {
+    obj = type == ASSET_TYPE_IMAGE ? build_image(&bundle.index[i]) : build_font(&bundle.index[i]);
+    bundle.objs[i] = obj;
+    if (obj == NULL) {
+      LOG_ERR("Asset %s is invalid", name);
+    }
+  }
+  k_mutex_unlock(&bundle_mutex);
+  return obj;
+}
+
+const lv_image_dsc_t *asset_bundle_image(const char *name) {
+  return get_object(name, ASSET_TYPE_IMAGE);
+}
+
+const lv_font_t *asset_bundle_font(const char *name) {
+  struct asset_font *af = get_object(name, ASSET_TYPE_FONT);
+
+  return af != NULL ? &af->font : NULL;
+}
+
+void asset_bundle_get_stats(struct asset_bundle_stats *stats) {
+  K_SPINLOCK(&stats_lock) {
+    *stats = bundle.stats;
+  }
+}
+
+#if defined(CONFIG_SHELL)
+static const char *const type_names[] = {"?", "image", "font"};
+
+static int cmd_assets_ls(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  if (bundle.base == NULL) {
+    shell_print(sh, "No asset bundle");
+    return 0;
+  }
+
+  for (uint16_t i = 0; i < bundle.hdr->count; i++) {
+    const struct asset_bundle_entry *e = &bundle.index[i];
+
+    shell_print(sh, "%08x %-5s %7u %.*s", e->hash, type_names[e->type < 3 ? e->type : 0], e->size,
+                e->name_len, (const char *)bundle.base + e->name);
+  }
+  shell_print(sh, "%u assets, %u bytes", bundle.hdr->count, bundle.hdr->size);
+  return 0;
+}
+
+static int cmd_assets_stats(const struct shell *sh, size_t argc, char **argv) {
+  struct asset_bundle_stats s;
+
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  asset_bundle_get_stats(&s);
+  shell_print(sh, "lookups: %u (misses %u)", s.lookups, s.misses);
+  if (s.lookups > 0) {
+    shell_print(sh, "per lookup: %u probes/100, %u ns", s.probes * 100 / s.lookups,
+                (uint32_t)(k_cyc_to_ns_floor64(s.cycles) / s.lookups));
+  }
+  return 0;
+}
+
+static int cmd_assets_bench(const struct shell *sh, size_t argc, char **argv) {
+  int runs = argc > 1 ? atoi(argv[1]) : 100;
+  char name[32];
+
+  if (runs <= 0) {
+    shell_error(sh, "usage: assets bench [runs]");
+    return -EINVAL;
+  }
+  if (bundle.base == NULL) {
+    shell_error(sh, "No asset bundle");
+    return -ENOENT;
+  }
+
+  // Every name of the bundle, copied to RAM as a caller would pass it, then a miss
+  for (int i = 0; i <= bundle.hdr->count; i++) {
+    uint32_t probes = 0;
+
+    if (i < bundle.hdr->count) {
+      const struct asset_bundle_entry *e = &bundle.index[i];
+      size_t len = MIN(e->name_len, sizeof(name) - 1);
+
+      memcpy(name, bundle.base + e->name, len);
+      name[len] = '\0';
+    } else {
+      strcpy(name, "no_such_asset");
+    }
+
+    uint32_t start = k_cycle_get_32();
+    for (int r = 0; r < runs; r++) {
+      probes = 0;
+      find_index(name, &probes);
+    }
+    uint64_t ns = k_cyc_to_ns_floor64(k_cycle_get_32() - start);
+
+    shell_print(sh, "%-20s %u probes, %u ns per lookup", name, probes, (uint32_t)(ns / runs));
+  }
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(assets_cmds,
+                               SHELL_CMD(ls, NULL, "List the bundled assets", cmd_assets_ls),
+                               SHELL_CMD(stats, NULL, "Show lookup counters", cmd_assets_stats),
+                               SHELL_CMD_ARG(bench, NULL, "Time name lookups [runs]",
+                                             cmd_assets_bench, 1, 1),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(assets, &assets_cmds, "Asset bundle commands", NULL);
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file asset_bundle.h
+ * @brief Images and fonts from a bundle in their own flash partition
+ *
+ * The bundle is packed at build time by script/pack_assets.py (see
+ * cmake/asset_bundle.cmake) and flashed separately from the application, so
+ * artwork can change without reflashing the firmware. The partition is
+ * memory mapped once; lookups binary-search an index sorted by name hash and
+ * return descriptors whose pixel and glyph data point straight into flash.
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bundle magic, "WAB1" */
+#define ASSET_BUNDLE_MAGIC 0x31424157
+
+/** Asset types of the index */
+enum asset_type {
+  ASSET_TYPE_IMAGE = 1, /**< lv_image_header_t followed by the image data */
+  ASSET_TYPE_FONT = 2,  /**< lv_font_fmt_txt arrays, see pack_assets.py */
+};
+
+/**
+ * @brief Bundle header, at the start of the partition
+ */
+struct asset_bundle_header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count; /**< Index entries */
+  uint32_t size;  /**< Whole bundle, header included */
+  uint32_t crc32; /**< CRC-32 (IEEE) of everything after the header */
+} __packed;
+
+/**
+ * @brief Index entry, sorted by hash then name
+ */
+struct asset_bundle_entry {
+  uint32_t hash;     /**< FNV-1a of the name */
+  uint32_t offset;   /**< Blob offset from the bundle start */
+  uint32_t size;     /**< Blob size */
+  uint16_t type;     /**< enum asset_type */
+  uint16_t name_len; /**< Name length, not terminated in the bundle */
+  uint32_t name;     /**< Name offset from the bundle start */
+} __packed;
+
+/**
+ * @brief Lookup counters, for benchmarking
+ */
+struct asset_bundle_stats {
+  uint32_t lookups; /**< asset_bundle_image() and asset_bundle_font() calls */
+  uint32_t misses;  /**< Names not in the bundle */
+  uint32_t probes;  /**< Index entries compared */
+  uint64_t cycles;  /**< Time spent in lookups */
+};
+
+/**
+ * @brief Map the asset partition and check the bundle
+ *
+ * @return 0 on success, -ENOENT if the partition holds no bundle, -EBADMSG
+ * on a CRC mismatch, or another negative error code.
+ */
+int asset_bundle_init(void);
+
+/**
+ * @brief Hash of an asset name, as used by the index
+ */
+uint32_t asset_bundle_hash(const char *name);
+
+/**
+ * @brief Find an index entry by name
+ *
+ * @return The entry, or NULL if the bundle has no asset of that name
+ */
+const struct asset_bundle_entry *asset_bundle_find(const char *name);
+
+/**
+ * @brief Look up an image
+ *
+ * The descriptor is built on the first lookup and kept, its data points
+ * into the mapped partition.
+ *
+ * @return The image, or NULL if it is missing or not an image
+ */
+const lv_image_dsc_t *asset_bundle_image(const char *name);
+
+/**
+ * @brief Look up a font
+ *
+ * The font and its character map records are built on the first lookup and
+ * kept; glyph descriptors and bitmaps stay in the mapped partition.
+ *
+ * @return The font, or NULL if it is missing or not a font
+ */
+const lv_font_t *asset_bundle_font(const char *name);
+
+/**
+ * @brief Get the lookup counters
+ */
+void asset_bundle_get_stats(struct asset_bundle_stats *stats);
@@ -0,0 +1,67 @@
+/**
+ * @file notif_rules.c
+ * @brief Which notifications are worth fetching, by app and category
+ *
+ * A summary is the app identifier and title: enough to list a notification,
+ * not to show it. The message and the rest are then only fetched when the
+ * notification is opened.
+ */
+
+#include "notif_rules.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+#define ANY_CATEGORY 0xFF
+
+struct rule {
+  const char *app_id; /* NULL for any app */
+  uint8_t category;   /* ancs_category_id_t or ANY_CATEGORY */
+  uint8_t flags;      /* ancs_event_flags_t all set in the event, 0 for any */
+  ancs_filter_t action;
+};
+
+/* First match wins, the last rule matches everything */
+static const struct rule rules[] = {
+    {NULL, ANCS_CATEGORY_ID_INCOMING_CALL, 0, ANCS_FILTER_FULL},
+    {NULL, ANCS_CATEGORY_ID_MISSED_CALL, 0, ANCS_FILTER_FULL},
+    /* Already on the phone before connecting, or not meant to interrupt */
+    {NULL, ANY_CATEGORY, ANCS_EVENT_FLAG_PRE_EXISTING, ANCS_FILTER_SUMMARY},
+    {NULL, ANY_CATEGORY, ANCS_EVENT_FLAG_SILENT, ANCS_FILTER_SUMMARY},
+    {NULL, ANCS_CATEGORY_ID_SOCIAL, 0, ANCS_FILTER_FULL},
+    {NULL, ANCS_CATEGORY_ID_SCHEDULE, 0, ANCS_FILTER_FULL},
+    /* Messaging apps not always posting as social */
+    {"com.apple.MobileSMS", ANY_CATEGORY, 0, ANCS_FILTER_FULL},
+    {"net.whatsapp.WhatsApp", ANY_CATEGORY, 0, ANCS_FILTER_FULL},
+    {"com.facebook.Messenger", ANY_CATEGORY, 0, ANCS_FILTER_FULL},
+    {"ph.telegra.Telegraph", ANY_CATEGORY, 0, ANCS_FILTER_FULL},
+    {"com.vng.zalo", ANY_CATEGORY, 0, ANCS_FILTER_FULL},
+    {NULL, ANY_CATEGORY, 0, ANCS_FILTER_SUMMARY},
+};
+
+static bool event_matches(const struct rule *r, const struct ancs_notification_source *src) {
+  return (r->category == ANY_CATEGORY || r->category == src->category_id) &&
+         (src->event_flags & r->flags) == r->flags;
+}
+
+ancs_filter_t notif_rules_filter(const struct ancs_notification_source *src, const char *app_id) {
+  for (size_t i = 0; i < ARRAY_SIZE(rules); i++) {
+    const struct rule *r = &rules[i];
+
+    if (!event_matches(r, src)) {
+      continue;
+    }
+    if (r->app_id == NULL) {
+      return r->action;
+    }
+    if (app_id == NULL) {
+      // This rule may come first, depending on the app
+      return ANCS_FILTER_NEED_APP;
+    }
+    if (strcmp(r->app_id, app_id) == 0) {
+      return r->action;
+    }
+  }
+  return ANCS_FILTER_SUMMARY;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file notif_rules.h
+ * @brief Which notifications are worth fetching, by app and category
+ *
+ * An ordered table of rules, the first one matching a notification decides
+ * what is fetched of it. A rule matches on the app identifier, the category
+ * and event flags of the Notification Source event. Before the app
+ * identifier is known, a notification that an app rule could match first
+ * is fetched in two steps: the app identifier and title, then the rest if
+ * the rule says so.
+ */
+
+#pragma once
+
+#include "ancs.h"
+
+/**
+ * @brief ANCS filter callback applying the rule table
+ *
+ * @param src Notification Source event
+ * @param app_id App identifier, or NULL before it is fetched
+ * @return What to fetch of the notification
+ */
+ancs_filter_t notif_rules_filter(const struct ancs_notification_source *src, const char *app_id);
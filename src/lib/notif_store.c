@@ -0,0 +1,552 @@
+/**
+ * @file notif_store.c
+ * @brief Notifications kept by UID after the ANCS callback returns
+ *
+ * Records are allocated at the head of a byte ring and freed from its tail:
+ * a record is free once it is no longer the current one of its UID and no
+ * handle references it. A record that doesn't fit before the end of the
+ * arena is placed at its start, after a padding record filling the end.
+ * Freeing is lazy, the tail only moves when room is needed.
+ *
+ * The index is a fixed table of slots, each pointing at the current record
+ * of a UID, chained in hash buckets. Everything is under one mutex; handles
+ * are read without it since a referenced record never changes.
+ */
+
+#include "notif_store.h"
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(notif_store, LOG_LEVEL_INF);
+
+/*
+ * Arena bytes, a record is 28 bytes plus its text. With the index this fits
+ * in the 1200 bytes of the two struct ancs_notification it replaces.
+ */
+#ifndef CONFIG_NOTIF_STORE_ARENA_SIZE
+#define CONFIG_NOTIF_STORE_ARENA_SIZE 1024
+#endif
+
+/* Notifications in the index, 8 bytes each */
+#ifndef CONFIG_NOTIF_STORE_SLOTS
+#define CONFIG_NOTIF_STORE_SLOTS 16
+#endif
+
+#define ARENA_SIZE ROUND_DOWN(CONFIG_NOTIF_STORE_ARENA_SIZE, 4)
+#define BUCKETS 16 /* power of two */
+#define NO_SLOT UINT8_MAX
+
+BUILD_ASSERT(CONFIG_NOTIF_STORE_SLOTS < NO_SLOT, "too many notification slots");
+BUILD_ASSERT(ARENA_SIZE <= UINT16_MAX, "notification arena too large");
+
+enum {
+  REC_PAD,     /* fills the end of the arena */
+  REC_CURRENT, /* in the index */
+  REC_STALE,   /* replaced or removed, free once not referenced */
+};
+
+struct notif {
+  uint16_t size; /* arena bytes, header included */
+  uint8_t state;
+  uint8_t refs;
+  uint32_t uid;
+  uint8_t category;
+  uint8_t flags;
+  uint8_t fetched; /* BIT(notif_attr) of the attributes received */
+  uint16_t text[NOTIF_ATTR_COUNT]; /* offset of each string, 0 if empty */
+};
+
+struct slot {
+  struct notif *rec;
+  uint8_t next; /* hash chain or free list */
+};
+
+/* The text of a notification being stored, from the update or the record it completes */
+struct view {
+  uint8_t category;
+  uint8_t flags;
+  uint8_t fetched;
+  const char *text[NOTIF_ATTR_COUNT];
+  size_t len[NOTIF_ATTR_COUNT];
+};
+
+#define FIELD(f, id)                                                                       \
+  {offsetof(struct ancs_notification, f), SIZEOF_FIELD(struct ancs_notification, f), id}
+
+/* Where the attributes are in a parsed notification */
+static const struct {
+  uint16_t offset;
+  uint16_t size;
+  uint8_t id; /* ancs_attribute_id_t */
+} src_fields[NOTIF_ATTR_COUNT] = {
+    [NOTIF_ATTR_APP_ID] = FIELD(app_identifier, ANCS_ATTR_ID_APP_IDENTIFIER),
+    [NOTIF_ATTR_TITLE] = FIELD(title, ANCS_ATTR_ID_TITLE),
+    [NOTIF_ATTR_SUBTITLE] = FIELD(subtitle, ANCS_ATTR_ID_SUBTITLE),
+    [NOTIF_ATTR_MESSAGE] = FIELD(message, ANCS_ATTR_ID_MESSAGE),
+    [NOTIF_ATTR_DATE] = FIELD(date, ANCS_ATTR_ID_DATE),
+    [NOTIF_ATTR_POSITIVE_ACTION] = FIELD(positive_action_label, ANCS_ATTR_ID_POSITIVE_ACTION_LABEL),
+    [NOTIF_ATTR_NEGATIVE_ACTION] = FIELD(negative_action_label, ANCS_ATTR_ID_NEGATIVE_ACTION_LABEL),
+};
+
+static uint8_t arena[ARENA_SIZE] __aligned(4);
+static size_t head;
+static size_t tail;
+static size_t used;
+
+static struct slot slots[CONFIG_NOTIF_STORE_SLOTS];
+static uint8_t buckets[BUCKETS];
+static uint8_t free_slot;
+static bool initialized;
+
+static struct notif_store_stats stats;
+
+K_MUTEX_DEFINE(store_mutex);
+
+static void init_index(void) {
+  memset(buckets, NO_SLOT, sizeof(buckets));
+  for (int i = 0; i < CONFIG_NOTIF_STORE_SLOTS; i++) {
+    slots[i].next = i + 1 < CONFIG_NOTIF_STORE_SLOTS ? i + 1 : NO_SLOT;
+  }
+  free_slot = 0;
+  initialized = true;
+}
+
+static uint8_t *bucket_of(uint32_t uid) {
+  return &buckets[(uid * 2654435761u) >> 28 & (BUCKETS - 1)];
+}
+
+static uint8_t find_slot(uint32_t uid) {
+  uint8_t i = *bucket_of(uid);
+
+  while (i != NO_SLOT && slots[i].rec->uid != uid) {
+    i = slots[i].next;
+  }
+  return i;
+}
+
+/* Drop a UID from the index, its record goes stale */
+static void unindex(uint32_t uid) {
+  uint8_t *link = bucket_of(uid);
+
+  while (*link != NO_SLOT && slots[*link].rec->uid != uid) {
+    link = &slots[*link].next;
+  }
+  if (*link == NO_SLOT) {
+    return;
+  }
+
+  uint8_t i = *link;
+  *link = slots[i].next;
+  slots[i].rec->state = REC_STALE;
+  slots[i].rec = NULL;
+  slots[i].next = free_slot;
+  free_slot = i;
+  stats.count--;
+}
+
+static struct notif *rec_at(size_t offset) {
+  return (struct notif *)&arena[offset];
+}
+
+/* Move the tail over the records nobody needs anymore */
+static void reclaim(void) {
+  while (used > 0) {
+    struct notif *r = rec_at(tail);
+
+    if (r->state == REC_CURRENT || r->refs > 0) {
+      break;
+    }
+    tail += r->size;
+    used -= r->size;
+    if (tail == ARENA_SIZE) {
+      tail = 0;
+    }
+  }
+  if (used == 0) {
+    head = tail = 0;
+  }
+}
+
+static struct notif *try_alloc(size_t size) {
+  if (used > 0 && head <= tail) {
+    // Free space is [head, tail)
+    if (tail - head < size) {
+      return NULL;
+    }
+  } else if (ARENA_SIZE - head < size) {
+    // Free space is [head, end) and [0, tail): pad the end, start over
+    if (tail < size) {
+      return NULL;
+    }
+    struct notif *pad = rec_at(head);
+    pad->size = ARENA_SIZE - head;
+    pad->state = REC_PAD;
+    pad->refs = 0;
+    used += pad->size;
+    head = 0;
+  }
+
+  struct notif *r = rec_at(head);
+  head += size;
+  used += size;
+  if (head == ARENA_SIZE) {
+    head = 0;
+  }
+  return r;
+}
+
+/* Allocate a record, evicting the oldest notifications if needed */
+static struct notif *alloc_record(size_t size) {
+  if (size > ARENA_SIZE) {
+    return NULL;
+  }
+
+  for (;;) {
+    reclaim();
+    struct notif *r = try_alloc(size);
+    if (r != NULL) {
+      return r;
+    }
+
+    // The oldest record is in use: current and held, or stale and held
+    struct notif *oldest = rec_at(tail);
+    if (oldest->refs > 0) {
+      return NULL;
+    }
+    unindex(oldest->uid);
+    stats.evicted++;
+  }
+}
+
+/* A free slot, evicting the notification with the oldest record if none */
+static uint8_t alloc_slot(void) {
+  if (free_slot == NO_SLOT) {
+    for (size_t offset = tail, seen = 0; seen < used;) {
+      struct notif *r = rec_at(offset);
+      if (r->state == REC_CURRENT) {
+        unindex(r->uid);
+        stats.evicted++;
+        break;
+      }
+      seen += r->size;
+      offset = (offset + r->size) % ARENA_SIZE;
+    }
+  }
+
+  uint8_t i = free_slot;
+  free_slot = slots[i].next;
+  return i;
+}
+
+/*
+ * The attributes of the update, and those it lacks from @p base. An update
+ * with the app identifier replaces the notification, one without only
+ * completes it.
+ */
+static void make_view(struct view *v, const struct ancs_notification *src,
+                      const struct notif *base) {
+  bool details = !(src->attr_mask & BIT(ANCS_ATTR_ID_APP_IDENTIFIER));
+
+  v->category = details ? base->category : src->source.category_id;
+  v->flags = details ? base->flags : src->source.event_flags;
+  v->fetched = details ? base->fetched : 0;
+
+  for (int a = 0; a < NOTIF_ATTR_COUNT; a++) {
+    if (src->attr_mask & BIT(src_fields[a].id)) {
+      v->text[a] = (const char *)src + src_fields[a].offset;
+      v->len[a] = strnlen(v->text[a], src_fields[a].size - 1);
+      v->fetched |= BIT(a);
+    } else if (details) {
+      v->text[a] = notif_text(base, a);
+      v->len[a] = strlen(v->text[a]);
+    } else {
+      v->text[a] = "";
+      v->len[a] = 0;
+    }
+  }
+}
+
+static bool same_content(const struct notif *r, const struct view *v) {
+  if (r->category != v->category || r->flags != v->flags || r->fetched != v->fetched) {
+    return false;
+  }
+
+  for (int a = 0; a < NOTIF_ATTR_COUNT; a++) {
+    const char *stored = notif_text(r, a);
+
+    if (strlen(stored) != v->len[a] || memcmp(stored, v->text[a], v->len[a]) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int notif_store_update(const struct ancs_notification *src, struct notif **out) {
+  uint32_t uid = src->source.notification_uid;
+  size_t size = sizeof(struct notif);
+  struct notif *base = NULL;
+  struct view v;
+  int ret;
+
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  if (!initialized) {
+    init_index();
+  }
+
+  uint8_t i = find_slot(uid);
+  if (!(src->attr_mask & BIT(ANCS_ATTR_ID_APP_IDENTIFIER))) {
+    if (i == NO_SLOT) {
+      ret = -ENOENT;
+      goto unlock;
+    }
+    // Making room must not reuse the text being completed
+    base = slots[i].rec;
+    base->refs++;
+  }
+  make_view(&v, src, base);
+
+  if (i != NO_SLOT && same_content(slots[i].rec, &v)) {
+    stats.unchanged++;
+    ret = -EALREADY;
+    goto unlock;
+  }
+  ret = i != NO_SLOT ? 1 : 0;
+
+  for (int a = 0; a < NOTIF_ATTR_COUNT; a++) {
+    size += v.len[a] > 0 ? v.len[a] + 1 : 0;
+  }
+  size = ROUND_UP(size, 4);
+
+  struct notif *r = alloc_record(size);
+  if (r == NULL) {
+    LOG_WRN("No room for UID 0x%x (%zu bytes)", uid, size);
+    stats.dropped++;
+    ret = -ENOMEM;
+    goto unlock;
+  }
+
+  r->size = size;
+  r->state = REC_CURRENT;
+  r->refs = 0;
+  r->uid = uid;
+  r->category = v.category;
+  r->flags = v.flags;
+  r->fetched = v.fetched;
+
+  char *p = (char *)(r + 1);
+  for (int a = 0; a < NOTIF_ATTR_COUNT; a++) {
+    size_t len = v.len[a];
+
+    r->text[a] = len > 0 ? p - (char *)r : 0;
+    if (len > 0) {
+      memcpy(p, v.text[a], len);
+      p[len] = '\0';
+      p += len + 1;
+    }
+  }
+
+  // Making room may have evicted the previous record of this UID
+  i = find_slot(uid);
+  if (i != NO_SLOT) {
+    slots[i].rec->state = REC_STALE;
+    slots[i].rec = r;
+  } else {
+    i = alloc_slot();
+    slots[i].rec = r;
+    slots[i].next = *bucket_of(uid);
+    *bucket_of(uid) = i;
+    stats.count++;
+  }
+
+  if (ret == 1) {
+    stats.modified++;
+  } else {
+    stats.added++;
+  }
+  if (out != NULL) {
+    r->refs++;
+    *out = r;
+  }
+
+unlock:
+  if (base != NULL) {
+    base->refs--;
+  }
+  k_mutex_unlock(&store_mutex);
+  return ret;
+}
+
+int notif_store_remove(uint32_t uid) {
+  int ret = -ENOENT;
+
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  if (initialized && find_slot(uid) != NO_SLOT) {
+    unindex(uid);
+    stats.removed++;
+    ret = 0;
+  }
+  k_mutex_unlock(&store_mutex);
+  return ret;
+}
+
+struct notif *notif_store_get(uint32_t uid) {
+  struct notif *r = NULL;
+
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  uint8_t i = initialized ? find_slot(uid) : NO_SLOT;
+  if (i != NO_SLOT && slots[i].rec->refs < UINT8_MAX) {
+    r = slots[i].rec;
+    r->refs++;
+  }
+  k_mutex_unlock(&store_mutex);
+  return r;
+}
+
+struct notif *notif_store_ref(struct notif *n) {
+  struct notif *r = NULL;
+
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  if (n->refs < UINT8_MAX) {
+    n->refs++;
+    r = n;
+  }
+  k_mutex_unlock(&store_mutex);
+  return r;
+}
+
+void notif_store_put(struct notif *n) {
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  __ASSERT(n->refs > 0, "notification 0x%x released too often", n->uid);
+  n->refs--;
+  k_mutex_unlock(&store_mutex);
+}
+
+uint32_t notif_uid(const struct notif *n) {
+  return n->uid;
+}
+
+uint8_t notif_category(const struct notif *n) {
+  return n->category;
+}
+
+uint8_t notif_flags(const struct notif *n) {
+  return n->flags;
+}
+
+const char *notif_text(const struct notif *n, enum notif_attr attr) {
+  return n->text[attr] != 0 ? (const char *)n + n->text[attr] : "";
+}
+
+bool notif_fetched(const struct notif *n, enum notif_attr attr) {
+  return n->fetched & BIT(attr);
+}
+
+struct notif *notif_store_newest(void) {
+  struct notif *newest = NULL;
+
+  // Records are in arrival order, the last current one is the newest
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  for (size_t offset = tail, seen = 0; seen < used;) {
+    struct notif *r = rec_at(offset);
+
+    if (r->state == REC_CURRENT) {
+      newest = r;
+    }
+    seen += r->size;
+    offset = (offset + r->size) % ARENA_SIZE;
+  }
+  if (newest != NULL && newest->refs < UINT8_MAX) {
+    newest->refs++;
+  } else {
+    newest = NULL;
+  }
+  k_mutex_unlock(&store_mutex);
+  return newest;
+}
+
+void notif_store_get_stats(struct notif_store_stats *out) {
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  *out = stats;
+  out->slots = CONFIG_NOTIF_STORE_SLOTS;
+  out->used = used;
+  out->capacity = ARENA_SIZE;
+  out->held = 0;
+
+  for (size_t offset = tail, seen = 0; seen < used;) {
+    const struct notif *r = rec_at(offset);
+    out->held += r->refs > 0;
+    seen += r->size;
+    offset = (offset + r->size) % ARENA_SIZE;
+  }
+  k_mutex_unlock(&store_mutex);
+}
+
+void notif_store_reset_stats(void) {
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  stats = (struct notif_store_stats){.count = stats.count};
+  k_mutex_unlock(&store_mutex);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_notif_stats(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  struct notif_store_stats s;
+  notif_store_get_stats(&s);
+
+  shell_print(sh, "notifications: %u/%u, %u held", s.count, s.slots, s.held);
+  shell_print(sh, "arena:         %u/%u bytes, %u per notification", s.used, s.capacity,
+              s.count ? s.used / s.count : 0);
+  shell_print(sh, "added: %u, modified: %u, unchanged: %u, removed: %u", s.added, s.modified,
+              s.unchanged, s.removed);
+  shell_print(sh, "evicted: %u, dropped: %u", s.evicted, s.dropped);
+  return 0;
+}
+
+static int cmd_notif_list(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  // Oldest first, straight from the arena
+  k_mutex_lock(&store_mutex, K_FOREVER);
+  for (size_t offset = tail, seen = 0; seen < used;) {
+    const struct notif *r = rec_at(offset);
+
+    if (r->state != REC_PAD) {
+      shell_print(sh, "0x%08x %c cat %2u %4u B refs %u  %s: %.32s", r->uid,
+                  r->state == REC_CURRENT ? ' ' : 'x', r->category, r->size, r->refs,
+                  notif_text(r, NOTIF_ATTR_APP_ID), notif_text(r, NOTIF_ATTR_TITLE));
+    }
+    seen += r->size;
+    offset = (offset + r->size) % ARENA_SIZE;
+  }
+  k_mutex_unlock(&store_mutex);
+  return 0;
+}
+
+static int cmd_notif_reset(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  notif_store_reset_stats();
+  shell_print(sh, "Notification counters reset");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(notif_cmds,
+                               SHELL_CMD(stats, NULL, "Show notification store counters",
+                                         cmd_notif_stats),
+                               SHELL_CMD(list, NULL, "List stored notifications, oldest first",
+                                         cmd_notif_list),
+                               SHELL_CMD(reset, NULL, "Reset notification store counters",
+                                         cmd_notif_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(notif, &notif_cmds, "Notification store commands", NULL);
+#endif
@@ -0,0 +1,153 @@
+/**
+ * @file notif_store.h
+ * @brief Notifications kept by UID after the ANCS callback returns
+ *
+ * Each notification is one record in a ring arena: a small header followed
+ * by its non-empty attributes as packed strings, so a notification takes
+ * about the length of its text instead of the fixed buffers of struct
+ * ancs_notification. A hash index finds the current record of a UID.
+ *
+ * Records are immutable. A modification writes a new record for the UID and
+ * a removal drops the UID from the index; a record still referenced by a
+ * handle stays readable until its last notif_store_put(). When the arena or
+ * the index is full the oldest notifications are evicted, unless a handle
+ * pins the oldest record.
+ *
+ * A notification may be stored with only some of its attributes fetched;
+ * an update carrying the others completes it.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ancs.h"
+
+/**
+ * @brief Text attributes of a notification
+ */
+enum notif_attr {
+  NOTIF_ATTR_APP_ID,
+  NOTIF_ATTR_TITLE,
+  NOTIF_ATTR_SUBTITLE,
+  NOTIF_ATTR_MESSAGE,
+  NOTIF_ATTR_DATE,
+  NOTIF_ATTR_POSITIVE_ACTION,
+  NOTIF_ATTR_NEGATIVE_ACTION,
+  NOTIF_ATTR_COUNT,
+};
+
+/** Handle to a stored notification, read with the accessors below */
+struct notif;
+
+/**
+ * @brief Store counters
+ */
+struct notif_store_stats {
+  uint32_t count;    /**< Notifications in the index */
+  uint32_t slots;    /**< Size of the index */
+  uint32_t used;     /**< Arena bytes used, stale records included */
+  uint32_t capacity; /**< Arena size */
+  uint32_t held;     /**< Records referenced by handles */
+  uint32_t added;
+  uint32_t modified;
+  uint32_t unchanged; /**< Updates identical to the stored notification */
+  uint32_t removed;
+  uint32_t evicted; /**< Oldest notifications dropped to make room */
+  uint32_t dropped; /**< Updates that found no room */
+};
+
+/**
+ * @brief Add or replace the notification of a UID
+ *
+ * Copies the source and the strings of @p src into a new record, which
+ * becomes the current one of its UID. An update without the app identifier
+ * in its attr_mask only adds the attributes it has to the stored
+ * notification, keeping the source and the other attributes.
+ *
+ * @param src Parsed notification, only read during the call
+ * @param out Set to a handle to the new record, to release with
+ *            notif_store_put(), on success. May be NULL.
+ *
+ * @retval 0 The UID was added
+ * @retval 1 The UID was already stored and is now modified
+ * @retval -EALREADY The stored notification is identical, nothing changed
+ * @retval -ENOENT An update without the app identifier for a UID not stored
+ * @retval -ENOMEM No room, even after evicting the notifications not held
+ */
+int notif_store_update(const struct ancs_notification *src, struct notif **out);
+
+/**
+ * @brief Remove a UID from the store
+ *
+ * Handles to its records stay valid until released.
+ *
+ * @retval 0 Removed
+ * @retval -ENOENT The UID is not stored
+ */
+int notif_store_remove(uint32_t uid);
+
+/**
+ * @brief Get a handle to the current notification of a UID
+ *
+ * @return The handle, to release with notif_store_put(), or NULL
+ */
+struct notif *notif_store_get(uint32_t uid);
+
+/**
+ * @brief Get a handle to the notification added or modified last
+ *
+ * @return The handle, to release with notif_store_put(), or NULL if empty
+ */
+struct notif *notif_store_newest(void);
+
+/**
+ * @brief Take another reference to a handle
+ *
+ * @return @p n, or NULL if it has too many references
+ */
+struct notif *notif_store_ref(struct notif *n);
+
+/**
+ * @brief Release a handle
+ */
+void notif_store_put(struct notif *n);
+
+/**
+ * @brief Get the UID of a notification
+ */
+uint32_t notif_uid(const struct notif *n);
+
+/**
+ * @brief Get the category of a notification, an ancs_category_id_t
+ */
+uint8_t notif_category(const struct notif *n);
+
+/**
+ * @brief Get the event flags of a notification, ancs_event_flags_t bits
+ */
+uint8_t notif_flags(const struct notif *n);
+
+/**
+ * @brief Get a text attribute of a notification
+ *
+ * @return A NUL-terminated string, empty if the attribute is, valid as
+ *         long as the handle
+ */
+const char *notif_text(const struct notif *n, enum notif_attr attr);
+
+/**
+ * @brief Tell whether an attribute was fetched, as opposed to left out
+ */
+bool notif_fetched(const struct notif *n, enum notif_attr attr);
+
+/**
+ * @brief Get the store counters
+ */
+void notif_store_get_stats(struct notif_store_stats *stats);
+
+/**
+ * @brief Reset the event counters of the store
+ */
+void notif_store_reset_stats(void);
@@ -0,0 +1,172 @@
+#include <errno.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/rtc.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include "../app/app_interface.h"
+#include "../app/ui_loop.h"
+#include "time_tick.h"
+
+LOG_MODULE_REGISTER(time_tick, LOG_LEVEL_INF);
+
+#ifndef CONFIG_TIME_TICK_PERIOD_MIN
+#define CONFIG_TIME_TICK_PERIOD_MIN 1
+#endif
+
+#define ALARM_ID 0
+
+/* The kernel timer fires on the kernel's idea of the boundary; an RTC running
+ * slow can still read this much short of it right after */
+#define BOUNDARY_SLACK_MS 2000
+
+static const struct device *const rtc_dev = DEVICE_DT_GET(DT_ALIAS(rtc));
+
+static struct {
+  uint8_t period_min;
+  bool use_alarm;
+  uint32_t ticks;
+} tick = {
+    .period_min = CONFIG_TIME_TICK_PERIOD_MIN,
+};
+
+static void arm_work_handler(struct k_work *work);
+static K_WORK_DEFINE(arm_work, arm_work_handler);
+
+static void fallback_timer_handler(struct k_timer *timer);
+static K_TIMER_DEFINE(fallback_timer, fallback_timer_handler, NULL);
+
+/* Set when the kernel timer posted the tick of the boundary being re-armed */
+static atomic_t timer_ticked;
+
+static void post_tick(void) {
+  input_event_t ev = {
+      .type = INPUT_EVENT_TYPE_TICK,
+      .code = INPUT_TICK_PERIOD,
+      .value = (int32_t)++tick.ticks,
+      .timestamp = k_cycle_get_32(),
+  };
+
+  if (ui_loop_post_event(&ev) != 0) {
+    LOG_WRN("UI event queue full, dropping tick");
+  }
+}
+
+/* Minutes from @p tm until the next period boundary */
+static int minutes_to_boundary(const struct rtc_time *tm) {
+  return tick.period_min - (tm->tm_min % tick.period_min);
+}
+
+#if defined(CONFIG_RTC_ALARM)
+static int arm_alarm(const struct rtc_time *now) {
+  struct rtc_time alarm = {0};
+
+  alarm.tm_min = (now->tm_min + minutes_to_boundary(now)) % 60;
+
+  // Reading the pending flag clears it so the next match raises INT again
+  (void)rtc_alarm_is_pending(rtc_dev, ALARM_ID);
+
+  int ret = rtc_alarm_set_time(rtc_dev, ALARM_ID, RTC_ALARM_TIME_MASK_MINUTE, &alarm);
+  if (ret == 0) {
+    LOG_DBG("Alarm armed for minute %02d", alarm.tm_min);
+  }
+  return ret;
+}
+
+static void alarm_callback(const struct device *dev, uint16_t id, void *user_data) {
+  ARG_UNUSED(dev);
+  ARG_UNUSED(id);
+  ARG_UNUSED(user_data);
+
+  post_tick();
+  k_work_submit(&arm_work);
+}
+#endif
+
+static void arm_timer(const struct rtc_time *now, bool ticked) {
+  int64_t ms = (int64_t)minutes_to_boundary(now) * MSEC_PER_SEC * 60 - now->tm_sec * MSEC_PER_SEC;
+
+  // Just ticked at mm:58 or mm:59 of a lagging RTC: that boundary is done
+  if (ticked && ms <= BOUNDARY_SLACK_MS) {
+    ms += (int64_t)tick.period_min * MSEC_PER_SEC * 60;
+  }
+
+  k_timer_start(&fallback_timer, K_MSEC(MAX(ms, 0)), K_NO_WAIT);
+}
+
+static void arm_work_handler(struct k_work *work) {
+  ARG_UNUSED(work);
+  struct rtc_time now;
+  bool ticked = atomic_clear(&timer_ticked);
+
+  int ret = rtc_get_time(rtc_dev, &now);
+  if (ret < 0) {
+    LOG_ERR("Failed to get RTC time: %d", ret);
+    // Keep ticking from the kernel clock rather than stopping
+    k_timer_start(&fallback_timer, K_MINUTES(tick.period_min), K_NO_WAIT);
+    return;
+  }
+
+#if defined(CONFIG_RTC_ALARM)
+  if (tick.use_alarm) {
+    if (arm_alarm(&now) == 0) {
+      return;
+    }
+    LOG_WRN("Failed to arm RTC alarm, falling back to kernel timer");
+    tick.use_alarm = false;
+  }
+#endif
+  arm_timer(&now, ticked);
+}
+
+static void fallback_timer_handler(struct k_timer *timer) {
+  ARG_UNUSED(timer);
+
+  post_tick();
+  // Realign on the RTC every tick so the kernel clock drift does not add up
+  atomic_set(&timer_ticked, 1);
+  k_work_submit(&arm_work);
+}
+
+int time_tick_set_period(uint8_t minutes) {
+  if (minutes == 0 || minutes > 60 || 60 % minutes != 0) {
+    return -EINVAL;
+  }
+
+  tick.period_min = minutes;
+  k_timer_stop(&fallback_timer);
+  k_work_submit(&arm_work);
+  return 0;
+}
+
+uint8_t time_tick_get_period(void) { return tick.period_min; }
+
+int time_tick_init(void) {
+  if (!device_is_ready(rtc_dev)) {
+    LOG_ERR("RTC device not ready");
+    return -ENODEV;
+  }
+
+  if (60 % tick.period_min != 0) {
+    LOG_WRN("Unsupported tick period %d, using 1 minute", tick.period_min);
+    tick.period_min = 1;
+  }
+
+#if defined(CONFIG_RTC_ALARM)
+  uint16_t fields = 0;
+
+  if (rtc_alarm_get_supported_fields(rtc_dev, ALARM_ID, &fields) == 0 &&
+      (fields & RTC_ALARM_TIME_MASK_MINUTE) &&
+      rtc_alarm_set_callback(rtc_dev, ALARM_ID, alarm_callback, NULL) == 0) {
+    tick.use_alarm = true;
+  }
+#endif
+
+  LOG_INF("Time tick every %d min using %s", tick.period_min,
+          tick.use_alarm ? "RTC alarm" : "kernel timer");
+
+  k_work_submit(&arm_work);
+  return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @file time_tick.h
+ * @brief Wall-clock aligned tick service driven by the RTC alarm.
+ *
+ * Posts an INPUT_EVENT_TYPE_TICK event to the UI loop at every period
+ * boundary (e.g. every full minute). Uses the PCF8563 alarm interrupt when
+ * available and falls back to a kernel timer aligned on the RTC otherwise.
+ */
+
+/**
+ * @brief Start the tick service with the default period.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int time_tick_init(void);
+
+/**
+ * @brief Change the tick period.
+ *
+ * @param minutes Period in minutes; must divide 60 (1, 2, 5, 15, 30, 60...).
+ * @return 0 on success, -EINVAL for an unsupported period.
+ */
+int time_tick_set_period(uint8_t minutes);
+
+/**
+ * @brief Get the current tick period in minutes.
+ */
+uint8_t time_tick_get_period(void);
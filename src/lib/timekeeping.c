@@ -0,0 +1,457 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/rtc.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/timeutil.h>
+#include <zephyr/sys/util.h>
+
+#include "timekeeping.h"
+
+LOG_MODULE_REGISTER(timekeeping, LOG_LEVEL_INF);
+
+#ifndef CONFIG_TIMEKEEPING_SYNC_INTERVAL_MIN
+#define CONFIG_TIMEKEEPING_SYNC_INTERVAL_MIN 360
+#endif
+
+#ifndef CONFIG_TIMEKEEPING_DEFAULT_ZONE
+#define CONFIG_TIMEKEEPING_DEFAULT_ZONE "UTC"
+#endif
+
+/* Shortest interval a drift estimate is taken over; with the edge search
+ * resolution below this bounds the estimate noise to a few ppm */
+#ifndef CONFIG_TIMEKEEPING_MIN_DRIFT_INTERVAL_MIN
+#define CONFIG_TIMEKEEPING_MIN_DRIFT_INTERVAL_MIN 60
+#endif
+
+/* Largest correction accepted as drift, beyond that the crystal is broken */
+#ifndef CONFIG_TIMEKEEPING_MAX_DRIFT_PPM
+#define CONFIG_TIMEKEEPING_MAX_DRIFT_PPM 500
+#endif
+
+/* Errors above this are a time step (RTC set elsewhere), not drift */
+#define STEP_THRESHOLD_MS 2000
+
+/* The RTC only has 1 s resolution, so syncs poll it until the seconds
+ * register changes and take the middle of the last interval as the edge */
+#define EDGE_POLL_MS 10
+#define EDGE_MAX_POLLS (1100 / EDGE_POLL_MS)
+
+#define PPB 1000000000LL
+
+static const struct device *const rtc_dev = DEVICE_DT_GET(DT_ALIAS(rtc));
+
+static struct {
+  int64_t base_epoch_ms;  /* UTC at base_uptime_ms */
+  int64_t base_uptime_ms; /* Uptime of the last rebase */
+  const struct tz_zone *zone;
+  uint32_t drift_samples;
+  struct timekeeping_stats stats;
+} tk = {
+    .zone = &tz_zones[0],
+};
+
+/* Transitions of the cached year, as UTC seconds */
+static struct {
+  const struct tz_zone *zone;
+  int year;
+  int64_t start;
+  int64_t end;
+} dst_cache;
+
+static struct {
+  int64_t prev_uptime_ms;
+  int prev_sec;
+  uint8_t polls;
+} edge;
+
+static struct k_spinlock lock;
+
+static void sync_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sync_work, sync_work_handler);
+
+/* Caller holds the lock */
+static int64_t soft_time_at(int64_t uptime_ms) {
+  int64_t elapsed = uptime_ms - tk.base_uptime_ms;
+
+  return tk.base_epoch_ms + elapsed + elapsed * tk.stats.drift_ppb / PPB;
+}
+
+int64_t timekeeping_now_ms(void) {
+  int64_t now;
+
+  K_SPINLOCK(&lock) { now = soft_time_at(k_uptime_get()); }
+  return now;
+}
+
+int64_t timekeeping_now(void) { return timekeeping_now_ms() / MSEC_PER_SEC; }
+
+static bool is_leap(int year) { return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0; }
+
+/* UTC seconds of a DST transition in @p year; @p offset_min is the offset in
+ * effect just before it, which the rule time is expressed in */
+static int64_t transition_utc(int year, const struct tz_rule *rule, int offset_min) {
+  static const uint8_t month_days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  struct tm first = {
+      .tm_year = year - 1900,
+      .tm_mon = rule->month - 1,
+      .tm_mday = 1,
+  };
+  int64_t first_s = timeutil_timegm64(&first);
+  int first_wday = (int)((first_s / SEC_PER_DAY + 4) % 7); // 1970-01-01 was a Thursday
+  int days = month_days[rule->month - 1] + (rule->month == 2 && is_leap(year));
+  int mday = 1 + (rule->wday - first_wday + 7) % 7 + (rule->week - 1) * 7;
+
+  while (mday > days) {
+    mday -= 7;
+  }
+
+  return first_s + (int64_t)(mday - 1) * SEC_PER_DAY + (rule->time_min - offset_min) * 60;
+}
+
+/* Caller holds the lock */
+static bool in_dst(const struct tz_zone *zone, int64_t utc) {
+  if (zone->dst_offset_min == 0) {
+    return false;
+  }
+
+  time_t local = (time_t)(utc + zone->std_offset_min * 60);
+  struct tm tm;
+  gmtime_r(&local, &tm);
+  int year = tm.tm_year + 1900;
+
+  if (dst_cache.zone != zone || dst_cache.year != year) {
+    dst_cache.zone = zone;
+    dst_cache.year = year;
+    dst_cache.start = transition_utc(year, &zone->start, zone->std_offset_min);
+    dst_cache.end = transition_utc(year, &zone->end, zone->dst_offset_min);
+  }
+
+  if (dst_cache.start < dst_cache.end) {
+    return utc >= dst_cache.start && utc < dst_cache.end;
+  }
+  // Southern hemisphere: DST spans the turn of the year
+  return utc >= dst_cache.start || utc < dst_cache.end;
+}
+
+int timekeeping_utc_offset_min(int64_t utc) {
+  int offset;
+
+  K_SPINLOCK(&lock) {
+    offset = in_dst(tk.zone, utc) ? tk.zone->dst_offset_min : tk.zone->std_offset_min;
+  }
+  return offset;
+}
+
+static void local_at(int64_t round_ms, struct rtc_time *tm) {
+  int64_t now_ms;
+  bool dst;
+  int offset;
+
+  K_SPINLOCK(&lock) {
+    now_ms = soft_time_at(k_uptime_get());
+    if (round_ms > 0) {
+      now_ms = (now_ms + round_ms / 2) / round_ms * round_ms;
+    }
+    dst = in_dst(tk.zone, now_ms / MSEC_PER_SEC);
+    offset = dst ? tk.zone->dst_offset_min : tk.zone->std_offset_min;
+  }
+
+  time_t local = (time_t)(now_ms / MSEC_PER_SEC + offset * 60);
+  gmtime_r(&local, rtc_time_to_tm(tm));
+  tm->tm_isdst = dst;
+  tm->tm_nsec = (int)(now_ms % MSEC_PER_SEC) * NSEC_PER_MSEC;
+}
+
+void timekeeping_get_local(struct rtc_time *tm) { local_at(0, tm); }
+
+void timekeeping_get_local_minute(struct rtc_time *tm) { local_at(MSEC_PER_SEC * 60, tm); }
+
+/* Rebase the software clock on an RTC reading and update the drift estimate
+ * if the reading was taken on the second edge */
+static void apply_rtc(int64_t rtc_ms, int64_t at_uptime_ms, bool aligned) {
+  K_SPINLOCK(&lock) {
+    int64_t error = rtc_ms - soft_time_at(at_uptime_ms);
+    int64_t elapsed = at_uptime_ms - tk.base_uptime_ms;
+
+    if (tk.stats.valid && aligned && llabs(error) < STEP_THRESHOLD_MS &&
+        elapsed >= (int64_t)CONFIG_TIMEKEEPING_MIN_DRIFT_INTERVAL_MIN * 60 * MSEC_PER_SEC) {
+      int64_t residual = error * PPB / elapsed;
+      int64_t limit = (int64_t)CONFIG_TIMEKEEPING_MAX_DRIFT_PPM * 1000;
+      int64_t drift = tk.stats.drift_ppb;
+
+      // Take the first estimate as is, then average to filter edge jitter
+      drift += tk.drift_samples == 0 ? residual : residual / 2;
+      tk.stats.drift_ppb = (int32_t)CLAMP(drift, -limit, limit);
+      tk.drift_samples++;
+    }
+
+    tk.stats.last_error_ms = tk.stats.valid ? (int32_t)CLAMP(error, INT32_MIN, INT32_MAX) : 0;
+    tk.base_epoch_ms = rtc_ms;
+    tk.base_uptime_ms = at_uptime_ms;
+    tk.stats.valid = true;
+    if (aligned) {
+      tk.stats.syncs++;
+      tk.stats.last_sync_ms = at_uptime_ms;
+    }
+  }
+}
+
+static int read_rtc(struct rtc_time *tm) {
+  int ret = rtc_get_time(rtc_dev, tm);
+
+  K_SPINLOCK(&lock) { tk.stats.rtc_reads++; }
+  return ret;
+}
+
+static int64_t rtc_to_ms(struct rtc_time *tm) {
+  return timeutil_timegm64(rtc_time_to_tm(tm)) * MSEC_PER_SEC;
+}
+
+static void sync_work_handler(struct k_work *work) {
+  ARG_UNUSED(work);
+  struct rtc_time tm;
+
+  int ret = read_rtc(&tm);
+  int64_t uptime = k_uptime_get();
+
+  if (ret < 0) {
+    LOG_WRN("RTC read failed during sync: %d", ret);
+    edge.polls = 0;
+    k_work_reschedule(&sync_work, K_MINUTES(CONFIG_TIMEKEEPING_SYNC_INTERVAL_MIN));
+    return;
+  }
+
+  if (edge.polls == 0 || tm.tm_sec == edge.prev_sec) {
+    if (edge.polls++ < EDGE_MAX_POLLS) {
+      edge.prev_sec = tm.tm_sec;
+      edge.prev_uptime_ms = uptime;
+      k_work_reschedule(&sync_work, K_MSEC(EDGE_POLL_MS));
+      return;
+    }
+    // The seconds register did not move: the RTC is stopped
+    LOG_WRN("No RTC second edge found, skipping sync");
+  } else {
+    apply_rtc(rtc_to_ms(&tm), (edge.prev_uptime_ms + uptime) / 2, true);
+    LOG_DBG("Synced on RTC, error %d ms, drift %d ppb", tk.stats.last_error_ms,
+            tk.stats.drift_ppb);
+  }
+
+  edge.polls = 0;
+  k_work_reschedule(&sync_work, K_MINUTES(CONFIG_TIMEKEEPING_SYNC_INTERVAL_MIN));
+}
+
+void timekeeping_sync(void) {
+  if (edge.polls == 0) {
+    k_work_reschedule(&sync_work, K_NO_WAIT);
+  }
+}
+
+int timekeeping_set_utc(int64_t utc) {
+  struct rtc_time tm = {0};
+  time_t t = (time_t)utc;
+
+  gmtime_r(&t, rtc_time_to_tm(&tm));
+  int ret = rtc_set_time(rtc_dev, &tm);
+  if (ret < 0) {
+    LOG_ERR("Failed to set RTC time: %d", ret);
+    return ret;
+  }
+
+  // An edge search under way would resume from a reading of the old time
+  struct k_work_sync sync;
+
+  k_work_cancel_delayable_sync(&sync_work, &sync);
+  edge.polls = 0;
+  edge.prev_sec = 0;
+  edge.prev_uptime_ms = 0;
+
+  // A deliberate step is not drift: rebase without touching the estimate
+  K_SPINLOCK(&lock) {
+    tk.base_epoch_ms = utc * MSEC_PER_SEC;
+    tk.base_uptime_ms = k_uptime_get();
+    tk.stats.valid = true;
+  }
+
+  k_work_reschedule(&sync_work, K_MINUTES(CONFIG_TIMEKEEPING_SYNC_INTERVAL_MIN));
+  return 0;
+}
+
+static const struct tz_zone *find_zone(const char *name) {
+  for (size_t i = 0; i < tz_zone_count; i++) {
+    if (strcmp(tz_zones[i].name, name) == 0) {
+      return &tz_zones[i];
+    }
+  }
+  return NULL;
+}
+
+static void select_zone(const struct tz_zone *zone) {
+  K_SPINLOCK(&lock) {
+    tk.zone = zone;
+    dst_cache.zone = NULL;
+  }
+}
+
+int timekeeping_set_zone(const char *name) {
+  const struct tz_zone *zone = find_zone(name);
+
+  if (zone == NULL) {
+    return -ENOENT;
+  }
+
+  select_zone(zone);
+  LOG_INF("Timezone set to %s", zone->name);
+
+#if defined(CONFIG_SETTINGS)
+  int ret = settings_save_one("clock/zone", zone->name, strlen(zone->name) + 1);
+  if (ret < 0) {
+    LOG_WRN("Failed to save timezone: %d", ret);
+  }
+#endif
+  return 0;
+}
+
+const struct tz_zone *timekeeping_get_zone(void) { return tk.zone; }
+
+void timekeeping_get_stats(struct timekeeping_stats *stats) {
+  K_SPINLOCK(&lock) { *stats = tk.stats; }
+}
+
+#if defined(CONFIG_SETTINGS)
+static int clock_settings_set(const char *key, size_t len, settings_read_cb read_cb,
+                              void *cb_arg) {
+  char name[32];
+
+  if (strcmp(key, "zone") != 0 || len > sizeof(name)) {
+    return -ENOENT;
+  }
+
+  int ret = read_cb(cb_arg, name, len);
+  if (ret < 0) {
+    return ret;
+  }
+  name[sizeof(name) - 1] = '\0';
+
+  const struct tz_zone *zone = find_zone(name);
+  if (zone == NULL) {
+    LOG_WRN("Saved timezone %s is not in the table", name);
+    return 0;
+  }
+
+  select_zone(zone);
+  return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(clock, "clock", NULL, clock_settings_set, NULL, NULL);
+#endif
+
+int timekeeping_init(void) {
+  struct rtc_time tm;
+
+  const struct tz_zone *zone = find_zone(CONFIG_TIMEKEEPING_DEFAULT_ZONE);
+  if (zone != NULL) {
+    select_zone(zone);
+  }
+
+#if defined(CONFIG_SETTINGS)
+  // A saved zone overrides the default
+  if (settings_subsys_init() == 0) {
+    settings_load_subtree("clock");
+  }
+#endif
+
+  if (!device_is_ready(rtc_dev)) {
+    LOG_ERR("RTC device not ready");
+    return -ENODEV;
+  }
+
+  int ret = read_rtc(&tm);
+  if (ret < 0) {
+    // -ENODATA: the PCF8563 lost power and its time is not valid
+    LOG_WRN("RTC time not available (%d), waiting for the time to be set", ret);
+    return ret;
+  }
+
+  // Start from the middle of the current second until the edge-aligned sync
+  apply_rtc(rtc_to_ms(&tm) + MSEC_PER_SEC / 2, k_uptime_get(), false);
+  k_work_reschedule(&sync_work, K_NO_WAIT);
+
+  LOG_INF("Time %04d-%02d-%02d %02d:%02d:%02d UTC, zone %s", tm.tm_year + 1900, tm.tm_mon + 1,
+          tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, tk.zone->name);
+  return 0;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_clock_status(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+  struct timekeeping_stats stats;
+  struct rtc_time tm;
+
+  timekeeping_get_stats(&stats);
+  timekeeping_get_local(&tm);
+
+  shell_print(sh, "local: %04d-%02d-%02d %02d:%02d:%02d%s (%s, UTC%+d min)", tm.tm_year + 1900,
+              tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+              tm.tm_isdst ? " DST" : "", tk.zone->name,
+              timekeeping_utc_offset_min(timekeeping_now()));
+  shell_print(sh, "valid: %s, syncs: %u, rtc reads: %u", stats.valid ? "yes" : "no", stats.syncs,
+              stats.rtc_reads);
+  shell_print(sh, "drift: %d ppb, last error: %d ms, last sync: %lld ms ago", stats.drift_ppb,
+              stats.last_error_ms, (long long)(stats.syncs ? k_uptime_get() - stats.last_sync_ms : -1));
+  return 0;
+}
+
+static int cmd_clock_zone(const struct shell *sh, size_t argc, char **argv) {
+  if (argc < 2) {
+    for (size_t i = 0; i < tz_zone_count; i++) {
+      shell_print(sh, "%c %s", &tz_zones[i] == tk.zone ? '*' : ' ', tz_zones[i].name);
+    }
+    return 0;
+  }
+
+  if (timekeeping_set_zone(argv[1]) < 0) {
+    shell_error(sh, "unknown zone %s", argv[1]);
+    return -ENOENT;
+  }
+  return 0;
+}
+
+static int cmd_clock_set(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  char *end;
+  long long utc = strtoll(argv[1], &end, 10);
+
+  if (*end != '\0' || utc < 0) {
+    shell_error(sh, "usage: clock set <unix seconds>");
+    return -EINVAL;
+  }
+  return timekeeping_set_utc(utc);
+}
+
+static int cmd_clock_sync(const struct shell *sh, size_t argc, char **argv) {
+  ARG_UNUSED(argc);
+  ARG_UNUSED(argv);
+
+  timekeeping_sync();
+  shell_print(sh, "sync scheduled");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(clock_cmds,
+                               SHELL_CMD(status, NULL, "Show time and sync state", cmd_clock_status),
+                               SHELL_CMD_ARG(zone, NULL, "List or select the timezone",
+                                             cmd_clock_zone, 1, 1),
+                               SHELL_CMD_ARG(set, NULL, "Set UTC time (unix seconds)",
+                                             cmd_clock_set, 2, 0),
+                               SHELL_CMD(sync, NULL, "Resync with the RTC", cmd_clock_sync),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(clock, &clock_cmds, "Timekeeping commands", NULL);
+#endif
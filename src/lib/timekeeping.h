@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/drivers/rtc.h>
+
+/**
+ * @file timekeeping.h
+ * @brief Cached wall-clock time service.
+ *
+ * Keeps UTC time in software from k_uptime plus an epoch offset, so reading
+ * the time costs no I2C traffic. The PCF8563 is the reference: it is read at
+ * boot and then every few hours, aligned on its second edge, to correct the
+ * offset and estimate the drift of the kernel clock against it.
+ *
+ * Local time is derived from a timezone table generated at build time from
+ * src/lib/tz_zones.txt (see cmake/tz_table.cmake).
+ */
+
+/**
+ * @brief DST transition rule, POSIX "Mm.w.d/time" form.
+ */
+struct tz_rule {
+  uint8_t month;    /**< 1..12 */
+  uint8_t week;     /**< 1..5, 5 means the last week of the month */
+  uint8_t wday;     /**< 0 (Sunday)..6 */
+  int16_t time_min; /**< Local time of the transition, minutes after midnight */
+};
+
+/**
+ * @brief Timezone entry; offsets are minutes east of UTC.
+ */
+struct tz_zone {
+  const char *name;
+  int16_t std_offset_min;
+  int16_t dst_offset_min; /**< 0 if the zone has no DST */
+  struct tz_rule start;   /**< Switch to DST, in standard local time */
+  struct tz_rule end;     /**< Switch back, in DST local time */
+};
+
+/** Generated timezone table */
+extern const struct tz_zone tz_zones[];
+extern const size_t tz_zone_count;
+
+/**
+ * @brief Timekeeping statistics.
+ */
+struct timekeeping_stats {
+  uint32_t syncs;           /**< Completed RTC synchronizations */
+  uint32_t rtc_reads;       /**< RTC register reads, including edge search */
+  int32_t drift_ppb;        /**< Kernel clock correction applied, parts per billion */
+  int32_t last_error_ms;    /**< RTC minus software time at the last sync */
+  int64_t last_sync_ms;     /**< Uptime of the last sync, 0 if none */
+  bool valid;               /**< Time was set from the RTC or by the user */
+};
+
+/**
+ * @brief Load the time from the RTC and start periodic synchronization.
+ *
+ * @return 0 on success, or a negative error code if the RTC is unusable.
+ *         Time still runs from the kernel clock on error.
+ */
+int timekeeping_init(void);
+
+/**
+ * @brief Current UTC time in milliseconds since the Unix epoch.
+ */
+int64_t timekeeping_now_ms(void);
+
+/**
+ * @brief Current UTC time in seconds since the Unix epoch.
+ */
+int64_t timekeeping_now(void);
+
+/**
+ * @brief Current local time in the selected timezone.
+ *
+ * @param tm Broken-down local time, with tm_wday, tm_yday and tm_isdst set.
+ */
+void timekeeping_get_local(struct rtc_time *tm);
+
+/**
+ * @brief Current local time rounded to the nearest minute.
+ *
+ * For updates on a minute tick: the tick comes on the RTC minute edge, and
+ * the software clock can be a second or so behind it, which would still
+ * read as the previous minute.
+ *
+ * @param tm Broken-down local time, tm_sec is 0.
+ */
+void timekeeping_get_local_minute(struct rtc_time *tm);
+
+/**
+ * @brief Offset of the local time from UTC at @p utc, in minutes.
+ */
+int timekeeping_utc_offset_min(int64_t utc);
+
+/**
+ * @brief Set the UTC time, updating the RTC as well.
+ *
+ * Cancels a synchronization in progress; not to be called from the system
+ * work queue, which runs it.
+ *
+ * @param utc Seconds since the Unix epoch.
+ * @return 0 on success, or a negative error code if the RTC write failed.
+ */
+int timekeeping_set_utc(int64_t utc);
+
+/**
+ * @brief Select the timezone by name (e.g. "Europe/Paris").
+ *
+ * The choice is persisted with the settings subsystem when available.
+ *
+ * @return 0 on success, -ENOENT if the zone is not in the table.
+ */
+int timekeeping_set_zone(const char *name);
+
+/**
+ * @brief Get the selected timezone.
+ */
+const struct tz_zone *timekeeping_get_zone(void);
+
+/**
+ * @brief Schedule an RTC synchronization now.
+ */
+void timekeeping_sync(void);
+
+/**
+ * @brief Get the timekeeping statistics.
+ */
+void timekeeping_get_stats(struct timekeeping_stats *stats);
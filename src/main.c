@@ -14,8 +14,16 @@
 
 #include "app/app_interface.h"
 #include "app/app_manager.h"
+#include "app/ui_loop.h"
 #include "buttons.h"
+#include "display/epd_refresh.h"
+#include "display/img_rle.h"
 #include "lib/ancs.h"
+#include "lib/asset_bundle.h"
+#include "lib/notif_rules.h"
+#include "lib/notif_store.h"
+#include "lib/time_tick.h"
+#include "lib/timekeeping.h"
 
 extern int sensor_init(void);
 extern void epd_display_init(void);
@@ -47,7 +55,8 @@ static int lvgl_display_init(void) {
 }
 
 void on_new_notification(const struct ancs_notification *notif) {
-  static uint32_t last_notification_uid = 0xffffffff;
+  // Latency counts from the Notification Source event, attribute fetch included
+  uint32_t timestamp = notif->source.timestamp;
   LOG_INF("New Notification:");
   LOG_INF("  UID: 0x%x", notif->source.notification_uid);
   LOG_INF("  App ID: %s", notif->app_identifier);
@@ -57,43 +66,96 @@ void on_new_notification(const struct ancs_notification *notif) {
   LOG_INF("  Date: %s", notif->date);
   LOG_INF("  Positive Action: %s", notif->positive_action_label);
 
-  if (last_notification_uid == notif->source.notification_uid) {
-    LOG_INF("Duplicate notification UID, ignoring");
+  // The store keeps the text; the event carries a handle the UI releases
+  struct notif *handle;
+  int ret = notif_store_update(notif, &handle);
+  if (ret == -EALREADY) {
+    LOG_INF("Notification unchanged, ignoring");
+    return;
+  } else if (ret < 0) {
+    LOG_WRN("Can't store UID 0x%x (err %d)", notif->source.notification_uid, ret);
     return;
   }
 
-  last_notification_uid = notif->source.notification_uid;
-  // Send notification event to active watchface
-  input_event_t event = {.type = INPUT_EVENT_TYPE_NOTIFICATION,
-                         .code = INPUT_NOTIFICATION_NEW,
-                         .data = (void *)notif};
-  app_manager_handle_event(&event);
+  // Send notification event to active watchface, calls to the call overlay
+  bool is_call = notif_category(handle) == ANCS_CATEGORY_ID_INCOMING_CALL;
+  input_event_t event = {.type = is_call ? INPUT_EVENT_TYPE_CALL : INPUT_EVENT_TYPE_NOTIFICATION,
+                         .code = ret == 0 ? INPUT_NOTIFICATION_NEW : INPUT_NOTIFICATION_MODIFIED,
+                         .value = (int32_t)notif->source.notification_uid,
+                         .data = handle,
+                         .timestamp = timestamp};
+  if (ui_loop_post_event(&event) != 0) {
+    LOG_WRN("UI event queue full, dropping notification");
+    notif_store_put(handle);
+  }
+}
+
+static void on_event_done(input_event_t *ev) {
+  if ((ev->type == INPUT_EVENT_TYPE_NOTIFICATION || ev->type == INPUT_EVENT_TYPE_CALL) &&
+      ev->data != NULL) {
+    notif_store_put(ev->data);
+  }
 }
+
 void on_notification_removed(uint32_t uid) {
+  uint32_t timestamp = k_cycle_get_32();
   LOG_INF("Notification Removed: UID=0x%x", uid);
+
+  struct notif *removed = notif_store_get(uid);
+  if (removed == NULL) {
+    return;
+  }
+  bool is_call = notif_category(removed) == ANCS_CATEGORY_ID_INCOMING_CALL;
+  notif_store_put(removed);
+  notif_store_remove(uid);
+
+  input_event_t event = {.type = is_call ? INPUT_EVENT_TYPE_CALL : INPUT_EVENT_TYPE_NOTIFICATION,
+                         .code = INPUT_NOTIFICATION_REMOVED,
+                         .value = (int32_t)uid,
+                         .timestamp = timestamp};
+  if (ui_loop_post_event(&event) != 0) {
+    LOG_WRN("UI event queue full, dropping removal");
+  }
 }
 struct ancs_callbacks ancs_cbs = {
     .on_new_notification = on_new_notification,
     .on_notification_removed = on_notification_removed,
+    .filter = notif_rules_filter,
 };
 
 int main(void) {
   LOG_INF("Starting Watchy Zephyr App with App Framework");
 
+  ui_loop_set_event_done_cb(on_event_done);
+
+#if defined(CONFIG_BT)
   // Initialize ANCS client
   ancs_client_init();
   ancs_register_cb(&ancs_cbs);
+#endif
 
   // Initialize button subsystem
   button_init();
   // init_net();
 
+  // Keep wall-clock time in software, re-reading the RTC only to correct drift
+  timekeeping_init();
+
   // Initialize LVGL display
   if (lvgl_display_init() < 0) {
     LOG_ERR("Failed to initialize display");
     return -1;
   }
 
+  // Route LVGL flushes through the refresh scheduler
+  epd_refresh_init();
+
+  // Draw compressed images a band of rows at a time
+  img_rle_decoder_init();
+
+  // Images and fonts flashed separately from the application
+  asset_bundle_init();
+
   // Register applications (launch segments watchface by default)
   app_manager_register(&SegmentsWatchfaceApp);
   // app_manager_register(&WatchfaceApp);
@@ -104,15 +166,11 @@ int main(void) {
   LOG_INF("Launching segments watchface app");
   app_manager_launch(0);
 
-  // Main event loop
-  while (1) {
-    LOG_DBG("Main loop tick");
-    uint32_t sleep_time = lv_timer_handler();
-    if (sleep_time >= 1000) {
-      sleep_time = 1000;
-    }
-    k_sleep(K_MSEC(sleep_time));
-  }
+  // Wake the UI once per minute from the RTC alarm instead of polling the RTC
+  time_tick_init();
+
+  // Main event loop: sleeps until an event, an LVGL timer or the display needs it
+  ui_loop_run();
 
   return 0;
 }
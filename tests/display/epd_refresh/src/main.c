@@ -0,0 +1,198 @@
+/**
+ * @file main.c
+ * @brief Tests of the e-paper refresh scheduler on the emulated panel
+ *
+ * LVGL renders into the epd_refresh framebuffer and the stock ssd16xx driver
+ * sends the updates to the SSD1681 emulator, which holds BUSY for as long as
+ * the waveforms take. The test thread stands in for the UI loop: it
+ * invalidates areas and renders them with lv_refr_now(), then compares the
+ * scheduler's counters with what the panel saw.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/ztest.h>
+
+#include "epd_refresh.h"
+#include "ssd16xx_emul.h"
+#include "ui_loop.h"
+
+/* As in epd_refresh.c */
+#ifndef CONFIG_EPD_REFRESH_GHOST_LIMIT
+#define CONFIG_EPD_REFRESH_GHOST_LIMIT 30
+#endif
+#ifndef CONFIG_EPD_REFRESH_FULL_WAIT_MS
+#define CONFIG_EPD_REFRESH_FULL_WAIT_MS 500
+#endif
+
+/* Full waveform time of the emulator binding */
+#define FULL_MS 2000
+
+#define PANEL_PX (200 * 200)
+
+static atomic_t display_done;
+
+void ui_loop_notify_display_done(void) { atomic_inc(&display_done); }
+
+/* Render @p area as the UI loop would after drawing into it */
+static void draw(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+  lv_area_t area = {x1, y1, x2, y2};
+
+  lv_obj_invalidate_area(lv_screen_active(), &area);
+  lv_refr_now(NULL);
+}
+
+/* Wait until the worker has sent everything and the panel is idle */
+static void settle(void) {
+  const struct emul *panel = ssd16xx_emul_get();
+  int idle = 0;
+
+  while (idle < 2) {
+    k_sleep(K_MSEC(50));
+    idle = ssd16xx_emul_is_busy(panel) ? 0 : idle + 1;
+  }
+}
+
+/* Full refresh pending: it runs once no frame comes within the wait */
+static void settle_full(void) {
+  k_sleep(K_MSEC(CONFIG_EPD_REFRESH_FULL_WAIT_MS + FULL_MS));
+  settle();
+}
+
+static void *setup(void) {
+  zassert_ok(epd_refresh_init());
+
+  // The first frame covers the whole screen
+  lv_obj_invalidate(lv_screen_active());
+  lv_refr_now(NULL);
+  settle();
+  return NULL;
+}
+
+static void before(void *fixture) {
+  ARG_UNUSED(fixture);
+
+  // Start every case from a clean panel and no ghosting
+  epd_refresh_request_full(EPD_FULL_REQUEST);
+  settle_full();
+  epd_refresh_reset_stats();
+  ssd16xx_emul_reset_stats(ssd16xx_emul_get());
+  atomic_clear(&display_done);
+}
+
+static void after(void *fixture) {
+  ARG_UNUSED(fixture);
+  struct ssd16xx_emul_stats panel;
+
+  ssd16xx_emul_get_stats(ssd16xx_emul_get(), &panel);
+  zassert_equal(panel.busy_errors, 0, "no command may be sent while BUSY is high");
+  zassert_equal(panel.ram_errors, 0);
+}
+
+ZTEST(epd_refresh, test_partial_area) {
+  struct epd_refresh_stats epd;
+  struct ssd16xx_emul_stats panel;
+
+  // 80x40 px, 10 bytes per row
+  draw(40, 64, 119, 103);
+  settle();
+
+  epd_refresh_get_stats(&epd);
+  zassert_equal(epd.flushes, 1);
+  zassert_equal(epd.partial, 1);
+  zassert_equal(epd.full, 0);
+  zassert_equal(epd.pixels, 80 * 40);
+  zassert_equal(epd.tx_bytes, 10 * 40);
+  zassert_equal(epd.max_tile, 1);
+
+  ssd16xx_emul_get_stats(ssd16xx_emul_get(), &panel);
+  zassert_equal(panel.partial, 1);
+  zassert_equal(panel.full, 0);
+  zassert_equal(panel.refreshed_px, 80 * 40, "only the dirty window is refreshed");
+  zassert_true(panel.ram_bytes >= 10 * 40);
+  zassert_true(atomic_get(&display_done) >= 1, "the UI loop must hear of the end");
+}
+
+ZTEST(epd_refresh, test_coalesce_while_busy) {
+  const struct emul *emul = ssd16xx_emul_get();
+  struct epd_refresh_stats epd;
+  struct ssd16xx_emul_stats panel;
+
+  draw(0, 0, 39, 39);
+  k_sleep(K_MSEC(20));
+  zassert_true(ssd16xx_emul_is_busy(emul), "the first update must be on the panel");
+
+  // Two frames during the waveform go out as one update of their bounding box
+  draw(80, 80, 119, 119);
+  draw(160, 160, 199, 199);
+  settle();
+
+  epd_refresh_get_stats(&epd);
+  zassert_equal(epd.flushes, 3);
+  zassert_equal(epd.coalesced, 1);
+  zassert_equal(epd.overlapped, 2);
+  zassert_equal(epd.partial, 2);
+  zassert_equal(epd.pixels, 40 * 40 + 120 * 120);
+
+  ssd16xx_emul_get_stats(emul, &panel);
+  zassert_equal(panel.partial, 2);
+  zassert_equal(panel.refreshed_px, 40 * 40 + 120 * 120);
+}
+
+ZTEST(epd_refresh, test_ghost_limit) {
+  struct epd_refresh_stats epd;
+  struct ssd16xx_emul_stats panel;
+
+  // The same tile over and over, each frame after the previous waveform
+  for (int i = 0; i < CONFIG_EPD_REFRESH_GHOST_LIMIT; i++) {
+    draw(40, 40, 79, 79);
+    settle();
+  }
+  settle_full();
+
+  epd_refresh_get_stats(&epd);
+  zassert_equal(epd.partial, CONFIG_EPD_REFRESH_GHOST_LIMIT);
+  zassert_equal(epd.full, 1, "the limit must force a full refresh");
+  zassert_equal(epd.full_reason[EPD_FULL_GHOSTING], 1);
+  zassert_equal(epd.max_tile, 0, "a full refresh clears the ghosting");
+
+  ssd16xx_emul_get_stats(ssd16xx_emul_get(), &panel);
+  zassert_equal(panel.partial, CONFIG_EPD_REFRESH_GHOST_LIMIT);
+  zassert_equal(panel.full, 1);
+  zassert_equal(panel.refreshed_px, CONFIG_EPD_REFRESH_GHOST_LIMIT * 40 * 40 + PANEL_PX);
+
+  // Back to partial refreshes
+  draw(40, 40, 79, 79);
+  settle();
+  epd_refresh_get_stats(&epd);
+  zassert_equal(epd.partial, CONFIG_EPD_REFRESH_GHOST_LIMIT + 1);
+  zassert_equal(epd.full, 1);
+}
+
+ZTEST(epd_refresh, test_hold) {
+  struct epd_refresh_stats epd;
+  struct ssd16xx_emul_stats panel;
+
+  // Frames rendered while held never reach the panel
+  epd_refresh_hold(true);
+  for (int i = 0; i < 3; i++) {
+    draw(40, 40, 79, 79);
+  }
+  epd_refresh_hold(false);
+  settle();
+
+  epd_refresh_get_stats(&epd);
+  zassert_equal(epd.flushes, 0);
+  zassert_equal(epd.max_tile, 0, "held frames add no ghosting");
+  ssd16xx_emul_get_stats(ssd16xx_emul_get(), &panel);
+  zassert_equal(panel.partial + panel.full, 0);
+
+  // Released, the area goes out once it is drawn again
+  draw(40, 40, 79, 79);
+  settle();
+  epd_refresh_get_stats(&epd);
+  zassert_equal(epd.flushes, 1);
+  zassert_equal(epd.partial, 1);
+}
+
+ZTEST_SUITE(epd_refresh, NULL, setup, before, after, NULL);
@@ -0,0 +1,264 @@
+/**
+ * @file main.c
+ * @brief Tests of the glyph cache
+ *
+ * A made-up source font draws every code point from 32 up as a box whose
+ * size and A4 levels follow from the letter, and counts how often it is
+ * asked. The cached font has to give the same glyphs back, thresholded to
+ * 1bpp, and only ask the source on a miss.
+ */
+
+#include <string.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include "glyph_cache.h"
+
+#define FIRST 32
+#define BIG 0x7E /* too large for a cache slot */
+#define KERN_NEXT 'V'
+#define LRU_FIRST 200 /* past BIG for a whole cache of letters */
+
+static int src_bitmaps;
+static uint8_t out[64 * 64] __aligned(LV_DRAW_BUF_ALIGN);
+static const lv_font_t *cached;
+static const lv_font_t *cached_kerned;
+static uint32_t capacity;
+
+static uint8_t level(uint32_t letter, uint32_t x, uint32_t y) {
+  return ((x * 7 + y * 13 + letter) * 37) & 0xFF;
+}
+
+static bool src_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter,
+                              uint32_t letter_next) {
+  if (letter < FIRST) {
+    return false;
+  }
+
+  memset(dsc, 0, sizeof(*dsc));
+  dsc->adv_w = 100 + letter;
+  if (font->kerning != LV_FONT_KERNING_NONE && letter_next == KERN_NEXT) {
+    dsc->adv_w -= 10;
+  }
+  dsc->box_w = letter == BIG ? 60 : 3 + letter % 13;
+  dsc->box_h = letter == BIG ? 60 : 5 + letter % 11;
+  dsc->ofs_x = -1;
+  dsc->ofs_y = -2;
+  dsc->format = LV_FONT_GLYPH_FORMAT_A4;
+  dsc->gid.index = letter;
+  return true;
+}
+
+static const void *src_get_glyph_bitmap(lv_font_glyph_dsc_t *dsc, lv_draw_buf_t *draw_buf) {
+  uint32_t letter = dsc->gid.index;
+
+  src_bitmaps++;
+  for (uint32_t y = 0; y < dsc->box_h; y++) {
+    for (uint32_t x = 0; x < dsc->box_w; x++) {
+      draw_buf->data[y * draw_buf->header.stride + x] = level(letter, x, y);
+    }
+  }
+  return draw_buf->data;
+}
+
+static const lv_font_t src = {
+    .get_glyph_dsc = src_get_glyph_dsc,
+    .get_glyph_bitmap = src_get_glyph_bitmap,
+    .line_height = 20,
+    .kerning = LV_FONT_KERNING_NONE,
+};
+
+static const lv_font_t src_kerned = {
+    .get_glyph_dsc = src_get_glyph_dsc,
+    .get_glyph_bitmap = src_get_glyph_bitmap,
+    .line_height = 20,
+    .kerning = LV_FONT_KERNING_NORMAL,
+};
+
+static void glyph(const lv_font_t *font, uint32_t letter, lv_font_glyph_dsc_t *dsc) {
+  zassert_true(font->get_glyph_dsc(font, dsc, letter, 0), "letter %u", letter);
+  dsc->resolved_font = font;
+}
+
+/* Draw a glyph into out, NULL if the cache skipped it */
+static const uint8_t *draw(lv_font_glyph_dsc_t *dsc, lv_draw_buf_t *buf) {
+  uint32_t stride = lv_draw_buf_width_to_stride(dsc->box_w, LV_COLOR_FORMAT_A8);
+
+  lv_draw_buf_init(buf, dsc->box_w, dsc->box_h, LV_COLOR_FORMAT_A8, stride, out, sizeof(out));
+  return dsc->resolved_font->get_glyph_bitmap(dsc, buf);
+}
+
+/* Look a glyph up and check it against the source, thresholded unless it is uncached */
+static void check(const lv_font_t *font, uint32_t letter, bool thresholded) {
+  lv_font_glyph_dsc_t dsc;
+  lv_draw_buf_t buf;
+  const uint8_t *a8;
+
+  glyph(font, letter, &dsc);
+  zassert_equal(dsc.adv_w, 100 + letter);
+  zassert_equal(dsc.ofs_x, -1);
+  zassert_equal(dsc.ofs_y, -2);
+
+  a8 = draw(&dsc, &buf);
+  zassert_not_null(a8, "letter %u", letter);
+  for (uint32_t y = 0; y < dsc.box_h; y++) {
+    for (uint32_t x = 0; x < dsc.box_w; x++) {
+      uint8_t want = level(letter, x, y);
+
+      if (thresholded) {
+        want = want >= 128 ? 0xFF : 0x00;
+      }
+      zassert_equal(a8[y * buf.header.stride + x], want, "letter %u at %u,%u", letter, x, y);
+    }
+  }
+}
+
+static void *setup(void) {
+  struct glyph_cache_stats stats;
+
+  cached = glyph_cache_wrap(&src);
+  cached_kerned = glyph_cache_wrap(&src_kerned);
+  glyph_cache_get_stats(&stats);
+  capacity = stats.capacity;
+  return NULL;
+}
+
+static void before(void *fixture) {
+  glyph_cache_flush();
+  glyph_cache_reset_stats();
+  src_bitmaps = 0;
+}
+
+ZTEST(glyph_cache, test_wrap) {
+  zassert_not_equal(cached, &src);
+  zassert_equal(glyph_cache_wrap(&src), cached, "wrapping again gives the same font");
+  zassert_not_equal(cached_kerned, cached);
+  zassert_equal(cached->line_height, src.line_height);
+  zassert_true(capacity > 0);
+}
+
+ZTEST(glyph_cache, test_hits) {
+  struct glyph_cache_stats stats;
+  lv_font_glyph_dsc_t dsc;
+
+  for (int pass = 0; pass < 3; pass++) {
+    for (uint32_t letter = FIRST; letter < FIRST + 50; letter++) {
+      check(cached, letter, true);
+    }
+  }
+
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.misses, 50);
+  zassert_equal(stats.hits, 100);
+  zassert_equal(stats.evictions, 0);
+  zassert_equal(stats.entries, 50);
+  zassert_equal(src_bitmaps, 50, "hits must not ask the source font");
+
+  // Unknown letters are not cached
+  zassert_false(cached->get_glyph_dsc(cached, &dsc, FIRST - 1, 0));
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.misses, 50);
+}
+
+ZTEST(glyph_cache, test_lru_order) {
+  struct glyph_cache_stats stats;
+  lv_font_glyph_dsc_t dsc;
+
+  for (uint32_t i = 0; i < capacity; i++) {
+    glyph(cached, LRU_FIRST + i, &dsc);
+  }
+  glyph(cached, LRU_FIRST, &dsc);
+
+  // The oldest glyph is now the second one, the first was just used
+  glyph(cached, LRU_FIRST + capacity, &dsc);
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.misses, capacity + 1);
+  zassert_equal(stats.hits, 1);
+  zassert_equal(stats.evictions, 1);
+  zassert_equal(stats.entries, capacity);
+
+  glyph(cached, LRU_FIRST, &dsc);
+  glyph(cached, LRU_FIRST + capacity, &dsc);
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.hits, 3, "the first and newest glyphs stay cached");
+  zassert_equal(stats.misses, capacity + 1);
+
+  check(cached, LRU_FIRST + 1, true);
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.misses, capacity + 2, "the second glyph was evicted");
+  zassert_equal(stats.evictions, 2);
+
+  // Going round more letters than slots misses every time
+  glyph_cache_reset_stats();
+  for (int pass = 0; pass < 2; pass++) {
+    for (uint32_t letter = 1000; letter < 1000 + capacity + 1; letter++) {
+      check(cached, letter, true);
+    }
+  }
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.hits, 0);
+  zassert_equal(stats.misses, 2 * (capacity + 1));
+}
+
+ZTEST(glyph_cache, test_bypass) {
+  struct glyph_cache_stats stats;
+
+  check(cached, BIG, false);
+  check(cached, BIG, false);
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.bypass, 2);
+  zassert_equal(stats.misses, 0);
+  zassert_equal(stats.entries, 0);
+  zassert_equal(src_bitmaps, 2, "the source font draws it every time");
+}
+
+ZTEST(glyph_cache, test_stale) {
+  struct glyph_cache_stats stats;
+  lv_font_glyph_dsc_t dsc;
+  lv_font_glyph_dsc_t other;
+  lv_draw_buf_t buf;
+
+  // The slot of the first glyph is reused before its bitmap is asked for
+  glyph(cached, 500, &dsc);
+  for (uint32_t i = 0; i < capacity; i++) {
+    glyph(cached, 600 + i, &other);
+  }
+  zassert_is_null(draw(&dsc, &buf));
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.stale, 1);
+
+  check(cached, 500, true);
+}
+
+ZTEST(glyph_cache, test_flush) {
+  struct glyph_cache_stats stats;
+
+  check(cached, 'A', true);
+  glyph_cache_flush();
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.entries, 0);
+
+  check(cached, 'A', true);
+  glyph_cache_get_stats(&stats);
+  zassert_equal(stats.misses, 2);
+  zassert_equal(stats.hits, 0);
+  zassert_equal(stats.entries, 1);
+}
+
+ZTEST(glyph_cache, test_kerning) {
+  lv_font_glyph_dsc_t dsc;
+
+  // The pair's advance is given on the miss and on the hit, the plain one after it
+  for (int pass = 0; pass < 2; pass++) {
+    zassert_true(cached_kerned->get_glyph_dsc(cached_kerned, &dsc, 'A', KERN_NEXT));
+    zassert_equal(dsc.adv_w, 100 + 'A' - 10, "pass %d", pass);
+    zassert_true(cached_kerned->get_glyph_dsc(cached_kerned, &dsc, 'A', 'x'));
+    zassert_equal(dsc.adv_w, 100 + 'A', "pass %d", pass);
+  }
+
+  // A font without kerning ignores the next letter
+  zassert_true(cached->get_glyph_dsc(cached, &dsc, 'A', KERN_NEXT));
+  zassert_equal(dsc.adv_w, 100 + 'A');
+}
+
+ZTEST_SUITE(glyph_cache, NULL, setup, before, NULL, NULL);
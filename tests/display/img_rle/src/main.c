@@ -0,0 +1,195 @@
+/**
+ * @file main.c
+ * @brief Tests of the run-length compressed 1bpp images
+ *
+ * The image is encoded here the way script/img_to_i1.py does it, from rows
+ * of solid runs and noise, then read back row by row, from any row, and
+ * through the LVGL decoder in bands.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include "img_rle.h"
+
+#define W 200
+#define H 37
+#define STRIDE DIV_ROUND_UP(W, 8)
+#define BLOCK_ROWS 8
+#define BLOCKS DIV_ROUND_UP(H, BLOCK_ROWS)
+
+static uint8_t pixels[H][STRIDE];
+static uint8_t data[8 + 4 + 4 * BLOCKS + H * (STRIDE + DIV_ROUND_UP(STRIDE, 2))];
+static lv_image_dsc_t img;
+
+/* PackBits-style codes of one row, as img_to_i1.py writes them */
+static size_t encode_row(const uint8_t *row, uint8_t *out) {
+  size_t n = 0;
+  size_t i = 0;
+
+  while (i < STRIDE) {
+    size_t run = 1;
+
+    while (i + run < STRIDE && run < 129 && row[i + run] == row[i]) {
+      run++;
+    }
+    if (run >= 2) {
+      out[n++] = run + 126;
+      out[n++] = row[i];
+      i += run;
+      continue;
+    }
+
+    size_t lit = 1;
+    while (i + lit < STRIDE && lit < 128 &&
+           !(i + lit + 1 < STRIDE && row[i + lit] == row[i + lit + 1])) {
+      lit++;
+    }
+    out[n++] = lit - 1;
+    memcpy(&out[n], &row[i], lit);
+    n += lit;
+    i += lit;
+  }
+  return n;
+}
+
+static void *setup(void) {
+  uint32_t seed = 12345;
+
+  // Solid bands, noise and a mix of both, so both code kinds show up
+  for (int y = 0; y < H; y++) {
+    for (int x = 0; x < STRIDE; x++) {
+      seed = seed * 1103515245 + 12345;
+      if (y % 3 == 0) {
+        pixels[y][x] = y % 2 ? 0xFF : 0x00;
+      } else if (y % 3 == 1 || x < STRIDE / 2) {
+        pixels[y][x] = seed >> 24;
+      } else {
+        pixels[y][x] = 0xAA;
+      }
+    }
+  }
+
+  // Palette: index 0 black, index 1 white
+  memset(data, 0, sizeof(data));
+  sys_put_le32(0xFF000000, &data[0]);
+  sys_put_le32(0xFFFFFFFF, &data[4]);
+  sys_put_le16(BLOCK_ROWS, &data[8]);
+  sys_put_le16(BLOCKS, &data[10]);
+
+  uint8_t *stream = &data[12 + 4 * BLOCKS];
+  size_t len = 0;
+  for (int y = 0; y < H; y++) {
+    if (y % BLOCK_ROWS == 0) {
+      sys_put_le32(len, &data[12 + 4 * (y / BLOCK_ROWS)]);
+    }
+    len += encode_row(pixels[y], &stream[len]);
+  }
+
+  img.header.magic = LV_IMAGE_HEADER_MAGIC;
+  img.header.cf = LV_COLOR_FORMAT_I1;
+  img.header.flags = IMG_RLE_FLAG;
+  img.header.w = W;
+  img.header.h = H;
+  img.header.stride = STRIDE;
+  img.data = data;
+  img.data_size = stream + len - data;
+
+  zassert_ok(img_rle_decoder_init());
+  return NULL;
+}
+
+ZTEST(img_rle, test_rows_in_order) {
+  struct img_rle_cursor cur;
+  uint8_t row[STRIDE];
+
+  zassert_true(img_rle_is_rle(&img));
+  zassert_ok(img_rle_seek(&cur, &img, 0));
+  for (int y = 0; y < H; y++) {
+    zassert_ok(img_rle_next_row(&cur, row), "row %d", y);
+    zassert_mem_equal(row, pixels[y], STRIDE, "row %d", y);
+  }
+  zassert_equal(img_rle_next_row(&cur, row), -EINVAL);
+}
+
+ZTEST(img_rle, test_seek_any_row) {
+  struct img_rle_cursor cur;
+  uint8_t row[STRIDE];
+
+  // Rows inside a block skip the ones above them
+  for (int y = H - 1; y >= 0; y--) {
+    zassert_ok(img_rle_seek(&cur, &img, y), "row %d", y);
+    zassert_equal(cur.row, y);
+    zassert_ok(img_rle_next_row(&cur, row), "row %d", y);
+    zassert_mem_equal(row, pixels[y], STRIDE, "row %d", y);
+  }
+}
+
+ZTEST(img_rle, test_invalid) {
+  struct img_rle_cursor cur;
+  uint8_t row[STRIDE];
+  lv_image_dsc_t bad = img;
+
+  zassert_equal(img_rle_seek(&cur, &img, -1), -EINVAL);
+  zassert_equal(img_rle_seek(&cur, &img, H), -EINVAL);
+
+  // An uncompressed image of the same format
+  bad.header.flags = 0;
+  zassert_false(img_rle_is_rle(&bad));
+  zassert_equal(img_rle_seek(&cur, &bad, 0), -EINVAL);
+
+  // Cut in the middle of the last row: the rows before it still decode
+  bad = img;
+  bad.data_size -= 2;
+  zassert_ok(img_rle_seek(&cur, &bad, H - 2));
+  zassert_ok(img_rle_next_row(&cur, row));
+  zassert_equal(img_rle_next_row(&cur, row), -EINVAL);
+
+  // Too short for the header
+  bad.data_size = 10;
+  zassert_equal(img_rle_seek(&cur, &bad, 0), -EINVAL);
+}
+
+ZTEST(img_rle, test_decoder_bands) {
+  // 194 columns make bands of 10 rows in the 2 KB scratch buffer
+  const lv_area_t area = {3, 5, 196, 30};
+  lv_area_t decoded = {LV_COORD_MIN, LV_COORD_MIN, LV_COORD_MIN, LV_COORD_MIN};
+  lv_image_decoder_dsc_t dsc;
+  int32_t next_y = area.y1;
+  int bands = 0;
+
+  zassert_equal(lv_image_decoder_open(&dsc, &img, NULL), LV_RESULT_OK);
+  zassert_is_null(dsc.decoded, "nothing is decoded up front");
+
+  while (lv_image_decoder_get_area(&dsc, &area, &decoded) == LV_RESULT_OK) {
+    const lv_draw_buf_t *band = dsc.decoded;
+
+    zassert_equal(decoded.x1, area.x1);
+    zassert_equal(decoded.x2, area.x2);
+    zassert_equal(decoded.y1, next_y, "bands must follow each other");
+    zassert_equal(band->header.cf, LV_COLOR_FORMAT_L8);
+
+    for (int32_t y = decoded.y1; y <= decoded.y2; y++) {
+      const uint8_t *out = band->data + (y - decoded.y1) * band->header.stride;
+
+      for (int32_t x = area.x1; x <= area.x2; x++) {
+        uint8_t want = pixels[y][x / 8] & BIT(7 - x % 8) ? 0xFF : 0x00;
+        zassert_equal(out[x - area.x1], want, "pixel %d,%d", x, y);
+      }
+    }
+    next_y = decoded.y2 + 1;
+    bands++;
+  }
+  zassert_equal(next_y, area.y2 + 1, "the bands must cover the area");
+  zassert_true(bands > 1);
+  lv_image_decoder_close(&dsc);
+
+  // The scratch buffer is free again
+  zassert_equal(lv_image_decoder_open(&dsc, &img, NULL), LV_RESULT_OK);
+  lv_image_decoder_close(&dsc);
+}
+
+ZTEST_SUITE(img_rle, NULL, setup, NULL, NULL, NULL);
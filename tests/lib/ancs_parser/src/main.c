@@ -0,0 +1,226 @@
+/**
+ * @file main.c
+ * @brief Tests of the streaming ANCS Data Source parser
+ *
+ * Responses are built as iOS sends them and fed whole, then cut at every
+ * fragment size from 1 byte up: the parsed notification must not depend on
+ * where the fragments end.
+ */
+
+#include <string.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include "ancs_parser.h"
+
+#define UID 0x11223344
+
+static struct ancs_parser parser;
+static struct ancs_notification slot;
+static uint32_t want_uid;
+static uint8_t num_attr;
+static int begins;
+static int dones;
+
+static struct ancs_notification *begin(uint32_t uid, uint8_t *n, void *user_data) {
+  ARG_UNUSED(user_data);
+
+  begins++;
+  *n = num_attr;
+  if (uid != want_uid) {
+    return NULL;
+  }
+  memset(&slot, 0, sizeof(slot));
+  slot.source.notification_uid = uid;
+  return &slot;
+}
+
+static void done(struct ancs_notification *notif, void *user_data) {
+  ARG_UNUSED(user_data);
+  zassert_equal(notif, &slot);
+  dones++;
+}
+
+static const struct ancs_parser_cb cb = {
+    .begin = begin,
+    .done = done,
+};
+
+static size_t put_attr(uint8_t *buf, uint8_t id, const char *value) {
+  size_t len = strlen(value);
+
+  buf[0] = id;
+  buf[1] = len & 0xFF;
+  buf[2] = len >> 8;
+  memcpy(&buf[3], value, len);
+  return 3 + len;
+}
+
+static size_t put_header(uint8_t *buf, uint32_t uid) {
+  buf[0] = 0; /* Get Notification Attributes */
+  buf[1] = uid & 0xFF;
+  buf[2] = (uid >> 8) & 0xFF;
+  buf[3] = (uid >> 16) & 0xFF;
+  buf[4] = uid >> 24;
+  return 5;
+}
+
+/* App identifier, title and message, the summary and message of a chat */
+static size_t put_response(uint8_t *buf, uint32_t uid, const char *message) {
+  size_t n = put_header(buf, uid);
+
+  n += put_attr(&buf[n], ANCS_ATTR_ID_APP_IDENTIFIER, "com.apple.MobileSMS");
+  n += put_attr(&buf[n], ANCS_ATTR_ID_TITLE, "Nguyễn Văn A");
+  n += put_attr(&buf[n], ANCS_ATTR_ID_MESSAGE, message);
+  return n;
+}
+
+static void feed_in(const uint8_t *buf, size_t len, size_t fragment) {
+  for (size_t i = 0; i < len; i += fragment) {
+    ancs_parser_feed(&parser, &buf[i], MIN(fragment, len - i));
+  }
+}
+
+static void before(void *fixture) {
+  ARG_UNUSED(fixture);
+  ancs_parser_init(&parser, &cb, NULL);
+  want_uid = UID;
+  num_attr = 3;
+  begins = 0;
+  dones = 0;
+}
+
+ZTEST(ancs_parser, test_whole_response) {
+  uint8_t buf[128];
+  size_t len = put_response(buf, UID, "Chiều nay đi cà phê không?");
+
+  ancs_parser_feed(&parser, buf, len);
+
+  zassert_equal(dones, 1);
+  zassert_equal(slot.source.notification_uid, UID);
+  zassert_str_equal(slot.app_identifier, "com.apple.MobileSMS");
+  zassert_str_equal(slot.title, "Nguyễn Văn A");
+  zassert_str_equal(slot.message, "Chiều nay đi cà phê không?");
+  zassert_equal(slot.attr_mask, BIT(ANCS_ATTR_ID_APP_IDENTIFIER) | BIT(ANCS_ATTR_ID_TITLE) |
+                                    BIT(ANCS_ATTR_ID_MESSAGE));
+  zassert_equal(parser.responses, 1);
+}
+
+ZTEST(ancs_parser, test_any_fragment_size) {
+  uint8_t buf[128];
+  size_t len = put_response(buf, UID, "Chiều nay đi cà phê không?");
+
+  for (size_t fragment = 1; fragment <= len; fragment++) {
+    dones = 0;
+    feed_in(buf, len, fragment);
+    zassert_equal(dones, 1, "fragment %u", fragment);
+    zassert_str_equal(slot.title, "Nguyễn Văn A", "fragment %u", fragment);
+    zassert_str_equal(slot.message, "Chiều nay đi cà phê không?", "fragment %u", fragment);
+  }
+}
+
+ZTEST(ancs_parser, test_long_value_cut_on_character) {
+  char message[CONFIG_ANCS_MESSAGE_MAX_LEN + 40];
+  uint8_t buf[sizeof(message) + 64];
+
+  // "ệ" is 3 bytes: 255 bytes of them leave a partial one at the end
+  message[0] = 'x';
+  for (size_t i = 1; i + 3 < sizeof(message); i += 3) {
+    memcpy(&message[i], "ệ", 3);
+    message[i + 3] = '\0';
+  }
+  size_t len = put_response(buf, UID, message);
+
+  feed_in(buf, len, 20);
+
+  zassert_equal(dones, 1);
+  zassert_equal(parser.truncated, 1);
+  zassert_equal(strlen(slot.message), 1 + (CONFIG_ANCS_MESSAGE_MAX_LEN - 1) / 3 * 3);
+  zassert_equal(ancs_utf8_whole(slot.message, strlen(slot.message)), strlen(slot.message));
+}
+
+ZTEST(ancs_parser, test_responses_back_to_back) {
+  uint8_t buf[256];
+  size_t len = put_response(buf, UID, "first");
+
+  len += put_response(&buf[len], UID, "second");
+  feed_in(buf, len, 7);
+
+  zassert_equal(dones, 2);
+  zassert_str_equal(slot.message, "second");
+}
+
+ZTEST(ancs_parser, test_unexpected_command_dropped) {
+  uint8_t buf[128];
+  size_t len = put_response(buf, UID, "after");
+  const uint8_t junk[] = {0x05, 0x00, 0x01, 0x02};
+
+  ancs_parser_feed(&parser, junk, sizeof(junk));
+  feed_in(buf, len, 20);
+
+  zassert_equal(parser.errors, 1);
+  zassert_equal(dones, 1);
+  zassert_str_equal(slot.message, "after");
+}
+
+ZTEST(ancs_parser, test_skipped_response_sized) {
+  uint8_t buf[256];
+  size_t len = put_response(buf, 0xAABBCCDD, "not requested");
+
+  // Skipped with its count known, the next response may start in the same
+  // fragment
+  len += put_response(&buf[len], UID, "requested");
+  feed_in(buf, len, 20);
+
+  zassert_equal(begins, 2);
+  zassert_equal(dones, 1);
+  zassert_equal(parser.skipped, 0);
+  zassert_str_equal(slot.message, "requested");
+  zassert_equal(parser.responses, 2);
+}
+
+static struct ancs_notification *begin_unknown(uint32_t uid, uint8_t *n, void *user_data) {
+  // No request for the UID: no attribute count either
+  if (uid != want_uid) {
+    begins++;
+    return NULL;
+  }
+  return begin(uid, n, user_data);
+}
+
+ZTEST(ancs_parser, test_unsized_response_skipped) {
+  static const struct ancs_parser_cb unknown_cb = {
+      .begin = begin_unknown,
+      .done = done,
+  };
+  uint8_t late[256];
+  uint8_t buf[128];
+  size_t late_len = put_response(late, 0xAABBCCDD, "late");
+  size_t len = put_response(buf, UID, "requested");
+
+  ancs_parser_init(&parser, &unknown_cb, NULL);
+  want_uid = UID;
+
+  // A late response in 20-byte fragments: its attributes, whose id 0 reads
+  // like a command byte, must not be taken for new responses
+  for (size_t i = 0; i < late_len; i += 20) {
+    ancs_parser_feed(&parser, &late[i], MIN(20, late_len - i));
+  }
+  zassert_equal(begins, 1);
+  zassert_equal(parser.skipped, 1);
+
+  feed_in(buf, len, 20);
+  zassert_equal(dones, 1);
+  zassert_str_equal(slot.app_identifier, "com.apple.MobileSMS");
+  zassert_str_equal(slot.message, "requested");
+}
+
+ZTEST(ancs_parser, test_utf8_whole) {
+  zassert_equal(ancs_utf8_whole("abc", 3), 3);
+  zassert_equal(ancs_utf8_whole("a\xe1\xbb", 3), 1);
+  zassert_equal(ancs_utf8_whole("a\xe1\xbb\x87", 4), 4);
+  zassert_equal(ancs_utf8_whole("a\xc3", 2), 1);
+  zassert_equal(ancs_utf8_whole("\xf0\x9f\x98", 3), 0);
+}
+
+ZTEST_SUITE(ancs_parser, NULL, NULL, before, NULL, NULL);
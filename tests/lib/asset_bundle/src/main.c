@@ -0,0 +1,205 @@
+/**
+ * @file main.c
+ * @brief Tests of the asset bundle index lookup
+ *
+ * A bundle of small images is packed here as script/pack_assets.py lays it
+ * out, written to the asset partition of the simulated flash and mapped by
+ * asset_bundle_init(). Lookups must find every name in about log2(count)
+ * probes, walk the entries sharing a hash and reject what is missing.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include "asset_bundle.h"
+
+#define ASSETS 40
+#define BLOB_ALIGN 16
+#define PIXELS 8
+
+/* An entry with the hash of "img_07", sorted before it */
+#define IMPOSTOR "alias"
+
+struct asset {
+  char name[16];
+  uint32_t hash;
+};
+
+static struct asset assets[ASSETS + 1];
+static uint8_t bundle[4096] __aligned(4);
+static size_t bundle_size;
+
+static int by_hash(const void *a, const void *b) {
+  const struct asset *x = a;
+  const struct asset *y = b;
+
+  if (x->hash != y->hash) {
+    return x->hash < y->hash ? -1 : 1;
+  }
+  return strcmp(x->name, y->name);
+}
+
+/* Pack the images img_00..img_39, each PIXELS bytes of its own number */
+static void pack(void) {
+  struct asset_bundle_header *hdr = (struct asset_bundle_header *)bundle;
+  struct asset_bundle_entry *index = (struct asset_bundle_entry *)(hdr + 1);
+  size_t count = ARRAY_SIZE(assets);
+
+  for (int i = 0; i < ASSETS; i++) {
+    snprintf(assets[i].name, sizeof(assets[i].name), "img_%02d", i);
+    assets[i].hash = asset_bundle_hash(assets[i].name);
+  }
+  strcpy(assets[ASSETS].name, IMPOSTOR);
+  assets[ASSETS].hash = asset_bundle_hash("img_07");
+  qsort(assets, count, sizeof(assets[0]), by_hash);
+
+  memset(bundle, 0, sizeof(bundle));
+  size_t pos = sizeof(*hdr) + count * sizeof(*index);
+  for (size_t i = 0; i < count; i++) {
+    index[i].hash = assets[i].hash;
+    index[i].name = pos;
+    index[i].name_len = strlen(assets[i].name);
+    memcpy(&bundle[pos], assets[i].name, index[i].name_len);
+    pos += index[i].name_len;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    lv_image_header_t header = {
+        .magic = LV_IMAGE_HEADER_MAGIC,
+        .cf = LV_COLOR_FORMAT_L8,
+        .w = PIXELS,
+        .h = 1,
+        .stride = PIXELS,
+    };
+
+    pos = ROUND_UP(pos, BLOB_ALIGN);
+    index[i].offset = pos;
+    index[i].size = sizeof(header) + PIXELS;
+    index[i].type = ASSET_TYPE_IMAGE;
+    memcpy(&bundle[pos], &header, sizeof(header));
+    memset(&bundle[pos + sizeof(header)], atoi(assets[i].name + 4), PIXELS);
+    pos += index[i].size;
+  }
+
+  bundle_size = pos;
+  zassert_true(bundle_size <= sizeof(bundle));
+  hdr->magic = ASSET_BUNDLE_MAGIC;
+  hdr->version = 1;
+  hdr->count = count;
+  hdr->size = bundle_size;
+  hdr->crc32 = crc32_ieee(bundle + sizeof(*hdr), bundle_size - sizeof(*hdr));
+}
+
+static void write_partition(const uint8_t *data, size_t size) {
+  const struct flash_area *fa;
+
+  zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &fa));
+  zassert_ok(flash_area_erase(fa, 0, ROUND_UP(size, 4096)));
+  zassert_ok(flash_area_write(fa, 0, data, size));
+  flash_area_close(fa);
+}
+
+static void *setup(void) {
+  pack();
+  write_partition(bundle, bundle_size);
+  zassert_ok(asset_bundle_init());
+  return NULL;
+}
+
+ZTEST(asset_bundle, test_find_all) {
+  struct asset_bundle_stats before;
+  struct asset_bundle_stats after;
+  char name[16];
+
+  asset_bundle_get_stats(&before);
+  for (int i = 0; i < ASSETS; i++) {
+    snprintf(name, sizeof(name), "img_%02d", i);
+
+    const struct asset_bundle_entry *e = asset_bundle_find(name);
+    zassert_not_null(e, "%s", name);
+    zassert_equal(e->hash, asset_bundle_hash(name));
+    zassert_equal(e->type, ASSET_TYPE_IMAGE);
+    zassert_equal(e->offset % BLOB_ALIGN, 0);
+  }
+  asset_bundle_get_stats(&after);
+
+  // Binary search of 41 entries plus the names of the hash: at most 6 + 2
+  zassert_equal(after.lookups - before.lookups, ASSETS);
+  zassert_equal(after.misses, before.misses);
+  zassert_true(after.probes - before.probes <= ASSETS * 8, "%u probes",
+               after.probes - before.probes);
+}
+
+ZTEST(asset_bundle, test_shared_hash) {
+  const struct asset_bundle_entry *e = asset_bundle_find("img_07");
+
+  // Both entries carry the hash, only one the name
+  zassert_not_null(e);
+  zassert_equal(e->name_len, strlen("img_07"));
+
+  const lv_image_dsc_t *img = asset_bundle_image("img_07");
+  zassert_not_null(img);
+  zassert_equal(img->data[0], 7);
+
+  // The impostor is only found by its own name, under another hash
+  zassert_is_null(asset_bundle_find(IMPOSTOR));
+}
+
+ZTEST(asset_bundle, test_missing) {
+  struct asset_bundle_stats before;
+  struct asset_bundle_stats after;
+
+  asset_bundle_get_stats(&before);
+  zassert_is_null(asset_bundle_find("img_40"));
+  zassert_is_null(asset_bundle_find("img_0"));
+  zassert_is_null(asset_bundle_find("img_000"));
+  zassert_is_null(asset_bundle_find(""));
+  zassert_is_null(asset_bundle_image("no_such_asset"));
+  asset_bundle_get_stats(&after);
+
+  zassert_equal(after.misses - before.misses, 5);
+}
+
+ZTEST(asset_bundle, test_image) {
+  const lv_image_dsc_t *img = asset_bundle_image("img_23");
+
+  zassert_not_null(img);
+  zassert_equal(img->header.w, PIXELS);
+  zassert_equal(img->header.h, 1);
+  zassert_equal(img->data_size, PIXELS);
+  for (int i = 0; i < PIXELS; i++) {
+    zassert_equal(img->data[i], 23);
+  }
+
+  // Built once, then the same descriptor
+  zassert_equal(asset_bundle_image("img_23"), img);
+
+  // Not a font
+  zassert_is_null(asset_bundle_font("img_23"));
+}
+
+ZTEST(asset_bundle, test_bad_bundle) {
+  struct asset_bundle_header *hdr = (struct asset_bundle_header *)bundle;
+
+  bundle[bundle_size - 1] ^= 0xFF;
+  write_partition(bundle, bundle_size);
+  zassert_equal(asset_bundle_init(), -EBADMSG);
+  bundle[bundle_size - 1] ^= 0xFF;
+
+  hdr->magic = 0xFFFFFFFF;
+  write_partition(bundle, bundle_size);
+  zassert_equal(asset_bundle_init(), -ENOENT);
+  hdr->magic = ASSET_BUNDLE_MAGIC;
+
+  // Leave the good bundle for the other tests
+  write_partition(bundle, bundle_size);
+  zassert_ok(asset_bundle_init());
+}
+
+ZTEST_SUITE(asset_bundle, NULL, setup, NULL, NULL, NULL);
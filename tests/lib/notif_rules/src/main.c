@@ -0,0 +1,91 @@
+/**
+ * @file main.c
+ * @brief Tests of the notification fetch rules
+ *
+ * Each case is asked twice like the ANCS client does: first without the app
+ * identifier, then with it when the first answer was ANCS_FILTER_NEED_APP.
+ */
+
+#include <stddef.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include "notif_rules.h"
+
+static ancs_filter_t filter(uint8_t category, uint8_t flags, const char *app_id) {
+  struct ancs_notification_source src = {
+      .event_id = ANCS_EVENT_ID_NOTIFICATION_ADDED,
+      .event_flags = flags,
+      .category_id = category,
+      .notification_uid = 1,
+  };
+  ancs_filter_t first = notif_rules_filter(&src, NULL);
+
+  return first == ANCS_FILTER_NEED_APP ? notif_rules_filter(&src, app_id) : first;
+}
+
+ZTEST(notif_rules, test_calls_in_full) {
+  zassert_equal(filter(ANCS_CATEGORY_ID_INCOMING_CALL, 0, "com.apple.mobilephone"),
+                ANCS_FILTER_FULL);
+  zassert_equal(filter(ANCS_CATEGORY_ID_MISSED_CALL, 0, "com.apple.mobilephone"),
+                ANCS_FILTER_FULL);
+
+  // Even when they were already on the phone or silent
+  zassert_equal(filter(ANCS_CATEGORY_ID_INCOMING_CALL, ANCS_EVENT_FLAG_PRE_EXISTING, "x"),
+                ANCS_FILTER_FULL);
+  zassert_equal(filter(ANCS_CATEGORY_ID_MISSED_CALL, ANCS_EVENT_FLAG_SILENT, "x"),
+                ANCS_FILTER_FULL);
+}
+
+ZTEST(notif_rules, test_decided_without_app) {
+  struct ancs_notification_source src = {.category_id = ANCS_CATEGORY_ID_SOCIAL};
+
+  // Category rules come before the app rules, no need to fetch the app first
+  zassert_equal(notif_rules_filter(&src, NULL), ANCS_FILTER_FULL);
+  src.category_id = ANCS_CATEGORY_ID_SCHEDULE;
+  zassert_equal(notif_rules_filter(&src, NULL), ANCS_FILTER_FULL);
+  src.event_flags = ANCS_EVENT_FLAG_PRE_EXISTING;
+  zassert_equal(notif_rules_filter(&src, NULL), ANCS_FILTER_SUMMARY);
+}
+
+ZTEST(notif_rules, test_need_app) {
+  struct ancs_notification_source src = {.category_id = ANCS_CATEGORY_ID_OTHER};
+
+  zassert_equal(notif_rules_filter(&src, NULL), ANCS_FILTER_NEED_APP);
+  src.category_id = ANCS_CATEGORY_ID_EMAIL;
+  zassert_equal(notif_rules_filter(&src, NULL), ANCS_FILTER_NEED_APP);
+}
+
+ZTEST(notif_rules, test_messaging_apps) {
+  static const char *const apps[] = {
+      "com.apple.MobileSMS",  "net.whatsapp.WhatsApp", "com.facebook.Messenger",
+      "ph.telegra.Telegraph", "com.vng.zalo",
+  };
+
+  for (size_t i = 0; i < ARRAY_SIZE(apps); i++) {
+    zassert_equal(filter(ANCS_CATEGORY_ID_OTHER, 0, apps[i]), ANCS_FILTER_FULL, "%s", apps[i]);
+    zassert_equal(filter(ANCS_CATEGORY_ID_NEWS, ANCS_EVENT_FLAG_IMPORTANT, apps[i]),
+                  ANCS_FILTER_FULL, "%s", apps[i]);
+  }
+
+  // Exact identifiers only
+  zassert_equal(filter(ANCS_CATEGORY_ID_OTHER, 0, "com.apple.mobilesms"), ANCS_FILTER_SUMMARY);
+  zassert_equal(filter(ANCS_CATEGORY_ID_OTHER, 0, "com.vng.zalo.extra"), ANCS_FILTER_SUMMARY);
+}
+
+ZTEST(notif_rules, test_quiet_messages) {
+  // Pre-existing and silent notifications are only listed, whatever the app
+  zassert_equal(filter(ANCS_CATEGORY_ID_SOCIAL, ANCS_EVENT_FLAG_PRE_EXISTING, "com.vng.zalo"),
+                ANCS_FILTER_SUMMARY);
+  zassert_equal(filter(ANCS_CATEGORY_ID_OTHER, ANCS_EVENT_FLAG_SILENT, "com.apple.MobileSMS"),
+                ANCS_FILTER_SUMMARY);
+}
+
+ZTEST(notif_rules, test_default_summary) {
+  zassert_equal(filter(ANCS_CATEGORY_ID_NEWS, 0, "com.example.news"), ANCS_FILTER_SUMMARY);
+  zassert_equal(filter(ANCS_CATEGORY_ID_EMAIL, ANCS_EVENT_FLAG_IMPORTANT, "com.google.Gmail"),
+                ANCS_FILTER_SUMMARY);
+  zassert_equal(filter(ANCS_CATEGORY_ID_OTHER, 0, ""), ANCS_FILTER_SUMMARY);
+}
+
+ZTEST_SUITE(notif_rules, NULL, NULL, NULL, NULL, NULL);
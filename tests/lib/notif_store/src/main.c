@@ -0,0 +1,252 @@
+/**
+ * @file main.c
+ * @brief Tests of the notification store
+ *
+ * The store keeps its records in static RAM, each test starts by removing
+ * the UIDs the previous one left. Sizes are those of the default arena and
+ * index, the budget of the two struct ancs_notification the store replaced.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/ztest.h>
+
+#include "notif_store.h"
+
+#define UIDS 256
+
+/* A chat message as Messages sends it, 40 characters of text */
+#define CHAT_APP "com.apple.MobileSMS"
+#define CHAT_TEXT "See you at the station at half past six!"
+#define CHAT_DATE "20261016T093000"
+
+static struct ancs_notification src;
+
+static void make(uint32_t uid, const char *title, const char *message) {
+  memset(&src, 0, sizeof(src));
+  src.source.notification_uid = uid;
+  src.source.category_id = ANCS_CATEGORY_ID_SOCIAL;
+  src.attr_mask = BIT(ANCS_ATTR_ID_APP_IDENTIFIER) | BIT(ANCS_ATTR_ID_TITLE) |
+                  BIT(ANCS_ATTR_ID_MESSAGE) | BIT(ANCS_ATTR_ID_DATE);
+  strcpy(src.app_identifier, CHAT_APP);
+  strcpy(src.title, title);
+  strcpy(src.message, message);
+  strcpy(src.date, CHAT_DATE);
+}
+
+static int add(uint32_t uid, const char *title, const char *message) {
+  make(uid, title, message);
+  return notif_store_update(&src, NULL);
+}
+
+static void before(void *fixture) {
+  ARG_UNUSED(fixture);
+
+  for (uint32_t uid = 0; uid < UIDS; uid++) {
+    notif_store_remove(uid);
+  }
+  notif_store_reset_stats();
+}
+
+ZTEST(notif_store, test_add_get) {
+  struct notif *n;
+
+  zassert_equal(add(1, "Alice", CHAT_TEXT), 0);
+
+  n = notif_store_get(1);
+  zassert_not_null(n);
+  zassert_equal(notif_uid(n), 1);
+  zassert_equal(notif_category(n), ANCS_CATEGORY_ID_SOCIAL);
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_APP_ID), CHAT_APP);
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_TITLE), "Alice");
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_MESSAGE), CHAT_TEXT);
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_SUBTITLE), "");
+  zassert_true(notif_fetched(n, NOTIF_ATTR_MESSAGE));
+  zassert_false(notif_fetched(n, NOTIF_ATTR_SUBTITLE));
+  notif_store_put(n);
+
+  zassert_is_null(notif_store_get(2));
+}
+
+ZTEST(notif_store, test_modify) {
+  struct notif *old;
+  struct notif *n;
+
+  zassert_equal(add(1, "Alice", CHAT_TEXT), 0);
+  old = notif_store_get(1);
+
+  zassert_equal(add(1, "Alice", CHAT_TEXT), -EALREADY);
+  zassert_equal(add(1, "Alice", "On my way"), 1);
+
+  // The held record keeps the text it had
+  n = notif_store_get(1);
+  zassert_not_equal(n, old);
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_MESSAGE), "On my way");
+  zassert_str_equal(notif_text(old, NOTIF_ATTR_MESSAGE), CHAT_TEXT);
+  notif_store_put(n);
+  notif_store_put(old);
+
+  struct notif_store_stats stats;
+  notif_store_get_stats(&stats);
+  zassert_equal(stats.added, 1);
+  zassert_equal(stats.modified, 1);
+  zassert_equal(stats.unchanged, 1);
+}
+
+ZTEST(notif_store, test_complete_details) {
+  struct notif *n;
+
+  // Summary first, the message is asked for later
+  make(1, "Alice", "");
+  src.attr_mask &= ~BIT(ANCS_ATTR_ID_MESSAGE);
+  zassert_equal(notif_store_update(&src, NULL), 0);
+
+  memset(&src, 0, sizeof(src));
+  src.source.notification_uid = 1;
+  src.attr_mask = BIT(ANCS_ATTR_ID_MESSAGE);
+  strcpy(src.message, CHAT_TEXT);
+  zassert_equal(notif_store_update(&src, &n), 1);
+
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_APP_ID), CHAT_APP);
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_TITLE), "Alice");
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_MESSAGE), CHAT_TEXT);
+  zassert_equal(notif_category(n), ANCS_CATEGORY_ID_SOCIAL);
+  zassert_true(notif_fetched(n, NOTIF_ATTR_MESSAGE));
+  notif_store_put(n);
+
+  // Details of a notification that is not stored
+  src.source.notification_uid = 2;
+  zassert_equal(notif_store_update(&src, NULL), -ENOENT);
+}
+
+ZTEST(notif_store, test_remove_held) {
+  struct notif *n;
+
+  zassert_equal(add(1, "Alice", CHAT_TEXT), 0);
+  n = notif_store_get(1);
+
+  zassert_ok(notif_store_remove(1));
+  zassert_equal(notif_store_remove(1), -ENOENT);
+  zassert_is_null(notif_store_get(1));
+  zassert_str_equal(notif_text(n, NOTIF_ATTR_MESSAGE), CHAT_TEXT);
+  notif_store_put(n);
+}
+
+ZTEST(notif_store, test_newest) {
+  struct notif *n;
+
+  zassert_is_null(notif_store_newest());
+
+  zassert_equal(add(1, "Alice", CHAT_TEXT), 0);
+  zassert_equal(add(2, "Bob", CHAT_TEXT), 0);
+  n = notif_store_newest();
+  zassert_equal(notif_uid(n), 2);
+  notif_store_put(n);
+
+  zassert_equal(add(1, "Alice", "On my way"), 1);
+  n = notif_store_newest();
+  zassert_equal(notif_uid(n), 1);
+  notif_store_put(n);
+}
+
+ZTEST(notif_store, test_capacity) {
+  struct notif_store_stats stats;
+  struct notif *n;
+  int fit = 0;
+
+  zassert_equal(strlen(CHAT_TEXT), 40);
+
+  // A 28-byte header and 4 strings, rounded up to 4 bytes
+  zassert_equal(add(0, "Alice", CHAT_TEXT), 0);
+  notif_store_get_stats(&stats);
+  zassert_equal(stats.used, 112);
+  zassert_equal(stats.capacity, 1024);
+  zassert_equal(stats.slots, 16);
+
+  for (uint32_t uid = 1; uid < UIDS; uid++) {
+    zassert_equal(add(uid, "Alice", CHAT_TEXT), 0);
+    notif_store_get_stats(&stats);
+    if (stats.evicted > 0) {
+      break;
+    }
+    fit = stats.count;
+  }
+  zassert_equal(fit, 9, "a 1 KB arena holds 9 chat messages");
+
+  // The oldest went first
+  zassert_is_null(notif_store_get(0));
+  n = notif_store_get(9);
+  zassert_not_null(n);
+  notif_store_put(n);
+}
+
+ZTEST(notif_store, test_slots_full) {
+  struct notif_store_stats stats;
+
+  // Records of 32 bytes run out of index slots before arena bytes
+  for (uint32_t uid = 0; uid < 20; uid++) {
+    make(uid, "", "");
+    src.attr_mask = BIT(ANCS_ATTR_ID_APP_IDENTIFIER);
+    strcpy(src.app_identifier, "a");
+    zassert_equal(notif_store_update(&src, NULL), 0);
+  }
+  notif_store_get_stats(&stats);
+  zassert_equal(stats.count, 16);
+  zassert_equal(stats.evicted, 4);
+  zassert_is_null(notif_store_get(3));
+
+  struct notif *n = notif_store_get(4);
+  zassert_not_null(n);
+  notif_store_put(n);
+}
+
+ZTEST(notif_store, test_held_oldest) {
+  struct notif_store_stats stats;
+  struct notif *held;
+  uint32_t uid;
+
+  zassert_equal(add(0, "Alice", CHAT_TEXT), 0);
+  held = notif_store_get(0);
+
+  // Nothing behind a held record can be reclaimed
+  for (uid = 1; uid < UIDS; uid++) {
+    int ret = add(uid, "Alice", CHAT_TEXT);
+    if (ret != 0) {
+      zassert_equal(ret, -ENOMEM);
+      break;
+    }
+  }
+  zassert_true(uid < UIDS);
+  notif_store_get_stats(&stats);
+  zassert_equal(stats.dropped, 1);
+  zassert_str_equal(notif_text(held, NOTIF_ATTR_MESSAGE), CHAT_TEXT);
+
+  notif_store_put(held);
+  zassert_equal(add(uid, "Alice", CHAT_TEXT), 0);
+  zassert_is_null(notif_store_get(0));
+}
+
+ZTEST(notif_store, test_wrap) {
+  char message[64];
+
+  // Records of varying size wrap around the arena many times
+  for (uint32_t i = 0; i < 500; i++) {
+    snprintf(message, sizeof(message), "%.*s", (int)(i * 7 % 60), CHAT_TEXT CHAT_TEXT);
+    zassert_true(add(i % UIDS, "Alice", message) >= 0);
+
+    struct notif *n = notif_store_get(i % UIDS);
+    zassert_not_null(n);
+    zassert_str_equal(notif_text(n, NOTIF_ATTR_MESSAGE), message);
+    notif_store_put(n);
+  }
+
+  struct notif_store_stats stats;
+  notif_store_get_stats(&stats);
+  zassert_true(stats.used <= stats.capacity);
+  zassert_equal(stats.held, 0);
+  zassert_equal(stats.dropped, 0);
+}
+
+ZTEST_SUITE(notif_store, NULL, NULL, before, NULL, NULL);
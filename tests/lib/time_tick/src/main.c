@@ -0,0 +1,160 @@
+/**
+ * @file main.c
+ * @brief Tests of the minute tick on the emulated PCF8563
+ *
+ * The stock PCF8563 driver talks to the register-level emulator, whose
+ * minute alarm pulls INT low; time_tick re-arms it on every tick. The UI
+ * loop is replaced by a stub counting the tick events, and simulated time
+ * runs as fast as the host allows. Without CONFIG_RTC_ALARM the same cases
+ * run on the kernel timer fallback.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/ztest.h>
+
+#include "app_interface.h"
+#include "pcf8563_emul.h"
+#include "time_tick.h"
+#include "ui_loop.h"
+
+/* Sunday 2024-03-31 00:59:00 UTC, a minute boundary */
+#define T0 1711846740
+
+static atomic_t ticks;
+static atomic_t off_minute; /* Ticks not posted in the first second of a minute */
+static atomic_t strays;     /* Events other than the period tick */
+static atomic_t last_value;
+
+int ui_loop_post_event(const input_event_t *ev) {
+  // Posted from the alarm callback, count here and assert in the test thread
+  if (ev->type != INPUT_EVENT_TYPE_TICK || ev->code != INPUT_TICK_PERIOD) {
+    atomic_inc(&strays);
+    return 0;
+  }
+  if (pcf8563_emul_get_time(pcf8563_emul_get()) % 60 != 0) {
+    atomic_inc(&off_minute);
+  }
+  atomic_set(&last_value, ev->value);
+  atomic_inc(&ticks);
+  return 0;
+}
+
+static void *setup(void) {
+  pcf8563_emul_set_time(pcf8563_emul_get(), T0 - 5);
+  zassert_ok(time_tick_init());
+  return NULL;
+}
+
+static void before(void *fixture) {
+  ARG_UNUSED(fixture);
+  const struct emul *rtc = pcf8563_emul_get();
+
+  zassert_ok(time_tick_set_period(1));
+  pcf8563_emul_set_drift(rtc, 0);
+  // Let the re-arm for the new period settle before counting
+  k_sleep(K_MSEC(100));
+  atomic_clear(&ticks);
+  atomic_clear(&off_minute);
+  atomic_clear(&strays);
+  pcf8563_emul_reset_stats(rtc);
+}
+
+static void after(void *fixture) {
+  ARG_UNUSED(fixture);
+  zassert_equal(atomic_get(&strays), 0, "only period ticks may be posted");
+}
+
+/* Sleep until the RTC is @p s seconds past its next minute */
+static void sleep_past_minute(int s) {
+  time_t now = pcf8563_emul_get_time(pcf8563_emul_get());
+
+  k_sleep(K_SECONDS(60 - now % 60 + s));
+}
+
+ZTEST(time_tick, test_one_tick_per_minute) {
+  struct pcf8563_emul_stats stats;
+
+  sleep_past_minute(1);
+  atomic_clear(&ticks);
+  atomic_clear(&off_minute);
+
+  atomic_val_t first = atomic_get(&last_value);
+
+  for (int minute = 1; minute <= 10; minute++) {
+    k_sleep(K_SECONDS(60));
+    zassert_equal(atomic_get(&ticks), minute, "after %d minutes", minute);
+  }
+  zassert_equal(atomic_get(&off_minute), 0);
+  zassert_equal(atomic_get(&last_value) - first, 10, "tick values must count up by one");
+
+  // One alarm and one INT assertion per tick, no extra wake-ups
+  pcf8563_emul_get_stats(pcf8563_emul_get(), &stats);
+  zassert_equal(stats.alarms, IS_ENABLED(CONFIG_RTC_ALARM) ? 11 : 0);
+  zassert_equal(stats.irqs, IS_ENABLED(CONFIG_RTC_ALARM) ? 11 : 0);
+}
+
+ZTEST(time_tick, test_no_tick_before_minute) {
+  const struct emul *rtc = pcf8563_emul_get();
+  time_t now = pcf8563_emul_get_time(rtc);
+
+  // Half a minute in, then 25 s: still the same minute
+  k_sleep(K_SECONDS(60 - now % 60 + 30));
+  atomic_clear(&ticks);
+  k_sleep(K_SECONDS(25));
+  zassert_equal(atomic_get(&ticks), 0);
+
+  k_sleep(K_SECONDS(10));
+  zassert_equal(atomic_get(&ticks), 1);
+}
+
+ZTEST(time_tick, test_period_five_minutes) {
+  zassert_ok(time_tick_set_period(5));
+  zassert_equal(time_tick_get_period(), 5);
+  k_sleep(K_MSEC(100));
+
+  // Start right after a 5 minute boundary
+  time_t now = pcf8563_emul_get_time(pcf8563_emul_get());
+  k_sleep(K_SECONDS(300 - now % 300 + 1));
+  atomic_clear(&ticks);
+
+  k_sleep(K_SECONDS(15 * 60));
+  zassert_equal(atomic_get(&ticks), 3);
+  zassert_equal(atomic_get(&off_minute), 0);
+
+  zassert_equal(time_tick_set_period(7), -EINVAL);
+}
+
+ZTEST(time_tick, test_fast_rtc) {
+  // The tick follows the RTC minute, not the kernel clock
+  pcf8563_emul_set_drift(pcf8563_emul_get(), 20000);
+  // Past the second or two the kernel timer ticks late by
+  sleep_past_minute(5);
+  atomic_clear(&ticks);
+
+  k_sleep(K_SECONDS(5 * 60));
+  zassert_equal(atomic_get(&ticks), 5);
+  if (IS_ENABLED(CONFIG_RTC_ALARM)) {
+    // The kernel timer realigns a second or so after the boundary
+    zassert_equal(atomic_get(&off_minute), 0);
+  }
+}
+
+ZTEST(time_tick, test_slow_rtc) {
+  const int32_t ppm = -20000;
+
+  // The kernel timer fires before the RTC gets to mm:00 and reads mm:58 or
+  // mm:59, which must not schedule a second tick for the same minute
+  pcf8563_emul_set_drift(pcf8563_emul_get(), ppm);
+  sleep_past_minute(5);
+  atomic_clear(&ticks);
+
+  // Ten RTC minutes
+  k_sleep(K_MSEC(10 * 60 * MSEC_PER_SEC * 1000000LL / (1000000 + ppm)));
+  zassert_equal(atomic_get(&ticks), 10);
+  if (IS_ENABLED(CONFIG_RTC_ALARM)) {
+    zassert_equal(atomic_get(&off_minute), 0);
+  }
+}
+
+ZTEST_SUITE(time_tick, NULL, setup, before, after, NULL);
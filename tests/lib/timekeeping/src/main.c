@@ -0,0 +1,103 @@
+/**
+ * @file main.c
+ * @brief Tests of the RTC synchronization on the emulated PCF8563
+ *
+ * The software clock is checked against the emulated RTC, whose seconds
+ * start on the uptime at which it was set, across syncs and time steps
+ * hours of simulated time apart.
+ */
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "pcf8563_emul.h"
+#include "timekeeping.h"
+
+/* Sunday 2024-03-31 00:59:00 UTC, the seconds register reads 0 */
+#define T0 1711846740
+
+/* As in timekeeping.c */
+#ifndef CONFIG_TIMEKEEPING_SYNC_INTERVAL_MIN
+#define CONFIG_TIMEKEEPING_SYNC_INTERVAL_MIN 360
+#endif
+
+/* Edge search resolution plus the kernel tick */
+#define TOLERANCE_MS 30
+
+static time_t set_time;
+static int64_t set_uptime;
+
+/* Set the emulated RTC behind the service's back */
+static void set_rtc(time_t unix_s) {
+  pcf8563_emul_set_time(pcf8563_emul_get(), unix_s);
+  set_time = unix_s;
+  set_uptime = k_uptime_get();
+}
+
+/* Software clock minus the RTC, to the millisecond */
+static int64_t clock_error_ms(void) {
+  int64_t rtc_ms = set_time * MSEC_PER_SEC + k_uptime_get() - set_uptime;
+
+  return timekeeping_now_ms() - rtc_ms;
+}
+
+static void *setup(void) {
+  set_rtc(T0);
+  zassert_ok(timekeeping_init());
+  return NULL;
+}
+
+static void before(void *fixture) {
+  ARG_UNUSED(fixture);
+
+  // Let any edge search finish, it takes at most a second
+  k_sleep(K_MSEC(1200));
+}
+
+ZTEST(timekeeping, test_sync_on_edge) {
+  struct timekeeping_stats start;
+  struct timekeeping_stats end;
+
+  set_rtc(T0 + 100);
+  timekeeping_get_stats(&start);
+  timekeeping_sync();
+  k_sleep(K_MSEC(1500));
+
+  timekeeping_get_stats(&end);
+  zassert_equal(end.syncs, start.syncs + 1);
+  zassert_true(end.rtc_reads > start.rtc_reads + 1, "the edge is found by polling");
+  zassert_true(llabs(clock_error_ms()) <= TOLERANCE_MS, "error %lld ms",
+               (long long)clock_error_ms());
+}
+
+ZTEST(timekeeping, test_set_during_edge_search) {
+  const time_t set = T0 + 3600 + 30;
+  struct timekeeping_stats start;
+  struct timekeeping_stats end;
+
+  // Start a sync and set the time before the seconds register moves
+  set_rtc(T0);
+  timekeeping_get_stats(&start);
+  timekeeping_sync();
+  k_sleep(K_MSEC(50));
+  timekeeping_get_stats(&end);
+  zassert_true(end.rtc_reads > start.rtc_reads, "the edge search must be under way");
+
+  zassert_ok(timekeeping_set_utc(set));
+  set_time = set;
+  set_uptime = k_uptime_get();
+  zassert_true(llabs(clock_error_ms()) <= TOLERANCE_MS);
+
+  // The next sync is a fresh search, not the end of the one cut short
+  k_sleep(K_SECONDS(CONFIG_TIMEKEEPING_SYNC_INTERVAL_MIN * 60 + 2));
+  timekeeping_get_stats(&end);
+  zassert_equal(end.syncs, start.syncs + 1);
+  zassert_true(llabs(end.drift_ppb - start.drift_ppb) <= 1000, "the RTC does not drift");
+  zassert_true(llabs(end.last_error_ms) <= TOLERANCE_MS, "sync error %d ms",
+               end.last_error_ms);
+  zassert_true(llabs(clock_error_ms()) <= TOLERANCE_MS, "error %lld ms",
+               (long long)clock_error_ms());
+}
+
+ZTEST_SUITE(timekeeping, NULL, setup, before, NULL, NULL);